@@ -89,7 +89,8 @@ namespace lotus::incremental_convex_hull {
 			vertex_indices(vert_ids),
 			edges{ nullptr, nullptr, nullptr },
 			previous(face_id::invalid),
-			next(face_id::invalid) {
+			next(face_id::invalid),
+			marked(false) {
 		}
 
 		/// Returns the ID of the given vertex.
@@ -104,6 +105,8 @@ namespace lotus::incremental_convex_hull {
 		std::array<half_edge_ref, 3> edges{ uninitialized, uninitialized, uninitialized };
 		face_id previous; ///< Previous face. These form a circular doubly-linked list.
 		face_id next; ///< Next face. These form a circular doubly-linked list.
+		/// Used when adding a vertex to mark faces that are visible from the vertex and will be removed.
+		bool marked;
 	};
 	using face_entry = pool_entry<face, face_id>; ///< Pool entry type for a face.
 
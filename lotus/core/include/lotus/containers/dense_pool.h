@@ -0,0 +1,179 @@
+#pragma once
+
+/// \file
+/// Densely stored pools addressed by stable handles.
+
+#include <compare>
+#include <span>
+#include <vector>
+
+#include "lotus/common.h"
+#include "pool.h"
+
+namespace lotus {
+	/// A pool that stores all of its objects contiguously so that they can be iterated over like an array. Objects
+	/// are identified by handles that stay valid while the objects are moved around: when an object is freed, the
+	/// last object is moved into its place. Each slot of the handle table carries a generation that is incremented
+	/// when its object is freed, so that stale handles can be detected. Like \ref pool_manager, free slots form a
+	/// linked list.
+	template <typename T, typename Index = std::uint32_t> class dense_pool {
+	public:
+		using value_type = T; ///< Value type.
+		/// Index type used for both slots and positions in the dense array.
+		using index_type =
+			_details::pool_index_type<Index, std::is_integral_v<Index> && !std::is_enum_v<Index>>::type;
+		using iterator       = T*;       ///< Iterator type.
+		using const_iterator = const T*; ///< Const iterator type.
+
+		/// Identifies an object in the pool.
+		struct handle {
+			/// No initialization.
+			handle(uninitialized_t) {
+			}
+			/// Returns a handle that never refers to any object.
+			[[nodiscard]] constexpr static handle invalid() {
+				return handle(index_type::invalid, 0);
+			}
+
+			/// Default comparison.
+			friend std::strong_ordering operator<=>(const handle&, const handle&) = default;
+			/// Default equality.
+			friend bool operator==(const handle&, const handle&) = default;
+
+			index_type slot; ///< Index of the slot in the handle table.
+			std::uint32_t generation; ///< Generation of the slot when the object was allocated.
+		private:
+			friend dense_pool;
+
+			/// Initializes all fields of this struct.
+			constexpr handle(index_type s, std::uint32_t gen) : slot(s), generation(gen) {
+			}
+		};
+
+		/// Allocates a new object at the end of the dense array, and initializes it with the given arguments.
+		template <typename ...Args> std::pair<handle, value_type&> allocate(Args &&...args) {
+			index_type slot;
+			if (_head == index_type::invalid) {
+				slot = static_cast<index_type>(_slots.size());
+				_slots.emplace_back(index_type::invalid, 0);
+			} else {
+				slot = _head;
+				_head = _slots[std::to_underlying(slot)].index;
+			}
+			_slots[std::to_underlying(slot)].index = static_cast<index_type>(_objects.size());
+			value_type &obj = _objects.emplace_back(std::forward<Args>(args)...);
+			_object_slots.emplace_back(slot);
+			return { handle(slot, _slots[std::to_underlying(slot)].generation), obj };
+		}
+		/// Frees the given object. The last object in the dense array is moved into its place.
+		void free(handle h) {
+			crash_if(!is_valid(h));
+			_slot &s = _slots[std::to_underlying(h.slot)];
+			const auto index = std::to_underlying(s.index);
+			if (index + 1 < _objects.size()) {
+				_objects[index] = std::move(_objects.back());
+				_object_slots[index] = _object_slots.back();
+				_slots[std::to_underlying(_object_slots[index])].index = s.index;
+			}
+			_objects.pop_back();
+			_object_slots.pop_back();
+			s.index = std::exchange(_head, h.slot);
+			++s.generation;
+		}
+		/// Frees all objects. All handles become invalid.
+		void clear() {
+			for (const index_type slot : _object_slots) {
+				_slot &s = _slots[std::to_underlying(slot)];
+				s.index = std::exchange(_head, slot);
+				++s.generation;
+			}
+			_objects.clear();
+			_object_slots.clear();
+		}
+
+		/// Returns whether the handle refers to an object that has not been freed.
+		[[nodiscard]] bool is_valid(handle h) const {
+			return
+				std::to_underlying(h.slot) < _slots.size() &&
+				_slots[std::to_underlying(h.slot)].generation == h.generation;
+		}
+		/// Returns the position of the given object in the dense array. The position changes when other objects
+		/// are freed.
+		[[nodiscard]] std::uint32_t get_index(handle h) const {
+			crash_if(!is_valid(h));
+			return static_cast<std::uint32_t>(_slots[std::to_underlying(h.slot)].index);
+		}
+		/// Returns the handle of the object at the given position in the dense array.
+		[[nodiscard]] handle get_handle(std::size_t i) const {
+			const index_type slot = _object_slots[i];
+			return handle(slot, _slots[std::to_underlying(slot)].generation);
+		}
+
+		/// Returns the object that the handle refers to.
+		[[nodiscard]] value_type &at(handle h) {
+			return _objects[get_index(h)];
+		}
+		/// \overload
+		[[nodiscard]] const value_type &at(handle h) const {
+			return _objects[get_index(h)];
+		}
+		/// Returns the object that the handle refers to.
+		[[nodiscard]] value_type &operator[](handle h) {
+			return at(h);
+		}
+		/// \overload
+		[[nodiscard]] const value_type &operator[](handle h) const {
+			return at(h);
+		}
+
+		/// Returns all objects in the order they're stored.
+		[[nodiscard]] std::span<value_type> get_objects() {
+			return _objects;
+		}
+		/// \overload
+		[[nodiscard]] std::span<const value_type> get_objects() const {
+			return _objects;
+		}
+		/// Returns the number of objects in this pool.
+		[[nodiscard]] std::size_t size() const {
+			return _objects.size();
+		}
+		/// Returns whether this pool contains no objects.
+		[[nodiscard]] bool empty() const {
+			return _objects.empty();
+		}
+
+		/// Returns an iterator to the first object.
+		[[nodiscard]] iterator begin() {
+			return _objects.data();
+		}
+		/// \overload
+		[[nodiscard]] const_iterator begin() const {
+			return _objects.data();
+		}
+		/// Returns an iterator past the last object.
+		[[nodiscard]] iterator end() {
+			return _objects.data() + _objects.size();
+		}
+		/// \overload
+		[[nodiscard]] const_iterator end() const {
+			return _objects.data() + _objects.size();
+		}
+	private:
+		/// An entry in the handle table.
+		struct _slot {
+			/// Initializes all fields of this struct.
+			_slot(index_type i, std::uint32_t gen) : index(i), generation(gen) {
+			}
+
+			/// Position of the object in the dense array, or the next free slot if this slot is free.
+			index_type index;
+			std::uint32_t generation; ///< Incremented whenever the object in this slot is freed.
+		};
+
+		std::vector<value_type> _objects; ///< All objects, stored contiguously.
+		std::vector<index_type> _object_slots; ///< The slot of each object in \ref _objects.
+		std::vector<_slot> _slots; ///< The handle table.
+		index_type _head = index_type::invalid; ///< The first free slot.
+	};
+}
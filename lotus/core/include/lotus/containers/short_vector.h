@@ -22,7 +22,7 @@ namespace lotus {
 			}
 			Size result = std::max(base, original);
 			while (result < target) {
-				result = static_cast<Size>(result * factor);
+				result = static_cast<Size>(static_cast<float>(result) * factor);
 			}
 			return result;
 		}
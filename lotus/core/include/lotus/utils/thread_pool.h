@@ -0,0 +1,76 @@
+#pragma once
+
+/// \file
+/// A pool of worker threads.
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "lotus/common.h"
+
+namespace lotus {
+	/// A fixed set of worker threads that cooperatively execute data-parallel loops. The thread that starts a loop
+	/// also takes part in executing it.
+	class thread_pool {
+	public:
+		/// Callback type for \ref parallel_for(). The range of indices is [begin, end).
+		using range_callback = void (*)(std::size_t begin, std::size_t end, void *user_data);
+
+		/// Creates a pool with the given total number of threads, including the calling thread. If the number is
+		/// zero, the number of hardware threads is used.
+		explicit thread_pool(std::size_t num_threads);
+		/// No copy construction.
+		thread_pool(const thread_pool&) = delete;
+		/// No copy assignment.
+		thread_pool &operator=(const thread_pool&) = delete;
+		/// Stops and joins all worker threads.
+		~thread_pool();
+
+		/// Invokes the callback for consecutive ranges of at most \p grain indices that together cover
+		/// [0, count), and blocks until all ranges have been processed. Ranges may be processed in any order and on
+		/// any thread.
+		void parallel_for(std::size_t count, std::size_t grain, range_callback, void *user_data);
+		/// \overload
+		template <typename Callback> void parallel_for(std::size_t count, std::size_t grain, Callback &&cb) {
+			using _callback_type = std::remove_reference_t<Callback>;
+			parallel_for(count, grain,
+				[](std::size_t begin, std::size_t end, void *user_data) {
+					(*static_cast<_callback_type*>(user_data))(begin, end);
+				},
+				const_cast<void*>(static_cast<const void*>(&cb))
+			);
+		}
+
+		/// Returns the total number of threads, including the calling thread.
+		[[nodiscard]] std::size_t get_num_threads() const {
+			return _workers.size() + 1;
+		}
+	private:
+		/// A data-parallel loop.
+		struct _job {
+			range_callback callback = nullptr; ///< The callback.
+			void *user_data = nullptr; ///< User data passed to \ref callback.
+			std::size_t count = 0; ///< The total number of indices.
+			std::size_t grain = 1; ///< Number of indices processed by each invocation of \ref callback.
+		};
+
+		std::vector<std::thread> _workers; ///< Worker threads.
+		std::mutex _mutex; ///< Protects \ref _current_job, \ref _generation, \ref _num_pending, and \ref _exit.
+		std::condition_variable _job_available; ///< Signaled when a new job is available.
+		std::condition_variable _job_finished; ///< Signaled when all workers have finished the current job.
+		_job _current_job; ///< The current job.
+		std::uint64_t _generation = 0; ///< Incremented whenever a new job is started.
+		std::size_t _num_pending = 0; ///< The number of workers that have not finished the current job.
+		std::atomic_size_t _next_index = 0; ///< The next index in the current job that should be processed.
+		bool _exit = false; ///< Whether the worker threads should exit.
+
+		/// The function executed by worker threads.
+		void _worker_main();
+		/// Processes ranges of the given job until there are none left.
+		void _execute(const _job&);
+	};
+}
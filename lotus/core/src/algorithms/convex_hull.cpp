@@ -91,14 +91,15 @@ namespace lotus::incremental_convex_hull {
 		{ // find all faces that should be removed & create new faces
 			auto bookmark = get_scratch_bookmark();
 
-			auto face_marked = bookmark.create_vector_array<bool>(_faces.size(), false);
+			// faces are marked in place instead of in an array indexed by face ID, so that the cost of adding a
+			// vertex only depends on the number of faces that are removed
 			std::stack<face_id, std::deque<face_id, memory::stack_allocator::std_allocator<face_id>>> stk(bookmark.create_std_allocator<face_id>());
 			auto is_face_marked = [&](face_id i) {
-				return face_marked[std::to_underlying(i)];
+				return _faces_pool[i].marked;
 			};
 			auto mark_face = [&](face_id i) {
 				stk.emplace(i);
-				face_marked[std::to_underlying(i)] = true;
+				_faces_pool[i].marked = true;
 			};
 
 			mark_face(hint);
@@ -0,0 +1,99 @@
+#include "lotus/utils/thread_pool.h"
+
+/// \file
+/// Implementation of the thread pool.
+
+namespace lotus {
+	thread_pool::thread_pool(std::size_t num_threads) {
+		if (num_threads == 0) {
+			num_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+		}
+		_workers.reserve(num_threads - 1);
+		for (std::size_t i = 1; i < num_threads; ++i) {
+			_workers.emplace_back([this]() {
+				_worker_main();
+			});
+		}
+	}
+
+	thread_pool::~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_exit = true;
+		}
+		_job_available.notify_all();
+		for (std::thread &t : _workers) {
+			t.join();
+		}
+	}
+
+	void thread_pool::parallel_for(std::size_t count, std::size_t grain, range_callback cb, void *user_data) {
+		grain = std::max<std::size_t>(grain, 1);
+		if (_workers.empty() || count <= grain) {
+			for (std::size_t begin = 0; begin < count; begin += grain) {
+				cb(begin, std::min(begin + grain, count), user_data);
+			}
+			return;
+		}
+
+		_job job;
+		job.callback  = cb;
+		job.user_data = user_data;
+		job.count     = count;
+		job.grain     = grain;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_current_job = job;
+			_next_index = 0;
+			_num_pending = _workers.size();
+			++_generation;
+		}
+		_job_available.notify_all();
+
+		_execute(job);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_job_finished.wait(lock, [this]() {
+			return _num_pending == 0;
+		});
+	}
+
+	void thread_pool::_worker_main() {
+		std::uint64_t last_generation = 0;
+		while (true) {
+			_job job;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_job_available.wait(lock, [&]() {
+					return _exit || _generation != last_generation;
+				});
+				if (_exit) {
+					return;
+				}
+				last_generation = _generation;
+				job = _current_job;
+			}
+
+			_execute(job);
+
+			bool finished = false;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				finished = --_num_pending == 0;
+			}
+			if (finished) {
+				_job_finished.notify_one();
+			}
+		}
+	}
+
+	void thread_pool::_execute(const _job &job) {
+		while (true) {
+			const std::size_t begin = _next_index.fetch_add(job.grain);
+			if (begin >= job.count) {
+				break;
+			}
+			job.callback(begin, std::min(begin + job.grain, job.count), job.user_data);
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+/// \file
+/// Time of impact queries between moving shapes using conservative advancement.
+
+#include <optional>
+
+#include "lotus/math/vector.h"
+#include "lotus/collision/shape.h"
+#include "lotus/physics/body_properties.h"
+
+namespace lotus::collision {
+	/// Finds the first time at which two moving shapes touch. Both shapes move with constant linear and angular
+	/// velocities between their states at the start and the end of the time interval. The shapes are repeatedly
+	/// advanced in time by their distance divided by an upper bound of their approach speed, which never skips
+	/// past the time of impact.
+	///
+	/// \sa Mirtich, Impulse-based Dynamic Simulation of Rigid Body Systems
+	struct conservative_advancement {
+		/// The maximum number of distance queries before the algorithm stops and reports the time that it has
+		/// reached, at which the shapes may still be further apart than the tolerance.
+		constexpr static std::uint32_t max_iterations = 32;
+
+		/// Closest points between two shapes.
+		struct separation {
+			/// No initialization.
+			separation(uninitialized_t) {
+			}
+
+			vec3 position1 = uninitialized; ///< The closest point on the first shape in world space.
+			vec3 position2 = uninitialized; ///< The closest point on the second shape in world space.
+			/// Normalized direction from the first shape towards the second. This is only meaningful if the shapes
+			/// are separated.
+			vec3 normal = uninitialized;
+			/// Distance between the shapes, which is zero or negative if they intersect.
+			scalar distance;
+		};
+		/// The result of a time of impact query.
+		struct result {
+			/// No initialization.
+			result(uninitialized_t) {
+			}
+
+			/// Time of impact between zero and one, relative to the time interval.
+			scalar time;
+			physics::body_state state1 = uninitialized; ///< State of the first shape at the time of impact.
+			physics::body_state state2 = uninitialized; ///< State of the second shape at the time of impact.
+			/// Closest points of the shapes at the time of impact. The shapes are separated by at most the
+			/// tolerance passed to \ref compute_time_of_impact(), unless they already intersect at the start of
+			/// the time interval, or unless \ref max_iterations has been reached, in which case they may be
+			/// further apart.
+			separation closest = uninitialized;
+			std::uint32_t iterations; ///< The number of distance queries performed.
+		};
+
+		/// Computes the closest points between two shapes. Returns \p std::nullopt if distances between the shapes
+		/// are not supported, e.g., between two planes.
+		[[nodiscard]] static std::optional<separation> compute_separation(
+			const shape&, const physics::body_state&, const shape&, const physics::body_state&
+		);
+		/// Returns the state at the given time between zero and one, moving with constant linear and angular
+		/// velocities between the two given states.
+		[[nodiscard]] static physics::body_state interpolate(
+			const physics::body_state &from, const physics::body_state &to, scalar t
+		);
+		/// Returns the largest distance between the origin of the shape in local space and any point of it, which
+		/// bounds how fast a point on the shape can move due to rotation. Planes are treated as having no extent,
+		/// i.e., rotating planes are not handled.
+		[[nodiscard]] static scalar get_bounding_radius(const shape&);
+		/// Computes the time of impact of two shapes that move between the given states. The shapes touch once
+		/// they're closer than \p tolerance. If they're still apart after \ref max_iterations distance queries,
+		/// the time reached so far is returned instead; the shapes do not touch before that time, so callers can
+		/// stop there and keep the remaining separation as a speculative contact. Returns \p std::nullopt if the
+		/// shapes do not touch within the time interval, or if distances between them are not supported.
+		[[nodiscard]] static std::optional<result> compute_time_of_impact(
+			const shape&, const physics::body_state &from1, const physics::body_state &to1,
+			const shape&, const physics::body_state &from2, const physics::body_state &to2,
+			scalar tolerance
+		);
+	};
+}
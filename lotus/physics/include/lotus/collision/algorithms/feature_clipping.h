@@ -0,0 +1,75 @@
+#pragma once
+
+/// \file
+/// Contact manifold generation by clipping features of polyhedra against each other.
+
+#include <span>
+
+#include "lotus/math/vector.h"
+#include "lotus/containers/short_vector.h"
+#include "lotus/collision/common.h"
+#include "lotus/collision/shapes/polyhedron.h"
+#include "lotus/physics/body_properties.h"
+
+namespace lotus::collision {
+	/// Generates contact points between two polyhedra from their features that are closest along the contact
+	/// normal. If both features are faces, or if one is a face and the other an edge, the other feature is clipped
+	/// against the side planes of the face; this produces multiple points that keep resting bodies from rocking
+	/// between single contact points.
+	struct feature_clipping {
+		/// The maximum number of vertices in a feature. Polyhedra with larger faces only produce a single contact.
+		constexpr static std::uint32_t max_feature_vertices = 16;
+		/// The maximum number of points that clipping can produce.
+		constexpr static std::uint32_t max_clipped_points = 2 * max_feature_vertices;
+		/// The maximum number of points in a reduced contact manifold.
+		constexpr static std::uint32_t max_manifold_points = 4;
+		/// A vertex is part of a feature if the edge between it and the support vertex deviates from the plane
+		/// perpendicular to the query direction by an angle whose sine is at most this value.
+		constexpr static scalar feature_tolerance = 0.05f;
+
+		/// The vertices of a polyhedron that support it along a direction: a single vertex, the two vertices of an
+		/// edge, or the vertices of a face in counter-clockwise order around the direction.
+		struct feature {
+			short_vector<vec3, max_feature_vertices> positions; ///< World space positions of the vertices.
+			short_vector<std::uint32_t, max_feature_vertices> vertices; ///< Indices of the vertices.
+		};
+		/// A contact point in world space.
+		struct contact_point {
+			/// No initialization.
+			contact_point(uninitialized_t) {
+			}
+
+			vec3 position1 = uninitialized; ///< The contact point on the first polyhedron.
+			vec3 position2 = uninitialized; ///< The contact point on the second polyhedron.
+			scalar depth; ///< Penetration depth along the contact normal, which is negative for separated points.
+			contact_feature feature1 = uninitialized; ///< Feature of the first polyhedron.
+			contact_feature feature2 = uninitialized; ///< Feature of the second polyhedron.
+		};
+		/// The result of clipping two features against each other.
+		struct result {
+			/// No initialization.
+			result(uninitialized_t) {
+			}
+
+			short_vector<contact_point, max_clipped_points> points; ///< Contact points.
+			/// The contact normal, which is the normal of the face that the other feature is clipped against,
+			/// pointing from the first polyhedron towards the second.
+			vec3 normal = uninitialized;
+		};
+
+		/// Finds the feature of the given polyhedron that supports it along the given normalized world space
+		/// direction.
+		[[nodiscard]] static feature find_support_feature(
+			const shapes::polyhedron&, const physics::body_state&, vec3 dir
+		);
+		/// Clips the given features of two polyhedra against each other. The normal points from the first
+		/// polyhedron towards the second, i.e., the first feature should support the first polyhedron along the
+		/// normal, and the second feature the second polyhedron along its negation. Points that are separated by at
+		/// most \p margin are also kept, so that the manifold stays complete while the bodies rock slightly. Returns
+		/// no points if neither feature is a face, or if one of them is a single vertex.
+		[[nodiscard]] static result clip(const feature &f1, const feature &f2, vec3 normal, scalar margin);
+		/// Reorders the given points so that the first ones span the largest area, and returns how many of them
+		/// should be kept, which is at most \ref max_manifold_points. The deepest point is always kept.
+		[[nodiscard]] static std::uint32_t reduce(std::span<contact_point>, vec3 normal);
+	};
+}
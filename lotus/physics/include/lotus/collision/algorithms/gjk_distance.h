@@ -0,0 +1,77 @@
+#pragma once
+
+/// \file
+/// The GJK distance algorithm between convex polyhedra and points.
+
+#include <array>
+#include <span>
+
+#include "lotus/math/vector.h"
+#include "lotus/collision/shapes/polyhedron.h"
+#include "lotus/physics/body_properties.h"
+
+namespace lotus::collision {
+	/// Implementation of the Gilbert-Johnson-Keerthi distance algorithm that finds the point on a convex
+	/// polyhedron closest to a given point, or the closest points of two convex polyhedra. Unlike \ref gjk_epa,
+	/// this does not compute penetration depths: if the objects intersect, it only reports that.
+	struct gjk_distance {
+		/// The maximum number of support queries before the algorithm gives up and returns the closest point found
+		/// so far.
+		constexpr static std::uint32_t max_iterations = 64;
+
+		/// The result of the algorithm.
+		struct result {
+			/// No initialization.
+			result(uninitialized_t) {
+			}
+
+			/// The closest point on the polyhedron in its local space. This is only valid if the point is outside
+			/// of the polyhedron.
+			vec3 closest_point = uninitialized;
+			/// Distance between the point and \ref closest_point, or zero if the point is inside the polyhedron.
+			scalar distance;
+			/// Vertices of the polyhedron whose convex combination is \ref closest_point. If the point is inside
+			/// the polyhedron, these are the vertices of a tetrahedron that contains it.
+			std::array<std::uint32_t, 4> vertices;
+			std::uint32_t num_vertices; ///< The number of valid entries in \ref vertices.
+			std::uint32_t support_queries; ///< The number of support vertices computed by the algorithm.
+
+			/// Returns whether the point is inside the polyhedron.
+			[[nodiscard]] bool is_inside() const {
+				return num_vertices == 4;
+			}
+		};
+
+		/// The result of the algorithm between two polyhedra.
+		struct pair_result {
+			/// No initialization.
+			pair_result(uninitialized_t) {
+			}
+
+			vec3 position1 = uninitialized; ///< The closest point on the first polyhedron in world space.
+			vec3 position2 = uninitialized; ///< The closest point on the second polyhedron in world space.
+			/// Normalized direction from \ref position1 to \ref position2. If the closest feature of the Minkowski
+			/// difference is a face, this is the normal of that face, which stays accurate even when the polyhedra
+			/// almost touch and the closest points are dominated by rounding errors.
+			vec3 normal = uninitialized;
+			/// Distance between \ref position1 and \ref position2, or zero if the polyhedra intersect.
+			scalar distance;
+			/// Whether the polyhedra intersect, in which case \ref position1 and \ref position2 are meaningless.
+			bool intersecting;
+			std::uint32_t support_queries; ///< The number of support vertices computed by the algorithm.
+		};
+
+		/// Finds the point on the given polyhedron that is closest to the given point in the local space of the
+		/// polyhedron. The search starts from the given vertices, which are usually those returned by a previous
+		/// query for a nearby point; at most four are used, and vertex 0 is used if none are given.
+		[[nodiscard]] static result closest_point(
+			const shapes::polyhedron&, vec3 point, std::span<const std::uint32_t> initial_vertices = {}
+		);
+		/// Finds the closest points on two polyhedra placed with the given states, by searching for the point on
+		/// their Minkowski difference that is closest to the origin.
+		[[nodiscard]] static pair_result closest_points(
+			const shapes::polyhedron&, const physics::body_state&,
+			const shapes::polyhedron&, const physics::body_state&
+		);
+	};
+}
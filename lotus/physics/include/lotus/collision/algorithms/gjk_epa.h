@@ -13,8 +13,24 @@
 namespace lotus::collision {
 	/// Implementation of the Gilbert-Johnson-Keerthi algorithm and the expanding polytope algorithm.
 	struct gjk_epa {
+		/// The number of distinct visited vertices that the GJK algorithm keeps track of on the stack. If it
+		/// visits more, they're moved to scratch memory, which is grown as necessary.
+		constexpr static std::size_t initial_gjk_vertices = 64;
+		/// The number of vertices that the polytope in the EPA algorithm initially has storage for. The storage
+		/// is doubled whenever it's exhausted.
+		constexpr static std::uint32_t initial_epa_vertices = 32;
+		/// The maximum number of vertices of the polytope in the EPA algorithm. If the algorithm hasn't converged
+		/// when this is reached, the nearest face found so far is returned.
+		constexpr static std::uint32_t max_epa_vertices = 512;
+		/// When the EPA polytope has storage for at least this many vertices, the nearest face is looked up in a
+		/// heap instead of by scanning all faces.
+		constexpr static std::uint32_t face_heap_min_epa_vertices = 128;
+
 		/// A vertex in a simplex.
 		struct simplex_vertex {
+			/// Initializes both indices to zero.
+			simplex_vertex() : simplex_vertex(0, 0) {
+			}
 			/// No initialization.
 			simplex_vertex(uninitialized_t) {
 			}
@@ -43,6 +59,10 @@ namespace lotus::collision {
 			/// simplex has been successfully created by the GJK algorithm, i.e., when \ref gjk() returns \p true
 			/// (there may be other cases where this is valid but this is usually not relevant in those cases).
 			bool invert_even_normals;
+			/// If \ref gjk() returns \p false because the support point along a direction does not reach the origin,
+			/// this is that direction in world space. Otherwise this is zero.
+			vec3 separating_axis = zero;
+			std::uint32_t support_queries = 0; ///< The number of support vertices computed by \ref gjk().
 		};
 		/// Results from the expanding polytope algorithm.
 		struct epa_result {
@@ -58,8 +78,23 @@ namespace lotus::collision {
 			std::array<vec3, 3> simplex_positions{ uninitialized, uninitialized, uninitialized };
 			/// Vertices of the contact plane.
 			std::array<simplex_vertex, 3> vertices{ uninitialized, uninitialized, uninitialized };
-			vec3 normal = uninitialized; ///< Contact normal.
+			vec3 normal = uninitialized; ///< Normalized contact normal.
 			scalar penetration_depth; ///< Penetration depth.
+			std::uint32_t iterations = 0; ///< The number of polytope expansion iterations that have been executed.
+			/// Whether the algorithm has converged. If this is \p false, the polytope has reached
+			/// \ref max_epa_vertices vertices, and the result is only an approximation.
+			bool converged = true;
+			std::size_t peak_scratch_bytes = 0; ///< The maximum amount of scratch memory used by the algorithm.
+		};
+
+		/// Data that is kept for a pair of polyhedra between time steps to exploit temporal coherence.
+		struct pair_cache {
+			/// Vertices of the simplex that the previous execution of the GJK algorithm terminated with.
+			std::array<simplex_vertex, 4> simplex{ uninitialized, uninitialized, uninitialized, uninitialized };
+			std::size_t simplex_vertices = 0; ///< The number of valid vertices in \ref simplex.
+			/// If the polyhedra were separated, a separating axis in the local space of the first polyhedron.
+			/// Otherwise this is zero.
+			vec3 separating_axis = zero;
 		};
 
 		/// No initialization.
@@ -83,11 +118,34 @@ namespace lotus::collision {
 
 		/// Updates and returns the result of the GJK algorithm.
 		[[nodiscard]] std::pair<bool, gjk_result_state> gjk();
-		/// The expanding polytope algorithm.
+		/// Tests whether the polyhedra are separated by more than the given distance along the given world space
+		/// direction using a single support query, which starts from the first vertex of the simplex if there is
+		/// one. A return value of \p false does not imply that the polyhedra intersect.
+		[[nodiscard]] bool is_separated_along(vec3, scalar margin = 0.0f) const;
+
+		/// Starts the next execution of \ref gjk() from the simplex stored in the given cache.
+		void resume_from(const pair_cache &cache) {
+			simplex = cache.simplex;
+			simplex_vertices = cache.simplex_vertices;
+		}
+		/// Stores the current simplex and the separating axis from the given result in the cache.
+		void store_to(pair_cache &cache, const gjk_result_state &state) const {
+			cache.simplex = simplex;
+			cache.simplex_vertices = simplex_vertices;
+			cache.separating_axis = orient1.inverse().rotate(state.separating_axis);
+		}
+		/// The expanding polytope algorithm. Storage for the polytope starts small and grows as necessary, up to
+		/// \ref max_epa_vertices vertices.
 		[[nodiscard]] epa_result epa(gjk_result_state) const;
+		/// Returns the number of bytes of scratch memory used by polytope storage for the given number of vertices.
+		[[nodiscard]] static std::size_t get_epa_scratch_bytes(std::uint32_t num_vertices);
+		/// Returns the number of entries in the heap of faces used by the expanding polytope algorithm, for a
+		/// polytope with the given number of vertices.
+		[[nodiscard]] static std::size_t get_epa_face_heap_capacity(std::uint32_t num_vertices);
 
-		/// Returns the support vertex for the given direction.
-		[[nodiscard]] simplex_vertex support_vertex(vec3) const;
+		/// Returns the support vertex for the given direction. The search starts from the given vertex, and is
+		/// faster if that vertex is close to the result.
+		[[nodiscard]] simplex_vertex support_vertex(vec3, simplex_vertex start = simplex_vertex(0, 0)) const;
 		/// Returns the position, in global coordinates, of the given \ref simplex_vertex.
 		[[nodiscard]] vec3 simplex_vertex_position(simplex_vertex) const;
 
@@ -0,0 +1,166 @@
+#pragma once
+
+/// \file
+/// Broad phase algorithms that find pairs of objects with overlapping bounding boxes.
+
+#include <cmath>
+#include <variant>
+#include <vector>
+#include <span>
+
+#include "common.h"
+
+namespace lotus::collision {
+	/// Broad phase algorithms. All algorithms take the bounding boxes of all objects and report pairs of indices of
+	/// objects whose bounding boxes overlap. The same set of objects is expected to be passed in on consecutive calls
+	/// so that temporal coherence can be exploited; if the number of objects changes, internal states are reset.
+	namespace broad_phases {
+		/// A pair of object indices. The first index is always smaller than the second.
+		using index_pair = std::pair<std::uint32_t, std::uint32_t>;
+
+		/// Returns whether the two bounding boxes overlap.
+		[[nodiscard]] inline bool overlaps(const bounding_box &a, const bounding_box &b) {
+			return
+				a.min[0] <= b.max[0] && b.min[0] <= a.max[0] &&
+				a.min[1] <= b.max[1] && b.min[1] <= a.max[1] &&
+				a.min[2] <= b.max[2] && b.min[2] <= a.max[2];
+		}
+		/// Returns whether the first box fully contains the second box.
+		[[nodiscard]] inline bool contains(const bounding_box &outer, const bounding_box &inner) {
+			return
+				outer.min[0] <= inner.min[0] && inner.max[0] <= outer.max[0] &&
+				outer.min[1] <= inner.min[1] && inner.max[1] <= outer.max[1] &&
+				outer.min[2] <= inner.min[2] && inner.max[2] <= outer.max[2];
+		}
+		/// Returns whether all coordinates of the bounding box are finite.
+		[[nodiscard]] inline bool is_bounded(const bounding_box &b) {
+			for (std::size_t i = 0; i < 3; ++i) {
+				if (!std::isfinite(b.min[i]) || !std::isfinite(b.max[i])) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/// Tests all pairs of bounding boxes against each other.
+		struct brute_force {
+			/// Appends all pairs of overlapping boxes to the output.
+			void find_overlapping_pairs(std::span<const bounding_box>, std::vector<index_pair>&);
+		};
+
+		/// Sweep and prune along the axis where the centers of the boxes have the largest variance. The sorted order
+		/// is kept between calls so that it can be updated efficiently using insertion sort; it's sorted from
+		/// scratch when the number of boxes or the sweep axis changes.
+		struct sweep_and_prune {
+			/// Appends all pairs of overlapping boxes to the output.
+			void find_overlapping_pairs(std::span<const bounding_box>, std::vector<index_pair>&);
+
+			/// The sweep axis is only changed when the variance along another axis is larger than that along the
+			/// current axis by this factor.
+			scalar axis_switch_threshold = 1.1f;
+		private:
+			std::vector<std::uint32_t> _order; ///< Indices of all boxes sorted by their minimum along \ref _axis.
+			std::vector<std::uint32_t> _active; ///< Boxes that overlap the current sweep position.
+			std::size_t _axis = 0; ///< The sweep axis.
+		};
+
+		/// A dynamic bounding volume hierarchy. Each leaf stores a box that's enlarged by \ref margin; leaves are
+		/// only removed and re-inserted when the object moves out of its enlarged box. The ancestors of inserted
+		/// leaves are rotated to keep the tree from degrading, e.g., when objects are inserted in spatial order.
+		/// Unbounded boxes (e.g., those of planes) are kept out of the tree and tested against all other boxes.
+		///
+		/// \sa Catto, Dynamic Bounding Volume Hierarchies
+		struct dynamic_aabb_tree {
+			/// Appends all pairs of overlapping boxes to the output.
+			void find_overlapping_pairs(std::span<const bounding_box>, std::vector<index_pair>&);
+
+			/// Returns the number of leaves that have been re-inserted during the last update.
+			[[nodiscard]] std::uint32_t get_num_reinserted_leaves() const {
+				return _num_reinserted;
+			}
+
+			scalar margin = 0.05f; ///< The amount that boxes are enlarged by in all directions.
+		private:
+			/// Indicates that a node or object index is invalid.
+			constexpr static std::uint32_t _invalid = std::numeric_limits<std::uint32_t>::max();
+
+			/// A node in the tree.
+			struct _node {
+				/// No initialization.
+				_node(uninitialized_t) {
+				}
+
+				/// Returns whether this node is a leaf node.
+				[[nodiscard]] bool is_leaf() const {
+					return child1 == _invalid;
+				}
+
+				bounding_box box = uninitialized; ///< Bounding box of this node.
+				std::uint32_t parent; ///< Parent node, or the next free node for unused nodes.
+				std::uint32_t child1; ///< The first child node. This is \ref _invalid for leaf nodes.
+				std::uint32_t child2; ///< The second child node.
+				std::uint32_t object; ///< Index of the object for leaf nodes.
+			};
+
+			std::vector<_node> _nodes; ///< All nodes.
+			std::vector<std::uint32_t> _object_leaves; ///< Leaf node of each object, or \ref _invalid if unbounded.
+			std::vector<std::uint32_t> _unbounded; ///< Objects that are not in the tree.
+			std::vector<std::uint32_t> _stack; ///< Stack used for tree traversal.
+			std::uint32_t _root = _invalid; ///< The root node.
+			std::uint32_t _free_list = _invalid; ///< List of free nodes.
+			std::uint32_t _num_reinserted = 0; ///< Number of leaves re-inserted during the last update.
+
+			/// Resets the tree to empty.
+			void _clear();
+			/// Allocates a new node.
+			[[nodiscard]] std::uint32_t _allocate_node();
+			/// Frees the given node.
+			void _free_node(std::uint32_t);
+			/// Inserts a new leaf for the given object.
+			void _insert_leaf(std::uint32_t object, const bounding_box&);
+			/// Removes the given leaf node from the tree and frees it.
+			void _remove_leaf(std::uint32_t leaf);
+			/// Recomputes the bounding boxes of the given node and all its ancestors, optionally rotating each of them
+			/// using \ref _rotate() first.
+			void _refit_ancestors(std::uint32_t node, bool rotate);
+			/// If swapping a child of the given internal node with a child of its other child reduces the surface
+			/// area of the latter, performs the swap that reduces it the most.
+			void _rotate(std::uint32_t node);
+		};
+	}
+
+	/// A broad phase algorithm chosen at runtime.
+	struct broad_phase {
+		/// The type of a broad phase algorithm. The order of entries in this \p enum must match that in
+		/// \ref storage.
+		enum class type : std::uint8_t {
+			brute_force, ///< \ref broad_phases::brute_force.
+			sweep_and_prune, ///< \ref broad_phases::sweep_and_prune.
+			dynamic_aabb_tree, ///< \ref broad_phases::dynamic_aabb_tree.
+
+			num_types ///< The total number of broad phase types.
+		};
+
+		/// A union for the storage of broad phase algorithms. The order of types must match the \ref type enum.
+		using storage = std::variant<
+			broad_phases::brute_force, broad_phases::sweep_and_prune, broad_phases::dynamic_aabb_tree
+		>;
+
+		/// Creates a new broad phase object of the given type.
+		[[nodiscard]] static broad_phase create(type);
+
+		/// Returns the type of the stored algorithm.
+		[[nodiscard]] type get_type() const {
+			return static_cast<type>(value.index());
+		}
+
+		/// Appends all pairs of overlapping boxes to the output.
+		void find_overlapping_pairs(std::span<const bounding_box> boxes, std::vector<broad_phases::index_pair> &out) {
+			std::visit([&](auto &alg) {
+				alg.find_overlapping_pairs(boxes, out);
+			}, value);
+		}
+
+		storage value; ///< The algorithm.
+	};
+}
@@ -3,6 +3,12 @@
 /// \file
 /// Common collision related definitions.
 
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <limits>
+
+#include "lotus/math/aab.h"
 #include "lotus/math/vector.h"
 #include "lotus/math/quaternion.h"
 #include "lotus/physics/common.h"
@@ -10,4 +16,45 @@
 namespace lotus::collision {
 	using namespace lotus::physics::types;
 	using namespace lotus::physics::constants;
+
+	using bounding_box = aab3<scalar>; ///< Axis-aligned bounding box type.
+
+	/// Identifies the feature of a shape that's involved in a contact - a vertex, an edge, or a face - using the
+	/// indices of up to three of its vertices.
+	struct contact_feature {
+		/// Marks unused entries in \ref vertices.
+		constexpr static std::uint32_t invalid_vertex = std::numeric_limits<std::uint32_t>::max();
+
+		/// No initialization.
+		contact_feature(uninitialized_t) {
+		}
+		/// Creates an object that does not identify any feature. This is used for shapes such as spheres and
+		/// planes that have no distinct features.
+		[[nodiscard]] constexpr inline static contact_feature none() {
+			return contact_feature(invalid_vertex, invalid_vertex, invalid_vertex);
+		}
+		/// Creates an object from the given vertex indices. Duplicate indices are removed, so that a triangle with
+		/// two identical vertices identifies an edge.
+		[[nodiscard]] constexpr inline static contact_feature from_vertices(
+			std::uint32_t v1, std::uint32_t v2 = invalid_vertex, std::uint32_t v3 = invalid_vertex
+		) {
+			contact_feature result(v1, v2, v3);
+			std::sort(result.vertices.begin(), result.vertices.end());
+			auto end = std::unique(result.vertices.begin(), result.vertices.end());
+			std::fill(end, result.vertices.end(), invalid_vertex);
+			return result;
+		}
+
+		/// Default comparison.
+		friend std::strong_ordering operator<=>(const contact_feature&, const contact_feature&) = default;
+		/// Default equality.
+		friend bool operator==(const contact_feature&, const contact_feature&) = default;
+
+		/// Sorted vertex indices, with unused entries set to \ref invalid_vertex.
+		std::array<std::uint32_t, 3> vertices;
+	protected:
+		/// Initializes \ref vertices directly.
+		constexpr contact_feature(std::uint32_t v1, std::uint32_t v2, std::uint32_t v3) : vertices({ v1, v2, v3 }) {
+		}
+	};
 }
@@ -34,6 +34,12 @@ namespace lotus::collision {
 		[[nodiscard]] type get_type() const {
 			return static_cast<type>(value.index());
 		}
+		/// Returns the world space bounding box of this shape when placed with the given state.
+		[[nodiscard]] bounding_box get_bounds(const physics::body_state &st) const {
+			return std::visit([&](const auto &s) {
+				return s.get_bounds(st);
+			}, value);
+		}
 
 		storage value; ///< The value of this shape.
 	};
@@ -52,13 +52,30 @@ namespace lotus::collision::shapes {
 			}
 		};
 
+		/// Polyhedra with fewer vertices than this always use a linear scan for support queries, since that's
+		/// faster than hill climbing for small vertex counts.
+		constexpr static std::size_t hill_climbing_min_vertices = 32;
+
 		std::vector<vec3> vertices; ///< Vertices of this polyhedron.
+		/// Neighbors of vertex \p i on the convex hull are stored in \ref adjacency between indices
+		/// \p adjacency_offsets[i] and \p adjacency_offsets[i + 1]. This is computed by \ref bake(), and is empty
+		/// if the polyhedron has not been baked.
+		std::vector<std::uint32_t> adjacency_offsets;
+		std::vector<std::uint32_t> adjacency; ///< Neighbors of all vertices. See \ref adjacency_offsets.
 
-		/// Offsets this shape so that the center of mass is at the origin, and returns the resulting
-		/// \ref body_properties.
+		/// Offsets this shape so that the center of mass is at the origin, computes \ref adjacency, and returns
+		/// the resulting \ref body_properties.
 		[[nodiscard]] physics::body_properties bake(scalar density);
 
 		/// Returns the index of the support vertex in the given direction, and its dot product with the direction.
+		/// This function checks all vertices.
 		[[nodiscard]] std::pair<std::uint32_t, scalar> get_support_vertex(vec3 dir) const;
+		/// Returns the index of the support vertex in the given direction, and its dot product with the direction.
+		/// The support vertex is found by walking along edges of the convex hull starting from the given vertex,
+		/// so this is fast if the vertex is close to the result. This falls back to checking all vertices if the
+		/// polyhedron is small, has not been baked, or if the starting vertex is not on the convex hull.
+		[[nodiscard]] std::pair<std::uint32_t, scalar> get_support_vertex(vec3 dir, std::uint32_t start) const;
+		/// Returns the world space bounding box of this shape when placed with the given state.
+		[[nodiscard]] bounding_box get_bounds(const physics::body_state&) const;
 	};
 }
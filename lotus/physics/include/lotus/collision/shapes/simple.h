@@ -3,6 +3,8 @@
 /// \file
 /// Simple shapes.
 
+#include <limits>
+
 #include "lotus/math/constants.h"
 #include "lotus/math/vector.h"
 #include "lotus/physics/body_properties.h"
@@ -35,9 +37,20 @@ namespace lotus::collision::shapes {
 			const scalar diag = 0.4f * mass * radius * radius;
 			return physics::body_properties::create(mat33s::diagonal(diag, diag, diag), mass);
 		}
+
+		/// Returns the world space bounding box of this shape when placed with the given state.
+		[[nodiscard]] bounding_box get_bounds(const physics::body_state &st) const {
+			const vec3 center = st.position + st.rotation.rotate(offset);
+			const vec3 extent(radius, radius, radius);
+			return bounding_box::create_from_min_max(center - extent, center + extent);
+		}
 	};
 
 	/// An infinitely large plane that passes through the origin and spans through the X-Y plane.
 	struct plane {
+		/// Returns the world space bounding box of the half space below this plane when placed with the given
+		/// state. The box is unbounded in all directions, unless the plane normal is aligned with one of the world
+		/// axes, in which case it's bounded on one side along that axis.
+		[[nodiscard]] bounding_box get_bounds(const physics::body_state&) const;
 	};
 }
@@ -27,10 +27,11 @@ namespace lotus::physics {
 				return compute(b1, b2, r1, r2, delta_x / norm, norm);
 			}
 
-			/// Applies this correction as a positional correction.
+			/// Applies this correction as a positional correction. Kinematic bodies are left unchanged.
 			void apply_position(scalar &lambda) const;
 			/// Applies this correction as a velocity correction. The input magnitude is the real magnitude of the
-			/// velocity change; this object should have been computed with a magnitude of 1.
+			/// velocity change; this object should have been computed with a magnitude of 1. Kinematic bodies are left
+			/// unchanged.
 			void apply_velocity(scalar mag) const;
 
 			body *body1; ///< The first body.
@@ -49,11 +50,13 @@ namespace lotus::physics {
 			collision::shape &shape, material_properties mat, body_properties prop, body_state st
 		) {
 			body result = uninitialized;
-			result.body_shape = &shape;
-			result.material   = mat;
-			result.properties = prop;
-			result.state      = st;
-			result.user_data  = nullptr;
+			result.body_shape            = &shape;
+			result.material              = mat;
+			result.properties            = prop;
+			result.state                 = st;
+			result.prev_linear_velocity  = st.linear_velocity;
+			result.prev_angular_velocity = st.angular_velocity;
+			result.user_data             = nullptr;
 			return result;
 		}
 
@@ -65,6 +68,20 @@ namespace lotus::physics {
 		uquats prev_rotation = uninitialized; ///< Rotation after the previous timestep.
 		vec3 prev_linear_velocity = uninitialized; ///< Linear velocity after the previous timestep.
 		vec3 prev_angular_velocity = uninitialized; ///< Angular velocity after the previous timestep.
+		/// Whether this body is sleeping. Sleeping bodies are not simulated; the engine wakes them up when they're
+		/// touched by an awake body or when \ref state is modified.
+		bool sleeping = false;
+		scalar sleep_timer = 0.0f; ///< How long this body has been resting, in seconds.
+		/// Identifies the island that this body fell asleep with, and is only meaningful while it's sleeping. Bodies
+		/// in the same island fall asleep and wake up together.
+		std::uint32_t island = 0;
+		/// Whether collisions of this body are detected continuously. The narrow phase then finds the first time
+		/// during each time step at which this body touches each other body and generates speculative contacts
+		/// at that point. If the body does touch something, its predicted motion is cut short at the earliest
+		/// time of impact, and the velocity solve removes its approaching velocity, so that fast bodies do not pass
+		/// through thin objects. Bodies that already touch another body at the start of the time step keep their
+		/// predicted motion. This should only be enabled for small, fast bodies, e.g., projectiles.
+		bool continuous_collision = false;
 		void *user_data; ///< User data.
 	};
 	/// Data associated with a single particle.
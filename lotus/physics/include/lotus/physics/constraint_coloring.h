@@ -0,0 +1,91 @@
+#pragma once
+
+/// \file
+/// Graph coloring of constraints.
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "lotus/common.h"
+
+namespace lotus::physics {
+	/// A partition of constraints into colors, such that no two constraints of the same color share a particle.
+	/// Constraints of the same color can therefore be projected in any order, or in parallel, with identical
+	/// results.
+	struct constraint_coloring {
+		/// Computes a greedy coloring for the given constraints. Constraints are visited in order, and each one is
+		/// assigned the smallest color not used by any of its particles. The callback should return a range of
+		/// particle indices of the constraint at the given index.
+		template <typename GetParticles> [[nodiscard]] inline static constraint_coloring compute(
+			std::size_t num_constraints, std::size_t num_particles, GetParticles &&get_particles
+		) {
+			constexpr std::uint32_t invalid_color = std::numeric_limits<std::uint32_t>::max();
+			constexpr std::uint32_t colors_per_pass = 64;
+
+			std::vector<std::uint32_t> colors(num_constraints, invalid_color);
+			std::vector<std::uint64_t> used_colors(num_particles);
+			std::uint32_t num_colors = 0;
+			// colors are assigned in batches of 64 using one bit mask per particle; constraints that do not fit in
+			// the current batch are deferred to the next one
+			for (std::size_t num_colored = 0, base = 0; num_colored < num_constraints; base += colors_per_pass) {
+				std::fill(used_colors.begin(), used_colors.end(), 0);
+				for (std::size_t i = 0; i < num_constraints; ++i) {
+					if (colors[i] != invalid_color) {
+						continue;
+					}
+					std::uint64_t used = 0;
+					for (const std::size_t p : get_particles(i)) {
+						used |= used_colors[p];
+					}
+					if (used == std::numeric_limits<std::uint64_t>::max()) {
+						continue;
+					}
+					const auto bit = static_cast<std::uint32_t>(std::countr_one(used));
+					for (const std::size_t p : get_particles(i)) {
+						used_colors[p] |= 1ull << bit;
+					}
+					colors[i] = static_cast<std::uint32_t>(base) + bit;
+					num_colors = std::max(num_colors, colors[i] + 1);
+					++num_colored;
+				}
+			}
+
+			// counting sort by color
+			constraint_coloring result;
+			result.num_constraints = num_constraints;
+			result.color_offsets.resize(num_colors + 1, 0);
+			for (const std::uint32_t c : colors) {
+				++result.color_offsets[c + 1];
+			}
+			for (std::size_t i = 1; i < result.color_offsets.size(); ++i) {
+				result.color_offsets[i] += result.color_offsets[i - 1];
+			}
+			result.constraints.resize(num_constraints);
+			std::vector<std::uint32_t> positions(result.color_offsets.begin(), result.color_offsets.end() - 1);
+			for (std::size_t i = 0; i < num_constraints; ++i) {
+				result.constraints[positions[colors[i]]++] = static_cast<std::uint32_t>(i);
+			}
+			return result;
+		}
+
+		/// Returns the number of colors.
+		[[nodiscard]] std::size_t get_num_colors() const {
+			return color_offsets.empty() ? 0 : color_offsets.size() - 1;
+		}
+		/// Returns the indices of all constraints with the given color, in increasing order.
+		[[nodiscard]] std::span<const std::uint32_t> get_constraints(std::size_t color) const {
+			return std::span(constraints).subspan(color_offsets[color], color_offsets[color + 1] - color_offsets[color]);
+		}
+
+		/// Indices of all constraints, sorted by their colors.
+		std::vector<std::uint32_t> constraints;
+		/// Offsets of the first constraint of each color in \ref constraints, followed by the total number of
+		/// constraints.
+		std::vector<std::uint32_t> color_offsets;
+		/// The number of constraints at the time this coloring was computed, used to detect changes.
+		std::size_t num_constraints = 0;
+	};
+}
@@ -160,6 +160,21 @@ namespace lotus::physics::constraints {
 			x3 += (c_coefficient * delta_lambda * inv_m3) * dtheta_dx3.transposed();
 			x4 += (c_coefficient * delta_lambda * inv_m4) * dtheta_dx4.transposed();
 		}
+		/// Returns the residual \f$C + \tilde{\alpha}\lambda\f$ of this constraint, which is driven to zero by
+		/// \ref project().
+		[[nodiscard]] scalar compute_residual(
+			const vec3 &x1, const vec3 &x2, const vec3 &x3, const vec3 &x4, scalar inv_dt2, scalar lambda
+		) const {
+			const vec3 d1 = x2 - x1;
+			// scaling both normals does not change the angle
+			const vec3 n1 = vec::cross(d1, x3 - x1);
+			const vec3 n2 = vec::cross(d1, x4 - x1);
+			const scalar theta = std::atan2(vec::dot(vec::cross(n1, n2), d1) / d1.norm(), vec::dot(n1, n2));
+			const scalar c_coefficient = state.sqrt_sum_inverse_areas * state.edge_length / std::sqrt(8.0f);
+			return
+				c_coefficient * clamp_angle(theta - state.rest_angle) +
+				properties.inverse_stiffness * inv_dt2 * lambda;
+		}
 
 		constraint_properties properties = uninitialized; ///< The properties of this constraint.
 		constraint_state state = uninitialized; ///< The state of this constraint.
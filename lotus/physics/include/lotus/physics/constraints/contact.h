@@ -3,52 +3,83 @@
 /// \file
 /// Contact constraints.
 
+#include <span>
+
 #include "lotus/physics/common.h"
+#include "lotus/physics/body.h"
 
 namespace lotus::physics::constraints {
-	/// A contact constraint between two bodies.
+	/// A contact constraint between two bodies. The bodies are referenced by their indices in the array of bodies
+	/// that is passed to all member functions.
 	struct body_contact {
 		/// No initialization.
 		body_contact(uninitialized_t) {
 		}
 		/// Creates a contact for the given bodies at the given contact position in local space.
-		[[nodiscard]] inline static body_contact create_for(body &b1, body &b2, vec3 p1, vec3 p2, vec3 n) {
+		[[nodiscard]] inline static body_contact create_for(
+			std::uint32_t b1, std::uint32_t b2, vec3 p1, vec3 p2, vec3 n
+		) {
 			body_contact result = uninitialized;
 			result.offset1 = p1;
 			result.offset2 = p2;
 			result.normal = n;
-			result.body1 = &b1;
-			result.body2 = &b2;
+			result.body1 = b1;
+			result.body2 = b2;
 			return result;
 		}
 
-		/// Projects this constraint.
-		void project(scalar &lambda_n, scalar &lambda_t) {
+		/// Applies the normal multiplier carried over from a previous time step as a positional correction, so that
+		/// the solver starts from the previous solution instead of from zero.
+		void warm_start(std::span<body> bodies, scalar lambda_n) const {
+			auto correction = body::correction::compute(
+				bodies[body1], bodies[body2], offset1, offset2, normal, 0.0f
+			);
+			correction.delta_lambda = lambda_n;
+			scalar lambda = 0.0f;
+			correction.apply_position(lambda);
+		}
+
+		/// Projects this constraint. If the solve has been warm started using \ref warm_start(), contacts whose
+		/// bodies have been separated further than necessary take back part of their accumulated correction.
+		void project(std::span<body> bodies, scalar &lambda_n, scalar &lambda_t, bool warm_started) const {
+			body &b1 = bodies[body1];
+			body &b2 = bodies[body2];
 			{ // handle penetration
-				const vec3 global_contact1 = body1->state.position + body1->state.rotation.rotate(offset1);
-				const vec3 global_contact2 = body2->state.position + body2->state.rotation.rotate(offset2);
+				const vec3 global_contact1 = b1.state.position + b1.state.rotation.rotate(offset1);
+				const vec3 global_contact2 = b2.state.position + b2.state.rotation.rotate(offset2);
 				const scalar depth = vec::dot(global_contact1 - global_contact2, normal);
 				if (depth < 0.0f) {
+					if (!warm_started || lambda_n >= 0.0f) {
+						return;
+					}
+					// the bodies have been separated further than necessary, e.g., by warm starting; take back
+					// part of the accumulated correction, but never pull the bodies towards each other
+					auto correction = body::correction::compute(b1, b2, offset1, offset2, normal, depth);
+					correction.delta_lambda = std::min(correction.delta_lambda, -lambda_n);
+					correction.apply_position(lambda_n);
 					return;
 				}
 				body::correction::compute(
-					*body1, *body2, offset1, offset2, normal, depth
+					b1, b2, offset1, offset2, normal, depth
 				).apply_position(lambda_n);
 			}
 
 			{ // handle static friction
-				const vec3 global_contact1 = body1->state.position + body1->state.rotation.rotate(offset1);
-				const vec3 old_global_contact1 = body1->prev_position + body1->prev_rotation.rotate(offset1);
-				const vec3 global_contact2 = body2->state.position + body2->state.rotation.rotate(offset2);
-				const vec3 old_global_contact2 = body2->prev_position + body2->prev_rotation.rotate(offset2);
+				const vec3 global_contact1 = b1.state.position + b1.state.rotation.rotate(offset1);
+				const vec3 old_global_contact1 = b1.prev_position + b1.prev_rotation.rotate(offset1);
+				const vec3 global_contact2 = b2.state.position + b2.state.rotation.rotate(offset2);
+				const vec3 old_global_contact2 = b2.prev_position + b2.prev_rotation.rotate(offset2);
 
 				const vec3 delta_p = (global_contact1 - old_global_contact1) - (global_contact2 - old_global_contact2);
 				const vec3 delta_pt = delta_p - normal * vec::dot(normal, delta_p);
+				if (delta_pt == vec3(zero)) {
+					return;
+				}
 
-				const scalar static_friction = std::min(body1->material.static_friction, body2->material.static_friction);
+				const scalar static_friction = std::min(b1.material.static_friction, b2.material.static_friction);
 
 				const auto correction = body::correction::compute(
-					*body1, *body2, offset1, offset2, delta_pt
+					b1, b2, offset1, offset2, delta_pt
 				);
 				const scalar max_multiplier = static_friction * lambda_n;
 				if (correction.delta_lambda > max_multiplier) {
@@ -57,12 +88,22 @@ namespace lotus::physics::constraints {
 			}
 		}
 
+		/// Returns the penetration depth of the bodies at this contact, or zero if they're separated. This is the
+		/// residual of the normal constraint, which is driven to zero by \ref project().
+		[[nodiscard]] scalar compute_residual(std::span<const body> bodies) const {
+			const body &b1 = bodies[body1];
+			const body &b2 = bodies[body2];
+			const vec3 global_contact1 = b1.state.position + b1.state.rotation.rotate(offset1);
+			const vec3 global_contact2 = b2.state.position + b2.state.rotation.rotate(offset2);
+			return std::max(vec::dot(global_contact1 - global_contact2, normal), 0.0f);
+		}
+
 		/// Offset of the spring's connection to \ref body1 in its local coordinates.
 		vec3 offset1 = uninitialized;
 		/// Offset of the spring's connection to \ref body2 in its local coordinates.
 		vec3 offset2 = uninitialized;
 		vec3 normal = uninitialized; ///< Contact normal.
-		body *body1; ///< The first body.
-		body *body2; ///< The second body.
+		std::uint32_t body1; ///< Index of the first body.
+		std::uint32_t body2; ///< Index of the second body.
 	};
 }
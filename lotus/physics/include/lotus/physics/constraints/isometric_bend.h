@@ -0,0 +1,122 @@
+#pragma once
+
+/// \file
+/// Quadratic bending constraint for nearly inextensible surfaces.
+
+#include <array>
+
+#include "lotus/common.h"
+#include "lotus/math/vector.h"
+#include "bend.h"
+
+namespace lotus::physics::constraints {
+	/// Bending constraint between two triangles that share a single edge, based on the quadratic bending energy of
+	/// isometric surfaces. The energy is \f$\frac{1}{2}k|\sum_i k_i x_i|^2\f$, whose Hessian is constant, so that
+	/// all coefficients \f$k_i\f$ are computed from the rest pose and projecting the constraint only involves a
+	/// few vector additions and dot products. This is much cheaper than \ref bend, but is only accurate while
+	/// the surface is not stretched much, and it only preserves the magnitude of the rest curvature. It matches
+	/// \ref bend for small deviations from a flat rest pose.
+	///
+	/// \sa Bergou et al., A Quadratic Bending Model for Inextensible Surfaces
+	struct isometric_bend {
+		/// Properties of this constraint, which are the same as those of \ref bend.
+		using constraint_properties = bend::constraint_properties;
+		/// The state of this constraint.
+		struct constraint_state {
+		public:
+			/// No initialization.
+			constraint_state(uninitialized_t) {
+			}
+
+			/// Initializes the state from the rest pose.
+			[[nodiscard]] inline static constraint_state from_rest_pose(
+				const vec3 &e1, const vec3 &e2, const vec3 &x3, const vec3 &x4
+			) {
+				const vec3 d1 = e2 - e1;
+				const vec3 d2 = x3 - e1;
+				const vec3 d3 = x4 - e1;
+				const vec3 d4 = x3 - e2;
+				const vec3 d5 = x4 - e2;
+				// cotangents of the angles at the edge vertices in both triangles
+				const auto cot = [](vec3 a, vec3 b) {
+					return vec::dot(a, b) / vec::cross(a, b).norm();
+				};
+				const scalar c1 = cot(d1, d2);
+				const scalar c2 = cot(d1, d3);
+				const scalar c3 = cot(-d1, d4);
+				const scalar c4 = cot(-d1, d5);
+				const scalar inv_a1 = 2.0f / vec::cross(d1, d2).norm();
+				const scalar inv_a2 = 2.0f / vec::cross(d1, d3).norm();
+
+				// scale the coefficients so that the constraint matches that of bend for a small bending angle
+				const scalar scale = std::sqrt((inv_a1 + inv_a2) / 8.0f);
+				constraint_state result = uninitialized;
+				result.coefficients = {
+					scale * (c3 + c4), scale * (c1 + c2), -scale * (c1 + c3), -scale * (c2 + c4)
+				};
+				result.rest_curvature = result.compute_curvature(e1, e2, x3, x4).norm();
+				return result;
+			}
+
+			/// Computes \f$\sum_i k_i x_i\f$, which is proportional to the mean curvature normal at the edge.
+			[[nodiscard]] vec3 compute_curvature(const vec3 &x1, const vec3 &x2, const vec3 &x3, const vec3 &x4) const {
+				return
+					coefficients[0] * x1 + coefficients[1] * x2 +
+					coefficients[2] * x3 + coefficients[3] * x4;
+			}
+
+			/// Coefficients \f$k_i\f$ of the four particles. They sum to zero, so that rigid translations do not
+			/// change the curvature.
+			std::array<scalar, 4> coefficients;
+			/// Norm of \ref compute_curvature() in the rest pose, which is zero for flat surfaces.
+			scalar rest_curvature;
+		};
+
+		/// No initialization.
+		isometric_bend(uninitialized_t) {
+		}
+
+		/// Projects this constraint.
+		void project(
+			vec3 &x1, vec3 &x2, vec3 &x3, vec3 &x4,
+			scalar inv_m1, scalar inv_m2, scalar inv_m3, scalar inv_m4,
+			scalar inv_dt2, scalar &lambda
+		) const {
+			const vec3 h = state.compute_curvature(x1, x2, x3, x4);
+			const scalar h_norm = h.norm();
+			if (h_norm < 1e-6f) { // the gradient is undefined
+				return;
+			}
+			const std::array<scalar, 4> &k = state.coefficients;
+
+			const scalar c = h_norm - state.rest_curvature;
+			const scalar alpha_hat = properties.inverse_stiffness * inv_dt2;
+			const scalar delta_lambda = -(c + alpha_hat * lambda) / (
+				inv_m1 * k[0] * k[0] + inv_m2 * k[1] * k[1] + inv_m3 * k[2] * k[2] + inv_m4 * k[3] * k[3] +
+				alpha_hat
+			);
+			lambda += delta_lambda;
+			const vec3 dir = h * (delta_lambda / h_norm);
+			x1 += (inv_m1 * k[0]) * dir;
+			x2 += (inv_m2 * k[1]) * dir;
+			x3 += (inv_m3 * k[2]) * dir;
+			x4 += (inv_m4 * k[3]) * dir;
+		}
+		/// Returns the residual \f$C + \tilde{\alpha}\lambda\f$ of this constraint, which is driven to zero by
+		/// \ref project().
+		[[nodiscard]] scalar compute_residual(
+			const vec3 &x1, const vec3 &x2, const vec3 &x3, const vec3 &x4, scalar inv_dt2, scalar lambda
+		) const {
+			return
+				state.compute_curvature(x1, x2, x3, x4).norm() - state.rest_curvature +
+				properties.inverse_stiffness * inv_dt2 * lambda;
+		}
+
+		constraint_properties properties = uninitialized; ///< The properties of this constraint.
+		constraint_state state = uninitialized; ///< The state of this constraint.
+		std::size_t particle_edge1; ///< Index of the first particle on the shared edge.
+		std::size_t particle_edge2; ///< Index of the second particle on the shared edge.
+		std::size_t particle3; ///< Index of the third particle. This particle is not on the shared edge.
+		std::size_t particle4; ///< Index of the fourth particle. This particle is not on the shared edge.
+	};
+}
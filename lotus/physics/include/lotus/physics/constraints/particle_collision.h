@@ -0,0 +1,119 @@
+#pragma once
+
+/// \file
+/// Collision constraints between particles, and between particles and triangles formed by other particles.
+
+#include <cmath>
+
+#include "lotus/common.h"
+#include "lotus/math/vector.h"
+#include "lotus/physics/common.h"
+
+namespace lotus::physics::constraints {
+	/// Keeps two particles at least a given distance apart.
+	struct particle_pair_collision {
+		/// No initialization.
+		particle_pair_collision(uninitialized_t) {
+		}
+		/// Creates a constraint between the two given particles.
+		[[nodiscard]] inline static particle_pair_collision create(std::uint32_t p1, std::uint32_t p2) {
+			particle_pair_collision result = uninitialized;
+			result.particle1 = p1;
+			result.particle2 = p2;
+			return result;
+		}
+
+		/// Projects this constraint if the particles are closer than the given distance.
+		void project(vec3 &x1, vec3 &x2, scalar inv_m1, scalar inv_m2, scalar thickness) const {
+			const vec3 d = x2 - x1;
+			const scalar dist2 = d.squared_norm();
+			const scalar w = inv_m1 + inv_m2;
+			// coincident particles have no well-defined direction to be separated along
+			if (dist2 >= thickness * thickness || dist2 == 0.0f || w == 0.0f) {
+				return;
+			}
+			const scalar dist = std::sqrt(dist2);
+			const vec3 dx = ((thickness - dist) / (w * dist)) * d;
+			x1 -= inv_m1 * dx;
+			x2 += inv_m2 * dx;
+		}
+
+		std::uint32_t particle1; ///< The first particle.
+		std::uint32_t particle2; ///< The second particle.
+	};
+
+	/// Keeps a particle on one side of a triangle formed by three other particles, at least a given distance away
+	/// from the triangle. The constraint is only enforced while the particle projects onto the inside of the
+	/// triangle; neighboring triangles handle the rest.
+	struct particle_triangle_collision {
+		/// No initialization.
+		particle_triangle_collision(uninitialized_t) {
+		}
+		/// Creates a constraint between the given particle and triangle. The particle is kept on the side of the
+		/// triangle that the normal (x2 - x1) x (x3 - x1) points to if \p positive_side is \p true, and on the
+		/// other side otherwise.
+		[[nodiscard]] inline static particle_triangle_collision create(
+			std::uint32_t p, std::uint32_t t1, std::uint32_t t2, std::uint32_t t3, bool positive_side
+		) {
+			particle_triangle_collision result = uninitialized;
+			result.particle = p;
+			result.triangle1 = t1;
+			result.triangle2 = t2;
+			result.triangle3 = t3;
+			result.side = positive_side ? 1.0f : -1.0f;
+			return result;
+		}
+
+		/// Projects this constraint if the particle is closer to the triangle than the given distance, or on the
+		/// wrong side of it.
+		void project(
+			vec3 &x, vec3 &x1, vec3 &x2, vec3 &x3,
+			scalar inv_m, scalar inv_m1, scalar inv_m2, scalar inv_m3, scalar thickness
+		) const {
+			const vec3 e1 = x2 - x1;
+			const vec3 e2 = x3 - x1;
+			vec3 n = vec::cross(e1, e2);
+			const scalar n_norm = n.norm();
+			if (n_norm == 0.0f) {
+				return;
+			}
+			n *= side / n_norm;
+			const vec3 offset = x - x1;
+			const scalar c = vec::dot(offset, n) - thickness;
+			if (c >= 0.0f) {
+				return;
+			}
+
+			// barycentric coordinates of the projection of the particle onto the plane of the triangle
+			const scalar d11 = vec::dot(e1, e1);
+			const scalar d12 = vec::dot(e1, e2);
+			const scalar d22 = vec::dot(e2, e2);
+			const scalar d1 = vec::dot(offset, e1);
+			const scalar d2 = vec::dot(offset, e2);
+			const scalar denom = d11 * d22 - d12 * d12;
+			const scalar b2 = (d22 * d1 - d12 * d2) / denom;
+			const scalar b3 = (d11 * d2 - d12 * d1) / denom;
+			const scalar b1 = 1.0f - b2 - b3;
+			if (!(b1 >= 0.0f && b2 >= 0.0f && b3 >= 0.0f)) {
+				return;
+			}
+
+			const scalar w = inv_m + b1 * b1 * inv_m1 + b2 * b2 * inv_m2 + b3 * b3 * inv_m3;
+			if (w == 0.0f) {
+				return;
+			}
+			const vec3 dx = (-c / w) * n;
+			x += inv_m * dx;
+			x1 -= (b1 * inv_m1) * dx;
+			x2 -= (b2 * inv_m2) * dx;
+			x3 -= (b3 * inv_m3) * dx;
+		}
+
+		std::uint32_t particle; ///< The particle.
+		std::uint32_t triangle1; ///< The first particle of the triangle.
+		std::uint32_t triangle2; ///< The second particle of the triangle.
+		std::uint32_t triangle3; ///< The third particle of the triangle.
+		/// 1 if the particle should stay on the side that the normal of the triangle points to, and -1 otherwise.
+		scalar side;
+	};
+}
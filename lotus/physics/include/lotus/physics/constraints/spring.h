@@ -38,6 +38,11 @@ namespace lotus::physics::constraints {
 			x1 -= inv_m1 * dx;
 			x2 += inv_m2 * dx;
 		}
+		/// Returns the residual \f$C + \tilde{\alpha}\lambda\f$ of this constraint, which is driven to zero by
+		/// \ref project().
+		[[nodiscard]] scalar compute_residual(const vec3 &x1, const vec3 &x2, scalar inv_dt2, scalar lambda) const {
+			return (x2 - x1).norm() - properties.length + properties.inverse_stiffness * inv_dt2 * lambda;
+		}
 
 		spring_constraint_properties properties = uninitialized; ///< Properties of this constraint.
 		std::size_t particle1; ///< The first particle affected by this constraint.
@@ -0,0 +1,57 @@
+#pragma once
+
+/// \file
+/// Spring constraints grouped for SIMD projection.
+
+#include <span>
+#include <vector>
+
+#include "lotus/physics/constraint_coloring.h"
+#include "lotus/physics/particle_soa.h"
+#include "spring.h"
+
+namespace lotus::physics::constraints {
+	/// Spring constraints stored in batches of \ref batch_size. All springs in a batch have the same color and
+	/// therefore share no particles, so a whole batch can be projected at once using SIMD instructions. The
+	/// kernel uses AVX2 or SSE2 when the compiler targets them, and falls back to scalar code otherwise.
+	struct particle_spring_batches {
+		/// The number of springs in a batch.
+		constexpr static std::size_t batch_size = 8;
+
+		/// Groups the given springs into batches, color by color.
+		[[nodiscard]] static particle_spring_batches create(
+			std::span<const particle_spring>, const constraint_coloring&
+		);
+
+		/// Sets the lambda values of all springs to zero.
+		void reset_lambdas();
+		/// Copies lambda values into the given array, which is indexed in the original order of the springs.
+		void store_lambdas(std::span<scalar>) const;
+
+		/// Projects all springs in batches [begin, end) once.
+		void project(particle_soa&, std::size_t begin, std::size_t end, scalar inv_dt2);
+
+		/// Returns the number of colors.
+		[[nodiscard]] std::size_t get_num_colors() const {
+			return color_offsets.empty() ? 0 : color_offsets.size() - 1;
+		}
+		/// Returns the number of batches.
+		[[nodiscard]] std::size_t get_num_batches() const {
+			return num_springs.size();
+		}
+
+		// each of the following arrays contains batch_size elements for each batch
+		std::vector<std::int32_t> particle1; ///< Indices of the first particles.
+		std::vector<std::int32_t> particle2; ///< Indices of the second particles.
+		std::vector<scalar> length; ///< Rest lengths of the springs.
+		std::vector<scalar> inverse_stiffness; ///< Inverse stiffness of the springs.
+		std::vector<scalar> lambda; ///< Lambda values of the springs.
+		/// Indices of the springs in the original array. Unused slots are filled with
+		/// \p std::numeric_limits<std::uint32_t>::max().
+		std::vector<std::uint32_t> spring_indices;
+
+		std::vector<std::uint8_t> num_springs; ///< The number of springs in each batch.
+		/// Index of the first batch of each color, followed by the total number of batches.
+		std::vector<std::uint32_t> color_offsets;
+	};
+}
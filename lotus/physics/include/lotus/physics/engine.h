@@ -3,79 +3,299 @@
 /// \file
 /// The PBD simulation engine.
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <vector>
-#include <list>
 #include <deque>
 #include <optional>
+#include <span>
 
+#include "lotus/containers/dense_pool.h"
+#include "lotus/utils/thread_pool.h"
 #include "lotus/collision/shape.h"
+#include "lotus/collision/broad_phase.h"
+#include "lotus/collision/algorithms/conservative_advancement.h"
+#include "lotus/collision/algorithms/feature_clipping.h"
+#include "lotus/collision/algorithms/gjk_distance.h"
+#include "lotus/collision/algorithms/gjk_epa.h"
 #include "constraints/spring.h"
 #include "constraints/contact.h"
 #include "constraints/face.h"
 #include "constraints/bend.h"
+#include "constraints/isometric_bend.h"
+#include "constraints/particle_collision.h"
+#include "constraints/spring_batches.h"
 #include "body.h"
+#include "constraint_coloring.h"
+#include "particle_grid.h"
+#include "particle_soa.h"
+#include "statistics.h"
 
 namespace lotus::physics {
+	/// Identifies a body in \ref engine::bodies. Handles stay valid when other bodies are removed.
+	using body_handle = dense_pool<body>::handle;
+
+	/// Optional data used by the narrow phase of \ref engine when testing a pair of shapes. Members that are
+	/// \p nullptr are ignored.
+	struct narrow_phase_context {
+		/// Data of the pair from the previous time step, used as a starting point by GJK and updated with the
+		/// results of this test.
+		collision::gjk_epa::pair_cache *gjk_cache = nullptr;
+		/// Counters to update. These are not updated if \ref instrumentation_enabled is \p false.
+		step_counters *counters = nullptr;
+	};
+
 	/// The PBD simulation engine.
 	class engine {
 	public:
-		/// Result of collision detection.
+		/// The order in which particle constraints (springs, faces, and bends) are projected.
+		enum class constraint_ordering {
+			serial, ///< Constraints are projected one by one in the order they're stored.
+			/// Constraints are grouped by graph coloring, and constraints of the same color are projected in
+			/// parallel using \ref worker_pool. Results do not depend on the number of threads.
+			colored_parallel,
+
+			num_constraint_orderings ///< The number of available orderings.
+		};
+		/// How particle data is laid out in memory during constraint projection.
+		enum class particle_layout {
+			/// Particles are accessed directly in \ref particles.
+			array_of_structures,
+			/// Particles are copied into separate arrays for each component before projection and copied back
+			/// afterwards. Spring constraints are always projected color by color in SIMD batches in this mode.
+			structure_of_arrays,
+
+			num_particle_layouts ///< The number of available layouts.
+		};
+		/// How often collision detection is performed by \ref timestep_substepped().
+		enum class collision_detection_cadence {
+			/// Collisions are detected in the first substep, and the contacts are reused in later substeps.
+			once_per_frame,
+			once_per_substep, ///< Collisions are detected in every substep.
+
+			num_collision_detection_cadences ///< The number of available cadences.
+		};
+		/// How particle positions are extrapolated between iterations of the position solve to speed up the
+		/// convergence of spring, face, and bend constraints.
+		enum class iteration_acceleration {
+			none, ///< Positions are not extrapolated.
+			/// Successive over-relaxation: the change of positions made by each iteration is scaled by
+			/// \ref over_relaxation_factor.
+			over_relaxation,
+			/// Chebyshev semi-iterative acceleration: after \ref chebyshev_delay plain iterations, positions are
+			/// extrapolated from those two iterations earlier with weights that follow the Chebyshev recurrence for
+			/// \ref chebyshev_spectral_radius.
+			chebyshev,
+
+			num_iteration_accelerations ///< The number of available acceleration methods.
+		};
+
+		/// Points of a contact manifold that are separated by at most this distance are kept along with penetrating
+		/// ones. They produce no correction until they penetrate, but keep manifolds of resting bodies complete.
+		constexpr static scalar contact_manifold_margin = 0.01f;
+
+		/// Result of collision detection: a manifold of contact points that share the same normal.
 		struct collision_detection_result {
+			/// The maximum number of contact points.
+			constexpr static std::uint32_t max_points = collision::feature_clipping::max_manifold_points;
+
+			/// A single point of contact.
+			struct contact_point {
+				/// No initialization.
+				contact_point(uninitialized_t) {
+				}
+
+				vec3 contact1 = uninitialized; ///< Contact point on the first object in local space.
+				vec3 contact2 = uninitialized; ///< Contact point on the second object in local space.
+				/// Feature of the first object involved in the contact.
+				collision::contact_feature feature1 = collision::contact_feature::none();
+				/// Feature of the second object involved in the contact.
+				collision::contact_feature feature2 = collision::contact_feature::none();
+			};
+
 			/// No initialization.
 			collision_detection_result(uninitialized_t) {
 			}
-			/// Creates a new object.
-			[[nodiscard]] inline static collision_detection_result create(vec3 c1, vec3 c2, vec3 n) {
+			/// Creates a new object with the given normal and no contact points.
+			[[nodiscard]] inline static collision_detection_result create(vec3 n) {
 				collision_detection_result result = uninitialized;
+				result.normal = n;
+				result.num_points = 0;
+				result.time_of_impact = 1.0f;
+				return result;
+			}
+			/// Creates a new object with a single contact point.
+			[[nodiscard]] inline static collision_detection_result create(vec3 c1, vec3 c2, vec3 n) {
+				collision_detection_result result = create(n);
+				result.add_point(c1, c2);
+				return result;
+			}
+
+			/// Adds a contact point to this manifold and returns it.
+			contact_point &add_point(vec3 c1, vec3 c2) {
+				crash_if(num_points >= max_points);
+				contact_point &result = points[num_points];
+				++num_points;
 				result.contact1 = c1;
 				result.contact2 = c2;
-				result.normal = n;
+				result.feature1 = collision::contact_feature::none();
+				result.feature2 = collision::contact_feature::none();
 				return result;
 			}
+			/// Returns the valid contact points.
+			[[nodiscard]] std::span<contact_point> get_points() {
+				return std::span(points.data(), num_points);
+			}
+			/// \overload
+			[[nodiscard]] std::span<const contact_point> get_points() const {
+				return std::span(points.data(), num_points);
+			}
 
-			vec3 contact1 = uninitialized; ///< Contact point on the first object in local space.
-			vec3 contact2 = uninitialized; ///< Contact point on the second object in local space.
-			/// Normalized contact normal. There's no guarantee of its direction.
+			/// Contact points. Only the first \ref num_points entries are valid.
+			std::array<contact_point, max_points> points{ uninitialized, uninitialized, uninitialized, uninitialized };
+			std::uint32_t num_points; ///< The number of contact points.
+			/// Normalized contact normal pointing from the first object towards the second.
 			vec3 normal = uninitialized;
+			/// For speculative contacts found by \ref detect_continuous_collision(), the time at which the objects
+			/// touch relative to the time step. This is one for contacts that are found at the end of the time step.
+			scalar time_of_impact;
 		};
 
-		/// Executes one time step with the given delta time in seconds and the given number of iterations.
+		/// Residuals of position constraints, grouped by constraint type. The residual of a spring, face, or bend
+		/// constraint is \f$C(x) + \tilde{\alpha}\lambda\f$, which XPBD drives to zero, and that of a contact is
+		/// its penetration depth. Each value is the root mean square of the residuals of all constraints of the
+		/// type, or zero if there are none.
+		struct constraint_residuals {
+			scalar springs = 0.0f; ///< Residual of spring constraints.
+			scalar faces = 0.0f; ///< Residual of face constraints.
+			scalar bends = 0.0f; ///< Residual of bend and isometric bend constraints.
+			scalar contacts = 0.0f; ///< Residual of contact constraints.
+
+			/// Returns the largest residual of all constraint types.
+			[[nodiscard]] scalar max() const {
+				return std::max({ springs, faces, bends, contacts });
+			}
+		};
+		/// Convergence of a position solve.
+		struct position_solve_report {
+			/// The number of iterations performed for particle constraints.
+			std::uint32_t particle_iterations = 0;
+			/// The largest number of iterations performed for any island of contacts.
+			std::uint32_t contact_iterations = 0;
+			/// Residuals after the last iteration. These are only computed if \ref convergence_monitoring or
+			/// \ref particle_iteration_acceleration is enabled, and are zero otherwise. Contacts are only
+			/// included with \ref convergence_monitoring.
+			constraint_residuals residuals;
+			/// Whether \ref particle_iteration_acceleration has been turned off during this solve because the
+			/// residuals grew.
+			bool acceleration_fallback = false;
+		};
+
+		/// Executes one time step with the given delta time in seconds and the given number of iterations. If
+		/// \ref convergence_monitoring is enabled, the number of iterations is the maximum. Restitution and
+		/// dynamic friction are not applied at contacts of bodies that were separated by less than
+		/// \ref contact_manifold_margin and have not been pushed apart during the position solve, so that they're
+		/// not held together.
 		void timestep(scalar dt, std::uint32_t iters);
+		/// Executes one time step by splitting it into the given number of substeps, each of which is a full
+		/// time step with the given number of iterations. Collision detection is performed according to
+		/// \ref substep_collision_detection. Restitution and dynamic friction are only applied at contacts that
+		/// have pushed the bodies apart during the position solve of the substep, since contacts detected in an
+		/// earlier substep may belong to bodies that have since separated.
+		void timestep_substepped(scalar dt, std::uint32_t substeps, std::uint32_t iters = 1);
 
+		/// Forces the colorings and batches of particle constraints, as well as the pairs of particles excluded from
+		/// self-collision, to be recomputed before they're used next time. They are automatically recomputed when
+		/// the number of constraints change; this function should be called when existing constraints are modified.
+		void invalidate_constraint_colorings();
+
+		/// Version of the binary format written by \ref save_snapshot(). Snapshots with a different version are
+		/// rejected by \ref restore_snapshot().
+		constexpr static std::uint32_t snapshot_version = 1;
+		/// Returns the number of bytes required by \ref save_snapshot() for the current state.
+		[[nodiscard]] std::size_t get_snapshot_size() const;
+		/// Returns the number of bytes required by \ref save_snapshot_delta() for the current state, which is four
+		/// bytes per particle and per body more than \ref get_snapshot_size(), since changed particles and bodies
+		/// are saved with their indices.
+		[[nodiscard]] std::size_t get_snapshot_delta_size() const;
+		/// Saves the simulation state into the given buffer without allocating any memory. This includes the
+		/// states of all particles and bodies, lambda values of all constraints, results of previous projections
+		/// of face constraints, the contacts detected in the last time step, and the data kept between time steps
+		/// for warm starting and collision pair caching, so that simulating from a restored snapshot produces the
+		/// same results. Shapes, properties of particles and bodies, constraints themselves, and settings are not
+		/// saved; they must be the same when the snapshot is restored. Returns the number of bytes written, or zero
+		/// if the buffer is too small.
+		std::size_t save_snapshot(std::span<std::byte>) const;
+		/// Saves a snapshot like \ref save_snapshot(), but only includes particles and bodies whose states differ
+		/// from those in the given full snapshot, e.g., because pinned particles and sleeping bodies do not change.
+		/// Particles and bodies are each saved in full if their deltas would not be smaller; if neither is, the
+		/// result is a full snapshot, which \ref restore_snapshot() accepts the same way. The base snapshot must be
+		/// from a state with the same particles and bodies. Returns the number of bytes written, or zero if the
+		/// buffer is too small or if the base snapshot does not match the current particles and bodies.
+		std::size_t save_snapshot_delta(std::span<const std::byte> base, std::span<std::byte>) const;
+		/// Restores the simulation state from a snapshot. For delta snapshots, the full snapshot that it's based
+		/// on must also be given. Returns \p false and leaves the engine unchanged if the snapshot has a different
+		/// version, or if the particles, bodies, or constraints of the engine do not match it; bodies are matched
+		/// by their handles.
+		bool restore_snapshot(std::span<const std::byte> snapshot, std::span<const std::byte> base = {});
 
 		/// Detects collision between two generic shapes.
 		[[nodiscard]] static std::optional<collision_detection_result> detect_collision(
-			const collision::shape&, const body_state&, const collision::shape&, const body_state&
+			const collision::shape&, const body_state&, const collision::shape&, const body_state&,
+			narrow_phase_context = {}
 		);
 		/// Fallback case for collision detection between generic shapes - this always returns \p std::nullopt and
 		/// should only be used internally.
 		template <
 			typename Shape1, typename Shape2
 		> [[nodiscard]] static std::optional<engine::collision_detection_result> detect_collision(
-			const Shape1&, const body_state&, const Shape2&, const body_state&
+			const Shape1&, const body_state&, const Shape2&, const body_state&, narrow_phase_context = {}
 		);
-		/// Detects collision between a sphere and a plane.
+		/// Detects collision between a plane and a sphere.
 		[[nodiscard]] static std::optional<collision_detection_result> detect_collision(
-			const collision::shapes::sphere&, const body_state&, const collision::shapes::plane&, const body_state&
+			const collision::shapes::plane&, const body_state&, const collision::shapes::sphere&, const body_state&,
+			narrow_phase_context = {}
 		);
 		/// Detects collision between two spheres.
 		[[nodiscard]] static std::optional<collision_detection_result> detect_collision(
-			const collision::shapes::sphere&, const body_state&, const collision::shapes::sphere&, const body_state&
+			const collision::shapes::sphere&, const body_state&, const collision::shapes::sphere&, const body_state&,
+			narrow_phase_context = {}
 		);
-		/// Detects collision between a plane and a polyhedron.
+		/// Detects collision between a plane and a polyhedron. If any vertex is below the plane, all vertices within
+		/// \ref contact_manifold_margin of it are contact points, and the manifold is reduced using
+		/// \ref collision::feature_clipping::reduce().
 		[[nodiscard]] static std::optional<collision_detection_result> detect_collision(
 			const collision::shapes::plane&, const body_state&,
-			const collision::shapes::polyhedron&, const body_state&
+			const collision::shapes::polyhedron&, const body_state&, narrow_phase_context = {}
 		);
-		/// Detects collision between a sphere and a polyhedron.
+		/// Detects collision between a sphere and a polyhedron. The closest point on the polyhedron to the center of
+		/// the sphere is found using \ref collision::gjk_distance; only if the center is inside the polyhedron is
+		/// the penetration depth computed using \ref collision::gjk_epa.
 		[[nodiscard]] static std::optional<collision_detection_result> detect_collision(
 			const collision::shapes::sphere&, const body_state&,
-			const collision::shapes::polyhedron&, const body_state&
+			const collision::shapes::polyhedron&, const body_state&, narrow_phase_context = {}
 		);
-		/// Detects collision between two polyhedra.
+		/// Detects collision between two polyhedra. The contact normal is found using \ref collision::gjk_epa; if the
+		/// features of both polyhedra along it can be clipped against each other, the contact manifold contains
+		/// multiple points, and otherwise it contains the single point found by EPA. Polyhedra that are separated
+		/// by less than \ref contact_manifold_margin also produce a manifold with negative depths, so that bodies
+		/// resting on each other keep their contacts even if the position solve has left them just apart.
 		[[nodiscard]] static std::optional<collision_detection_result> detect_collision(
 			const collision::shapes::polyhedron&, const body_state&,
-			const collision::shapes::polyhedron&, const body_state&
+			const collision::shapes::polyhedron&, const body_state&, narrow_phase_context = {}
+		);
+
+		/// Detects collision between two shapes that move between the given states during a time step, using
+		/// \ref collision::conservative_advancement. If the shapes are separated by more than
+		/// \ref contact_manifold_margin at the start of the time step and touch during it, the result is a
+		/// speculative manifold between the shapes at the time of impact. If conservative advancement runs out of
+		/// iterations, the manifold is created at the time reached instead, with the remaining separation as
+		/// negative depths. If the shapes already touch at the start, or if their distance cannot be computed, this
+		/// falls back to discrete collision detection at the final states.
+		[[nodiscard]] static std::optional<collision_detection_result> detect_continuous_collision(
+			const collision::shape&, const body_state &from1, const body_state &to1,
+			const collision::shape&, const body_state &from2, const body_state &to2, narrow_phase_context = {}
 		);
 
 		/// Handles the collision between a plane and a particle.
@@ -89,9 +309,37 @@ namespace lotus::physics {
 		/// The list of shapes. This provides a convenient place to store shapes, but the user can store shapes
 		/// anywhere.
 		std::deque<collision::shape> shapes;
-		std::list<body> bodies; ///< The list of bodies.
+		/// All bodies, stored contiguously. Removing a body moves the last body into its place, so indices into
+		/// this array are only valid until bodies are added or removed; \ref body_handle should be used to refer
+		/// to bodies across time steps. Bodies must not be added or removed during a time step.
+		dense_pool<body> bodies;
+		/// The broad phase algorithm used to find pairs of bodies that may collide.
+		collision::broad_phase body_broad_phase =
+			collision::broad_phase::create(collision::broad_phase::type::sweep_and_prune);
+		/// Whether the final GJK simplex and separating axis of each pair of bodies are kept between time steps and
+		/// used as the starting point of the next test.
+		bool collision_pair_caching = true;
 
 		std::vector<particle> particles; ///< The list of particles.
+		/// Particles are sorted into a uniform grid with cells of this size before each position solve. Each
+		/// kinematic body then only tests particles in the cells that overlap its bounding box for collisions, and
+		/// the same candidates are used by all iterations of the solve.
+		scalar particle_grid_cell_size = 0.1f;
+		/// Bounding boxes of kinematic bodies are enlarged by this distance, plus the largest distance that any
+		/// particle has moved during prediction, when gathering collision candidates. Particles that move further
+		/// during the iterations of a single position solve are only tested in the next one.
+		scalar particle_collision_margin = 0.01f;
+		/// Whether particles collide with each other, and with the triangles of \ref face_constraints. Particles
+		/// that share a spring, face, or bend constraint do not collide with each other, and particles do not
+		/// collide with the triangles they belong to. Collision constraints are found before each position solve
+		/// between particles and triangles that are closer than \ref self_collision_thickness plus
+		/// \ref particle_collision_margin, and are projected after all other particle constraints in each
+		/// iteration, one by one.
+		bool particle_self_collision = false;
+		/// The minimum distance kept between colliding particles, and between particles and triangles. This also
+		/// determines the cell size of the grid used to find collisions, and should be smaller than the distance
+		/// between particles that are not connected by constraints.
+		scalar self_collision_thickness = 0.005f;
 
 		std::vector<constraints::particle_spring> particle_spring_constraints; ///< The list of spring constraints.
 		std::vector<scalar> spring_lambdas; ///< Lambda values for all spring constraints.
@@ -105,9 +353,352 @@ namespace lotus::physics {
 		std::vector<constraints::bend> bend_constraints; ///< The list of bend constraints.
 		std::vector<scalar> bend_lambdas; ///< Lambda values for bend constraints.
 
-		std::deque<constraints::body_contact> contact_constraints; ///< Contact constraints.
+		/// The list of isometric bend constraints, which are a cheaper alternative to \ref bend_constraints.
+		std::vector<constraints::isometric_bend> isometric_bend_constraints;
+		std::vector<scalar> isometric_bend_lambdas; ///< Lambda values for isometric bend constraints.
+
+		/// Contact constraints. Bodies are referenced by their indices in \ref bodies.
+		std::vector<constraints::body_contact> contact_constraints;
 		std::vector<std::pair<scalar, scalar>> contact_lambdas; ///< Lambda values for contact constraints.
+		/// Whether contacts that persist across time steps, identified by their bodies and features, start the
+		/// position solve with the lambda values they ended the previous time step with. The normal lambda is
+		/// applied as a positional correction before the first iteration, and contacts that end up separated
+		/// further than necessary take back part of it. Contacts are matched regardless of this value, and the
+		/// results are reported in \ref accumulated_statistics.
+		bool contact_warm_starting = false;
 
 		vec3 gravity = zero; ///< Gravity.
+
+		/// Whether bodies that have come to rest are put to sleep. Dynamic bodies that are in contact form
+		/// islands, and an island falls asleep once all of its bodies have been resting for \ref time_to_sleep
+		/// seconds. Sleeping bodies are skipped by all phases of the simulation until they're woken up, which
+		/// happens to the entire island when one of its bodies is touched by an awake body or has its
+		/// \ref body::state modified. Disabling this wakes up all bodies in the next time step.
+		bool sleeping_enabled = false;
+		/// Bodies whose linear velocity is below this value may fall asleep.
+		scalar sleep_linear_velocity_threshold = 0.05f;
+		/// Bodies whose angular velocity is below this value may fall asleep.
+		scalar sleep_angular_velocity_threshold = 0.05f;
+		/// How long all bodies in an island need to be resting before the island falls asleep, in seconds.
+		scalar time_to_sleep = 0.5f;
+
+		/// Statistics accumulated over all time steps so far. This can be reset by the user at any time. All
+		/// statistics stay zero if \ref instrumentation_enabled is \p false.
+		step_statistics accumulated_statistics;
+		/// Statistics of recent calls to \ref timestep() or \ref timestep_substepped(), one entry per call.
+		statistics_history recent_statistics = statistics_history::create(256);
+
+		/// How often collision detection is performed by \ref timestep_substepped().
+		collision_detection_cadence substep_collision_detection = collision_detection_cadence::once_per_frame;
+		/// The order in which particle constraints are projected.
+		constraint_ordering particle_constraint_ordering = constraint_ordering::serial;
+		/// Whether the position solver computes the residuals of constraints every \ref residual_check_interval
+		/// iterations and after the last one, and stops early once they're below \ref residual_tolerance. Each
+		/// island of contacts stops on its own once the residual of its contacts is small enough, while spring,
+		/// face, and bend constraints stop together once the residual of each type is small enough. Collisions
+		/// involving particles are not taken into account. The results are reported in \ref last_position_solve.
+		bool convergence_monitoring = false;
+		/// The number of iterations between two residual computations when \ref convergence_monitoring is enabled.
+		/// Computing the residuals costs roughly as much as half an iteration.
+		std::uint32_t residual_check_interval = 4;
+		/// The position solver stops once all residuals are below this value when \ref convergence_monitoring is
+		/// enabled.
+		scalar residual_tolerance = 1e-4f;
+		/// Convergence of the last position solve, i.e., of the last substep for \ref timestep_substepped().
+		position_solve_report last_position_solve;
+		/// How particle positions are extrapolated between iterations. When this is enabled, residuals of particle
+		/// constraints are computed every \ref residual_check_interval iterations even if
+		/// \ref convergence_monitoring is disabled. Extrapolation is turned off for the rest of the position solve
+		/// as soon as the largest residual grows between two checks, or as soon as an iteration moves particles
+		/// more than the first iteration did. Positions are never extrapolated after the last iteration, so that
+		/// collisions handled in that iteration are kept.
+		iteration_acceleration particle_iteration_acceleration = iteration_acceleration::none;
+		/// Scale of position changes for \ref iteration_acceleration::over_relaxation. Values between 1 and about
+		/// 1.5 are useful; larger values make the iterations of stiff cloth oscillate, so that extrapolation is
+		/// turned off after a few iterations in almost every time step.
+		scalar over_relaxation_factor = 1.5f;
+		/// Estimated spectral radius of a plain iteration for \ref iteration_acceleration::chebyshev, which must
+		/// be less than one. Larger values extrapolate more aggressively.
+		scalar chebyshev_spectral_radius = 0.9f;
+		/// The number of plain iterations before Chebyshev extrapolation starts. This is at least one.
+		std::uint32_t chebyshev_delay = 2;
+		/// How particles are stored during constraint projection. Regardless of this value, \ref particles is
+		/// up-to-date between time steps.
+		particle_layout particle_storage_layout = particle_layout::array_of_structures;
+		/// Worker threads used for parallel constraint projection. The pool is owned by the user. If this is
+		/// \p nullptr, all work is done on the calling thread.
+		thread_pool *worker_pool = nullptr;
+		/// The number of constraints of the same color that are projected by a single task.
+		std::size_t constraint_batch_size = 256;
+		/// Contacts are grouped into islands of dynamic bodies that touch each other, either directly or through
+		/// other dynamic bodies. Islands are independent, so each island is solved by a single task on
+		/// \ref worker_pool, which projects its contacts in the order they're detected. Islands with more contacts
+		/// than this are instead split by graph coloring, and contacts of the same color are projected in
+		/// parallel, so that one large pile does not serialize the time step. Results do not depend on the number
+		/// of threads.
+		std::size_t max_serial_island_contacts = 256;
+	protected:
+		constraint_coloring _spring_coloring; ///< Coloring of \ref particle_spring_constraints.
+		constraint_coloring _face_coloring; ///< Coloring of \ref face_constraints.
+		constraint_coloring _bend_coloring; ///< Coloring of \ref bend_constraints.
+		constraint_coloring _isometric_bend_coloring; ///< Coloring of \ref isometric_bend_constraints.
+		bool _colorings_valid = false; ///< Whether colorings have been computed and have not been invalidated.
+		/// Spring constraints grouped by \ref _spring_coloring, used with the structure-of-arrays layout.
+		constraints::particle_spring_batches _spring_batches;
+		particle_soa _particle_soa; ///< Particle data used with the structure-of-arrays layout.
+		particle_grid _particle_grid; ///< Grid of particle positions, used to find collision candidates.
+		/// Indices of kinematic bodies in \ref bodies that may collide with particles in the ongoing position solve.
+		std::vector<std::uint32_t> _particle_collision_bodies;
+		/// Offsets of the first candidate of each body of \ref _particle_collision_bodies in
+		/// \ref _particle_collision_candidates, followed by the total number of candidates.
+		std::vector<std::uint32_t> _particle_collision_offsets;
+		/// Indices of particles that may collide with each body in \ref _particle_collision_bodies.
+		std::vector<std::uint32_t> _particle_collision_candidates;
+
+		/// Grid of particle positions used to find self-collisions, updated before each position solve.
+		particle_grid _self_collision_grid;
+		/// Offsets of the first neighbor of each particle in \ref _particle_neighbors, followed by the total
+		/// number of neighbors.
+		std::vector<std::uint32_t> _particle_neighbor_offsets;
+		/// For each particle, the sorted indices of all particles with larger indices that share a constraint with
+		/// it. These pairs do not collide with each other.
+		std::vector<std::uint32_t> _particle_neighbors;
+		/// Whether \ref _particle_neighbors has been computed and has not been invalidated.
+		bool _particle_neighbors_valid = false;
+		/// Number of spring, face, bend, and isometric bend constraints when \ref _particle_neighbors was computed.
+		std::array<std::size_t, 4> _particle_neighbor_constraint_counts{};
+		/// Collisions between pairs of particles found for the ongoing position solve.
+		std::vector<constraints::particle_pair_collision> _particle_pair_collisions;
+		/// Collisions between particles and triangles found for the ongoing position solve.
+		std::vector<constraints::particle_triangle_collision> _particle_triangle_collisions;
+		/// Pair collisions found by each task of the parallel search, concatenated in order afterwards.
+		std::vector<std::vector<constraints::particle_pair_collision>> _particle_pair_collision_chunks;
+		/// Triangle collisions found by each task of the parallel search, concatenated in order afterwards.
+		std::vector<std::vector<constraints::particle_triangle_collision>> _particle_triangle_collision_chunks;
+
+		std::vector<collision::bounding_box> _body_bounds; ///< Bounding boxes of all bodies in \ref bodies.
+		/// Pairs of indices into \ref bodies produced by the broad phase.
+		std::vector<collision::broad_phases::index_pair> _body_pairs;
+
+		/// Union-find forest over \ref bodies that groups bodies into islands.
+		std::vector<std::uint32_t> _island_parents;
+		/// Index of the contact island of each root in \ref _island_parents that has any contact.
+		std::vector<std::uint32_t> _root_contact_islands;
+		std::vector<std::uint32_t> _contact_islands; ///< Index of the island of each contact.
+		/// Indices of all contacts in \ref contact_constraints, grouped by island. Contacts of the same island are
+		/// in the order they're detected.
+		std::vector<std::uint32_t> _island_contacts;
+		/// Offsets of the first contact of each island in \ref _island_contacts, followed by the total number of
+		/// contacts.
+		std::vector<std::uint32_t> _island_contact_offsets;
+		/// Islands with at most \ref max_serial_island_contacts contacts, sorted from the largest to the smallest
+		/// so that large islands are started first.
+		std::vector<std::uint32_t> _serial_islands;
+		/// An island whose contacts are projected color by color.
+		struct _split_island {
+			/// Initializes all fields of this struct.
+			_split_island(std::uint32_t i, constraint_coloring c) : island(i), coloring(std::move(c)) {
+			}
+
+			std::uint32_t island; ///< Index of the island.
+			/// Coloring of the contacts of the island, with indices relative to the first contact of the island.
+			constraint_coloring coloring;
+		};
+		/// Islands with more than \ref max_serial_island_contacts contacts.
+		std::vector<_split_island> _split_islands;
+		/// The number of iterations and the sum of squared residuals of each island in \ref _serial_islands,
+		/// followed by those of \ref _split_islands, filled by \ref _solve_contact_islands().
+		std::vector<std::pair<std::uint32_t, scalar>> _island_convergence;
+		/// Particle positions before the ongoing iteration, used by \ref particle_iteration_acceleration.
+		std::vector<vec3> _iteration_positions;
+		/// Particle positions before the previous iteration, used by \ref iteration_acceleration::chebyshev.
+		std::vector<vec3> _previous_iteration_positions;
+		/// Sums of squared residuals of consecutive ranges of \ref constraint_batch_size constraints, used by
+		/// \ref _compute_rms_residual().
+		std::vector<scalar> _residual_sums;
+		/// Minimum \ref body::sleep_timer of each island, indexed by the root of the island.
+		std::vector<scalar> _island_sleep_timers;
+		std::vector<std::uint32_t> _islands_to_wake; ///< Islands that should be woken up.
+		/// Indices of pairs in \ref _body_pairs between a sleeping and an awake body that have been tested to decide
+		/// whether to wake up the sleeping body, and their results, so that they're not tested again.
+		std::vector<std::pair<std::size_t, std::optional<collision_detection_result>>> _wake_test_results;
+		/// One plus the largest \ref body::island of all sleeping bodies. Sleeping islands are renumbered in each
+		/// time step so that this is at most the number of bodies plus one.
+		std::uint32_t _next_island = 1;
+		/// New \ref body::island of each sleeping island indexed by its old ID, and then of each island that
+		/// falls asleep indexed by its root.
+		std::vector<std::uint32_t> _island_ids;
+
+		/// GJK data of a pair of bodies kept between time steps.
+		struct _cached_gjk_pair {
+			/// Initializes \ref bodies and leaves the cache empty.
+			explicit _cached_gjk_pair(std::pair<body_handle, body_handle> b) : bodies(b) {
+			}
+
+			std::pair<body_handle, body_handle> bodies; ///< The two bodies.
+			collision::gjk_epa::pair_cache cache; ///< Cached data.
+		};
+		/// GJK data of all pairs of bodies tested in the previous time step, sorted by \ref _cached_gjk_pair::bodies.
+		std::vector<_cached_gjk_pair> _gjk_cache;
+		std::vector<_cached_gjk_pair> _new_gjk_cache; ///< GJK data of pairs tested in the current time step.
+
+		/// Identifies a contact across time steps.
+		struct _contact_key {
+			/// No initialization.
+			_contact_key(uninitialized_t) {
+			}
+			/// Initializes all fields of this struct.
+			_contact_key(
+				body_handle b1, body_handle b2, collision::contact_feature f1, collision::contact_feature f2
+			) : body1(b1), body2(b2), feature1(f1), feature2(f2) {
+			}
+
+			/// Default comparison.
+			friend std::strong_ordering operator<=>(const _contact_key&, const _contact_key&) = default;
+			/// Default equality.
+			friend bool operator==(const _contact_key&, const _contact_key&) = default;
+
+			body_handle body1 = uninitialized; ///< The first body.
+			body_handle body2 = uninitialized; ///< The second body.
+			collision::contact_feature feature1 = uninitialized; ///< Feature of the first body.
+			collision::contact_feature feature2 = uninitialized; ///< Feature of the second body.
+		};
+		/// A contact remembered from the previous position solve.
+		struct _cached_contact {
+			/// No initialization.
+			_cached_contact(uninitialized_t) {
+			}
+			/// Initializes all fields of this struct.
+			_cached_contact(_contact_key k, std::pair<scalar, scalar> l) : key(k), lambdas(l) {
+			}
+
+			_contact_key key = uninitialized; ///< Identifies the contact.
+			/// Normal and tangential lambda values divided by the squared time step, which makes them independent
+			/// of the time step size.
+			std::pair<scalar, scalar> lambdas;
+		};
+		std::vector<_contact_key> _contact_keys; ///< Keys of all contacts in \ref contact_constraints.
+		/// Lambda values that contacts in \ref contact_constraints start the next position solve with, divided by
+		/// the squared time step.
+		std::vector<std::pair<scalar, scalar>> _contact_initial_lambdas;
+		/// Contacts from the previous position solve, sorted by their keys.
+		std::vector<_cached_contact> _contact_cache;
+
+		/// Whether each contact in \ref contact_constraints is a speculative contact found by continuous collision
+		/// detection. These contacts have their approaching velocities removed by the velocity solve even if they
+		/// were not enforced during the position solve.
+		std::vector<bool> _speculative_contacts;
+		/// Whether each contact in \ref contact_constraints belongs to a manifold of bodies that were separated by
+		/// less than \ref contact_manifold_margin when the contact was detected. The velocity solve skips these
+		/// contacts if they were not enforced during the position solve, so that they do not hold the bodies
+		/// together.
+		std::vector<bool> _margin_contacts;
+		/// Earliest time of impact of each body in \ref bodies, relative to the time step.
+		std::vector<scalar> _body_impact_times;
+		/// Whether each body in \ref bodies has contacts from the discrete narrow phase in the ongoing time step.
+		/// These contacts are found at the end of the time step, so such bodies are not moved back to their time of
+		/// impact.
+		std::vector<bool> _body_discrete_contacts;
+		/// Bodies with \ref body::continuous_collision enabled that have been moved back to their earliest time of
+		/// impact in the ongoing time step, and those times. \ref _update_velocities() adds back the remaining
+		/// part of their predicted motion to their velocities, so that speculative contacts can stop them.
+		std::vector<std::pair<std::uint32_t, scalar>> _rewound_bodies;
+
+		/// Updates velocities with external forces and predicts the positions of all particles and bodies.
+		void _predict(scalar dt);
+		/// Runs the broad phase and narrow phase for all bodies, and fills \ref contact_constraints. Contacts that
+		/// are also found in \ref _contact_cache inherit their lambda values.
+		void _detect_body_collisions();
+		/// Runs the narrow phase for the given pair of bodies, using \ref detect_continuous_collision() if either
+		/// of them has \ref body::continuous_collision enabled.
+		[[nodiscard]] static std::optional<collision_detection_result> _detect_body_pair_collision(
+			const body&, const body&, narrow_phase_context
+		);
+		/// Creates the contact manifold of two polyhedra that GJK has not found to intersect, if they're separated
+		/// by less than \ref contact_manifold_margin.
+		[[nodiscard]] static std::optional<collision_detection_result> _detect_nearby_polyhedra(
+			const collision::shapes::polyhedron&, const body_state&,
+			const collision::shapes::polyhedron&, const body_state&, narrow_phase_context
+		);
+		/// Saves a snapshot into the given buffer. If \p base is not empty, it's a full snapshot that matches the
+		/// current particles and bodies, and only particles and bodies that differ from it are saved.
+		std::size_t _save_snapshot(std::span<const std::byte> base, std::span<std::byte>) const;
+		/// Resets all lambda values and projects all constraints for the given number of iterations.
+		void _solve_positions(scalar dt, std::uint32_t iters);
+		/// Derives velocities of all particles and bodies from their displacements.
+		void _update_velocities(scalar dt);
+		/// Applies restitution and dynamic friction to the velocities of bodies in contact. Contacts in
+		/// \ref _margin_contacts whose normal lambda is zero have not been enforced during the position solve and
+		/// are skipped. If \p skip_unenforced is \p true, all such contacts are skipped, except for speculative
+		/// contacts, whose approaching velocity is removed instead.
+		void _solve_velocities(scalar dt, bool skip_unenforced);
+		/// Removes the approaching velocity of two bodies along the normal of a speculative contact that was not
+		/// enforced during the position solve. Only linear velocities are changed, so that the bodies stop
+		/// approaching as a whole instead of pivoting around the first point that touches.
+		static void _stop_speculative_contact(body&, body&, vec3 normal);
+		/// Wakes up sleeping bodies whose states have been changed by the user, or all sleeping bodies if
+		/// \ref sleeping_enabled is \p false.
+		void _wake_modified_bodies();
+		/// Wakes up all bodies that belong to any island in \ref _islands_to_wake.
+		void _wake_islands();
+		/// Updates the sleep timers of awake bodies, and puts islands found by \ref _build_contact_islands() that
+		/// have been resting for long enough to sleep.
+		void _update_sleeping_bodies(scalar dt);
+		/// Groups dynamic bodies into islands using the current contacts, sorts contacts by island, and colors the
+		/// contacts of large islands.
+		void _build_contact_islands();
+		/// Invokes the callback with the index of each contact for the given number of iterations. Each island
+		/// goes through all iterations on its own, and different islands may be solved in parallel. If
+		/// \p monitor is \p true, an island stops early once its residual is below \ref residual_tolerance, and
+		/// the number of iterations and the sum of squared residuals of each island are stored in
+		/// \ref _island_convergence.
+		template <typename Solve> void _solve_contact_islands(std::uint32_t iters, const Solve&, bool monitor = false);
+		/// Returns whether residuals should be computed after the given number of iterations out of \p iters.
+		[[nodiscard]] bool _should_check_residuals(std::uint32_t iterations_done, std::uint32_t iters) const;
+		/// Returns the root mean square of the given residual function over [0, count), using \ref worker_pool
+		/// if it's available. The result does not depend on the number of threads.
+		template <typename Residual> [[nodiscard]] scalar _compute_rms_residual(std::size_t count, const Residual&);
+		/// Computes the residuals of all spring, face, and bend constraints.
+		template <typename Particles> [[nodiscard]] constraint_residuals _compute_particle_residuals(
+			Particles&, scalar inv_dt2
+		);
+		/// Moves \ref _iteration_positions into \ref _previous_iteration_positions, and stores the current
+		/// particle positions in \ref _iteration_positions.
+		template <typename Particles> void _store_iteration_positions(const Particles&);
+		/// Extrapolates the positions of all dynamic particles as \f$x_0 + \omega (x - x_0)\f$, where \f$x_0\f$ is
+		/// taken from the given array.
+		template <typename Particles> void _extrapolate_particle_positions(
+			Particles&, std::span<const vec3> base, scalar omega
+		);
+
+		step_statistics _step_statistics; ///< Statistics of the ongoing call to \ref timestep().
+
+		/// Resets \ref _step_statistics.
+		void _begin_step_statistics();
+		/// Adds \ref _step_statistics to \ref accumulated_statistics and \ref recent_statistics.
+		void _end_step_statistics();
+
+		/// Recomputes constraint colorings if necessary.
+		void _update_constraint_colorings();
+		/// Invokes the callback with ranges of indices that cover [0, count), using \ref worker_pool if it's
+		/// available.
+		template <typename Callback> void _parallel_for(std::size_t count, const Callback&);
+		/// Projects all constraints in the coloring color by color.
+		template <typename Project> void _project_colored(const constraint_coloring&, const Project&);
+
+		class _aos_particles;
+		/// Fills \ref _particle_collision_candidates using the current positions of all particles.
+		void _gather_particle_collision_candidates();
+		/// Handles collisions between kinematic bodies and all particles in \ref _particle_collision_candidates.
+		template <typename Particles> void _handle_body_particle_collisions(Particles&);
+		/// Recomputes \ref _particle_neighbors if necessary.
+		void _update_particle_neighbors();
+		/// Fills \ref _particle_pair_collisions and \ref _particle_triangle_collisions using the current and
+		/// previous positions of all particles.
+		void _gather_self_collisions();
+		/// Projects all constraints in \ref _particle_pair_collisions and \ref _particle_triangle_collisions once.
+		template <typename Particles> void _project_self_collisions(Particles&);
+		/// Projects all spring, face, and bend constraints once.
+		template <typename Particles> void _project_particle_constraints(Particles&, scalar inv_dt2);
 	};
 }
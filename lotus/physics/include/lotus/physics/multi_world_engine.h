@@ -0,0 +1,164 @@
+#pragma once
+
+/// \file
+/// Simulation of many copies of the same particle system.
+
+#include <vector>
+
+#include "lotus/containers/dense_pool.h"
+#include "lotus/utils/thread_pool.h"
+#include "constraints/spring.h"
+#include "constraints/face.h"
+#include "constraints/bend.h"
+#include "constraints/isometric_bend.h"
+#include "body.h"
+#include "engine.h"
+
+namespace lotus::physics {
+	/// Simulates many copies of the particles and particle constraints of an \ref engine, called worlds, that only
+	/// differ in their states and material parameters, e.g., to sweep over the stiffness of a piece of cloth.
+	/// Particle properties, constraints, and bodies are shared by all worlds and stored once, while states, lambda
+	/// values, and material parameters are stored for each world. Worlds are grouped into blocks of
+	/// \ref block_size, and the data of a block is stored with the worlds in consecutive elements, so that each
+	/// constraint is projected in all worlds of a block at once using SIMD instructions without gathering any
+	/// particles. Blocks are independent and are simulated in parallel using \ref worker_pool.
+	///
+	/// Each world is simulated like an \ref engine using \ref engine::constraint_ordering::serial. Only particles,
+	/// particle constraints, and collisions between particles and kinematic bodies are simulated; dynamic bodies,
+	/// contacts, and self-collisions are not. Springs, Gauss-Seidel face projection, and isometric bends are
+	/// projected using SIMD instructions; other projection types of faces and bends are projected world by world.
+	class multi_world_engine {
+	public:
+		/// The number of worlds in a block. Blocks are padded with copies of the first world, which only take part
+		/// in the computations that are done with SIMD instructions.
+		constexpr static std::size_t block_size = 8;
+
+		/// Creates worlds that all start from the current state of the given engine. The particles, particle
+		/// constraints, bodies, gravity, and settings related to them are copied; bodies keep pointing to the
+		/// shapes of the engine, which must outlive this object. All worlds start with the material parameters of
+		/// the constraints of the engine.
+		[[nodiscard]] static multi_world_engine create(const engine&, std::size_t num_worlds);
+
+		/// Executes one time step in all worlds with the given delta time in seconds and the given number of
+		/// iterations.
+		void timestep(scalar dt, std::uint32_t iters);
+
+		/// Returns the number of worlds.
+		[[nodiscard]] std::size_t get_num_worlds() const {
+			return _num_worlds;
+		}
+		/// Returns the number of particles in each world.
+		[[nodiscard]] std::size_t get_num_particles() const {
+			return _inverse_masses.size();
+		}
+
+		/// Returns the state of the given particle in the given world.
+		[[nodiscard]] particle_state get_particle_state(std::size_t world, std::size_t particle) const;
+		/// Sets the state of the given particle in the given world.
+		void set_particle_state(std::size_t world, std::size_t particle, particle_state);
+
+		/// Returns the factor that the inverse stiffness of all springs in the given world is multiplied with.
+		[[nodiscard]] scalar get_spring_inverse_stiffness_scale(std::size_t world) const;
+		/// Multiplies the inverse stiffness of all springs in the given world with the given factor. Springs are
+		/// usually created with an inverse stiffness proportional to the inverse of their lengths, so this
+		/// corresponds to dividing the Young's modulus of the material by the factor.
+		void set_spring_inverse_stiffness_scale(std::size_t world, scalar);
+		/// Returns the properties of the given face constraint in the given world.
+		[[nodiscard]] constraints::face::constraint_properties get_face_properties(
+			std::size_t world, std::size_t face
+		) const;
+		/// Sets the properties of the given face constraint in the given world.
+		void set_face_properties(std::size_t world, std::size_t face, const constraints::face::constraint_properties&);
+		/// Returns the properties of the given bend constraint in the given world.
+		[[nodiscard]] constraints::bend::constraint_properties get_bend_properties(
+			std::size_t world, std::size_t bend
+		) const;
+		/// Sets the properties of the given bend constraint in the given world.
+		void set_bend_properties(std::size_t world, std::size_t bend, const constraints::bend::constraint_properties&);
+		/// Returns the properties of the given isometric bend constraint in the given world.
+		[[nodiscard]] constraints::isometric_bend::constraint_properties get_isometric_bend_properties(
+			std::size_t world, std::size_t bend
+		) const;
+		/// Sets the properties of the given isometric bend constraint in the given world.
+		void set_isometric_bend_properties(
+			std::size_t world, std::size_t bend, const constraints::isometric_bend::constraint_properties&
+		);
+
+		/// Bodies shared by all worlds, with the same handles as the bodies of the engine that this object has
+		/// been created from. Kinematic bodies move like they do in an \ref engine and collide with the particles
+		/// of all worlds; dynamic bodies are ignored.
+		dense_pool<body> bodies;
+		vec3 gravity = zero; ///< Gravity.
+		/// Determines how face constraints are projected. Only \ref constraints::face::projection_type::gauss_seidel
+		/// is projected using SIMD instructions.
+		constraints::face::projection_type face_constraint_projection_type =
+			constraints::face::projection_type::gauss_seidel;
+		/// Bounding boxes of kinematic bodies are enlarged by this distance, plus the largest distance that any
+		/// particle of a block has moved during prediction, when gathering collision candidates for the block.
+		scalar particle_collision_margin = 0.01f;
+		/// Worker threads used to simulate blocks in parallel. The pool is owned by the user. If this is
+		/// \p nullptr, all blocks are simulated on the calling thread.
+		thread_pool *worker_pool = nullptr;
+	protected:
+		/// Data of all worlds in a block. Arrays with per-world data store \ref block_size consecutive elements for
+		/// each value, one for each world.
+		struct _block {
+			/// The number of worlds in this block. The remaining lanes are padding, which is skipped wherever worlds
+			/// are processed one at a time.
+			std::size_t num_worlds = 0;
+
+			/// Particle positions, with the three coordinates of each particle stored one after another.
+			std::vector<scalar> positions;
+			std::vector<scalar> prev_positions; ///< Particle positions in the previous time step.
+			std::vector<scalar> velocities; ///< Particle velocities.
+
+			std::vector<scalar> spring_lambdas; ///< Lambda values of all spring constraints.
+			std::vector<scalar> face_lambdas; ///< Six lambda values for each face constraint.
+			/// Lambda deltas of the previous projection of each face constraint, used by Gauss-Seidel projection.
+			std::vector<scalar> face_prev_delta_lambdas;
+			std::vector<scalar> bend_lambdas; ///< Lambda values of all bend constraints.
+			std::vector<scalar> isometric_bend_lambdas; ///< Lambda values of all isometric bend constraints.
+
+			/// See \ref set_spring_inverse_stiffness_scale().
+			std::vector<scalar> spring_inverse_stiffness_scale;
+			/// Inverse stiffness matrices of all face constraints, 36 elements each in row-major order.
+			std::vector<scalar> face_inverse_stiffness;
+			std::vector<scalar> bend_inverse_stiffness; ///< Inverse stiffness of all bend constraints.
+			/// Inverse stiffness of all isometric bend constraints.
+			std::vector<scalar> isometric_bend_inverse_stiffness;
+
+			/// Indices of kinematic bodies in \ref bodies that may collide with particles of this block in the
+			/// ongoing position solve.
+			std::vector<std::uint32_t> collision_bodies;
+			/// Offsets of the first candidate of each body of \ref collision_bodies in \ref collision_candidates,
+			/// followed by the total number of candidates.
+			std::vector<std::uint32_t> collision_offsets;
+			/// Indices of particles that may collide with each body in \ref collision_bodies in any world.
+			std::vector<std::uint32_t> collision_candidates;
+		};
+
+		/// Moves all kinematic bodies according to their velocities.
+		void _predict_bodies(scalar dt);
+		/// Updates the velocities of all kinematic bodies from the distance they've moved.
+		void _update_body_velocities(scalar dt);
+		/// Executes one time step for all worlds in the given block.
+		void _timestep_block(_block&, scalar dt, std::uint32_t iters) const;
+		/// Finds particles that may collide with kinematic bodies in any world of the block.
+		void _gather_collision_candidates(_block&) const;
+		/// Handles collisions between particles and kinematic bodies in all worlds of the block.
+		void _handle_collisions(_block&) const;
+		/// Projects all particle constraints once in all worlds of the block.
+		void _project_constraints(_block&, scalar inv_dt2) const;
+
+		std::vector<scalar> _inverse_masses; ///< Inverse masses of all particles.
+		/// Spring constraints. Their inverse stiffness is scaled in each world.
+		std::vector<constraints::particle_spring> _springs;
+		/// Face constraints. Their properties and previous lambda deltas are stored for each world.
+		std::vector<constraints::face> _faces;
+		std::vector<constraints::bend> _bends; ///< Bend constraints. Their properties are stored for each world.
+		/// Isometric bend constraints. Their properties are stored for each world.
+		std::vector<constraints::isometric_bend> _isometric_bends;
+		std::vector<_block> _blocks; ///< All blocks.
+		std::size_t _num_worlds = 0; ///< The number of worlds.
+	};
+}
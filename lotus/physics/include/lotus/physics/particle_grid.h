@@ -0,0 +1,169 @@
+#pragma once
+
+/// \file
+/// Uniform grid over particle positions.
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "lotus/math/aab.h"
+#include "lotus/math/vector.h"
+#include "common.h"
+
+namespace lotus::physics {
+	/// A uniform grid of cubic cells that stores the indices of the particles inside each cell. Only occupied cells
+	/// take up memory: cells are mapped to buckets of a hash table, and each bucket stores the particles of all
+	/// cells that map to it. The grid does not track particles as they move, and should be updated whenever
+	/// up-to-date results are needed; updating reuses previously allocated memory.
+	struct particle_grid {
+		/// Sorts the given number of particles into cells of the given size. The callback should return the
+		/// position of the particle at the given index.
+		template <typename GetPosition> void build(std::size_t count, scalar size, GetPosition &&get_position) {
+			cell_size = size;
+			inverse_cell_size = 1.0f / size;
+			particle_cells.resize(count, zero);
+			for (std::size_t i = 0; i < count; ++i) {
+				particle_cells[i] = get_cell(get_position(i));
+			}
+			sort_particles();
+		}
+		/// Recomputes the cells of all particles, but only sorts the particles again if any of them has moved to
+		/// another cell. Falls back to \ref build() if the number of particles or the cell size has changed.
+		/// Returns whether particles have been sorted again.
+		template <typename GetPosition> bool update(std::size_t count, scalar size, GetPosition &&get_position) {
+			if (count != particle_cells.size() || size != cell_size || bucket_offsets.empty()) {
+				build(count, size, std::forward<GetPosition>(get_position));
+				return true;
+			}
+			bool changed = false;
+			for (std::size_t i = 0; i < count; ++i) {
+				const cvec3i cell = get_cell(get_position(i));
+				if (cell != particle_cells[i]) {
+					particle_cells[i] = cell;
+					changed = true;
+				}
+			}
+			if (changed) {
+				sort_particles();
+			}
+			return changed;
+		}
+		/// Sorts particles into hash table buckets according to \ref particle_cells, and updates \ref min_cell
+		/// and \ref max_cell.
+		void sort_particles() {
+			const std::size_t count = particle_cells.size();
+			// twice as many buckets as particles keeps collisions between occupied cells rare
+			const std::size_t num_buckets = std::bit_ceil(std::max<std::size_t>(2 * count, 1));
+			bucket_offsets.assign(num_buckets + 1, 0);
+			constexpr int int_max = std::numeric_limits<int>::max();
+			constexpr int int_min = std::numeric_limits<int>::min();
+			min_cell = cvec3i(int_max, int_max, int_max);
+			max_cell = cvec3i(int_min, int_min, int_min);
+			for (const cvec3i &cell : particle_cells) {
+				for (std::size_t j = 0; j < 3; ++j) {
+					min_cell[j] = std::min(min_cell[j], cell[j]);
+					max_cell[j] = std::max(max_cell[j], cell[j]);
+				}
+				++bucket_offsets[get_bucket(cell)];
+			}
+
+			// counting sort by bucket; particles are visited backwards so that the offsets end up at the first
+			// particle of each bucket, and particles of the same bucket stay in order
+			for (std::size_t i = 1; i <= num_buckets; ++i) {
+				bucket_offsets[i] += bucket_offsets[i - 1];
+			}
+			particles.resize(count);
+			sorted_cells.resize(count, zero);
+			for (std::size_t i = count; i > 0; --i) {
+				const std::uint32_t index = --bucket_offsets[get_bucket(particle_cells[i - 1])];
+				particles[index] = static_cast<std::uint32_t>(i - 1);
+				sorted_cells[index] = particle_cells[i - 1];
+			}
+		}
+
+		/// Invokes the callback with the index of every particle in a cell that overlaps the given box. Each
+		/// particle is visited at most once, and the box may be unbounded.
+		template <typename Callback> void for_each_in(const aab3<scalar> &box, Callback &&cb) const {
+			if (particles.empty()) {
+				return;
+			}
+			// clamp the box to occupied cells before converting to integers, which also handles infinite bounds
+			cvec3i first_cell = uninitialized;
+			cvec3i last_cell = uninitialized;
+			std::size_t num_cells = 1;
+			for (std::size_t i = 0; i < 3; ++i) {
+				const scalar first = std::max(box.min[i] * inverse_cell_size, static_cast<scalar>(min_cell[i]));
+				const scalar last = std::min(box.max[i] * inverse_cell_size, static_cast<scalar>(max_cell[i]));
+				if (!(first <= last)) {
+					return;
+				}
+				first_cell[i] = static_cast<int>(std::floor(first));
+				last_cell[i] = static_cast<int>(std::floor(last));
+				num_cells *= static_cast<std::size_t>(last_cell[i] - first_cell[i] + 1);
+			}
+
+			if (num_cells >= particles.size()) { // it's cheaper to check every particle
+				for (std::uint32_t i = 0; i < particle_cells.size(); ++i) {
+					const cvec3i &cell = particle_cells[i];
+					if (
+						cell[0] >= first_cell[0] && cell[0] <= last_cell[0] &&
+						cell[1] >= first_cell[1] && cell[1] <= last_cell[1] &&
+						cell[2] >= first_cell[2] && cell[2] <= last_cell[2]
+					) {
+						cb(i);
+					}
+				}
+				return;
+			}
+			for (int z = first_cell[2]; z <= last_cell[2]; ++z) {
+				for (int y = first_cell[1]; y <= last_cell[1]; ++y) {
+					for (int x = first_cell[0]; x <= last_cell[0]; ++x) {
+						for_each_in_cell(cvec3i(x, y, z), cb);
+					}
+				}
+			}
+		}
+		/// Invokes the callback with the index of every particle in the given cell.
+		template <typename Callback> void for_each_in_cell(cvec3i cell, Callback &&cb) const {
+			const std::size_t bucket = get_bucket(cell);
+			// skip particles of other cells that map to the same bucket
+			for (std::uint32_t i = bucket_offsets[bucket]; i < bucket_offsets[bucket + 1]; ++i) {
+				if (sorted_cells[i] == cell) {
+					cb(particles[i]);
+				}
+			}
+		}
+
+		/// Returns the cell that contains the given position.
+		[[nodiscard]] cvec3i get_cell(vec3 p) const {
+			return cvec3i(
+				static_cast<int>(std::floor(p[0] * inverse_cell_size)),
+				static_cast<int>(std::floor(p[1] * inverse_cell_size)),
+				static_cast<int>(std::floor(p[2] * inverse_cell_size))
+			);
+		}
+		/// Returns the hash table bucket of the given cell.
+		[[nodiscard]] std::size_t get_bucket(cvec3i cell) const {
+			const std::uint32_t hash =
+				(static_cast<std::uint32_t>(cell[0]) * 73856093u) ^
+				(static_cast<std::uint32_t>(cell[1]) * 19349663u) ^
+				(static_cast<std::uint32_t>(cell[2]) * 83492791u);
+			return hash & (bucket_offsets.size() - 2);
+		}
+
+		scalar cell_size = 1.0f; ///< The size of each cell.
+		scalar inverse_cell_size = 1.0f; ///< The inverse of \ref cell_size.
+		/// Offsets of the first particle of each bucket in \ref particles, followed by the total number of
+		/// particles.
+		std::vector<std::uint32_t> bucket_offsets;
+		std::vector<std::uint32_t> particles; ///< Indices of all particles, sorted by bucket.
+		std::vector<cvec3i> particle_cells; ///< The cell of each particle, indexed by particle.
+		std::vector<cvec3i> sorted_cells; ///< The cell of each particle in \ref particles, in the same order.
+		cvec3i min_cell = zero; ///< Minimum coordinates of all occupied cells.
+		cvec3i max_cell = zero; ///< Maximum coordinates of all occupied cells.
+	};
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+/// \file
+/// Structure-of-arrays particle storage.
+
+#include <span>
+#include <vector>
+
+#include "body.h"
+
+namespace lotus::physics {
+	/// Particle data where each component is stored in a separate array, so that the data of consecutive particles
+	/// can be loaded into SIMD registers directly.
+	struct particle_soa {
+		/// Copies the positions and inverse masses of all given particles into this object, resizing all arrays as
+		/// necessary.
+		void load(std::span<const particle>);
+		/// Copies the positions back into the given particles. Other data of the particles is not modified by the
+		/// position solve and is therefore not stored.
+		void store(std::span<particle>) const;
+
+		/// Returns the number of particles.
+		[[nodiscard]] std::size_t size() const {
+			return inverse_mass.size();
+		}
+
+		/// Returns the position of the given particle.
+		[[nodiscard]] vec3 get_position(std::size_t i) const {
+			return vec3(position_x[i], position_y[i], position_z[i]);
+		}
+		/// Sets the position of the given particle.
+		void set_position(std::size_t i, vec3 p) {
+			position_x[i] = p[0];
+			position_y[i] = p[1];
+			position_z[i] = p[2];
+		}
+		/// Returns the inverse mass of the given particle.
+		[[nodiscard]] scalar get_inverse_mass(std::size_t i) const {
+			return inverse_mass[i];
+		}
+
+		std::vector<scalar> position_x; ///< X coordinates of particle positions.
+		std::vector<scalar> position_y; ///< Y coordinates of particle positions.
+		std::vector<scalar> position_z; ///< Z coordinates of particle positions.
+		std::vector<scalar> inverse_mass; ///< Inverse masses of all particles.
+	};
+}
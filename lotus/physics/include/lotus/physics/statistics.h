@@ -0,0 +1,199 @@
+#pragma once
+
+/// \file
+/// Timings and counters collected by the physics engine.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "lotus/common.h"
+
+namespace lotus::physics {
+	/// Whether the engine collects statistics. Instrumentation can be removed at compile time by defining
+	/// \p LOTUS_PHYSICS_NO_INSTRUMENTATION, in which case all statistics stay zero.
+#ifdef LOTUS_PHYSICS_NO_INSTRUMENTATION
+	constexpr static bool instrumentation_enabled = false;
+#else
+	constexpr static bool instrumentation_enabled = true;
+#endif
+
+	/// Wall-clock time spent in each phase of the simulation.
+	struct phase_timings {
+		std::chrono::nanoseconds prediction = std::chrono::nanoseconds::zero(); ///< Position prediction.
+		/// Broad phase and narrow phase collision detection between bodies.
+		std::chrono::nanoseconds collision_detection = std::chrono::nanoseconds::zero();
+		/// Projection of all position constraints.
+		std::chrono::nanoseconds position_solve = std::chrono::nanoseconds::zero();
+		/// Derivation of velocities from positions.
+		std::chrono::nanoseconds velocity_update = std::chrono::nanoseconds::zero();
+		/// Velocity-level friction and restitution.
+		std::chrono::nanoseconds velocity_solve = std::chrono::nanoseconds::zero();
+		/// Island detection and sleep state updates.
+		std::chrono::nanoseconds sleep_update = std::chrono::nanoseconds::zero();
+
+		/// Returns the sum of all phases.
+		[[nodiscard]] std::chrono::nanoseconds total() const {
+			return
+				prediction + collision_detection + position_solve + velocity_update + velocity_solve + sleep_update;
+		}
+
+		/// Accumulates the given timings into this object.
+		phase_timings &operator+=(const phase_timings &rhs) {
+			prediction += rhs.prediction;
+			collision_detection += rhs.collision_detection;
+			position_solve += rhs.position_solve;
+			velocity_update += rhs.velocity_update;
+			velocity_solve += rhs.velocity_solve;
+			sleep_update += rhs.sleep_update;
+			return *this;
+		}
+	};
+
+	/// Counters of the work done by the simulation.
+	struct step_counters {
+		std::uint64_t body_pairs_tested = 0; ///< Number of body pairs tested by the narrow phase.
+		std::uint64_t gjk_calls = 0; ///< Number of times the GJK algorithm has been executed.
+		/// Number of support vertices computed by the GJK algorithm, including those used to test cached separating
+		/// axes.
+		std::uint64_t gjk_support_queries = 0;
+		std::uint64_t epa_iterations = 0; ///< Total number of iterations of the expanding polytope algorithm.
+		/// Number of times the expanding polytope algorithm ran out of polytope storage before converging.
+		std::uint64_t epa_fallbacks = 0;
+		/// The maximum amount of scratch memory used by a single narrow phase query. Unlike other counters, this is
+		/// accumulated by taking the maximum.
+		std::uint64_t peak_narrow_phase_scratch_bytes = 0;
+		std::uint64_t contacts_generated = 0; ///< Number of body contacts generated by the narrow phase.
+		/// Number of time of impact queries between pairs of bodies, at least one of which has continuous
+		/// collision detection enabled.
+		std::uint64_t continuous_collision_tests = 0;
+		/// Number of contacts generated at the time of impact by continuous collision detection.
+		std::uint64_t speculative_contacts = 0;
+		/// Number of generated contacts that match a contact from the previous position solve.
+		std::uint64_t contacts_matched = 0;
+		/// Number of generated contacts that do not match any contact from the previous position solve.
+		std::uint64_t contacts_created = 0;
+		/// Number of contacts from the previous position solve that do not match any generated contact.
+		std::uint64_t contacts_dropped = 0;
+		std::uint64_t active_bodies = 0; ///< Number of bodies that are awake at the end of each time step.
+		std::uint64_t sleeping_bodies = 0; ///< Number of bodies that are sleeping at the end of each time step.
+		/// Number of islands of awake dynamic bodies that are found by collision detection.
+		std::uint64_t islands = 0;
+		/// Number of contact islands that are split by graph coloring because they have too many contacts.
+		std::uint64_t split_islands = 0;
+		std::uint64_t solver_iterations = 0; ///< Number of position solver iterations.
+		/// Number of contact, spring, face, and bend constraints projected, summed over all iterations.
+		std::uint64_t constraints_projected = 0;
+		/// Number of collision tests between particles and kinematic bodies, summed over all iterations.
+		std::uint64_t particle_collision_tests = 0;
+		/// Number of particle-particle and particle-triangle self-collision constraints found, summed over all
+		/// position solves.
+		std::uint64_t self_collisions = 0;
+
+		/// Returns the average number of constraints projected in each solver iteration.
+		[[nodiscard]] double get_constraints_per_iteration() const {
+			return
+				solver_iterations == 0 ?
+				0.0 :
+				static_cast<double>(constraints_projected) / static_cast<double>(solver_iterations);
+		}
+
+		/// Accumulates the given counters into this object.
+		step_counters &operator+=(const step_counters &rhs) {
+			body_pairs_tested += rhs.body_pairs_tested;
+			gjk_calls += rhs.gjk_calls;
+			gjk_support_queries += rhs.gjk_support_queries;
+			epa_iterations += rhs.epa_iterations;
+			epa_fallbacks += rhs.epa_fallbacks;
+			peak_narrow_phase_scratch_bytes =
+				std::max(peak_narrow_phase_scratch_bytes, rhs.peak_narrow_phase_scratch_bytes);
+			contacts_generated += rhs.contacts_generated;
+			continuous_collision_tests += rhs.continuous_collision_tests;
+			speculative_contacts += rhs.speculative_contacts;
+			contacts_matched += rhs.contacts_matched;
+			contacts_created += rhs.contacts_created;
+			contacts_dropped += rhs.contacts_dropped;
+			active_bodies += rhs.active_bodies;
+			sleeping_bodies += rhs.sleeping_bodies;
+			islands += rhs.islands;
+			split_islands += rhs.split_islands;
+			solver_iterations += rhs.solver_iterations;
+			constraints_projected += rhs.constraints_projected;
+			particle_collision_tests += rhs.particle_collision_tests;
+			self_collisions += rhs.self_collisions;
+			return *this;
+		}
+	};
+
+	/// Timings and counters of one or more time steps.
+	struct step_statistics {
+		phase_timings timings; ///< Time spent in each phase.
+		step_counters counters; ///< Work counters.
+
+		/// Accumulates the given statistics into this object.
+		step_statistics &operator+=(const step_statistics &rhs) {
+			timings += rhs.timings;
+			counters += rhs.counters;
+			return *this;
+		}
+	};
+
+	/// A fixed-capacity ring buffer of per-step statistics. When the buffer is full, the oldest entry is
+	/// overwritten.
+	class statistics_history {
+	public:
+		/// Initializes the buffer to be empty with zero capacity, i.e., no history is kept.
+		statistics_history(std::nullptr_t) {
+		}
+		/// Creates an empty buffer with the given capacity.
+		[[nodiscard]] inline static statistics_history create(std::size_t capacity) {
+			statistics_history result = nullptr;
+			result._entries.resize(capacity);
+			return result;
+		}
+
+		/// Adds an entry, overwriting the oldest one if the buffer is full.
+		void push(const step_statistics &stats) {
+			if (_entries.empty()) {
+				return;
+			}
+			_entries[(_first + _count) % _entries.size()] = stats;
+			if (_count < _entries.size()) {
+				++_count;
+			} else {
+				_first = (_first + 1) % _entries.size();
+			}
+		}
+		/// Removes all entries.
+		void clear() {
+			_first = _count = 0;
+		}
+
+		/// Returns the entry at the given index, where 0 is the oldest entry.
+		[[nodiscard]] const step_statistics &operator[](std::size_t i) const {
+			crash_if(i >= _count);
+			return _entries[(_first + i) % _entries.size()];
+		}
+		/// Returns the most recent entry.
+		[[nodiscard]] const step_statistics &latest() const {
+			return (*this)[_count - 1];
+		}
+		/// Returns the number of entries.
+		[[nodiscard]] std::size_t size() const {
+			return _count;
+		}
+		/// Returns whether there are no entries.
+		[[nodiscard]] bool empty() const {
+			return _count == 0;
+		}
+		/// Returns the maximum number of entries.
+		[[nodiscard]] std::size_t capacity() const {
+			return _entries.size();
+		}
+	private:
+		std::vector<step_statistics> _entries; ///< Storage for all entries.
+		std::size_t _first = 0; ///< Index of the oldest entry in \ref _entries.
+		std::size_t _count = 0; ///< Number of valid entries.
+	};
+}
@@ -0,0 +1,208 @@
+#include "lotus/collision/algorithms/conservative_advancement.h"
+
+/// \file
+/// Implementation of conservative advancement.
+
+#include <algorithm>
+#include <cmath>
+
+#include "lotus/collision/algorithms/gjk_distance.h"
+
+namespace lotus::collision {
+	using _separation = conservative_advancement::separation; ///< Shorthand for the separation type.
+
+	/// Fallback case for shapes whose distance cannot be computed.
+	template <typename Shape1, typename Shape2> [[nodiscard]] static std::optional<_separation>
+		_compute_separation(const Shape1&, const physics::body_state&, const Shape2&, const physics::body_state&) {
+		return std::nullopt;
+	}
+	/// Computes the separation between a plane and a sphere.
+	[[nodiscard]] static std::optional<_separation> _compute_separation(
+		const shapes::plane&, const physics::body_state &st1,
+		const shapes::sphere &sp2, const physics::body_state &st2
+	) {
+		const vec3 normal = st1.rotation.rotate(vec3(0.0f, 0.0f, 1.0f));
+		const vec3 center = st2.position + st2.rotation.rotate(sp2.offset);
+		const scalar center_dist = vec::dot(center - st1.position, normal);
+		_separation result = uninitialized;
+		result.position1 = center - center_dist * normal;
+		result.position2 = center - sp2.radius * normal;
+		result.normal = normal;
+		result.distance = center_dist - sp2.radius;
+		return result;
+	}
+	/// Computes the separation between a plane and a polyhedron.
+	[[nodiscard]] static std::optional<_separation> _compute_separation(
+		const shapes::plane&, const physics::body_state &st1,
+		const shapes::polyhedron &p2, const physics::body_state &st2
+	) {
+		const vec3 normal = st1.rotation.rotate(vec3(0.0f, 0.0f, 1.0f));
+		const std::uint32_t vert = p2.get_support_vertex(st2.rotation.inverse().rotate(-normal)).first;
+		const vec3 pos = st2.position + st2.rotation.rotate(p2.vertices[vert]);
+		_separation result = uninitialized;
+		result.distance = vec::dot(pos - st1.position, normal);
+		result.position1 = pos - result.distance * normal;
+		result.position2 = pos;
+		result.normal = normal;
+		return result;
+	}
+	/// Computes the separation between two spheres.
+	[[nodiscard]] static std::optional<_separation> _compute_separation(
+		const shapes::sphere &sp1, const physics::body_state &st1,
+		const shapes::sphere &sp2, const physics::body_state &st2
+	) {
+		const vec3 center1 = st1.position + st1.rotation.rotate(sp1.offset);
+		const vec3 center2 = st2.position + st2.rotation.rotate(sp2.offset);
+		const vec3 diff = center2 - center1;
+		const scalar center_dist = diff.norm();
+		_separation result = uninitialized;
+		// concentric spheres can be separated in any direction
+		result.normal = center_dist > 0.0f ? diff / center_dist : vec3(0.0f, 0.0f, 1.0f);
+		result.position1 = center1 + sp1.radius * result.normal;
+		result.position2 = center2 - sp2.radius * result.normal;
+		result.distance = center_dist - sp1.radius - sp2.radius;
+		return result;
+	}
+	/// Computes the separation between a sphere and a polyhedron.
+	[[nodiscard]] static std::optional<_separation> _compute_separation(
+		const shapes::sphere &sp1, const physics::body_state &st1,
+		const shapes::polyhedron &p2, const physics::body_state &st2
+	) {
+		const vec3 center = st1.position + st1.rotation.rotate(sp1.offset);
+		const auto res = gjk_distance::closest_point(p2, st2.rotation.inverse().rotate(center - st2.position));
+		_separation result = uninitialized;
+		if (res.is_inside() || res.distance == 0.0f) {
+			result.position1 = result.position2 = center;
+			result.normal = vec3(0.0f, 0.0f, 1.0f);
+			result.distance = -sp1.radius;
+			return result;
+		}
+		result.position2 = st2.position + st2.rotation.rotate(res.closest_point);
+		result.normal = (result.position2 - center) / res.distance;
+		result.position1 = center + sp1.radius * result.normal;
+		result.distance = res.distance - sp1.radius;
+		return result;
+	}
+	/// Computes the separation between two polyhedra.
+	[[nodiscard]] static std::optional<_separation> _compute_separation(
+		const shapes::polyhedron &p1, const physics::body_state &st1,
+		const shapes::polyhedron &p2, const physics::body_state &st2
+	) {
+		const auto res = gjk_distance::closest_points(p1, st1, p2, st2);
+		_separation result = uninitialized;
+		result.position1 = res.position1;
+		result.position2 = res.position2;
+		if (res.intersecting) {
+			result.normal = vec3(0.0f, 0.0f, 1.0f);
+			result.distance = 0.0f;
+			return result;
+		}
+		result.normal = (res.position2 - res.position1) / res.distance;
+		result.distance = res.distance;
+		return result;
+	}
+
+	/// Returns the rotation that turns \p from into \p to, as a normalized axis and an angle in [0, pi].
+	[[nodiscard]] static std::pair<vec3, scalar> _get_rotation_between(uquats from, uquats to) {
+		const uquats dq = quat::unsafe_normalize(to * from.inverse());
+		// q and -q are the same rotation; take the shorter way around
+		const scalar sign = dq.w() < 0.0f ? -1.0f : 1.0f;
+		const vec3 axis = sign * vec3(dq.x(), dq.y(), dq.z());
+		const scalar sin_half = axis.norm();
+		if (sin_half == 0.0f) {
+			return { vec3(1.0f, 0.0f, 0.0f), 0.0f };
+		}
+		return { axis / sin_half, 2.0f * std::atan2(sin_half, sign * dq.w()) };
+	}
+
+
+	std::optional<_separation> conservative_advancement::compute_separation(
+		const shape &s1, const physics::body_state &st1, const shape &s2, const physics::body_state &st2
+	) {
+		if (s1.get_type() > s2.get_type()) {
+			auto res = std::visit([&](const auto &shape2, const auto &shape1) {
+				return _compute_separation(shape2, st2, shape1, st1);
+			}, s2.value, s1.value);
+			if (res) {
+				std::swap(res->position1, res->position2);
+				res->normal = -res->normal;
+			}
+			return res;
+		}
+		return std::visit([&](const auto &shape1, const auto &shape2) {
+			return _compute_separation(shape1, st1, shape2, st2);
+		}, s1.value, s2.value);
+	}
+
+	physics::body_state conservative_advancement::interpolate(
+		const physics::body_state &from, const physics::body_state &to, scalar t
+	) {
+		const auto [axis, angle] = _get_rotation_between(from.rotation, to.rotation);
+		return physics::body_state::at(
+			from.position + t * (to.position - from.position),
+			quat::unsafe_normalize(quat::from_normalized_axis_angle(axis, t * angle) * from.rotation),
+			from.linear_velocity, from.angular_velocity
+		);
+	}
+
+	scalar conservative_advancement::get_bounding_radius(const shape &s) {
+		return std::visit([](const auto &value) {
+			using _shape = std::decay_t<decltype(value)>;
+			if constexpr (std::is_same_v<_shape, shapes::polyhedron>) {
+				scalar max_dist2 = 0.0f;
+				for (const vec3 &v : value.vertices) {
+					max_dist2 = std::max(max_dist2, v.squared_norm());
+				}
+				return std::sqrt(max_dist2);
+			} else if constexpr (std::is_same_v<_shape, shapes::sphere>) {
+				return value.offset.norm(); // rotating a sphere around its center does not move its surface
+			} else {
+				return 0.0f;
+			}
+		}, s.value);
+	}
+
+	std::optional<conservative_advancement::result> conservative_advancement::compute_time_of_impact(
+		const shape &s1, const physics::body_state &from1, const physics::body_state &to1,
+		const shape &s2, const physics::body_state &from2, const physics::body_state &to2,
+		scalar tolerance
+	) {
+		// bound of the speed at which any point of one shape approaches the other along any direction, relative to
+		// the time interval
+		const vec3 linear = (to1.position - from1.position) - (to2.position - from2.position);
+		const scalar angular =
+			_get_rotation_between(from1.rotation, to1.rotation).second * get_bounding_radius(s1) +
+			_get_rotation_between(from2.rotation, to2.rotation).second * get_bounding_radius(s2);
+
+		result res = uninitialized;
+		res.time = 0.0f;
+		res.iterations = 0;
+		while (true) {
+			res.state1 = interpolate(from1, to1, res.time);
+			res.state2 = interpolate(from2, to2, res.time);
+			const auto sep = compute_separation(s1, res.state1, s2, res.state2);
+			if (!sep) {
+				return std::nullopt;
+			}
+			res.closest = sep.value();
+			++res.iterations;
+			if (sep->distance <= tolerance) {
+				return res;
+			}
+			if (res.iterations == max_iterations) {
+				// the shapes are still apart, but advancing never skips past the time of impact, so the time
+				// reached is safe to stop at
+				return res;
+			}
+			const scalar speed = vec::dot(linear, sep->normal) + angular;
+			if (speed <= 0.0f) {
+				return std::nullopt; // the shapes are moving apart
+			}
+			// aim for half the tolerance so that each step makes progress
+			res.time += (sep->distance - 0.5f * tolerance) / speed;
+			if (res.time > 1.0f) {
+				return std::nullopt;
+			}
+		}
+	}
+}
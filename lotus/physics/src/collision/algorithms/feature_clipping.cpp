@@ -0,0 +1,338 @@
+#include "lotus/collision/algorithms/feature_clipping.h"
+
+/// \file
+/// Implementation of contact manifold generation by feature clipping.
+
+#include <algorithm>
+#include <cmath>
+
+namespace lotus::collision {
+	/// A vertex of the polygon that is being clipped, and the features that it originates from.
+	struct _clip_vertex {
+		/// Initializes all fields of this struct.
+		_clip_vertex(vec3 pos, contact_feature inc, contact_feature ref) :
+			position(pos), incident_feature(inc), reference_feature(ref) {
+		}
+
+		vec3 position = uninitialized; ///< World space position.
+		contact_feature incident_feature = uninitialized; ///< Feature of the incident polyhedron.
+		contact_feature reference_feature = uninitialized; ///< Feature of the reference polyhedron.
+	};
+	/// A polygon that is being clipped.
+	using _clip_polygon = short_vector<_clip_vertex, feature_clipping::max_clipped_points>;
+
+	/// Returns the unnormalized normal of the given polygon, computed using Newell's method. Its length is twice
+	/// the area of the polygon.
+	[[nodiscard]] static vec3 _polygon_normal(std::span<const vec3> positions) {
+		vec3 result = zero;
+		for (std::size_t i = 0, j = positions.size() - 1; i < positions.size(); j = i, ++i) {
+			result += vec::cross(positions[j], positions[i]);
+		}
+		return result;
+	}
+
+	/// Returns a value in [0, 4) that increases monotonically with the angle of the given 2D vector, which is
+	/// cheaper than \p std::atan2() and sufficient for sorting.
+	[[nodiscard]] static scalar _pseudo_angle(scalar x, scalar y) {
+		const scalar sum = std::abs(x) + std::abs(y);
+		if (sum == 0.0f) {
+			return 0.0f;
+		}
+		const scalar p = x / sum;
+		return y < 0.0f ? 3.0f + p : 1.0f - p;
+	}
+
+	/// Returns the feature that identifies the given face: an arbitrary but consistent choice of its vertices.
+	[[nodiscard]] static contact_feature _face_feature(const feature_clipping::feature &f) {
+		auto sorted = f.vertices;
+		std::sort(sorted.begin(), sorted.end());
+		return contact_feature::from_vertices(sorted[0], sorted[1], sorted[2]);
+	}
+
+	/// Returns the feature of the incident polyhedron that contains both given points of the clipped polygon.
+	/// Vertices and edges are merged into edges; if the points only share the incident face, the face is returned.
+	[[nodiscard]] static contact_feature _common_incident_feature(
+		const contact_feature &a, const contact_feature &b, const contact_feature &face
+	) {
+		std::array<std::uint32_t, 6> verts{};
+		std::uint32_t count = 0;
+		for (const contact_feature *f : { &a, &b }) {
+			for (std::uint32_t v : f->vertices) {
+				if (v != contact_feature::invalid_vertex) {
+					verts[count] = v;
+					++count;
+				}
+			}
+		}
+		std::sort(verts.begin(), verts.begin() + count);
+		count = static_cast<std::uint32_t>(std::unique(verts.begin(), verts.begin() + count) - verts.begin());
+		if (count > 2) {
+			return face;
+		}
+		return contact_feature::from_vertices(verts[0], count > 1 ? verts[1] : contact_feature::invalid_vertex);
+	}
+
+
+	feature_clipping::feature feature_clipping::find_support_feature(
+		const shapes::polyhedron &poly, const physics::body_state &state, vec3 dir
+	) {
+		const vec3 local_dir = state.rotation.inverse().rotate(dir);
+		const std::uint32_t support = poly.get_support_vertex(local_dir, 0).first;
+		const vec3 support_pos = poly.vertices[support];
+
+		feature result;
+		result.vertices.emplace_back(support);
+		bool overflow = false;
+		const auto try_add = [&](std::uint32_t v) {
+			if (std::find(result.vertices.begin(), result.vertices.end(), v) != result.vertices.end()) {
+				return;
+			}
+			const vec3 offset = poly.vertices[v] - support_pos;
+			if (vec::dot(offset, local_dir) < -feature_tolerance * offset.norm()) {
+				return;
+			}
+			if (result.vertices.size() == max_feature_vertices) {
+				overflow = true;
+				return;
+			}
+			result.vertices.emplace_back(v);
+		};
+		if (poly.adjacency_offsets.empty()) {
+			for (std::uint32_t i = 0; i < poly.vertices.size() && !overflow; ++i) {
+				try_add(i);
+			}
+		} else { // features are connected, so it's enough to flood from the support vertex along the hull
+			for (std::size_t i = 0; i < result.vertices.size() && !overflow; ++i) {
+				const std::uint32_t v = result.vertices[i];
+				for (std::uint32_t j = poly.adjacency_offsets[v]; j < poly.adjacency_offsets[v + 1]; ++j) {
+					try_add(poly.adjacency[j]);
+				}
+			}
+		}
+		if (overflow) { // the face is too large; only report the support vertex
+			result.vertices.resize(1);
+		}
+
+		for (std::uint32_t v : result.vertices) {
+			result.positions.emplace_back(state.position + state.rotation.rotate(poly.vertices[v]));
+		}
+		if (result.vertices.size() < 3) {
+			return result;
+		}
+
+		// sort the vertices around their centroid
+		vec3 centroid = zero;
+		for (const vec3 &p : result.positions) {
+			centroid += p;
+		}
+		centroid /= static_cast<scalar>(result.positions.size());
+		const vec3 x = vec::unsafe_normalize(result.positions[0] - centroid);
+		const vec3 y = vec::cross(dir, x);
+		std::array<std::pair<scalar, std::uint32_t>, max_feature_vertices> angles;
+		for (std::size_t i = 0; i < result.vertices.size(); ++i) {
+			const vec3 offset = result.positions[i] - centroid;
+			angles[i] = { _pseudo_angle(vec::dot(offset, x), vec::dot(offset, y)), result.vertices[i] };
+		}
+		std::sort(angles.begin(), angles.begin() + result.vertices.size());
+		for (std::size_t i = 0; i < result.vertices.size(); ++i) {
+			result.vertices[i] = angles[i].second;
+			result.positions[i] = state.position + state.rotation.rotate(poly.vertices[angles[i].second]);
+		}
+
+		// vertices that are almost collinear are treated as an edge between the two that are farthest apart
+		scalar max_dist2 = 0.0f;
+		std::size_t first = 0;
+		std::size_t second = 1;
+		for (std::size_t i = 0; i < result.positions.size(); ++i) {
+			for (std::size_t j = i + 1; j < result.positions.size(); ++j) {
+				const scalar dist2 = (result.positions[i] - result.positions[j]).squared_norm();
+				if (dist2 > max_dist2) {
+					max_dist2 = dist2;
+					first = i;
+					second = j;
+				}
+			}
+		}
+		const scalar area2 = _polygon_normal(std::span(result.positions.begin(), result.positions.size())).norm();
+		if (area2 <= feature_tolerance * max_dist2) {
+			feature edge;
+			edge.vertices = { result.vertices[first], result.vertices[second] };
+			edge.positions = { result.positions[first], result.positions[second] };
+			return edge;
+		}
+		return result;
+	}
+
+	feature_clipping::result feature_clipping::clip(
+		const feature &f1, const feature &f2, vec3 normal, scalar margin
+	) {
+		result res = uninitialized;
+		res.normal = normal;
+		const std::size_t count1 = f1.vertices.size();
+		const std::size_t count2 = f2.vertices.size();
+		if (count1 < 2 || count2 < 2 || (count1 < 3 && count2 < 3)) {
+			return res;
+		}
+
+		// choose the face that is best aligned with the contact normal as the reference face, preferring the first
+		// polyhedron so that the choice does not flip between frames for parallel faces
+		const auto face_normal = [](const feature &f, vec3 dir) -> vec3 {
+			if (f.vertices.size() < 3) {
+				return zero;
+			}
+			const vec3 n = vec::unsafe_normalize(_polygon_normal(std::span(f.positions.begin(), f.positions.size())));
+			return vec::dot(n, dir) < 0.0f ? -n : n;
+		};
+		const vec3 normal1 = face_normal(f1, normal);
+		const vec3 normal2 = face_normal(f2, -normal);
+		const bool reference1 = count1 >= 3 && vec::dot(normal1, normal) >= 0.98f * vec::dot(normal2, -normal);
+		const feature &ref = reference1 ? f1 : f2;
+		const feature &inc = reference1 ? f2 : f1;
+		const vec3 ref_normal = reference1 ? normal1 : normal2;
+		res.normal = reference1 ? ref_normal : -ref_normal;
+
+		const contact_feature ref_face = _face_feature(ref);
+		const contact_feature inc_face = inc.vertices.size() >= 3 ?
+			_face_feature(inc) :
+			contact_feature::from_vertices(inc.vertices[0], inc.vertices[1]);
+		// the polygon is clipped back and forth between two buffers
+		std::array<_clip_polygon, 2> buffers;
+		std::size_t current = 0;
+		for (std::size_t i = 0; i < inc.vertices.size(); ++i) {
+			buffers[current].emplace_back(inc.positions[i], contact_feature::from_vertices(inc.vertices[i]), ref_face);
+		}
+
+		// clip against the side planes of the reference face using the Sutherland-Hodgman algorithm
+		vec3 ref_centroid = zero;
+		for (const vec3 &p : ref.positions) {
+			ref_centroid += p;
+		}
+		ref_centroid /= static_cast<scalar>(ref.positions.size());
+		for (
+			std::size_t i = 0, j = ref.positions.size() - 1;
+			i < ref.positions.size() && !buffers[current].empty();
+			j = i, ++i
+		) {
+			const vec3 edge_start = ref.positions[j];
+			vec3 side_normal = vec::cross(ref.positions[i] - edge_start, ref_normal);
+			if (vec::dot(side_normal, ref_centroid - edge_start) > 0.0f) {
+				side_normal = -side_normal;
+			}
+			const contact_feature side_feature = contact_feature::from_vertices(ref.vertices[j], ref.vertices[i]);
+			const auto side_distance = [&](vec3 p) {
+				return vec::dot(p - edge_start, side_normal);
+			};
+			const auto intersect = [&](const _clip_vertex &a, scalar da, const _clip_vertex &b, scalar db) {
+				return _clip_vertex(
+					a.position + (da / (da - db)) * (b.position - a.position),
+					_common_incident_feature(a.incident_feature, b.incident_feature, inc_face),
+					side_feature
+				);
+			};
+
+			const _clip_polygon &input = buffers[current];
+			current = 1 - current;
+			_clip_polygon &poly = buffers[current];
+			poly.clear();
+			if (input.size() == 2) { // an edge, which is not closed
+				const scalar d0 = side_distance(input[0].position);
+				const scalar d1 = side_distance(input[1].position);
+				if (d0 <= 0.0f) {
+					poly.emplace_back(input[0]);
+				}
+				if ((d0 <= 0.0f) != (d1 <= 0.0f)) {
+					poly.emplace_back(intersect(input[0], d0, input[1], d1));
+				}
+				if (d1 <= 0.0f) {
+					poly.emplace_back(input[1]);
+				}
+				continue;
+			}
+			for (std::size_t k = 0, l = input.size() - 1; k < input.size(); l = k, ++k) {
+				const scalar dprev = side_distance(input[l].position);
+				const scalar dcur = side_distance(input[k].position);
+				if ((dprev <= 0.0f) != (dcur <= 0.0f)) {
+					poly.emplace_back(intersect(input[l], dprev, input[k], dcur));
+				}
+				if (dcur <= 0.0f) {
+					poly.emplace_back(input[k]);
+				}
+			}
+		}
+
+		// keep points below the reference face or within the margin, and project them onto the face
+		for (const _clip_vertex &v : buffers[current]) {
+			const scalar dist = vec::dot(v.position - ref.positions[0], ref_normal);
+			if (dist > margin) {
+				continue;
+			}
+			contact_point &pt = res.points.emplace_back(uninitialized);
+			const vec3 projected = v.position - dist * ref_normal;
+			pt.depth = -dist;
+			if (reference1) {
+				pt.position1 = projected;
+				pt.position2 = v.position;
+				pt.feature1 = v.reference_feature;
+				pt.feature2 = v.incident_feature;
+			} else {
+				pt.position1 = v.position;
+				pt.position2 = projected;
+				pt.feature1 = v.incident_feature;
+				pt.feature2 = v.reference_feature;
+			}
+		}
+		return res;
+	}
+
+	std::uint32_t feature_clipping::reduce(std::span<contact_point> points, vec3 normal) {
+		if (points.size() <= max_manifold_points) {
+			return static_cast<std::uint32_t>(points.size());
+		}
+		// moves the point with the highest score among the remaining ones to the given index
+		const auto select = [&](std::size_t index, auto &&score) {
+			std::size_t best = index;
+			scalar best_score = score(points[index]);
+			for (std::size_t i = index + 1; i < points.size(); ++i) {
+				const scalar s = score(points[i]);
+				if (s > best_score) {
+					best = i;
+					best_score = s;
+				}
+			}
+			std::swap(points[index], points[best]);
+			return best_score;
+		};
+
+		select(0, [](const contact_point &p) {
+			return p.depth;
+		});
+		const vec3 p0 = points[0].position1;
+		const scalar dist2 = select(1, [&](const contact_point &p) {
+			return (p.position1 - p0).squared_norm();
+		});
+		if (dist2 <= 0.0f) {
+			return 1;
+		}
+		const vec3 p1 = points[1].position1;
+		const auto signed_area = [&](vec3 a, vec3 b, vec3 c) {
+			return vec::dot(vec::cross(b - a, c - a), normal);
+		};
+		const scalar area = select(2, [&](const contact_point &p) {
+			return std::abs(signed_area(p0, p1, p.position1));
+		});
+		if (area <= 0.0f) {
+			return 2;
+		}
+		// the last point is the one that adds the most area to the triangle, i.e., that is farthest outside of it
+		const vec3 p2 = points[2].position1;
+		const scalar orientation = signed_area(p0, p1, p2) > 0.0f ? 1.0f : -1.0f;
+		const scalar added = select(3, [&](const contact_point &p) {
+			return -std::min({
+				orientation * signed_area(p0, p1, p.position1),
+				orientation * signed_area(p1, p2, p.position1),
+				orientation * signed_area(p2, p0, p.position1)
+			});
+		});
+		return added > 0.0f ? 4 : 3;
+	}
+}
@@ -0,0 +1,317 @@
+#include "lotus/collision/algorithms/gjk_distance.h"
+
+/// \file
+/// Implementation of the GJK distance algorithm.
+
+#include <algorithm>
+
+namespace lotus::collision {
+	/// The simplex of the GJK distance algorithm. Positions are relative to the query point, or are points of the
+	/// Minkowski difference of two polyhedra, so the algorithm searches for the point on the simplex closest to the
+	/// origin.
+	template <typename Vertex> struct _gjk_distance_simplex {
+		std::array<vec3, 4> positions{ uninitialized, uninitialized, uninitialized, uninitialized }; ///< Positions.
+		std::array<Vertex, 4> vertices{}; ///< Indices of the polyhedron vertices.
+		std::uint32_t count = 0; ///< The number of vertices.
+
+		/// Adds a vertex to this simplex.
+		void add(vec3 pos, Vertex vert) {
+			positions[count] = pos;
+			vertices[count] = vert;
+			++count;
+		}
+		/// Returns whether the given polyhedron vertex is in this simplex.
+		[[nodiscard]] bool contains(Vertex vert) const {
+			return std::find(vertices.begin(), vertices.begin() + count, vert) != vertices.begin() + count;
+		}
+		/// Keeps only the given vertices, in the given order.
+		template <std::size_t N> void keep(const std::array<std::uint32_t, N> &indices) {
+			_gjk_distance_simplex old = *this;
+			count = 0;
+			for (std::uint32_t i : indices) {
+				add(old.positions[i], old.vertices[i]);
+			}
+		}
+		/// Returns the barycentric coordinates of the given point, which should lie on this simplex, with respect
+		/// to the first three vertices. The simplex should have at most three vertices.
+		[[nodiscard]] std::array<scalar, 3> get_barycentric_coordinates(vec3 p) const {
+			if (count == 1) {
+				return { 1.0f, 0.0f, 0.0f };
+			}
+			const vec3 ab = positions[1] - positions[0];
+			const vec3 ap = p - positions[0];
+			if (count == 2) {
+				const scalar denom = ab.squared_norm();
+				const scalar t = denom > 0.0f ? vec::dot(ap, ab) / denom : 0.0f;
+				return { 1.0f - t, t, 0.0f };
+			}
+			// see Real-Time Collision Detection, section 3.4
+			const vec3 ac = positions[2] - positions[0];
+			const scalar d00 = ab.squared_norm();
+			const scalar d01 = vec::dot(ab, ac);
+			const scalar d11 = ac.squared_norm();
+			const scalar d20 = vec::dot(ap, ab);
+			const scalar d21 = vec::dot(ap, ac);
+			const scalar denom = d00 * d11 - d01 * d01;
+			if (denom == 0.0f) {
+				return { 1.0f, 0.0f, 0.0f };
+			}
+			const scalar v = (d11 * d20 - d01 * d21) / denom;
+			const scalar w = (d00 * d21 - d01 * d20) / denom;
+			return { 1.0f - v - w, v, w };
+		}
+	};
+
+	/// Returns the point on the segment between the given points that is closest to the origin, and the indices of
+	/// the points that are necessary to represent it.
+	[[nodiscard]] static std::pair<vec3, std::uint32_t> _closest_on_segment(vec3 a, vec3 b) {
+		const vec3 ab = b - a;
+		const scalar t = -vec::dot(a, ab);
+		if (t <= 0.0f) {
+			return { a, 0b01 };
+		}
+		const scalar denom = ab.squared_norm();
+		if (t >= denom) {
+			return { b, 0b10 };
+		}
+		return { a + (t / denom) * ab, 0b11 };
+	}
+
+	/// Returns the point on the given triangle that is closest to the origin, and a mask of the vertices that are
+	/// necessary to represent it. See Real-Time Collision Detection, section 5.1.5.
+	[[nodiscard]] static std::pair<vec3, std::uint32_t> _closest_on_triangle(vec3 a, vec3 b, vec3 c) {
+		const vec3 ab = b - a;
+		const vec3 ac = c - a;
+
+		const scalar d1 = -vec::dot(ab, a);
+		const scalar d2 = -vec::dot(ac, a);
+		if (d1 <= 0.0f && d2 <= 0.0f) {
+			return { a, 0b001 };
+		}
+		const scalar d3 = -vec::dot(ab, b);
+		const scalar d4 = -vec::dot(ac, b);
+		if (d3 >= 0.0f && d4 <= d3) {
+			return { b, 0b010 };
+		}
+		const scalar vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+			return { a + (d1 / (d1 - d3)) * ab, 0b011 };
+		}
+		const scalar d5 = -vec::dot(ab, c);
+		const scalar d6 = -vec::dot(ac, c);
+		if (d6 >= 0.0f && d5 <= d6) {
+			return { c, 0b100 };
+		}
+		const scalar vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+			return { a + (d2 / (d2 - d6)) * ac, 0b101 };
+		}
+		const scalar va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+			return { b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b), 0b110 };
+		}
+		const scalar denom = 1.0f / (va + vb + vc);
+		return { a + (vb * denom) * ab + (vc * denom) * ac, 0b111 };
+	}
+
+	/// Reduces the simplex to the smallest subset that contains its point closest to the origin, and returns that
+	/// point. If the simplex is a tetrahedron that contains the origin, it's left unchanged and zero is returned.
+	template <typename Vertex> [[nodiscard]] static vec3 _reduce_simplex(_gjk_distance_simplex<Vertex> &s) {
+		const auto keep_mask = [&](std::uint32_t mask, const std::array<std::uint32_t, 3> &indices) {
+			std::array<std::uint32_t, 3> kept{};
+			std::uint32_t num_kept = 0;
+			for (std::uint32_t i = 0; i < 3; ++i) {
+				if (mask & (1u << i)) {
+					kept[num_kept] = indices[i];
+					++num_kept;
+				}
+			}
+			switch (num_kept) {
+			case 1:
+				s.keep(std::array{ kept[0] });
+				break;
+			case 2:
+				s.keep(std::array{ kept[0], kept[1] });
+				break;
+			default:
+				s.keep(kept);
+				break;
+			}
+		};
+
+		switch (s.count) {
+		case 1:
+			return s.positions[0];
+		case 2:
+			{
+				const auto [closest, mask] = _closest_on_segment(s.positions[0], s.positions[1]);
+				keep_mask(mask, { 0, 1, 0 });
+				return closest;
+			}
+		case 3:
+			{
+				const auto [closest, mask] = _closest_on_triangle(s.positions[0], s.positions[1], s.positions[2]);
+				keep_mask(mask, { 0, 1, 2 });
+				return closest;
+			}
+		default:
+			break;
+		}
+
+		// test the closest point of each face that separates the origin from the opposite vertex
+		constexpr std::array<std::array<std::uint32_t, 4>, 4> faces{ {
+			{ 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 3, 1 }, { 1, 2, 3, 0 }
+		} };
+		bool outside = false;
+		vec3 best = zero;
+		scalar best_dist2 = 0.0f;
+		std::uint32_t best_mask = 0;
+		std::array<std::uint32_t, 3> best_face{};
+		for (const auto &f : faces) {
+			const vec3 a = s.positions[f[0]];
+			const vec3 normal = vec::cross(s.positions[f[1]] - a, s.positions[f[2]] - a);
+			const scalar origin_side = -vec::dot(normal, a);
+			const scalar vertex_side = vec::dot(normal, s.positions[f[3]] - a);
+			// degenerate tetrahedra are treated as if the origin is outside of all faces
+			if (origin_side * vertex_side > 0.0f) {
+				continue;
+			}
+			const auto [closest, mask] = _closest_on_triangle(a, s.positions[f[1]], s.positions[f[2]]);
+			const scalar dist2 = closest.squared_norm();
+			if (!outside || dist2 < best_dist2) {
+				outside = true;
+				best = closest;
+				best_dist2 = dist2;
+				best_mask = mask;
+				best_face = { f[0], f[1], f[2] };
+			}
+		}
+		if (!outside) {
+			return zero;
+		}
+		keep_mask(best_mask, best_face);
+		return best;
+	}
+
+	/// Relative tolerance of the squared distance used to detect convergence.
+	constexpr static scalar _tolerance = 1e-5f;
+
+	gjk_distance::result gjk_distance::closest_point(
+		const shapes::polyhedron &poly, vec3 point, std::span<const std::uint32_t> initial_vertices
+	) {
+		result res = uninitialized;
+		res.support_queries = 0;
+
+		_gjk_distance_simplex<std::uint32_t> simplex;
+		for (std::uint32_t v : initial_vertices) {
+			if (simplex.count == 4) {
+				break;
+			}
+			if (v < poly.vertices.size() && !simplex.contains(v)) {
+				simplex.add(poly.vertices[v] - point, v);
+			}
+		}
+		if (simplex.count == 0) {
+			simplex.add(poly.vertices[0] - point, 0);
+		}
+
+		vec3 closest = _reduce_simplex(simplex);
+		for (std::uint32_t i = 0; i < max_iterations && simplex.count < 4; ++i) {
+			const scalar dist2 = closest.squared_norm();
+			if (dist2 == 0.0f) {
+				break; // the point is on the surface of the polyhedron
+			}
+			const std::uint32_t support = poly.get_support_vertex(-closest, simplex.vertices[0]).first;
+			++res.support_queries;
+			const vec3 support_pos = poly.vertices[support] - point;
+			// the support point does not get meaningfully closer to the origin than the current closest point
+			if (dist2 - vec::dot(closest, support_pos) <= _tolerance * dist2 || simplex.contains(support)) {
+				break;
+			}
+			simplex.add(support_pos, support);
+			closest = _reduce_simplex(simplex);
+		}
+
+		res.vertices = simplex.vertices;
+		res.num_vertices = simplex.count;
+		if (simplex.count == 4) {
+			res.closest_point = point;
+			res.distance = 0.0f;
+		} else {
+			res.closest_point = point + closest;
+			res.distance = closest.norm();
+		}
+		return res;
+	}
+
+	gjk_distance::pair_result gjk_distance::closest_points(
+		const shapes::polyhedron &poly1, const physics::body_state &st1,
+		const shapes::polyhedron &poly2, const physics::body_state &st2
+	) {
+		using _vertex = std::array<std::uint32_t, 2>;
+
+		const uquats inv_rot1 = st1.rotation.inverse();
+		const uquats inv_rot2 = st2.rotation.inverse();
+		const auto get_position1 = [&](std::uint32_t v) {
+			return st1.position + st1.rotation.rotate(poly1.vertices[v]);
+		};
+		const auto get_position2 = [&](std::uint32_t v) {
+			return st2.position + st2.rotation.rotate(poly2.vertices[v]);
+		};
+
+		pair_result res = uninitialized;
+		res.support_queries = 0;
+
+		_gjk_distance_simplex<_vertex> simplex;
+		simplex.add(get_position1(0) - get_position2(0), { 0, 0 });
+		vec3 closest = _reduce_simplex(simplex);
+		for (std::uint32_t i = 0; i < max_iterations && simplex.count < 4; ++i) {
+			const scalar dist2 = closest.squared_norm();
+			if (dist2 == 0.0f) {
+				break; // the polyhedra are touching
+			}
+			const _vertex support{
+				poly1.get_support_vertex(inv_rot1.rotate(-closest), simplex.vertices[0][0]).first,
+				poly2.get_support_vertex(inv_rot2.rotate(closest), simplex.vertices[0][1]).first
+			};
+			++res.support_queries;
+			const vec3 support_pos = get_position1(support[0]) - get_position2(support[1]);
+			if (dist2 - vec::dot(closest, support_pos) <= _tolerance * dist2 || simplex.contains(support)) {
+				break;
+			}
+			simplex.add(support_pos, support);
+			closest = _reduce_simplex(simplex);
+		}
+
+		res.intersecting = simplex.count == 4 || closest.squared_norm() == 0.0f;
+		if (res.intersecting) {
+			res.position1 = res.position2 = get_position1(simplex.vertices[0][0]);
+			res.normal = zero;
+			res.distance = 0.0f;
+			return res;
+		}
+		res.normal = vec::unsafe_normalize(-closest);
+		if (simplex.count == 3) {
+			// the origins of baked polyhedra are their centers of mass, so their difference lies inside the
+			// Minkowski difference, and the face normal that points away from it points towards the origin
+			const vec3 face_normal = vec::cross(
+				simplex.positions[1] - simplex.positions[0], simplex.positions[2] - simplex.positions[0]
+			);
+			const vec3 inside = st1.position - st2.position;
+			const scalar face_normal_norm = face_normal.norm();
+			if (face_normal_norm > 0.0f) {
+				const scalar side = vec::dot(face_normal, simplex.positions[0] - inside);
+				res.normal = (side > 0.0f ? face_normal : -face_normal) / face_normal_norm;
+			}
+		}
+		// the closest point is the same convex combination of the vertices on both polyhedra
+		const std::array<scalar, 3> weights = simplex.get_barycentric_coordinates(closest);
+		res.position1 = res.position2 = zero;
+		for (std::uint32_t i = 0; i < simplex.count; ++i) {
+			res.position1 += weights[i] * get_position1(simplex.vertices[i][0]);
+			res.position2 += weights[i] * get_position2(simplex.vertices[i][1]);
+		}
+		res.distance = closest.norm();
+		return res;
+	}
+}
@@ -3,15 +3,33 @@
 /// \file
 /// Implementation of the GJK and EPA algorithm.
 
+#include <algorithm>
 #include <cassert>
 
 #include "lotus/memory/stack_allocator.h"
 #include "lotus/algorithms/convex_hull.h"
 
 namespace lotus::collision {
-	std::pair<bool, gjk_epa::gjk_result_state> gjk_epa::gjk() {
-		auto bookmark = get_scratch_bookmark();
+	/// Data associated with a face of the polytope in the EPA algorithm.
+	struct _epa_face {
+		scalar distance; ///< Distance from the face to the origin.
+		/// Incremented whenever the face is removed, so that entries in the face heap that refer to a removed face
+		/// can be identified, even if its ID has since been reused.
+		std::uint32_t version;
+	};
+	/// An entry in the heap of faces in the EPA algorithm.
+	struct _epa_face_heap_entry {
+		scalar distance; ///< Distance from the face to the origin.
+		incremental_convex_hull::face_id face; ///< The face.
+		std::uint32_t version; ///< \ref _epa_face::version at the time this entry was added.
 
+		/// Ordering for a min-heap on the distance.
+		[[nodiscard]] friend bool operator<(const _epa_face_heap_entry &lhs, const _epa_face_heap_entry &rhs) {
+			return lhs.distance > rhs.distance;
+		}
+	};
+
+	std::pair<bool, gjk_epa::gjk_result_state> gjk_epa::gjk() {
 		gjk_result_state state = uninitialized;
 
 		// compute simplex positions, which may have changed due to the bodies moving
@@ -19,14 +37,31 @@ namespace lotus::collision {
 			state.simplex_positions[i] = simplex_vertex_position(simplex[i]);
 		}
 
-		auto vertex_looked_at = bookmark.create_vector_array<bool>(
-			polyhedron1->vertices.size() * polyhedron2->vertices.size(), false
-		);
+		// GJK usually only visits a handful of vertices, so they're kept in a small array on the stack. when it's
+		// full, the vertices are moved to scratch memory whose size is doubled as necessary; a revisited vertex is
+		// the only evidence of separation in some cases, so no vertex can be forgotten
+		std::array<simplex_vertex, initial_gjk_vertices> local_visited_vertices{};
+		simplex_vertex *visited_vertices = local_visited_vertices.data();
+		std::size_t visited_vertices_capacity = initial_gjk_vertices;
+		std::size_t num_visited_vertices = 0;
+		memory::stack_allocator::scoped_bookmark bookmark = nullptr;
 		auto mark_vert = [&](simplex_vertex v) {
-			vertex_looked_at[v.index1 * polyhedron2->vertices.size() + v.index2] = true;
+			if (num_visited_vertices == visited_vertices_capacity) {
+				if (visited_vertices == local_visited_vertices.data()) {
+					bookmark = get_scratch_bookmark();
+				}
+				visited_vertices_capacity *= 2;
+				simplex_vertex *const grown =
+					bookmark.create_std_allocator<simplex_vertex>().allocate(visited_vertices_capacity);
+				std::copy_n(visited_vertices, num_visited_vertices, grown);
+				visited_vertices = grown;
+			}
+			visited_vertices[num_visited_vertices] = v;
+			++num_visited_vertices;
 		};
 		auto check_vert = [&](simplex_vertex v) {
-			return vertex_looked_at[v.index1 * polyhedron2->vertices.size() + v.index2];
+			return std::find(visited_vertices, visited_vertices + num_visited_vertices, v) !=
+				visited_vertices + num_visited_vertices;
 		};
 		for (std::size_t i = 0; i < simplex_vertices; ++i) {
 			mark_vert(simplex[i]);
@@ -39,6 +74,7 @@ namespace lotus::collision {
 				// position is center1 - center2; support vector is its negation
 				const vec3 initial_support_vec = center2 - center1;
 				simplex[0] = support_vertex(initial_support_vec);
+				++state.support_queries;
 				mark_vert(simplex[0]);
 				state.simplex_positions[0] = simplex_vertex_position(simplex[0]);
 				++simplex_vertices;
@@ -46,9 +82,12 @@ namespace lotus::collision {
 			[[fallthrough]];
 		case 1:
 			{
-				simplex[1] = support_vertex(-state.simplex_positions[0]);
+				simplex[1] = support_vertex(-state.simplex_positions[0], simplex[0]);
+				++state.support_queries;
 				if (check_vert(simplex[1])) {
-					return { false, state }; // this vertex is the closest to the origin - no collision
+					// this vertex is the closest to the origin - no collision
+					state.separating_axis = -state.simplex_positions[0];
+					return { false, state };
 				}
 				mark_vert(simplex[1]);
 				state.simplex_positions[1] = simplex_vertex_position(simplex[1]);
@@ -57,6 +96,7 @@ namespace lotus::collision {
 				// fast exit: the support vertex does not reach the origin, thus the Minkowski difference does not
 				// contain the origin
 				if (vec::dot(state.simplex_positions[0], state.simplex_positions[1]) > 0.0f) {
+					state.separating_axis = -state.simplex_positions[0];
 					return { false, state };
 				}
 			}
@@ -65,7 +105,8 @@ namespace lotus::collision {
 			{
 				const vec3 line_diff = state.simplex_positions[1] - state.simplex_positions[0];
 				const vec3 support = vec::cross(line_diff, vec::cross(line_diff, state.simplex_positions[0]));
-				simplex[2] = support_vertex(support);
+				simplex[2] = support_vertex(support, simplex[1]);
+				++state.support_queries;
 				if (check_vert(simplex[2])) {
 					return { false, state }; // no collision
 				}
@@ -75,6 +116,7 @@ namespace lotus::collision {
 
 				// fast exit
 				if (vec::dot(support, state.simplex_positions[2]) < 0.0f) {
+					state.separating_axis = support;
 					return { false, state };
 				}
 			}
@@ -88,7 +130,8 @@ namespace lotus::collision {
 				if (vec::dot(support, state.simplex_positions[0]) > 0.0f) {
 					support = -support;
 				}
-				simplex[3] = support_vertex(support);
+				simplex[3] = support_vertex(support, simplex[2]);
+				++state.support_queries;
 				if (check_vert(simplex[3])) {
 					return { false, state }; // no collision
 				}
@@ -121,7 +164,8 @@ namespace lotus::collision {
 				const scalar dotv = vec::dot(normal, state.simplex_positions[i]);
 				if (dotv < 0.0f) {
 					// this face is facing the origin; use its normal as the support vector to find the next vertex
-					auto new_vertex = support_vertex(normal);
+					auto new_vertex = support_vertex(normal, simplex[i]);
+					++state.support_queries;
 					if (check_vert(new_vertex)) {
 						return { false, state }; // no more vertices to find; no collision
 					}
@@ -133,6 +177,7 @@ namespace lotus::collision {
 
 					// fast exit
 					if (vec::dot(normal, state.simplex_positions[replace_index]) <= 0.0f) {
+						state.separating_axis = normal;
 						return { false, state };
 					}
 
@@ -152,77 +197,182 @@ namespace lotus::collision {
 	gjk_epa::epa_result gjk_epa::epa(gjk_result_state gjk_state) const {
 		namespace convex_hull = incremental_convex_hull;
 
+		using polytope_vertex = std::pair<vec3, simplex_vertex>;
+
 		auto bookmark = get_scratch_bookmark();
 
-		auto hull_storage = convex_hull::create_storage_for_num_vertices(
-			static_cast<std::uint32_t>(polyhedron1->vertices.size() * polyhedron2->vertices.size()),
-			bookmark.create_std_allocator<convex_hull::vec3>(),
-			bookmark.create_std_allocator<convex_hull::face_entry>()
-		);
-		auto hull_data = hull_storage.create_user_data_storage<simplex_vertex, scalar>(
-			uninitialized,
-			uninitialized,
-			bookmark.create_std_allocator<simplex_vertex>(),
-			bookmark.create_std_allocator<scalar>()
-		);
-		auto hull = hull_storage.create_state_for_tetrahedron(
-			{
-				gjk_state.simplex_positions[0].into<convex_hull::scalar>(),
-				gjk_state.simplex_positions[1].into<convex_hull::scalar>(),
-				gjk_state.simplex_positions[2].into<convex_hull::scalar>(),
-				gjk_state.simplex_positions[3].into<convex_hull::scalar>()
-			},
-			[&hull_data](const convex_hull::state &hull, convex_hull::face_id fi) {
-				const auto& face = hull.get_face(fi);
-				hull_data.get(fi) = vec::dot(
-					vec::unsafe_normalize(face.normal), hull.get_vertex(face.vertex_indices[0])
-				);
-			}
-		);
-		for (std::uint32_t i = 0; i < 4; ++i) {
-			hull_data.get(static_cast<convex_hull::vertex_id>(i)) = simplex[i];
+		// the polytope can have at most as many vertices as the Minkowski difference
+		const auto max_vertices = static_cast<std::uint32_t>(std::clamp<std::size_t>(
+			polyhedron1->vertices.size() * polyhedron2->vertices.size(), 4, max_epa_vertices
+		));
+		// all vertices that have been added to the polytope, used to rebuild it when its storage is grown
+		auto polytope_vertices = bookmark.create_reserved_vector_array<polytope_vertex>(max_vertices);
+		for (std::size_t i = 0; i < 4; ++i) {
+			polytope_vertices.emplace_back(gjk_state.simplex_positions[i], simplex[i]);
 		}
+		const std::size_t polytope_vertices_bytes = sizeof(polytope_vertex) * max_vertices;
 
-		while (true) {
-			// find the closest plane
-			convex_hull::face_id nearest_face_id = hull.get_any_face();
-			convex_hull::scalar nearest_face_dist = hull_data.get(nearest_face_id);
-			for (convex_hull::face_id fi = hull.get_face(hull.get_any_face()).next; fi != hull.get_any_face(); ) {
-				const float dist = hull_data.get(fi);
-				if (dist < nearest_face_dist) {
-					nearest_face_dist = dist;
-					nearest_face_id = fi;
+		std::uint32_t iterations = 0;
+		std::size_t peak_scratch_bytes = 0;
+		for (std::uint32_t capacity = std::min(initial_epa_vertices, max_vertices); ; ) {
+			auto attempt_bookmark = get_scratch_bookmark();
+			peak_scratch_bytes = std::max(
+				peak_scratch_bytes, polytope_vertices_bytes + get_epa_scratch_bytes(capacity)
+			);
+
+			auto hull_storage = convex_hull::create_storage_for_num_vertices(
+				capacity,
+				attempt_bookmark.create_std_allocator<convex_hull::vec3>(),
+				attempt_bookmark.create_std_allocator<convex_hull::face_entry>()
+			);
+			auto hull_data = hull_storage.create_user_data_storage<simplex_vertex, _epa_face>(
+				uninitialized,
+				_epa_face(0.0f, 0),
+				attempt_bookmark.create_std_allocator<simplex_vertex>(),
+				attempt_bookmark.create_std_allocator<_epa_face>()
+			);
+			// min-heap of faces keyed on their distances to the origin; entries of removed faces are discarded
+			// lazily when they reach the top of the heap, or when the heap runs out of space. for small polytopes,
+			// scanning all faces is cheaper than maintaining the heap; in that case the heap has zero capacity
+			const bool use_face_heap = capacity >= face_heap_min_epa_vertices;
+			auto face_heap = attempt_bookmark.create_reserved_vector_array<_epa_face_heap_entry>(
+				use_face_heap ? get_epa_face_heap_capacity(capacity) : 0
+			);
+			auto hull = hull_storage.create_state_for_tetrahedron(
+				{
+					polytope_vertices[0].first.into<convex_hull::scalar>(),
+					polytope_vertices[1].first.into<convex_hull::scalar>(),
+					polytope_vertices[2].first.into<convex_hull::scalar>(),
+					polytope_vertices[3].first.into<convex_hull::scalar>()
+				},
+				[&hull_data, &face_heap](const convex_hull::state &hull, convex_hull::face_id fi) {
+					const auto& face = hull.get_face(fi);
+					_epa_face &data = hull_data.get(fi);
+					data.distance = vec::dot(
+						vec::unsafe_normalize(face.normal), hull.get_vertex(face.vertex_indices[0])
+					);
+					if (face_heap.capacity() == 0) {
+						return;
+					}
+					if (face_heap.size() == face_heap.capacity()) {
+						// there can be no more live faces than the hull has storage for, so this frees up space
+						std::erase_if(face_heap, [&hull_data](const _epa_face_heap_entry &entry) {
+							return hull_data.get(entry.face).version != entry.version;
+						});
+						std::make_heap(face_heap.begin(), face_heap.end());
+					}
+					face_heap.emplace_back(data.distance, fi, data.version);
+					std::push_heap(face_heap.begin(), face_heap.end());
+				},
+				use_face_heap ?
+					convex_hull::state::face_callback([&hull_data](const convex_hull::state&, convex_hull::face_id fi) {
+						++hull_data.get(fi).version;
+					}) :
+					nullptr
+			);
+			for (std::uint32_t i = 0; i < 4; ++i) {
+				hull_data.get(static_cast<convex_hull::vertex_id>(i)) = polytope_vertices[i].second;
+			}
+			// re-add vertices from the previous attempt
+			std::uint32_t num_hull_vertices = 4;
+			for (std::size_t i = 4; i < polytope_vertices.size(); ++i) {
+				if (auto vi = hull.add_vertex(polytope_vertices[i].first.into<convex_hull::scalar>())) {
+					hull_data.get(vi.value()) = polytope_vertices[i].second;
+					++num_hull_vertices;
 				}
-				fi = hull.get_face(fi).next;
 			}
-			//crash_if(nearest_face_dist < 0.0f);
-
-			// find new vertex
-			const convex_hull::face &nearest_face = hull.get_face(nearest_face_id);
-			const simplex_vertex new_vert_id = support_vertex(nearest_face.normal);
-			const vec3 new_vert_pos = simplex_vertex_position(new_vert_id);
-			const scalar new_dist = vec::dot(vec::unsafe_normalize(nearest_face.normal), new_vert_pos);
-			if (new_dist - nearest_face_dist < 1e-6f) { // TODO: threshold
-				const convex_hull::vertex_id v1 = nearest_face.vertex_indices[0];
-				const convex_hull::vertex_id v2 = nearest_face.vertex_indices[1];
-				const convex_hull::vertex_id v3 = nearest_face.vertex_indices[2];
-				return epa_result(
-					std::array{ hull.get_vertex(v1), hull.get_vertex(v2), hull.get_vertex(v3) },
-					std::array{ hull_data.get(v1), hull_data.get(v2), hull_data.get(v3) },
-					nearest_face.normal, nearest_face_dist
+
+			while (true) {
+				// find the closest plane
+				convex_hull::face_id nearest_face_id = hull.get_any_face();
+				convex_hull::scalar nearest_face_dist = hull_data.get(nearest_face_id).distance;
+				if (use_face_heap) {
+					// discard removed faces; the closest face stays in the heap, and is invalidated when the
+					// polytope is expanded past it
+					while (hull_data.get(face_heap.front().face).version != face_heap.front().version) {
+						std::pop_heap(face_heap.begin(), face_heap.end());
+						face_heap.pop_back();
+					}
+					nearest_face_id = face_heap.front().face;
+					nearest_face_dist = face_heap.front().distance;
+				} else {
+					for (
+						convex_hull::face_id fi = hull.get_face(hull.get_any_face()).next;
+						fi != hull.get_any_face();
+					) {
+						const float dist = hull_data.get(fi).distance;
+						if (dist < nearest_face_dist) {
+							nearest_face_dist = dist;
+							nearest_face_id = fi;
+						}
+						fi = hull.get_face(fi).next;
+					}
+				}
+				//crash_if(nearest_face_dist < 0.0f);
+
+				// find new vertex
+				const convex_hull::face &nearest_face = hull.get_face(nearest_face_id);
+				const simplex_vertex new_vert_id = support_vertex(
+					nearest_face.normal, hull_data.get(nearest_face.vertex_indices[0])
 				);
+				const vec3 new_vert_pos = simplex_vertex_position(new_vert_id);
+				const scalar new_dist = vec::dot(vec::unsafe_normalize(nearest_face.normal), new_vert_pos);
+				const bool converged = new_dist - nearest_face_dist < 1e-6f; // TODO: threshold
+				// when the polytope cannot grow any further, the nearest face is the best available estimate
+				const bool exhausted = !converged && num_hull_vertices == max_vertices;
+				if (converged || exhausted) {
+					const convex_hull::vertex_id v1 = nearest_face.vertex_indices[0];
+					const convex_hull::vertex_id v2 = nearest_face.vertex_indices[1];
+					const convex_hull::vertex_id v3 = nearest_face.vertex_indices[2];
+					epa_result result(
+						std::array{ hull.get_vertex(v1), hull.get_vertex(v2), hull.get_vertex(v3) },
+						std::array{ hull_data.get(v1), hull_data.get(v2), hull_data.get(v3) },
+						vec::unsafe_normalize(nearest_face.normal), nearest_face_dist
+					);
+					result.iterations = iterations + 1;
+					result.converged = converged;
+					result.peak_scratch_bytes = peak_scratch_bytes;
+					return result;
+				}
+				if (num_hull_vertices == capacity) {
+					break; // grow the storage and rebuild the polytope
+				}
+
+				// expand & remove faces
+				++iterations;
+				const convex_hull::vertex_id vi = hull.add_vertex_hint(new_vert_pos, nearest_face_id);
+				hull_data.get(vi) = new_vert_id;
+				polytope_vertices.emplace_back(new_vert_pos, new_vert_id);
+				++num_hull_vertices;
 			}
 
-			// expand & remove faces
-			const convex_hull::vertex_id vi = hull.add_vertex_hint(new_vert_pos, nearest_face_id);
-			hull_data.get(vi) = new_vert_id;
+			capacity = std::min(capacity * 2, max_vertices);
 		}
 	}
 
-	gjk_epa::simplex_vertex gjk_epa::support_vertex(vec3 dir) const {
+	std::size_t gjk_epa::get_epa_scratch_bytes(std::uint32_t num_vertices) {
+		const std::size_t num_faces = incremental_convex_hull::get_max_num_triangles_for_vertex_count(num_vertices);
+		return
+			num_vertices * (sizeof(incremental_convex_hull::vec3) + sizeof(simplex_vertex)) +
+			num_faces * (sizeof(incremental_convex_hull::face_entry) + sizeof(_epa_face)) +
+			get_epa_face_heap_capacity(num_vertices) * sizeof(_epa_face_heap_entry);
+	}
+
+	std::size_t gjk_epa::get_epa_face_heap_capacity(std::uint32_t num_vertices) {
+		// the heap is compacted when it's full, so this must be larger than the number of faces; with four times the
+		// number of faces, at least three quarters of the heap are freed up by each compaction
+		return 4 * incremental_convex_hull::get_max_num_triangles_for_vertex_count(num_vertices);
+	}
+
+	bool gjk_epa::is_separated_along(vec3 axis, scalar margin) const {
+		const simplex_vertex start = simplex_vertices > 0 ? simplex[0] : simplex_vertex(0, 0);
+		return vec::dot(simplex_vertex_position(support_vertex(axis, start)), axis) < -margin * axis.norm();
+	}
+
+	gjk_epa::simplex_vertex gjk_epa::support_vertex(vec3 dir, simplex_vertex start) const {
 		return gjk_epa::simplex_vertex(
-			polyhedron1->get_support_vertex(orient1.inverse().rotate(dir)).first,
-			polyhedron2->get_support_vertex(-orient2.inverse().rotate(dir)).first
+			polyhedron1->get_support_vertex(orient1.inverse().rotate(dir), start.index1).first,
+			polyhedron2->get_support_vertex(-orient2.inverse().rotate(dir), start.index2).first
 		);
 	}
 
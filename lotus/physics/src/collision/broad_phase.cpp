@@ -0,0 +1,373 @@
+#include "lotus/collision/broad_phase.h"
+
+/// \file
+/// Implementation of broad phase algorithms.
+
+#include <algorithm>
+#include <numeric>
+
+namespace lotus::collision {
+	namespace broad_phases {
+		/// Returns half of the surface area of the box.
+		[[nodiscard]] static scalar _half_area(const bounding_box &b) {
+			const vec3 size = b.signed_size();
+			return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+		}
+		/// Returns the union of the two boxes.
+		[[nodiscard]] static bounding_box _merge(const bounding_box &a, const bounding_box &b) {
+			return bounding_box::create_from_min_max(
+				vec::memberwise_min(a.min, b.min), vec::memberwise_max(a.max, b.max)
+			);
+		}
+
+		void brute_force::find_overlapping_pairs(
+			std::span<const bounding_box> boxes, std::vector<index_pair> &out
+		) {
+			const auto count = static_cast<std::uint32_t>(boxes.size());
+			for (std::uint32_t i = 0; i < count; ++i) {
+				for (std::uint32_t j = i + 1; j < count; ++j) {
+					if (overlaps(boxes[i], boxes[j])) {
+						out.emplace_back(i, j);
+					}
+				}
+			}
+		}
+
+
+		void sweep_and_prune::find_overlapping_pairs(
+			std::span<const bounding_box> boxes, std::vector<index_pair> &out
+		) {
+			// the order is only kept if it has been sorted along the same axis for the same boxes
+			bool sorted = true;
+			if (_order.size() != boxes.size()) {
+				_order.resize(boxes.size());
+				std::iota(_order.begin(), _order.end(), 0);
+				sorted = false;
+			}
+
+			{ // choose the axis with the largest variance, ignoring unbounded boxes
+				vec3 sum = zero;
+				vec3 sum_sqr = zero;
+				std::size_t num_bounded = 0;
+				for (const bounding_box &b : boxes) {
+					if (!is_bounded(b)) {
+						continue;
+					}
+					const vec3 center = 0.5f * (b.min + b.max);
+					sum += center;
+					sum_sqr += vec::memberwise_multiply(center, center);
+					++num_bounded;
+				}
+				if (num_bounded > 0) {
+					const vec3 mean = sum / static_cast<scalar>(num_bounded);
+					const vec3 variance = sum_sqr / static_cast<scalar>(num_bounded) - vec::memberwise_multiply(mean, mean);
+					std::size_t axis = 0;
+					if (variance[1] > variance[axis]) {
+						axis = 1;
+					}
+					if (variance[2] > variance[axis]) {
+						axis = 2;
+					}
+					// switching axes requires a full sort, so only do so if the new axis is clearly better; otherwise
+					// boxes whose variances are similar along two axes would keep switching between them
+					if (!sorted || variance[axis] > axis_switch_threshold * variance[_axis]) {
+						sorted = sorted && axis == _axis;
+						_axis = axis;
+					}
+				}
+			}
+
+			if (sorted) {
+				// insertion sort, which is close to linear when the order has not changed much since the last call
+				for (std::size_t i = 1; i < _order.size(); ++i) {
+					const std::uint32_t cur = _order[i];
+					const scalar key = boxes[cur].min[_axis];
+					std::size_t j = i;
+					for (; j > 0 && boxes[_order[j - 1]].min[_axis] > key; --j) {
+						_order[j] = _order[j - 1];
+					}
+					_order[j] = cur;
+				}
+			} else {
+				std::sort(_order.begin(), _order.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+					return boxes[lhs].min[_axis] < boxes[rhs].min[_axis];
+				});
+			}
+
+			// sweep
+			_active.clear();
+			for (const std::uint32_t cur : _order) {
+				const bounding_box &cur_box = boxes[cur];
+				// remove boxes that end before this one starts; this does not preserve the order of active boxes
+				for (std::size_t i = 0; i < _active.size(); ) {
+					if (boxes[_active[i]].max[_axis] < cur_box.min[_axis]) {
+						_active[i] = _active.back();
+						_active.pop_back();
+					} else {
+						++i;
+					}
+				}
+				for (const std::uint32_t other : _active) {
+					if (overlaps(boxes[other], cur_box)) {
+						out.emplace_back(std::min(cur, other), std::max(cur, other));
+					}
+				}
+				_active.emplace_back(cur);
+			}
+		}
+
+
+		void dynamic_aabb_tree::find_overlapping_pairs(
+			std::span<const bounding_box> boxes, std::vector<index_pair> &out
+		) {
+			const auto count = static_cast<std::uint32_t>(boxes.size());
+			_num_reinserted = 0;
+			if (_object_leaves.size() != boxes.size()) {
+				_clear();
+				_object_leaves.resize(boxes.size(), _invalid);
+			}
+
+			// update leaves
+			const vec3 margin_vec(margin, margin, margin);
+			_unbounded.clear();
+			for (std::uint32_t i = 0; i < count; ++i) {
+				const bounding_box &box = boxes[i];
+				const std::uint32_t leaf = _object_leaves[i];
+				if (!is_bounded(box)) {
+					if (leaf != _invalid) {
+						_remove_leaf(leaf);
+						_object_leaves[i] = _invalid;
+					}
+					_unbounded.emplace_back(i);
+					continue;
+				}
+				if (leaf != _invalid) {
+					if (contains(_nodes[leaf].box, box)) {
+						continue;
+					}
+					_remove_leaf(leaf);
+					++_num_reinserted;
+				}
+				_insert_leaf(i, bounding_box::create_from_min_max(box.min - margin_vec, box.max + margin_vec));
+			}
+
+			// query the tree for each leaf; only pairs where the other object has a larger index are reported
+			if (_root != _invalid) {
+				for (std::uint32_t i = 0; i < count; ++i) {
+					if (_object_leaves[i] == _invalid) {
+						continue;
+					}
+					const bounding_box &box = boxes[i];
+					_stack.clear();
+					_stack.emplace_back(_root);
+					while (!_stack.empty()) {
+						const _node &n = _nodes[_stack.back()];
+						_stack.pop_back();
+						if (!overlaps(n.box, box)) {
+							continue;
+						}
+						if (n.is_leaf()) {
+							if (n.object > i && overlaps(boxes[n.object], box)) {
+								out.emplace_back(i, n.object);
+							}
+						} else {
+							_stack.emplace_back(n.child1);
+							_stack.emplace_back(n.child2);
+						}
+					}
+				}
+			}
+
+			// test unbounded objects against everything else
+			for (const std::uint32_t i : _unbounded) {
+				for (std::uint32_t j = 0; j < count; ++j) {
+					if (j == i || (_object_leaves[j] == _invalid && j < i)) {
+						continue; // unbounded pairs are only reported once
+					}
+					if (overlaps(boxes[i], boxes[j])) {
+						out.emplace_back(std::min(i, j), std::max(i, j));
+					}
+				}
+			}
+		}
+
+		void dynamic_aabb_tree::_clear() {
+			_nodes.clear();
+			_object_leaves.clear();
+			_unbounded.clear();
+			_root = _invalid;
+			_free_list = _invalid;
+		}
+
+		std::uint32_t dynamic_aabb_tree::_allocate_node() {
+			if (_free_list != _invalid) {
+				const std::uint32_t result = _free_list;
+				_free_list = _nodes[result].parent;
+				return result;
+			}
+			const auto result = static_cast<std::uint32_t>(_nodes.size());
+			_nodes.emplace_back(uninitialized);
+			return result;
+		}
+
+		void dynamic_aabb_tree::_free_node(std::uint32_t n) {
+			_nodes[n].parent = _free_list;
+			_free_list = n;
+		}
+
+		void dynamic_aabb_tree::_insert_leaf(std::uint32_t object, const bounding_box &box) {
+			const std::uint32_t leaf = _allocate_node();
+			{
+				_node &n = _nodes[leaf];
+				n.box    = box;
+				n.parent = _invalid;
+				n.child1 = _invalid;
+				n.child2 = _invalid;
+				n.object = object;
+			}
+			_object_leaves[object] = leaf;
+
+			if (_root == _invalid) {
+				_root = leaf;
+				return;
+			}
+
+			// find the best sibling by descending the tree, choosing the child with the lowest area increase
+			std::uint32_t sibling = _root;
+			while (!_nodes[sibling].is_leaf()) {
+				const _node &n = _nodes[sibling];
+				const scalar area = _half_area(n.box);
+				const scalar combined_area = _half_area(_merge(n.box, box));
+				// cost of creating a new parent for this node and the leaf
+				const scalar cost = 2.0f * combined_area;
+				// minimum cost of pushing the leaf further down the tree
+				const scalar inheritance_cost = 2.0f * (combined_area - area);
+				auto child_cost = [&](std::uint32_t c) {
+					const _node &child = _nodes[c];
+					const scalar merged = _half_area(_merge(child.box, box));
+					return child.is_leaf() ? merged + inheritance_cost : merged - _half_area(child.box) + inheritance_cost;
+				};
+				const scalar cost1 = child_cost(n.child1);
+				const scalar cost2 = child_cost(n.child2);
+				if (cost < cost1 && cost < cost2) {
+					break;
+				}
+				sibling = cost1 < cost2 ? n.child1 : n.child2;
+			}
+
+			// create a new parent
+			const std::uint32_t old_parent = _nodes[sibling].parent;
+			const std::uint32_t new_parent = _allocate_node();
+			{
+				_node &n = _nodes[new_parent];
+				n.box    = _merge(_nodes[sibling].box, box);
+				n.parent = old_parent;
+				n.child1 = sibling;
+				n.child2 = leaf;
+				n.object = _invalid;
+			}
+			_nodes[sibling].parent = new_parent;
+			_nodes[leaf].parent = new_parent;
+			if (old_parent == _invalid) {
+				_root = new_parent;
+			} else {
+				_node &p = _nodes[old_parent];
+				(p.child1 == sibling ? p.child1 : p.child2) = new_parent;
+				_refit_ancestors(old_parent, true);
+			}
+		}
+
+		void dynamic_aabb_tree::_remove_leaf(std::uint32_t leaf) {
+			const std::uint32_t parent = _nodes[leaf].parent;
+			_free_node(leaf);
+			if (parent == _invalid) {
+				_root = _invalid;
+				return;
+			}
+
+			const _node &p = _nodes[parent];
+			const std::uint32_t sibling = p.child1 == leaf ? p.child2 : p.child1;
+			const std::uint32_t grandparent = p.parent;
+			_nodes[sibling].parent = grandparent;
+			_free_node(parent);
+			if (grandparent == _invalid) {
+				_root = sibling;
+			} else {
+				_node &g = _nodes[grandparent];
+				(g.child1 == parent ? g.child1 : g.child2) = sibling;
+				_refit_ancestors(grandparent, false);
+			}
+		}
+
+		void dynamic_aabb_tree::_refit_ancestors(std::uint32_t node, bool rotate) {
+			for (; node != _invalid; node = _nodes[node].parent) {
+				if (rotate) {
+					_rotate(node);
+				}
+				_node &n = _nodes[node];
+				n.box = _merge(_nodes[n.child1].box, _nodes[n.child2].box);
+			}
+		}
+
+		void dynamic_aabb_tree::_rotate(std::uint32_t node) {
+			const std::uint32_t child1 = _nodes[node].child1;
+			const std::uint32_t child2 = _nodes[node].child2;
+
+			// find the swap of a child with one of the children of its sibling that reduces the area of the sibling
+			// the most; the box of this node is unaffected, since it still contains the same leaves
+			std::uint32_t best_child = _invalid;
+			std::uint32_t best_nephew = _invalid;
+			scalar best_reduction = 0.0f;
+			for (const auto &[child, sibling] : { std::pair(child1, child2), std::pair(child2, child1) }) {
+				const _node &s = _nodes[sibling];
+				if (s.is_leaf()) {
+					continue;
+				}
+				const scalar area = _half_area(s.box);
+				const bounding_box &child_box = _nodes[child].box;
+				const std::pair<std::uint32_t, std::uint32_t> nephews[]{
+					{ s.child1, s.child2 }, { s.child2, s.child1 }
+				};
+				for (const auto &[nephew, other_nephew] : nephews) {
+					const scalar reduction = area - _half_area(_merge(child_box, _nodes[other_nephew].box));
+					if (reduction > best_reduction) {
+						best_child = child;
+						best_nephew = nephew;
+						best_reduction = reduction;
+					}
+				}
+			}
+			if (best_child == _invalid) {
+				return;
+			}
+
+			const std::uint32_t sibling = _nodes[best_nephew].parent;
+			_node &n = _nodes[node];
+			(n.child1 == best_child ? n.child1 : n.child2) = best_nephew;
+			_nodes[best_nephew].parent = node;
+			_node &s = _nodes[sibling];
+			(s.child1 == best_nephew ? s.child1 : s.child2) = best_child;
+			_nodes[best_child].parent = sibling;
+			s.box = _merge(_nodes[s.child1].box, _nodes[s.child2].box);
+		}
+	}
+
+
+	broad_phase broad_phase::create(type t) {
+		broad_phase result;
+		switch (t) {
+		case type::brute_force:
+			result.value.emplace<broad_phases::brute_force>();
+			break;
+		case type::sweep_and_prune:
+			result.value.emplace<broad_phases::sweep_and_prune>();
+			break;
+		case type::dynamic_aabb_tree:
+			result.value.emplace<broad_phases::dynamic_aabb_tree>();
+			break;
+		default:
+			std::abort(); // invalid type
+		}
+		return result;
+	}
+}
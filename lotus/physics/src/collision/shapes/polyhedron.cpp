@@ -48,8 +48,16 @@ namespace lotus::collision::shapes {
 			vertices[2].into<float>(),
 			vertices[3].into<float>()
 		});
+		// vertices that are inside the hull when they're added are not assigned IDs, so IDs need to be mapped back
+		// to indices into vertices
+		auto hull_vertex_indices = bookmark.create_reserved_vector_array<std::uint32_t>(vertices.size());
+		for (std::uint32_t i = 0; i < 4; ++i) {
+			hull_vertex_indices.emplace_back(i);
+		}
 		for (std::size_t i = 4; i < vertices.size(); ++i) {
-			hull_state.add_vertex(vertices[i].into<float>());
+			if (hull_state.add_vertex(vertices[i].into<float>())) {
+				hull_vertex_indices.emplace_back(static_cast<std::uint32_t>(i));
+			}
 		}
 
 		// gather faces
@@ -63,15 +71,36 @@ namespace lotus::collision::shapes {
 			do {
 				const incremental_convex_hull::face &face = hull_state.get_face(face_ptr);
 				faces.emplace_back(std::array{
-					std::to_underlying(face.vertex_indices[0]),
-					std::to_underlying(face.vertex_indices[1]),
-					std::to_underlying(face.vertex_indices[2])
+					hull_vertex_indices[std::to_underlying(face.vertex_indices[0])],
+					hull_vertex_indices[std::to_underlying(face.vertex_indices[1])],
+					hull_vertex_indices[std::to_underlying(face.vertex_indices[2])]
 				});
 				face_ptr = face.next;
 			} while (face_ptr != hull_state.get_any_face());
 		}
 		const auto prop = properties::compute_for(vertices, faces);
 
+		{ // collect adjacency - each edge appears once in each direction in the faces
+			adjacency_offsets.assign(vertices.size() + 1, 0);
+			for (const auto &f : faces) {
+				for (std::uint32_t v : f) {
+					++adjacency_offsets[v + 1];
+				}
+			}
+			for (std::size_t i = 1; i < adjacency_offsets.size(); ++i) {
+				adjacency_offsets[i] += adjacency_offsets[i - 1];
+			}
+			adjacency.resize(adjacency_offsets.back());
+			auto next = bookmark.create_vector_array<std::uint32_t>(
+				adjacency_offsets.begin(), adjacency_offsets.end() - 1
+			);
+			for (const auto &f : faces) {
+				for (std::size_t i = 0; i < 3; ++i) {
+					adjacency[next[f[i]]++] = f[(i + 1) % 3];
+				}
+			}
+		}
+
 		for (vec3 &v : vertices) {
 			v -= prop.center_of_mass;
 		}
@@ -90,4 +119,44 @@ namespace lotus::collision::shapes {
 		}
 		return { static_cast<std::uint32_t>(result), dot1max };
 	}
+
+	std::pair<std::uint32_t, scalar> polyhedron::get_support_vertex(vec3 dir, std::uint32_t start) const {
+		if (
+			vertices.size() < hill_climbing_min_vertices ||
+			adjacency_offsets.size() != vertices.size() + 1 ||
+			adjacency_offsets[start] == adjacency_offsets[start + 1]
+		) {
+			return get_support_vertex(dir);
+		}
+
+		// a vertex of a convex polyhedron that's not worse than any of its neighbors is a global maximum
+		std::uint32_t result = start;
+		scalar dotmax = vec::dot(vertices[result], dir);
+		while (true) {
+			const std::uint32_t current = result;
+			for (std::uint32_t i = adjacency_offsets[current]; i < adjacency_offsets[current + 1]; ++i) {
+				const scalar dv = vec::dot(vertices[adjacency[i]], dir);
+				if (dv > dotmax) {
+					dotmax = dv;
+					result = adjacency[i];
+				}
+			}
+			if (result == current) {
+				return { result, dotmax };
+			}
+		}
+	}
+
+	bounding_box polyhedron::get_bounds(const physics::body_state &st) const {
+		const vec3 first = st.rotation.rotate(vertices[0]);
+		bounding_box result = bounding_box::create_singularity(first);
+		for (std::size_t i = 1; i < vertices.size(); ++i) {
+			const vec3 v = st.rotation.rotate(vertices[i]);
+			result.min = vec::memberwise_min(result.min, v);
+			result.max = vec::memberwise_max(result.max, v);
+		}
+		result.min += st.position;
+		result.max += st.position;
+		return result;
+	}
 }
@@ -0,0 +1,25 @@
+#include "lotus/collision/shapes/simple.h"
+
+/// \file
+/// Implementation of simple shapes.
+
+namespace lotus::collision::shapes {
+	bounding_box plane::get_bounds(const physics::body_state &st) const {
+		constexpr scalar inf = std::numeric_limits<scalar>::infinity();
+
+		bounding_box result = bounding_box::create_from_min_max(vec3(-inf, -inf, -inf), vec3(inf, inf, inf));
+		const vec3 normal = st.rotation.rotate(vec3(0.0f, 0.0f, 1.0f));
+		for (std::size_t i = 0; i < 3; ++i) {
+			if (std::abs(normal[i]) >= 1.0f - 1e-6f) {
+				// the half space lies below the plane, i.e., opposite the normal
+				if (normal[i] > 0.0f) {
+					result.max[i] = st.position[i];
+				} else {
+					result.min[i] = st.position[i];
+				}
+				break;
+			}
+		}
+		return result;
+	}
+}
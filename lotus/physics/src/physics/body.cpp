@@ -29,24 +29,32 @@ namespace lotus::physics {
 	void body::correction::apply_position(scalar &lambda) const {
 		lambda += delta_lambda;
 		const vec3 p = direction * delta_lambda;
-		body1->state.position += p * body1->properties.inverse_mass;
-		body2->state.position -= p * body2->properties.inverse_mass;
-		body1->state.rotation = quat::unsafe_normalize(
-			body1->state.rotation + body1->state.rotation * quats::from_vector((0.5f * delta_lambda) * rotation1)
-		);
-		body2->state.rotation = quat::unsafe_normalize(
-			body2->state.rotation - body2->state.rotation * quats::from_vector((0.5f * delta_lambda) * rotation2)
-		);
+		// kinematic bodies are never written to, so that corrections involving different dynamic bodies can be
+		// applied concurrently even if they share a kinematic body
+		if (body1->properties.inverse_mass > 0.0f) {
+			body1->state.position += p * body1->properties.inverse_mass;
+			body1->state.rotation = quat::unsafe_normalize(
+				body1->state.rotation + body1->state.rotation * quats::from_vector((0.5f * delta_lambda) * rotation1)
+			);
+		}
+		if (body2->properties.inverse_mass > 0.0f) {
+			body2->state.position -= p * body2->properties.inverse_mass;
+			body2->state.rotation = quat::unsafe_normalize(
+				body2->state.rotation - body2->state.rotation * quats::from_vector((0.5f * delta_lambda) * rotation2)
+			);
+		}
 	}
 
 	void body::correction::apply_velocity(scalar mag) const {
 		const scalar p_norm = -mag * delta_lambda;
 		const vec3 p = direction * p_norm;
-		body1->state.linear_velocity += p * body1->properties.inverse_mass;
-		body2->state.linear_velocity -= p * body2->properties.inverse_mass;
-		body1->state.angular_velocity +=
-			p_norm * body1->state.rotation.rotate(rotation1);
-		body2->state.angular_velocity -=
-			p_norm * body2->state.rotation.rotate(rotation2);
+		if (body1->properties.inverse_mass > 0.0f) {
+			body1->state.linear_velocity += p * body1->properties.inverse_mass;
+			body1->state.angular_velocity += p_norm * body1->state.rotation.rotate(rotation1);
+		}
+		if (body2->properties.inverse_mass > 0.0f) {
+			body2->state.linear_velocity -= p * body2->properties.inverse_mass;
+			body2->state.angular_velocity -= p_norm * body2->state.rotation.rotate(rotation2);
+		}
 	}
 }
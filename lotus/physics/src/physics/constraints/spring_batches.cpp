@@ -0,0 +1,195 @@
+#include "lotus/physics/constraints/spring_batches.h"
+
+/// \file
+/// Implementation of batched spring projection.
+
+#include <cmath>
+#include <limits>
+
+#if !defined(LOTUS_PHYSICS_NO_SIMD) && defined(__AVX2__)
+#	define LOTUS_PHYSICS_SPRING_KERNEL_AVX2
+#	include <immintrin.h>
+#elif !defined(LOTUS_PHYSICS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64))
+#	define LOTUS_PHYSICS_SPRING_KERNEL_SSE2
+#	include <emmintrin.h>
+#endif
+
+namespace lotus::physics::constraints {
+	particle_spring_batches particle_spring_batches::create(
+		std::span<const particle_spring> springs, const constraint_coloring &coloring
+	) {
+		particle_spring_batches result;
+		result.color_offsets.emplace_back(0);
+		for (std::size_t c = 0; c < coloring.get_num_colors(); ++c) {
+			const std::span<const std::uint32_t> color = coloring.get_constraints(c);
+			for (std::size_t begin = 0; begin < color.size(); begin += batch_size) {
+				const std::size_t count = std::min(batch_size, color.size() - begin);
+				for (std::size_t i = 0; i < batch_size; ++i) {
+					if (i < count) {
+						const particle_spring &s = springs[color[begin + i]];
+						result.particle1.emplace_back(static_cast<std::int32_t>(s.particle1));
+						result.particle2.emplace_back(static_cast<std::int32_t>(s.particle2));
+						result.length.emplace_back(s.properties.length);
+						result.inverse_stiffness.emplace_back(s.properties.inverse_stiffness);
+						result.spring_indices.emplace_back(color[begin + i]);
+					} else { // padding, the results of which are discarded
+						result.particle1.emplace_back(0);
+						result.particle2.emplace_back(0);
+						result.length.emplace_back(0.0f);
+						result.inverse_stiffness.emplace_back(1.0f);
+						result.spring_indices.emplace_back(std::numeric_limits<std::uint32_t>::max());
+					}
+				}
+				result.num_springs.emplace_back(static_cast<std::uint8_t>(count));
+			}
+			result.color_offsets.emplace_back(static_cast<std::uint32_t>(result.num_springs.size()));
+		}
+		result.lambda.resize(result.length.size(), 0.0f);
+		return result;
+	}
+
+	void particle_spring_batches::reset_lambdas() {
+		std::fill(lambda.begin(), lambda.end(), 0.0f);
+	}
+
+	void particle_spring_batches::store_lambdas(std::span<scalar> lambdas) const {
+		for (std::size_t i = 0; i < spring_indices.size(); ++i) {
+			if (spring_indices[i] != std::numeric_limits<std::uint32_t>::max()) {
+				lambdas[spring_indices[i]] = lambda[i];
+			}
+		}
+	}
+
+	void particle_spring_batches::project(particle_soa &ps, std::size_t begin, std::size_t end, scalar inv_dt2) {
+		scalar *px = ps.position_x.data();
+		scalar *py = ps.position_y.data();
+		scalar *pz = ps.position_z.data();
+		const scalar *inv_m = ps.inverse_mass.data();
+
+		for (std::size_t b = begin; b < end; ++b) {
+			const std::size_t first = b * batch_size;
+			const std::int32_t *i1 = particle1.data() + first;
+			const std::int32_t *i2 = particle2.data() + first;
+
+			alignas(32) scalar x1[batch_size];
+			alignas(32) scalar y1[batch_size];
+			alignas(32) scalar z1[batch_size];
+			alignas(32) scalar x2[batch_size];
+			alignas(32) scalar y2[batch_size];
+			alignas(32) scalar z2[batch_size];
+
+#if defined(LOTUS_PHYSICS_SPRING_KERNEL_AVX2)
+			const __m256i vi1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(i1));
+			const __m256i vi2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(i2));
+			__m256 vx1 = _mm256_i32gather_ps(px, vi1, 4);
+			__m256 vy1 = _mm256_i32gather_ps(py, vi1, 4);
+			__m256 vz1 = _mm256_i32gather_ps(pz, vi1, 4);
+			__m256 vx2 = _mm256_i32gather_ps(px, vi2, 4);
+			__m256 vy2 = _mm256_i32gather_ps(py, vi2, 4);
+			__m256 vz2 = _mm256_i32gather_ps(pz, vi2, 4);
+			const __m256 inv_m1 = _mm256_i32gather_ps(inv_m, vi1, 4);
+			const __m256 inv_m2 = _mm256_i32gather_ps(inv_m, vi2, 4);
+
+			const __m256 tx = _mm256_sub_ps(vx2, vx1);
+			const __m256 ty = _mm256_sub_ps(vy2, vy1);
+			const __m256 tz = _mm256_sub_ps(vz2, vz1);
+			const __m256 t_len = _mm256_sqrt_ps(_mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(tx, tx), _mm256_mul_ps(ty, ty)), _mm256_mul_ps(tz, tz)
+			));
+			const __m256 c = _mm256_sub_ps(t_len, _mm256_loadu_ps(length.data() + first));
+			const __m256 inv_k_dt2 = _mm256_mul_ps(
+				_mm256_loadu_ps(inverse_stiffness.data() + first), _mm256_set1_ps(inv_dt2)
+			);
+			__m256 lambdas = _mm256_loadu_ps(lambda.data() + first);
+			const __m256 delta_lambda = _mm256_div_ps(
+				_mm256_sub_ps(_mm256_setzero_ps(), _mm256_add_ps(c, _mm256_mul_ps(inv_k_dt2, lambdas))),
+				_mm256_add_ps(_mm256_add_ps(inv_m1, inv_m2), inv_k_dt2)
+			);
+			lambdas = _mm256_add_ps(lambdas, delta_lambda);
+			_mm256_storeu_ps(lambda.data() + first, lambdas);
+			const __m256 ratio = _mm256_div_ps(delta_lambda, t_len);
+			const __m256 dx = _mm256_mul_ps(ratio, tx);
+			const __m256 dy = _mm256_mul_ps(ratio, ty);
+			const __m256 dz = _mm256_mul_ps(ratio, tz);
+			_mm256_store_ps(x1, _mm256_sub_ps(vx1, _mm256_mul_ps(inv_m1, dx)));
+			_mm256_store_ps(y1, _mm256_sub_ps(vy1, _mm256_mul_ps(inv_m1, dy)));
+			_mm256_store_ps(z1, _mm256_sub_ps(vz1, _mm256_mul_ps(inv_m1, dz)));
+			_mm256_store_ps(x2, _mm256_add_ps(vx2, _mm256_mul_ps(inv_m2, dx)));
+			_mm256_store_ps(y2, _mm256_add_ps(vy2, _mm256_mul_ps(inv_m2, dy)));
+			_mm256_store_ps(z2, _mm256_add_ps(vz2, _mm256_mul_ps(inv_m2, dz)));
+#elif defined(LOTUS_PHYSICS_SPRING_KERNEL_SSE2)
+			// SSE2 has no gather instructions, so each half of the batch is gathered manually
+			for (std::size_t h = 0; h < batch_size; h += 4) {
+				const std::int32_t *j1 = i1 + h;
+				const std::int32_t *j2 = i2 + h;
+				const __m128 vx1 = _mm_setr_ps(px[j1[0]], px[j1[1]], px[j1[2]], px[j1[3]]);
+				const __m128 vy1 = _mm_setr_ps(py[j1[0]], py[j1[1]], py[j1[2]], py[j1[3]]);
+				const __m128 vz1 = _mm_setr_ps(pz[j1[0]], pz[j1[1]], pz[j1[2]], pz[j1[3]]);
+				const __m128 vx2 = _mm_setr_ps(px[j2[0]], px[j2[1]], px[j2[2]], px[j2[3]]);
+				const __m128 vy2 = _mm_setr_ps(py[j2[0]], py[j2[1]], py[j2[2]], py[j2[3]]);
+				const __m128 vz2 = _mm_setr_ps(pz[j2[0]], pz[j2[1]], pz[j2[2]], pz[j2[3]]);
+				const __m128 inv_m1 = _mm_setr_ps(inv_m[j1[0]], inv_m[j1[1]], inv_m[j1[2]], inv_m[j1[3]]);
+				const __m128 inv_m2 = _mm_setr_ps(inv_m[j2[0]], inv_m[j2[1]], inv_m[j2[2]], inv_m[j2[3]]);
+
+				const __m128 tx = _mm_sub_ps(vx2, vx1);
+				const __m128 ty = _mm_sub_ps(vy2, vy1);
+				const __m128 tz = _mm_sub_ps(vz2, vz1);
+				const __m128 t_len = _mm_sqrt_ps(_mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)
+				));
+				const __m128 c = _mm_sub_ps(t_len, _mm_loadu_ps(length.data() + first + h));
+				const __m128 inv_k_dt2 = _mm_mul_ps(
+					_mm_loadu_ps(inverse_stiffness.data() + first + h), _mm_set1_ps(inv_dt2)
+				);
+				__m128 lambdas = _mm_loadu_ps(lambda.data() + first + h);
+				const __m128 delta_lambda = _mm_div_ps(
+					_mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(c, _mm_mul_ps(inv_k_dt2, lambdas))),
+					_mm_add_ps(_mm_add_ps(inv_m1, inv_m2), inv_k_dt2)
+				);
+				lambdas = _mm_add_ps(lambdas, delta_lambda);
+				_mm_storeu_ps(lambda.data() + first + h, lambdas);
+				const __m128 ratio = _mm_div_ps(delta_lambda, t_len);
+				const __m128 dx = _mm_mul_ps(ratio, tx);
+				const __m128 dy = _mm_mul_ps(ratio, ty);
+				const __m128 dz = _mm_mul_ps(ratio, tz);
+				_mm_store_ps(x1 + h, _mm_sub_ps(vx1, _mm_mul_ps(inv_m1, dx)));
+				_mm_store_ps(y1 + h, _mm_sub_ps(vy1, _mm_mul_ps(inv_m1, dy)));
+				_mm_store_ps(z1 + h, _mm_sub_ps(vz1, _mm_mul_ps(inv_m1, dz)));
+				_mm_store_ps(x2 + h, _mm_add_ps(vx2, _mm_mul_ps(inv_m2, dx)));
+				_mm_store_ps(y2 + h, _mm_add_ps(vy2, _mm_mul_ps(inv_m2, dy)));
+				_mm_store_ps(z2 + h, _mm_add_ps(vz2, _mm_mul_ps(inv_m2, dz)));
+			}
+#else
+			for (std::size_t i = 0; i < num_springs[b]; ++i) {
+				const scalar inv_m1 = inv_m[i1[i]];
+				const scalar inv_m2 = inv_m[i2[i]];
+				const scalar tx = px[i2[i]] - px[i1[i]];
+				const scalar ty = py[i2[i]] - py[i1[i]];
+				const scalar tz = pz[i2[i]] - pz[i1[i]];
+				const scalar t_len = std::sqrt(tx * tx + ty * ty + tz * tz);
+				const scalar c = t_len - length[first + i];
+				const scalar inv_k_dt2 = inverse_stiffness[first + i] * inv_dt2;
+				const scalar delta_lambda = -(c + inv_k_dt2 * lambda[first + i]) / (inv_m1 + inv_m2 + inv_k_dt2);
+				lambda[first + i] += delta_lambda;
+				const scalar ratio = delta_lambda / t_len;
+				x1[i] = px[i1[i]] - inv_m1 * (ratio * tx);
+				y1[i] = py[i1[i]] - inv_m1 * (ratio * ty);
+				z1[i] = pz[i1[i]] - inv_m1 * (ratio * tz);
+				x2[i] = px[i2[i]] + inv_m2 * (ratio * tx);
+				y2[i] = py[i2[i]] + inv_m2 * (ratio * ty);
+				z2[i] = pz[i2[i]] + inv_m2 * (ratio * tz);
+			}
+#endif
+
+			// scatter results of valid springs; springs in a batch share no particles so the order does not matter
+			for (std::size_t i = 0; i < num_springs[b]; ++i) {
+				px[i1[i]] = x1[i];
+				py[i1[i]] = y1[i];
+				pz[i1[i]] = z1[i];
+				px[i2[i]] = x2[i];
+				py[i2[i]] = y2[i];
+				pz[i2[i]] = z2[i];
+			}
+		}
+	}
+}
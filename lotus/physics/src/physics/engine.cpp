@@ -3,13 +3,238 @@
 /// \file
 /// Implementation of the physics engine.
 
-#include "lotus/collision/algorithms/gjk_epa.h"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <type_traits>
+
 
 namespace lotus::physics {
+	/// Provides access to particles stored as an array of structures, with the same interface as
+	/// \ref particle_soa.
+	class engine::_aos_particles {
+	public:
+		/// Initializes \ref _particles.
+		explicit _aos_particles(std::vector<particle> &ps) : _particles(ps) {
+		}
+
+		/// Returns the number of particles.
+		[[nodiscard]] std::size_t size() const {
+			return _particles.size();
+		}
+		/// Returns the position of the given particle.
+		[[nodiscard]] vec3 get_position(std::size_t i) const {
+			return _particles[i].state.position;
+		}
+		/// Sets the position of the given particle.
+		void set_position(std::size_t i, vec3 p) {
+			_particles[i].state.position = p;
+		}
+		/// Returns the inverse mass of the given particle.
+		[[nodiscard]] scalar get_inverse_mass(std::size_t i) const {
+			return _particles[i].properties.inverse_mass;
+		}
+	private:
+		std::vector<particle> &_particles; ///< The particles.
+	};
+
+
+	/// Invokes the callback and adds the time it took to the given duration. Only the callback is invoked if
+	/// instrumentation is disabled.
+	template <typename Callback> static void _measure(std::chrono::nanoseconds &total, Callback &&cb) {
+		if constexpr (instrumentation_enabled) {
+			const auto begin = std::chrono::high_resolution_clock::now();
+			cb();
+			total += std::chrono::high_resolution_clock::now() - begin;
+		} else {
+			cb();
+		}
+	}
+
+	/// Returns whether the state of the sleeping body has been changed since it fell asleep. Sleeping bodies are
+	/// left at rest at their previous positions, so any difference must have been introduced by the user.
+	[[nodiscard]] static bool _is_sleeping_body_modified(const body &b) {
+		const uquats &q1 = b.state.rotation;
+		const uquats &q2 = b.prev_rotation;
+		return
+			b.state.position != b.prev_position ||
+			q1.w() != q2.w() || q1.x() != q2.x() || q1.y() != q2.y() || q1.z() != q2.z() ||
+			b.state.linear_velocity != vec3(zero) || b.state.angular_velocity != vec3(zero);
+	}
+	/// Returns the state of the body at the start of the ongoing time step. Sleeping bodies are left at their
+	/// previous positions, so this is also valid for them.
+	[[nodiscard]] static body_state _get_previous_state(const body &b) {
+		return body_state::stationary_at(b.prev_position, b.prev_rotation);
+	}
+	/// Returns a polyhedron with a single vertex at the origin, which stands in for the center of a sphere when
+	/// GJK and EPA are run against a polyhedron. It's created once and shared by all threads.
+	[[nodiscard]] static const collision::shapes::polyhedron &_get_point_polyhedron() {
+		static const collision::shapes::polyhedron point = []() {
+			collision::shapes::polyhedron result;
+			result.vertices.emplace_back(zero);
+			return result;
+		}();
+		return point;
+	}
+	/// Creates a contact manifold from the given candidate points, reducing them to at most
+	/// \ref collision::feature_clipping::max_manifold_points points. If there are no candidates, the closest points
+	/// are used as the only contact.
+	[[nodiscard]] static engine::collision_detection_result _create_manifold_from_points(
+		std::span<collision::feature_clipping::contact_point> points, const body_state &st1, const body_state &st2,
+		const collision::conservative_advancement::separation &closest, scalar time_of_impact
+	) {
+		auto result = engine::collision_detection_result::create(closest.normal);
+		result.time_of_impact = time_of_impact;
+		if (points.size() > 1) {
+			const std::uint32_t num_points = collision::feature_clipping::reduce(points, closest.normal);
+			for (std::uint32_t i = 0; i < num_points; ++i) {
+				auto &pt = result.add_point(
+					st1.rotation.inverse().rotate(points[i].position1 - st1.position),
+					st2.rotation.inverse().rotate(points[i].position2 - st2.position)
+				);
+				pt.feature1 = points[i].feature1;
+				pt.feature2 = points[i].feature2;
+			}
+		} else {
+			result.add_point(
+				st1.rotation.inverse().rotate(closest.position1 - st1.position),
+				st2.rotation.inverse().rotate(closest.position2 - st2.position)
+			);
+		}
+		return result;
+	}
+	/// Creates the contact manifold of two shapes that are separated by the given closest points at the given time
+	/// of impact. If a polyhedron touches a plane or another polyhedron with an edge or a face, the manifold
+	/// contains all points of that feature within \ref engine::contact_manifold_margin of the closest points; a
+	/// single point would allow the body to rotate around it and still pass through.
+	[[nodiscard]] static engine::collision_detection_result _create_speculative_manifold(
+		const collision::shape &s1, const body_state &st1, const collision::shape &s2, const body_state &st2,
+		const collision::conservative_advancement::separation &closest, scalar time_of_impact
+	) {
+		using contact_point = collision::feature_clipping::contact_point;
+
+		const auto *poly1 = std::get_if<collision::shapes::polyhedron>(&s1.value);
+		const auto *poly2 = std::get_if<collision::shapes::polyhedron>(&s2.value);
+		const scalar margin = closest.distance + engine::contact_manifold_margin;
+		short_vector<contact_point, collision::feature_clipping::max_clipped_points> points;
+		if (poly1 && poly2) {
+			points = collision::feature_clipping::clip(
+				collision::feature_clipping::find_support_feature(*poly1, st1, closest.normal),
+				collision::feature_clipping::find_support_feature(*poly2, st2, -closest.normal),
+				closest.normal, margin
+			).points;
+		} else if (
+			(poly1 && s2.get_type() == collision::shape::type::plane) ||
+			(poly2 && s1.get_type() == collision::shape::type::plane)
+		) {
+			// the plane touches all vertices of the supporting feature of the polyhedron
+			const bool first = poly1 != nullptr;
+			const vec3 dir = first ? closest.normal : -closest.normal; // from the polyhedron towards the plane
+			const vec3 plane_point = first ? closest.position2 : closest.position1;
+			const auto feature =
+				collision::feature_clipping::find_support_feature(first ? *poly1 : *poly2, first ? st1 : st2, dir);
+			for (std::size_t i = 0; i < feature.positions.size(); ++i) {
+				const scalar dist = vec::dot(plane_point - feature.positions[i], dir);
+				if (dist > margin) {
+					continue;
+				}
+				contact_point &pt = points.emplace_back(uninitialized);
+				(first ? pt.position1 : pt.position2) = feature.positions[i];
+				(first ? pt.position2 : pt.position1) = feature.positions[i] + dist * dir;
+				pt.depth = -dist;
+				(first ? pt.feature1 : pt.feature2) = collision::contact_feature::from_vertices(feature.vertices[i]);
+				(first ? pt.feature2 : pt.feature1) = collision::contact_feature::none();
+			}
+		}
+
+		return _create_manifold_from_points(
+			std::span(points.begin(), points.size()), st1, st2, closest, time_of_impact
+		);
+	}
+	/// Returns the root of the tree that contains the given element in a union-find forest, compressing the path
+	/// along the way.
+	[[nodiscard]] static std::uint32_t _find_root(std::vector<std::uint32_t> &parents, std::uint32_t i) {
+		while (parents[i] != i) {
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	}
+
+
 	void engine::timestep(scalar dt, std::uint32_t iters) {
-		scalar dt2 = dt * dt;
-		scalar inv_dt2 = 1.0f / dt2;
+		_begin_step_statistics();
+		phase_timings &timings = _step_statistics.timings;
+		_measure(timings.sleep_update, [&]() {
+			_wake_modified_bodies();
+		});
+		_measure(timings.prediction, [&]() {
+			_predict(dt);
+		});
+		_measure(timings.collision_detection, [&]() {
+			_detect_body_collisions();
+		});
+		_measure(timings.position_solve, [&]() {
+			_solve_positions(dt, iters);
+		});
+		_measure(timings.velocity_update, [&]() {
+			_update_velocities(dt);
+		});
+		_measure(timings.velocity_solve, [&]() {
+			_solve_velocities(dt, false);
+		});
+		_measure(timings.sleep_update, [&]() {
+			_update_sleeping_bodies(dt);
+		});
+		_end_step_statistics();
+	}
+
+	void engine::timestep_substepped(scalar dt, std::uint32_t substeps, std::uint32_t iters) {
+		_begin_step_statistics();
+		phase_timings &timings = _step_statistics.timings;
+		const scalar h = dt / static_cast<scalar>(substeps);
+		_measure(timings.sleep_update, [&]() {
+			_wake_modified_bodies();
+		});
+		for (std::uint32_t i = 0; i < substeps; ++i) {
+			_measure(timings.prediction, [&]() {
+				_predict(h);
+			});
+			// contacts are stored in local space and are only enforced while the bodies are penetrating, so
+			// contacts detected earlier in this frame remain valid
+			if (i == 0 || substep_collision_detection == collision_detection_cadence::once_per_substep) {
+				_measure(timings.collision_detection, [&]() {
+					_detect_body_collisions();
+				});
+			}
+			_measure(timings.position_solve, [&]() {
+				_solve_positions(h, iters);
+			});
+			_measure(timings.velocity_update, [&]() {
+				_update_velocities(h);
+			});
+			_measure(timings.velocity_solve, [&]() {
+				_solve_velocities(h, true);
+			});
+		}
+		_measure(timings.sleep_update, [&]() {
+			_update_sleeping_bodies(dt);
+		});
+		_end_step_statistics();
+	}
 
+	void engine::_begin_step_statistics() {
+		_step_statistics = step_statistics();
+	}
+
+	void engine::_end_step_statistics() {
+		if constexpr (instrumentation_enabled) {
+			accumulated_statistics += _step_statistics;
+			recent_statistics.push(_step_statistics);
+		}
+	}
+
+	void engine::_predict(scalar dt) {
 		for (particle &p : particles) {
 			p.prev_position = p.state.position;
 			if (p.properties.inverse_mass > 0.0f) {
@@ -18,6 +243,9 @@ namespace lotus::physics {
 			p.state.position += dt * p.state.velocity;
 		}
 		for (body &b : bodies) {
+			if (b.sleeping) {
+				continue;
+			}
 			b.prev_position = b.state.position;
 			if (b.properties.inverse_mass > 0.0f) {
 				b.state.linear_velocity += dt * gravity;
@@ -30,24 +258,23 @@ namespace lotus::physics {
 				b.state.rotation + 0.5f * dt * quats::from_vector(b.state.angular_velocity) * b.state.rotation
 			);
 		}
+	}
 
-		// detect collisions
-		contact_constraints.clear();
-		// handle body collisions
-		for (auto bi = bodies.begin(); bi != bodies.end(); ++bi) {
-			auto bj = bi;
-			for (++bj; bj != bodies.end(); ++bj) {
-				if (auto res = detect_collision(*bi->body_shape, bi->state, *bj->body_shape, bj->state)) {
-					contact_constraints.emplace_back(constraints::body_contact::create_for(
-						*bi, *bj, res->contact1, res->contact2, res->normal
-					));
-				}
-			}
-		}
+	void engine::_solve_positions(scalar dt, std::uint32_t iters) {
+		const scalar dt2 = dt * dt;
+		const scalar inv_dt2 = 1.0f / dt2;
 
-		// solve constraints
 		contact_lambdas.resize(contact_constraints.size());
-		std::fill(contact_lambdas.begin(), contact_lambdas.end(), std::make_pair(0.0f, 0.0f));
+		if (contact_warm_starting) {
+			for (std::size_t i = 0; i < contact_constraints.size(); ++i) {
+				contact_lambdas[i] = {
+					_contact_initial_lambdas[i].first * dt2, _contact_initial_lambdas[i].second * dt2
+				};
+				contact_constraints[i].warm_start(bodies.get_objects(), contact_lambdas[i].first);
+			}
+		} else {
+			std::fill(contact_lambdas.begin(), contact_lambdas.end(), std::make_pair(0.0f, 0.0f));
+		}
 
 		spring_lambdas.resize(particle_spring_constraints.size());
 		std::fill(spring_lambdas.begin(), spring_lambdas.end(), 0.0f);
@@ -58,73 +285,417 @@ namespace lotus::physics {
 		bend_lambdas.resize(bend_constraints.size());
 		std::fill(bend_lambdas.begin(), bend_lambdas.end(), 0.0f);
 
-		for (std::size_t i = 0; i < iters; ++i) {
-			// project body contact constraints
-			for (std::size_t j = 0; j < contact_constraints.size(); ++j) {
-				contact_constraints[j].project(contact_lambdas[j].first, contact_lambdas[j].second);
-			}
-
-			// handle body-particle collisions
-			for (const body &b : bodies) {
-				if (b.properties.inverse_mass == 0.0f) {
-					for (particle &p : particles) {
-						std::visit(
-							[&](const auto &shape) {
-								handle_shape_particle_collision(shape, b.state, p.state.position);
-							},
-							b.body_shape->value
-						);
+		isometric_bend_lambdas.resize(isometric_bend_constraints.size());
+		std::fill(isometric_bend_lambdas.begin(), isometric_bend_lambdas.end(), 0.0f);
+
+		const bool use_soa = particle_storage_layout == particle_layout::structure_of_arrays;
+		if (use_soa || particle_constraint_ordering == constraint_ordering::colored_parallel) {
+			_update_constraint_colorings();
+		}
+		if (use_soa) {
+			_particle_soa.load(particles);
+			_spring_batches.reset_lambdas();
+		}
+		_gather_particle_collision_candidates();
+		_gather_self_collisions();
+
+		// contacts never move kinematic bodies, which are the only bodies that particles interact with, so all
+		// iterations of contacts can be done before those of particle constraints
+		last_position_solve = position_solve_report();
+		const std::span<body> all_bodies = bodies.get_objects();
+		_solve_contact_islands(iters, [&](std::uint32_t i) {
+			contact_constraints[i].project(
+				all_bodies, contact_lambdas[i].first, contact_lambdas[i].second, contact_warm_starting
+			);
+		}, convergence_monitoring);
+		std::uint64_t contact_projections = 0;
+		if (convergence_monitoring) {
+			scalar residual_sum = 0.0f;
+			for (std::size_t i = 0; i < _island_convergence.size(); ++i) {
+				const auto [island_iters, island_residual] = _island_convergence[i];
+				const std::uint32_t island =
+					i < _serial_islands.size() ? _serial_islands[i] : _split_islands[i - _serial_islands.size()].island;
+				contact_projections += static_cast<std::uint64_t>(island_iters) * (
+					_island_contact_offsets[island + 1] - _island_contact_offsets[island]
+				);
+				last_position_solve.contact_iterations = std::max(last_position_solve.contact_iterations, island_iters);
+				residual_sum += island_residual;
+			}
+			if (!contact_constraints.empty()) {
+				last_position_solve.residuals.contacts =
+					std::sqrt(residual_sum / static_cast<scalar>(contact_constraints.size()));
+			}
+		} else if (!contact_constraints.empty()) {
+			contact_projections = static_cast<std::uint64_t>(iters) * contact_constraints.size();
+			last_position_solve.contact_iterations = iters;
+		}
+
+		std::uint32_t particle_iterations = 0;
+		bool accelerate = particle_iteration_acceleration != iteration_acceleration::none;
+		scalar chebyshev_omega = 1.0f;
+		scalar checked_residual = std::numeric_limits<scalar>::max();
+		scalar first_change = 0.0f;
+		// performs one iteration, and returns whether the particle constraints have converged
+		const auto iterate_particles = [&](auto &ps) {
+			if (accelerate) {
+				_store_iteration_positions(ps);
+			}
+			_handle_body_particle_collisions(ps);
+			_project_particle_constraints(ps, inv_dt2);
+			++particle_iterations;
+
+			// extrapolation that's too aggressive excites oscillations that grow with every iteration, until
+			// iterations move particles more than the first, plain iteration did; this is checked after every
+			// iteration, since a few extrapolated iterations are enough to blow up stiff constraints
+			if (accelerate) {
+				const scalar change = _compute_rms_residual(ps.size(), [&](std::size_t i) {
+					return (ps.get_position(i) - _iteration_positions[i]).squared_norm();
+				});
+				if (particle_iterations == 1) {
+					first_change = change;
+				} else if (change > first_change) {
+					accelerate = false;
+					last_position_solve.acceleration_fallback = true;
+				}
+			}
+
+			bool converged = false;
+			if (_should_check_residuals(particle_iterations, iters)) {
+				constraint_residuals &residuals = last_position_solve.residuals;
+				const constraint_residuals particle_residuals = _compute_particle_residuals(ps, inv_dt2);
+				residuals.springs = particle_residuals.springs;
+				residuals.faces = particle_residuals.faces;
+				residuals.bends = particle_residuals.bends;
+				converged = convergence_monitoring && particle_residuals.max() < residual_tolerance;
+				// extrapolation is making things worse; fall back to plain iterations, which always converge
+				if (accelerate && particle_residuals.max() > checked_residual) {
+					accelerate = false;
+					last_position_solve.acceleration_fallback = true;
+				}
+				checked_residual = particle_residuals.max();
+			}
+
+			if (accelerate && !converged && particle_iterations < iters) {
+				switch (particle_iteration_acceleration) {
+				case iteration_acceleration::over_relaxation:
+					_extrapolate_particle_positions(ps, _iteration_positions, over_relaxation_factor);
+					break;
+				case iteration_acceleration::chebyshev:
+					{
+						const std::uint32_t delay = std::max<std::uint32_t>(chebyshev_delay, 1);
+						const scalar rho2 = chebyshev_spectral_radius * chebyshev_spectral_radius;
+						if (particle_iterations == delay + 1) {
+							chebyshev_omega = 2.0f / (2.0f - rho2);
+						} else if (particle_iterations > delay + 1) {
+							chebyshev_omega = 4.0f / (4.0f - rho2 * chebyshev_omega);
+						}
+						if (particle_iterations > delay) {
+							_extrapolate_particle_positions(ps, _previous_iteration_positions, chebyshev_omega);
+						}
 					}
+					break;
+				default:
+					break;
 				}
 			}
+			return converged;
+		};
+		while (particle_iterations < iters) {
+			if (use_soa) {
+				if (iterate_particles(_particle_soa)) {
+					break;
+				}
+			} else {
+				_aos_particles aos(particles);
+				if (iterate_particles(aos)) {
+					break;
+				}
+			}
+		}
+		last_position_solve.particle_iterations = particle_iterations;
 
-			// project spring constraints
-			for (std::size_t j = 0; j < particle_spring_constraints.size(); ++j) {
-				const auto &s = particle_spring_constraints[j];
-				particle &p1 = particles[s.particle1];
-				particle &p2 = particles[s.particle2];
-				s.project(
-					p1.state.position, p2.state.position,
-					p1.properties.inverse_mass, p2.properties.inverse_mass,
-					inv_dt2, spring_lambdas[j]
+		if constexpr (instrumentation_enabled) {
+			_step_statistics.counters.solver_iterations +=
+				std::max(last_position_solve.contact_iterations, particle_iterations);
+			_step_statistics.counters.constraints_projected += contact_projections +
+				static_cast<std::uint64_t>(particle_iterations) * (
+					particle_spring_constraints.size() + face_constraints.size() +
+					bend_constraints.size() + isometric_bend_constraints.size()
 				);
+			_step_statistics.counters.particle_collision_tests +=
+				static_cast<std::uint64_t>(particle_iterations) * _particle_collision_candidates.size();
+			_step_statistics.counters.self_collisions +=
+				_particle_pair_collisions.size() + _particle_triangle_collisions.size();
+		}
+
+		if (use_soa) {
+			_particle_soa.store(particles);
+			_spring_batches.store_lambdas(spring_lambdas);
+		}
+
+		// remember the final lambda values for the next position solve, which may reuse these contacts in a later
+		// substep or match them with newly detected contacts
+		_contact_cache.clear();
+		for (std::size_t i = 0; i < contact_constraints.size(); ++i) {
+			_contact_initial_lambdas[i] = { contact_lambdas[i].first * inv_dt2, contact_lambdas[i].second * inv_dt2 };
+			_contact_cache.emplace_back(_contact_keys[i], _contact_initial_lambdas[i]);
+		}
+		std::sort(
+			_contact_cache.begin(), _contact_cache.end(),
+			[](const _cached_contact &lhs, const _cached_contact &rhs) {
+				return lhs.key < rhs.key;
 			}
+		);
+	}
 
-			// project face constraints
-			for (std::size_t j = 0; j < face_constraints.size(); ++j) {
-				constraints::face &f = face_constraints[j];
-				particle &p1 = particles[f.particle1];
-				particle &p2 = particles[f.particle2];
-				particle &p3 = particles[f.particle3];
-				f.project(
-					p1.state.position, p2.state.position, p3.state.position,
-					p1.properties.inverse_mass, p2.properties.inverse_mass, p3.properties.inverse_mass,
-					inv_dt2, face_lambdas[j], face_constraint_projection_type
+	void engine::_gather_particle_collision_candidates() {
+		_particle_collision_bodies.clear();
+		_particle_collision_offsets.assign(1, 0);
+		_particle_collision_candidates.clear();
+		if (particles.empty()) {
+			return;
+		}
+
+		bool grid_built = false;
+		scalar margin = particle_collision_margin;
+		for (std::uint32_t bi = 0; bi < bodies.size(); ++bi) {
+			const body &b = bodies.get_objects()[bi];
+			if (b.properties.inverse_mass != 0.0f) {
+				continue;
+			}
+			if (!grid_built) {
+				scalar max_displacement2 = 0.0f;
+				for (const particle &p : particles) {
+					max_displacement2 = std::max(
+						max_displacement2, (p.state.position - p.prev_position).squared_norm()
+					);
+				}
+				margin += std::sqrt(max_displacement2);
+				_particle_grid.build(particles.size(), particle_grid_cell_size, [this](std::size_t i) {
+					return particles[i].state.position;
+				});
+				grid_built = true;
+			}
+
+			collision::bounding_box bounds = b.body_shape->get_bounds(b.state);
+			bounds.min -= vec3(margin, margin, margin);
+			bounds.max += vec3(margin, margin, margin);
+			const std::size_t first = _particle_collision_candidates.size();
+			_particle_grid.for_each_in(bounds, [this](std::uint32_t i) {
+				_particle_collision_candidates.emplace_back(i);
+			});
+			// visit particles in memory order during the iterations
+			std::sort(_particle_collision_candidates.begin() + first, _particle_collision_candidates.end());
+			if (_particle_collision_candidates.size() > first) {
+				_particle_collision_bodies.emplace_back(bi);
+				_particle_collision_offsets.emplace_back(
+					static_cast<std::uint32_t>(_particle_collision_candidates.size())
 				);
 			}
+		}
+	}
+
+	void engine::_update_particle_neighbors() {
+		const std::array<std::size_t, 4> counts{
+			particle_spring_constraints.size(), face_constraints.size(), bend_constraints.size(),
+			isometric_bend_constraints.size()
+		};
+		if (
+			_particle_neighbors_valid && _particle_neighbor_constraint_counts == counts &&
+			_particle_neighbor_offsets.size() == particles.size() + 1
+		) {
+			return;
+		}
+
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs;
+		const auto add_pair = [&](std::size_t p1, std::size_t p2) {
+			pairs.emplace_back(
+				static_cast<std::uint32_t>(std::min(p1, p2)), static_cast<std::uint32_t>(std::max(p1, p2))
+			);
+		};
+		for (const constraints::particle_spring &s : particle_spring_constraints) {
+			add_pair(s.particle1, s.particle2);
+		}
+		for (const constraints::face &f : face_constraints) {
+			add_pair(f.particle1, f.particle2);
+			add_pair(f.particle2, f.particle3);
+			add_pair(f.particle3, f.particle1);
+		}
+		const auto add_bend_pairs = [&](const auto &b) {
+			const std::array ps{ b.particle_edge1, b.particle_edge2, b.particle3, b.particle4 };
+			for (std::size_t i = 0; i < ps.size(); ++i) {
+				for (std::size_t j = i + 1; j < ps.size(); ++j) {
+					add_pair(ps[i], ps[j]);
+				}
+			}
+		};
+		for (const constraints::bend &b : bend_constraints) {
+			add_bend_pairs(b);
+		}
+		for (const constraints::isometric_bend &b : isometric_bend_constraints) {
+			add_bend_pairs(b);
+		}
+		std::sort(pairs.begin(), pairs.end());
+		pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
 
-			// project bend constraints
-			for (std::size_t j = 0; j < bend_constraints.size(); ++j) {
-				constraints::bend &b = bend_constraints[j];
-				particle &p1 = particles[b.particle_edge1];
-				particle &p2 = particles[b.particle_edge2];
-				particle &p3 = particles[b.particle3];
-				particle &p4 = particles[b.particle4];
-				b.project(
-					p1.state.position, p2.state.position, p3.state.position, p4.state.position,
-					p1.properties.inverse_mass, p2.properties.inverse_mass,
-					p3.properties.inverse_mass, p4.properties.inverse_mass,
-					inv_dt2, bend_lambdas[j]
+		_particle_neighbor_offsets.assign(particles.size() + 1, 0);
+		_particle_neighbors.resize(pairs.size());
+		for (std::size_t i = 0; i < pairs.size(); ++i) {
+			++_particle_neighbor_offsets[pairs[i].first + 1];
+			_particle_neighbors[i] = pairs[i].second;
+		}
+		for (std::size_t i = 1; i < _particle_neighbor_offsets.size(); ++i) {
+			_particle_neighbor_offsets[i] += _particle_neighbor_offsets[i - 1];
+		}
+
+		_particle_neighbor_constraint_counts = counts;
+		_particle_neighbors_valid = true;
+	}
+
+	void engine::_gather_self_collisions() {
+		_particle_pair_collisions.clear();
+		_particle_triangle_collisions.clear();
+		if (!particle_self_collision || particles.empty()) {
+			return;
+		}
+		_update_particle_neighbors();
+
+		const scalar radius = self_collision_thickness + particle_collision_margin;
+		const scalar radius2 = radius * radius;
+		_self_collision_grid.update(particles.size(), radius, [this](std::size_t i) {
+			return particles[i].state.position;
+		});
+
+		// candidates are searched in fixed-size chunks whose results are concatenated in order, so that the
+		// constraints do not depend on the number of threads
+		const auto search = [&](auto &chunks, std::size_t count, const auto &search_one) {
+			const std::size_t chunk_size = std::max<std::size_t>(constraint_batch_size, 1);
+			const std::size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+			chunks.resize(num_chunks);
+			const auto search_chunks = [&](std::size_t begin, std::size_t end) {
+				for (std::size_t c = begin; c < end; ++c) {
+					chunks[c].clear();
+					const std::size_t last = std::min(count, (c + 1) * chunk_size);
+					for (std::size_t i = c * chunk_size; i < last; ++i) {
+						search_one(i, chunks[c]);
+					}
+				}
+			};
+			if (worker_pool) {
+				worker_pool->parallel_for(num_chunks, 1, search_chunks);
+			} else {
+				search_chunks(0, num_chunks);
+			}
+		};
+
+		// the cells are as large as the search radius, so all pairs are in neighboring cells; each pair is found
+		// exactly once by visiting the cell of the first particle and the 13 neighboring cells that come after it
+		constexpr std::array<std::array<int, 3>, 13> forward_neighbors{ {
+			{ 1, 0, 0 },
+			{ -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+			{ -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 },
+			{ -1, 0, 1 }, { 0, 0, 1 }, { 1, 0, 1 },
+			{ -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 },
+		} };
+		search(_particle_pair_collision_chunks, particles.size(),
+			[&](std::size_t i, std::vector<constraints::particle_pair_collision> &out) {
+				const particle &pi = particles[i];
+				const auto test = [&](std::uint32_t j) {
+					const particle &pj = particles[j];
+					if (
+						(pi.properties.inverse_mass == 0.0f && pj.properties.inverse_mass == 0.0f) ||
+						(pj.state.position - pi.state.position).squared_norm() >= radius2
+					) {
+						return;
+					}
+					const auto first = std::min(static_cast<std::uint32_t>(i), j);
+					const auto second = std::max(static_cast<std::uint32_t>(i), j);
+					const auto first_neighbors = _particle_neighbors.begin() + _particle_neighbor_offsets[first];
+					const auto last_neighbors = _particle_neighbors.begin() + _particle_neighbor_offsets[first + 1];
+					if (!std::binary_search(first_neighbors, last_neighbors, second)) {
+						out.emplace_back(constraints::particle_pair_collision::create(first, second));
+					}
+				};
+
+				const cvec3i cell = _self_collision_grid.particle_cells[i];
+				_self_collision_grid.for_each_in_cell(cell, [&](std::uint32_t j) {
+					if (j > i) {
+						test(j);
+					}
+				});
+				for (const auto &offset : forward_neighbors) {
+					_self_collision_grid.for_each_in_cell(cell + cvec3i(offset[0], offset[1], offset[2]), test);
+				}
+			}
+		);
+		search(_particle_triangle_collision_chunks, face_constraints.size(),
+			[&](std::size_t i, std::vector<constraints::particle_triangle_collision> &out) {
+				const constraints::face &f = face_constraints[i];
+				const particle &p1 = particles[f.particle1];
+				const particle &p2 = particles[f.particle2];
+				const particle &p3 = particles[f.particle3];
+				vec3 normal =
+					vec::cross(p2.state.position - p1.state.position, p3.state.position - p1.state.position);
+				const scalar normal_norm = normal.norm();
+				if (normal_norm == 0.0f) {
+					return;
+				}
+				normal /= normal_norm;
+				// particles are kept on the side of the triangle that they were on at the end of the previous
+				// time step, so that they cannot pass through it
+				const vec3 prev_normal =
+					vec::cross(p2.prev_position - p1.prev_position, p3.prev_position - p1.prev_position);
+
+				const vec3 extent(radius, radius, radius);
+				const auto bounds = collision::bounding_box::create_from_min_max(
+					vec::memberwise_min(vec::memberwise_min(p1.state.position, p2.state.position), p3.state.position) -
+						extent,
+					vec::memberwise_max(vec::memberwise_max(p1.state.position, p2.state.position), p3.state.position) +
+						extent
 				);
+				_self_collision_grid.for_each_in(bounds, [&](std::uint32_t j) {
+					if (j == f.particle1 || j == f.particle2 || j == f.particle3) {
+						return;
+					}
+					const particle &p = particles[j];
+					if (std::abs(vec::dot(p.state.position - p1.state.position, normal)) >= radius) {
+						return;
+					}
+					scalar prev_side = vec::dot(p.prev_position - p1.prev_position, prev_normal);
+					if (prev_side == 0.0f) {
+						prev_side = vec::dot(p.state.position - p1.state.position, normal);
+					}
+					out.emplace_back(constraints::particle_triangle_collision::create(
+						j, static_cast<std::uint32_t>(f.particle1), static_cast<std::uint32_t>(f.particle2),
+						static_cast<std::uint32_t>(f.particle3), prev_side >= 0.0f
+					));
+				});
 			}
+		);
+
+		for (const auto &chunk : _particle_pair_collision_chunks) {
+			_particle_pair_collisions.insert(_particle_pair_collisions.end(), chunk.begin(), chunk.end());
 		}
+		for (const auto &chunk : _particle_triangle_collision_chunks) {
+			_particle_triangle_collisions.insert(_particle_triangle_collisions.end(), chunk.begin(), chunk.end());
+		}
+	}
 
+	void engine::_update_velocities(scalar dt) {
 		for (particle &p : particles) {
 			p.state.velocity = (p.state.position - p.prev_position) / dt;
 		}
 		for (body &b : bodies) {
+			if (b.sleeping) {
+				continue;
+			}
 			b.prev_linear_velocity = b.state.linear_velocity;
 			b.prev_angular_velocity = b.state.angular_velocity;
+			// the velocities of kinematic bodies are set by the user; deriving them from rounded rotations would
+			// give static bodies tiny angular velocities that keep waking up everything resting on them
+			if (b.properties.inverse_mass == 0.0f) {
+				continue;
+			}
 
 			b.state.linear_velocity = (b.state.position - b.prev_position) / dt;
 			auto dq = b.state.rotation * b.prev_rotation.inverse();
@@ -133,12 +704,36 @@ namespace lotus::physics {
 				b.state.angular_velocity = -b.state.angular_velocity;
 			}
 		}
+		// the predicted motion of these bodies has been cut short at their times of impact; keep the rest of their
+		// predicted velocities so that they're not slowed down in directions that they're free to move in
+		const std::span<body> all_bodies = bodies.get_objects();
+		for (const auto &[i, time] : _rewound_bodies) {
+			body &b = all_bodies[i];
+			b.state.linear_velocity += (1.0f - time) * b.prev_linear_velocity;
+			b.state.angular_velocity += (1.0f - time) * b.prev_angular_velocity;
+		}
+		_rewound_bodies.clear();
+	}
+
+	void engine::_solve_velocities(scalar dt, bool skip_unenforced) {
+		const std::span<body> all_bodies = bodies.get_objects();
+		_solve_contact_islands(1, [&](std::uint32_t i) {
+			// skip contacts that were not enforced during the position solve: contacts of bodies that were just
+			// apart, and when substepping, contacts detected in an earlier substep whose bodies have since
+			// separated, unless they're speculative contacts of bodies that may still be approaching each other
+			const bool speculative = _speculative_contacts[i];
+			if (contact_lambdas[i].first == 0.0f && (_margin_contacts[i] || (skip_unenforced && !speculative))) {
+				return;
+			}
 
-		// velocity solve
-		for (std::size_t i = 0; i < contact_constraints.size(); ++i) {
 			const auto &contact = contact_constraints[i];
-			auto &b1 = *contact.body1;
-			auto &b2 = *contact.body2;
+			auto &b1 = all_bodies[contact.body1];
+			auto &b2 = all_bodies[contact.body2];
+			if (speculative && contact_lambdas[i].first == 0.0f) {
+				_stop_speculative_contact(b1, b2, contact.normal);
+				return;
+			}
+
 			vec3 world_off1 = b1.state.rotation.rotate(contact.offset1);
 			vec3 world_off2 = b2.state.rotation.rotate(contact.offset2);
 			vec3 vel1 = b1.state.linear_velocity + vec::cross(b1.state.angular_velocity, world_off1);
@@ -168,28 +763,836 @@ namespace lotus::physics {
 				b1, b2, contact.offset1, contact.offset2, contact.normal, 1.0
 			).apply_velocity(delta_vn_norm);*/
 
-			vec3 delta_vt = -vt * (std::min(friction_coeff * -lambda_n / dt, vt_norm) / vt_norm);
+			// bodies that touch head-on, e.g., a sphere dropped onto a face, can have no tangential velocity at all
+			vec3 delta_vt = zero;
+			if (vt_norm > 0.0f) {
+				delta_vt = -vt * (std::min(friction_coeff * -lambda_n / dt, vt_norm) / vt_norm);
+			}
 			vec3 delta_vn = contact.normal * (std::min<scalar>(-old_vn * restitution_coeff, 0.0f) - vn);
 			vec3 delta_v = delta_vt + delta_vn;
 			scalar delta_v_norm = delta_v.norm();
+			if (delta_v_norm == 0.0f) {
+				return;
+			}
 			vec3 delta_v_unit = delta_v / delta_v_norm;
 			auto correction = body::correction::compute(
 				b1, b2, contact.offset1, contact.offset2, delta_v_unit, 1.0f
 			);
 			correction.apply_velocity(delta_v_norm);
+		});
+	}
+
+	void engine::_stop_speculative_contact(body &b1, body &b2, vec3 normal) {
+		const scalar vn = vec::dot(normal, b1.state.linear_velocity - b2.state.linear_velocity);
+		if (vn <= 0.0f) {
+			return; // the bodies are separating
+		}
+		const scalar old_vn = vec::dot(normal, b1.prev_linear_velocity - b2.prev_linear_velocity);
+		const scalar restitution_coeff = std::max(b1.material.restitution, b2.material.restitution);
+		const scalar inv_m1 = b1.properties.inverse_mass;
+		const scalar inv_m2 = b2.properties.inverse_mass;
+		const vec3 delta_v = normal * ((std::min<scalar>(-old_vn * restitution_coeff, 0.0f) - vn) / (inv_m1 + inv_m2));
+		b1.state.linear_velocity += inv_m1 * delta_v;
+		b2.state.linear_velocity -= inv_m2 * delta_v;
+	}
+
+	void engine::_wake_modified_bodies() {
+		if (!sleeping_enabled) {
+			for (body &b : bodies) {
+				b.sleeping = false;
+			}
+			return;
+		}
+
+		_islands_to_wake.clear();
+		for (const body &b : bodies) {
+			if (b.sleeping && _is_sleeping_body_modified(b)) {
+				_islands_to_wake.emplace_back(b.island);
+			}
+		}
+		_wake_islands();
+	}
+
+	void engine::_wake_islands() {
+		if (_islands_to_wake.empty()) {
+			return;
+		}
+		std::sort(_islands_to_wake.begin(), _islands_to_wake.end());
+		for (body &b : bodies) {
+			if (b.sleeping && std::binary_search(_islands_to_wake.begin(), _islands_to_wake.end(), b.island)) {
+				b.sleeping = false;
+				b.sleep_timer = 0.0f;
+			}
+		}
+		_islands_to_wake.clear();
+	}
+
+	void engine::_update_sleeping_bodies(scalar dt) {
+		step_counters &counters = _step_statistics.counters;
+		if (!sleeping_enabled) {
+			if constexpr (instrumentation_enabled) {
+				counters.active_bodies += bodies.size();
+			}
+			return;
+		}
+
+		// an island can only fall asleep when all of its bodies have been resting for long enough
+		const scalar lin_threshold2 = sleep_linear_velocity_threshold * sleep_linear_velocity_threshold;
+		const scalar ang_threshold2 = sleep_angular_velocity_threshold * sleep_angular_velocity_threshold;
+		const std::span<body> all_bodies = bodies.get_objects();
+		const auto num_bodies = static_cast<std::uint32_t>(all_bodies.size());
+		_island_sleep_timers.assign(num_bodies, std::numeric_limits<scalar>::max());
+		for (std::uint32_t i = 0; i < num_bodies; ++i) {
+			body &b = all_bodies[i];
+			if (b.sleeping || b.properties.inverse_mass == 0.0f) {
+				continue;
+			}
+			const bool resting =
+				b.state.linear_velocity.squared_norm() < lin_threshold2 &&
+				b.state.angular_velocity.squared_norm() < ang_threshold2;
+			b.sleep_timer = resting ? b.sleep_timer + dt : 0.0f;
+			scalar &island_timer = _island_sleep_timers[_find_root(_island_parents, i)];
+			island_timer = std::min(island_timer, b.sleep_timer);
+		}
+
+		// renumber sleeping islands starting from 1 so that island IDs stay below the number of bodies, followed by
+		// islands that fall asleep in this time step
+		std::uint32_t next_island = 1;
+		_island_ids.assign(_next_island, 0);
+		for (body &b : all_bodies) {
+			if (b.sleeping) {
+				std::uint32_t &id = _island_ids[b.island];
+				if (id == 0) {
+					id = next_island++;
+				}
+				b.island = id;
+			}
+		}
+		_island_ids.assign(num_bodies, 0);
+
+		for (std::uint32_t i = 0; i < num_bodies; ++i) {
+			body &b = all_bodies[i];
+			if (b.sleeping || b.properties.inverse_mass == 0.0f) {
+				continue;
+			}
+			const std::uint32_t root = _find_root(_island_parents, i);
+			if (_island_sleep_timers[root] >= time_to_sleep) {
+				std::uint32_t &id = _island_ids[root];
+				if (id == 0) {
+					id = next_island++;
+				}
+				b.island = id;
+				// bodies are left at rest so that modifications by the user can be detected
+				b.sleeping = true;
+				b.state.linear_velocity = b.state.angular_velocity = zero;
+				b.prev_linear_velocity = b.prev_angular_velocity = zero;
+				b.prev_position = b.state.position;
+				b.prev_rotation = b.state.rotation;
+			}
+		}
+		_next_island = next_island;
+
+		if constexpr (instrumentation_enabled) {
+			const auto num_sleeping = static_cast<std::uint64_t>(std::count_if(
+				bodies.begin(), bodies.end(), [](const body &b) {
+					return b.sleeping;
+				}
+			));
+			counters.active_bodies += bodies.size() - num_sleeping;
+			counters.sleeping_bodies += num_sleeping;
+		}
+	}
+
+	void engine::invalidate_constraint_colorings() {
+		_colorings_valid = false;
+		_particle_neighbors_valid = false;
+	}
+
+	void engine::_detect_body_collisions() {
+		contact_constraints.clear();
+		_contact_keys.clear();
+		_speculative_contacts.clear();
+		_margin_contacts.clear();
+		_rewound_bodies.clear();
+
+		const std::span<body> all_bodies = bodies.get_objects();
+		_body_impact_times.assign(all_bodies.size(), 1.0f);
+		_body_discrete_contacts.assign(all_bodies.size(), false);
+		_body_bounds.clear();
+		for (const body &b : all_bodies) {
+			collision::bounding_box &bounds = _body_bounds.emplace_back(b.body_shape->get_bounds(b.state));
+			if (b.continuous_collision && !b.sleeping) { // cover the path of the body during this time step
+				const collision::bounding_box prev_bounds = b.body_shape->get_bounds(_get_previous_state(b));
+				bounds.min = vec::memberwise_min(bounds.min, prev_bounds.min);
+				bounds.max = vec::memberwise_max(bounds.max, prev_bounds.max);
+			}
+			// the narrow phase also reports polyhedra that are just apart
+			bounds.min -= vec3(contact_manifold_margin, contact_manifold_margin, contact_manifold_margin);
+			bounds.max += vec3(contact_manifold_margin, contact_manifold_margin, contact_manifold_margin);
+		}
+
+		_body_pairs.clear();
+		body_broad_phase.find_overlapping_pairs(_body_bounds, _body_pairs);
+		// process pairs in a fixed order so that results do not depend on the broad phase algorithm
+		std::sort(_body_pairs.begin(), _body_pairs.end());
+
+		step_counters &counters = _step_statistics.counters;
+		_new_gjk_cache.clear();
+		// runs the narrow phase for the given pair of bodies, using and updating its cached GJK data
+		auto detect_pair = [&](std::uint32_t i, std::uint32_t j) {
+			narrow_phase_context context;
+			if constexpr (instrumentation_enabled) {
+				++counters.body_pairs_tested;
+				context.counters = &counters;
+			}
+			if (collision_pair_caching) {
+				// caches are keyed by handles, which stay the same when bodies are moved around in the dense array
+				// and never match bodies that have since been removed
+				auto &entry = _new_gjk_cache.emplace_back(std::make_pair(bodies.get_handle(i), bodies.get_handle(j)));
+				auto it = std::lower_bound(
+					_gjk_cache.begin(), _gjk_cache.end(), entry.bodies,
+					[](const _cached_gjk_pair &cached, const std::pair<body_handle, body_handle> &key) {
+						return cached.bodies < key;
+					}
+				);
+				if (it != _gjk_cache.end() && it->bodies == entry.bodies) {
+					entry.cache = it->cache;
+				}
+				context.gjk_cache = &entry.cache;
+			}
+			return _detect_body_pair_collision(all_bodies[i], all_bodies[j], context);
+		};
+
+		_wake_test_results.clear();
+		if (sleeping_enabled) {
+			// wake up islands that are touched by awake bodies, so that they take part in the rest of the time step.
+			// sleeping bodies do not move, so the results are reused below for pairs that end up both awake
+			for (std::size_t pair_index = 0; pair_index < _body_pairs.size(); ++pair_index) {
+				const auto [i, j] = _body_pairs[pair_index];
+				const body &bi = all_bodies[i];
+				const body &bj = all_bodies[j];
+				if (bi.sleeping == bj.sleeping) {
+					continue;
+				}
+				const body &sleeping_body = bi.sleeping ? bi : bj;
+				const body &awake_body = bi.sleeping ? bj : bi;
+				if (
+					awake_body.properties.inverse_mass == 0.0f &&
+					awake_body.state.linear_velocity == vec3(zero) && awake_body.state.angular_velocity == vec3(zero)
+				) {
+					continue; // static kinematic bodies, e.g., the ground, do not wake up bodies resting on them
+				}
+				if (_wake_test_results.emplace_back(pair_index, detect_pair(i, j)).second) {
+					_islands_to_wake.emplace_back(sleeping_body.island);
+				}
+			}
+			_wake_islands();
+		}
+
+		auto wake_test_it = _wake_test_results.begin();
+		for (std::size_t pair_index = 0; pair_index < _body_pairs.size(); ++pair_index) {
+			const auto [i, j] = _body_pairs[pair_index];
+			std::optional<collision_detection_result> *wake_test_result = nullptr;
+			if (wake_test_it != _wake_test_results.end() && wake_test_it->first == pair_index) {
+				wake_test_result = &wake_test_it->second;
+				++wake_test_it;
+			}
+			const body &bi = all_bodies[i];
+			const body &bj = all_bodies[j];
+			if (bi.properties.inverse_mass == 0.0f && bj.properties.inverse_mass == 0.0f) {
+				continue; // contacts between two kinematic bodies cannot be resolved
+			}
+			if (bi.sleeping || bj.sleeping) {
+				continue; // these bodies are not touching any awake body
+			}
+			const std::optional<collision_detection_result> res =
+				wake_test_result ? std::move(*wake_test_result) : detect_pair(i, j);
+			const body_handle hi = bodies.get_handle(i);
+			const body_handle hj = bodies.get_handle(j);
+			if (res) {
+				const bool speculative = res->time_of_impact < 1.0f;
+				for (const auto &pt : res->get_points()) {
+					contact_constraints.emplace_back(constraints::body_contact::create_for(
+						i, j, pt.contact1, pt.contact2, res->normal
+					));
+					_contact_keys.emplace_back(hi, hj, pt.feature1, pt.feature2);
+					_speculative_contacts.emplace_back(speculative);
+					_margin_contacts.emplace_back(
+						!speculative && contact_constraints.back().compute_residual(all_bodies) == 0.0f
+					);
+				}
+				for (const std::uint32_t b : { i, j }) {
+					if (!speculative) {
+						_body_discrete_contacts[b] = true;
+					} else if (all_bodies[b].continuous_collision && all_bodies[b].properties.inverse_mass > 0.0f) {
+						_body_impact_times[b] = std::min(_body_impact_times[b], res->time_of_impact);
+					}
+				}
+			}
+		}
+		// move fast bodies back to where they first touch something, so that the position solve does not need to
+		// resolve deep penetrations. Bodies that also have discrete contacts are left where they are, since those
+		// contacts have been computed at the end of the time step and would no longer match a rewound body; their
+		// speculative contacts are still enforced by the solvers
+		for (std::uint32_t i = 0; i < all_bodies.size(); ++i) {
+			if (_body_impact_times[i] < 1.0f && !_body_discrete_contacts[i]) {
+				body &b = all_bodies[i];
+				const body_state toi_state = collision::conservative_advancement::interpolate(
+					_get_previous_state(b), b.state, _body_impact_times[i]
+				);
+				b.state.position = toi_state.position;
+				b.state.rotation = toi_state.rotation;
+				_rewound_bodies.emplace_back(i, _body_impact_times[i]);
+			}
+		}
+		if constexpr (instrumentation_enabled) {
+			counters.contacts_generated += contact_constraints.size();
+		}
+		// pairs are tested in the order of body indices, which is unrelated to the order of cache keys
+		std::sort(
+			_new_gjk_cache.begin(), _new_gjk_cache.end(),
+			[](const _cached_gjk_pair &lhs, const _cached_gjk_pair &rhs) {
+				return lhs.bodies < rhs.bodies;
+			}
+		);
+		std::swap(_gjk_cache, _new_gjk_cache);
+
+		// match contacts against those from the previous position solve
+		std::size_t num_matched = 0;
+		_contact_initial_lambdas.resize(_contact_keys.size());
+		for (std::size_t i = 0; i < _contact_keys.size(); ++i) {
+			auto it = std::lower_bound(
+				_contact_cache.begin(), _contact_cache.end(), _contact_keys[i],
+				[](const _cached_contact &cached, const _contact_key &key) {
+					return cached.key < key;
+				}
+			);
+			if (it != _contact_cache.end() && it->key == _contact_keys[i]) {
+				_contact_initial_lambdas[i] = it->lambdas;
+				++num_matched;
+			} else {
+				_contact_initial_lambdas[i] = { 0.0f, 0.0f };
+			}
+		}
+		if constexpr (instrumentation_enabled) {
+			counters.contacts_matched += num_matched;
+			counters.contacts_created += _contact_keys.size() - num_matched;
+			counters.contacts_dropped += _contact_cache.size() - num_matched;
+		}
+
+		_build_contact_islands();
+	}
+
+	std::optional<engine::collision_detection_result> engine::_detect_body_pair_collision(
+		const body &b1, const body &b2, narrow_phase_context context
+	) {
+		if (b1.continuous_collision || b2.continuous_collision) {
+			return detect_continuous_collision(
+				*b1.body_shape, _get_previous_state(b1), b1.state,
+				*b2.body_shape, _get_previous_state(b2), b2.state,
+				context
+			);
+		}
+		return detect_collision(*b1.body_shape, b1.state, *b2.body_shape, b2.state, context);
+	}
+
+	void engine::_build_contact_islands() {
+		// group dynamic bodies that are in contact; kinematic bodies do not join islands, since they are not
+		// affected by the bodies touching them
+		const std::span<const body> all_bodies = bodies.get_objects();
+		const auto num_bodies = static_cast<std::uint32_t>(all_bodies.size());
+		_island_parents.resize(num_bodies);
+		for (std::uint32_t i = 0; i < num_bodies; ++i) {
+			_island_parents[i] = i;
+		}
+		for (const constraints::body_contact &contact : contact_constraints) {
+			if (
+				all_bodies[contact.body1].properties.inverse_mass > 0.0f &&
+				all_bodies[contact.body2].properties.inverse_mass > 0.0f
+			) {
+				_island_parents[_find_root(_island_parents, contact.body1)] =
+					_find_root(_island_parents, contact.body2);
+			}
+		}
+		if constexpr (instrumentation_enabled) {
+			// every awake dynamic body that is its own root represents an island, including those without contacts
+			std::uint64_t num_islands = 0;
+			for (std::uint32_t i = 0; i < num_bodies; ++i) {
+				const body &b = all_bodies[i];
+				if (!b.sleeping && b.properties.inverse_mass > 0.0f && _island_parents[i] == i) {
+					++num_islands;
+				}
+			}
+			_step_statistics.counters.islands += num_islands;
+		}
+
+		// number islands in the order of their first contacts, and count the contacts of each island
+		constexpr std::uint32_t invalid_island = std::numeric_limits<std::uint32_t>::max();
+		const auto num_contacts = static_cast<std::uint32_t>(contact_constraints.size());
+		_root_contact_islands.assign(num_bodies, invalid_island);
+		_contact_islands.resize(num_contacts);
+		_island_contact_offsets.assign(1, 0);
+		for (std::uint32_t c = 0; c < num_contacts; ++c) {
+			const constraints::body_contact &contact = contact_constraints[c];
+			// at least one of the bodies is dynamic
+			const std::uint32_t dynamic_body =
+				all_bodies[contact.body1].properties.inverse_mass > 0.0f ? contact.body1 : contact.body2;
+			std::uint32_t &island = _root_contact_islands[_find_root(_island_parents, dynamic_body)];
+			if (island == invalid_island) {
+				island = static_cast<std::uint32_t>(_island_contact_offsets.size() - 1);
+				_island_contact_offsets.emplace_back(0);
+			}
+			_contact_islands[c] = island;
+			++_island_contact_offsets[island];
+		}
+		// counting sort; contacts are visited backwards so that those of the same island stay in order, and the
+		// offsets end up at the first contact of each island
+		const auto num_islands = static_cast<std::uint32_t>(_island_contact_offsets.size() - 1);
+		for (std::uint32_t i = 1; i <= num_islands; ++i) {
+			_island_contact_offsets[i] += _island_contact_offsets[i - 1];
+		}
+		_island_contacts.resize(num_contacts);
+		for (std::uint32_t c = num_contacts; c > 0; --c) {
+			_island_contacts[--_island_contact_offsets[_contact_islands[c - 1]]] = c - 1;
+		}
+
+		_serial_islands.clear();
+		_split_islands.clear();
+		for (std::uint32_t island = 0; island < num_islands; ++island) {
+			const std::uint32_t first = _island_contact_offsets[island];
+			const std::uint32_t count = _island_contact_offsets[island + 1] - first;
+			if (count <= max_serial_island_contacts) {
+				_serial_islands.emplace_back(island);
+				continue;
+			}
+			// contacts never modify kinematic bodies, so a kinematic body is replaced by a placeholder that is
+			// unique to the contact and does not prevent other contacts from having the same color
+			_split_islands.emplace_back(island, constraint_coloring::compute(
+				count, num_bodies + count,
+				[&](std::size_t c) {
+					const constraints::body_contact &contact = contact_constraints[_island_contacts[first + c]];
+					const auto placeholder = static_cast<std::uint32_t>(num_bodies + c);
+					return std::array{
+						all_bodies[contact.body1].properties.inverse_mass > 0.0f ? contact.body1 : placeholder,
+						all_bodies[contact.body2].properties.inverse_mass > 0.0f ? contact.body2 : placeholder
+					};
+				}
+			));
+		}
+		// tasks are picked up in order, so starting with the largest islands balances the load between threads
+		std::stable_sort(
+			_serial_islands.begin(), _serial_islands.end(),
+			[this](std::uint32_t lhs, std::uint32_t rhs) {
+				return
+					_island_contact_offsets[lhs + 1] - _island_contact_offsets[lhs] >
+					_island_contact_offsets[rhs + 1] - _island_contact_offsets[rhs];
+			}
+		);
+
+		if constexpr (instrumentation_enabled) {
+			_step_statistics.counters.split_islands += _split_islands.size();
+		}
+	}
+
+	void engine::_update_constraint_colorings() {
+		if (!_colorings_valid || _spring_coloring.num_constraints != particle_spring_constraints.size()) {
+			_spring_coloring = constraint_coloring::compute(
+				particle_spring_constraints.size(), particles.size(),
+				[this](std::size_t i) {
+					const auto &s = particle_spring_constraints[i];
+					return std::array{ s.particle1, s.particle2 };
+				}
+			);
+			_spring_batches = constraints::particle_spring_batches::create(
+				particle_spring_constraints, _spring_coloring
+			);
+		}
+		if (!_colorings_valid || _face_coloring.num_constraints != face_constraints.size()) {
+			_face_coloring = constraint_coloring::compute(
+				face_constraints.size(), particles.size(),
+				[this](std::size_t i) {
+					const auto &f = face_constraints[i];
+					return std::array{ f.particle1, f.particle2, f.particle3 };
+				}
+			);
+		}
+		if (!_colorings_valid || _bend_coloring.num_constraints != bend_constraints.size()) {
+			_bend_coloring = constraint_coloring::compute(
+				bend_constraints.size(), particles.size(),
+				[this](std::size_t i) {
+					const auto &b = bend_constraints[i];
+					return std::array{ b.particle_edge1, b.particle_edge2, b.particle3, b.particle4 };
+				}
+			);
+		}
+		if (
+			!_colorings_valid ||
+			_isometric_bend_coloring.num_constraints != isometric_bend_constraints.size()
+		) {
+			_isometric_bend_coloring = constraint_coloring::compute(
+				isometric_bend_constraints.size(), particles.size(),
+				[this](std::size_t i) {
+					const auto &b = isometric_bend_constraints[i];
+					return std::array{ b.particle_edge1, b.particle_edge2, b.particle3, b.particle4 };
+				}
+			);
+		}
+		_colorings_valid = true;
+	}
+
+	template <typename Callback> void engine::_parallel_for(std::size_t count, const Callback &cb) {
+		if (worker_pool) {
+			worker_pool->parallel_for(count, constraint_batch_size, cb);
+		} else {
+			cb(0, count);
+		}
+	}
+
+	template <typename Project> void engine::_project_colored(
+		const constraint_coloring &coloring, const Project &project
+	) {
+		for (std::size_t c = 0; c < coloring.get_num_colors(); ++c) {
+			const std::span<const std::uint32_t> constraints = coloring.get_constraints(c);
+			_parallel_for(constraints.size(), [&](std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; ++i) {
+					project(constraints[i]);
+				}
+			});
+		}
+	}
+
+	template <typename Solve> void engine::_solve_contact_islands(
+		std::uint32_t iters, const Solve &solve, bool monitor
+	) {
+		if (monitor) {
+			_island_convergence.assign(_serial_islands.size() + _split_islands.size(), { 0, 0.0f });
+		}
+		// records the residual of the island with the given index after the given number of iterations, and
+		// returns whether the island has converged
+		const std::span<const body> all_bodies = bodies.get_objects();
+		const auto check_island = [&](std::size_t index, std::uint32_t island, std::uint32_t iterations_done) {
+			if (!monitor || !_should_check_residuals(iterations_done, iters)) {
+				return false;
+			}
+			const std::uint32_t first = _island_contact_offsets[island];
+			const std::uint32_t last = _island_contact_offsets[island + 1];
+			scalar sum = 0.0f;
+			for (std::uint32_t c = first; c < last; ++c) {
+				const scalar residual = contact_constraints[_island_contacts[c]].compute_residual(all_bodies);
+				sum += residual * residual;
+			}
+			_island_convergence[index] = { iterations_done, sum };
+			return sum < residual_tolerance * residual_tolerance * static_cast<scalar>(last - first);
+		};
+
+		const auto solve_serial_islands = [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				const std::uint32_t island = _serial_islands[i];
+				const std::uint32_t first = _island_contact_offsets[island];
+				const std::uint32_t last = _island_contact_offsets[island + 1];
+				for (std::uint32_t j = 0; j < iters; ) {
+					for (std::uint32_t c = first; c < last; ++c) {
+						solve(_island_contacts[c]);
+					}
+					if (check_island(i, island, ++j)) {
+						break;
+					}
+				}
+			}
+		};
+		if (worker_pool) {
+			worker_pool->parallel_for(_serial_islands.size(), 1, solve_serial_islands);
+		} else {
+			solve_serial_islands(0, _serial_islands.size());
+		}
+
+		for (std::size_t i = 0; i < _split_islands.size(); ++i) {
+			const _split_island &island = _split_islands[i];
+			const std::uint32_t *contacts = _island_contacts.data() + _island_contact_offsets[island.island];
+			for (std::uint32_t j = 0; j < iters; ) {
+				_project_colored(island.coloring, [&](std::uint32_t c) {
+					solve(contacts[c]);
+				});
+				if (check_island(_serial_islands.size() + i, island.island, ++j)) {
+					break;
+				}
+			}
+		}
+	}
+
+	bool engine::_should_check_residuals(std::uint32_t iterations_done, std::uint32_t iters) const {
+		return
+			(convergence_monitoring || particle_iteration_acceleration != iteration_acceleration::none) &&
+			(iterations_done == iters || iterations_done % std::max<std::uint32_t>(residual_check_interval, 1) == 0);
+	}
+
+	template <typename Residual> scalar engine::_compute_rms_residual(std::size_t count, const Residual &residual) {
+		if (count == 0) {
+			return 0.0f;
+		}
+		// partial sums are taken over fixed-size chunks and added up in order, so that the result does not depend on
+		// how the chunks are distributed between threads
+		const std::size_t chunk_size = std::max<std::size_t>(constraint_batch_size, 1);
+		const std::size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+		_residual_sums.resize(num_chunks);
+		const auto sum_chunks = [&](std::size_t begin, std::size_t end) {
+			for (std::size_t c = begin; c < end; ++c) {
+				scalar sum = 0.0f;
+				const std::size_t last = std::min(count, (c + 1) * chunk_size);
+				for (std::size_t i = c * chunk_size; i < last; ++i) {
+					sum += residual(i);
+				}
+				_residual_sums[c] = sum;
+			}
+		};
+		if (worker_pool) {
+			worker_pool->parallel_for(num_chunks, 1, sum_chunks);
+		} else {
+			sum_chunks(0, num_chunks);
+		}
+		scalar total = 0.0f;
+		for (const scalar sum : _residual_sums) {
+			total += sum;
+		}
+		return std::sqrt(total / static_cast<scalar>(count));
+	}
+
+	template <typename Particles> engine::constraint_residuals engine::_compute_particle_residuals(
+		Particles &ps, scalar inv_dt2
+	) {
+		if constexpr (std::is_same_v<Particles, particle_soa>) {
+			_spring_batches.store_lambdas(spring_lambdas);
+		}
+
+		constraint_residuals result;
+		result.springs = _compute_rms_residual(particle_spring_constraints.size(), [&](std::size_t i) {
+			const constraints::particle_spring &s = particle_spring_constraints[i];
+			const scalar residual = s.compute_residual(
+				ps.get_position(s.particle1), ps.get_position(s.particle2), inv_dt2, spring_lambdas[i]
+			);
+			return residual * residual;
+		});
+		result.faces = _compute_rms_residual(face_constraints.size(), [&](std::size_t i) {
+			const constraints::face &f = face_constraints[i];
+			return f.compute_residual(
+				ps.get_position(f.particle1), ps.get_position(f.particle2), ps.get_position(f.particle3),
+				inv_dt2, face_lambdas[i]
+			).squared_norm();
+		});
+		const scalar bends = _compute_rms_residual(bend_constraints.size(), [&](std::size_t i) {
+			const constraints::bend &b = bend_constraints[i];
+			const scalar residual = b.compute_residual(
+				ps.get_position(b.particle_edge1), ps.get_position(b.particle_edge2),
+				ps.get_position(b.particle3), ps.get_position(b.particle4),
+				inv_dt2, bend_lambdas[i]
+			);
+			return residual * residual;
+		});
+		const scalar isometric_bends = _compute_rms_residual(isometric_bend_constraints.size(), [&](std::size_t i) {
+			const constraints::isometric_bend &b = isometric_bend_constraints[i];
+			const scalar residual = b.compute_residual(
+				ps.get_position(b.particle_edge1), ps.get_position(b.particle_edge2),
+				ps.get_position(b.particle3), ps.get_position(b.particle4),
+				inv_dt2, isometric_bend_lambdas[i]
+			);
+			return residual * residual;
+		});
+		// both kinds of bends are reported together
+		const std::size_t num_bends = bend_constraints.size() + isometric_bend_constraints.size();
+		if (num_bends > 0) {
+			result.bends = std::sqrt((
+				bends * bends * static_cast<scalar>(bend_constraints.size()) +
+				isometric_bends * isometric_bends * static_cast<scalar>(isometric_bend_constraints.size())
+			) / static_cast<scalar>(num_bends));
+		}
+		return result;
+	}
+
+	template <typename Particles> void engine::_store_iteration_positions(const Particles &ps) {
+		std::swap(_iteration_positions, _previous_iteration_positions);
+		_iteration_positions.resize(ps.size(), uninitialized);
+		_parallel_for(ps.size(), [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				_iteration_positions[i] = ps.get_position(i);
+			}
+		});
+	}
+
+	template <typename Particles> void engine::_extrapolate_particle_positions(
+		Particles &ps, std::span<const vec3> base, scalar omega
+	) {
+		_parallel_for(ps.size(), [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				if (ps.get_inverse_mass(i) > 0.0f) {
+					ps.set_position(i, base[i] + (ps.get_position(i) - base[i]) * omega);
+				}
+			}
+		});
+	}
+
+	template <typename Particles> void engine::_handle_body_particle_collisions(Particles &ps) {
+		for (std::size_t i = 0; i < _particle_collision_bodies.size(); ++i) {
+			const body &b = bodies.get_objects()[_particle_collision_bodies[i]];
+			std::visit(
+				[&](const auto &shape) {
+					const std::uint32_t end = _particle_collision_offsets[i + 1];
+					for (std::uint32_t j = _particle_collision_offsets[i]; j < end; ++j) {
+						const std::uint32_t pi = _particle_collision_candidates[j];
+						vec3 pos = ps.get_position(pi);
+						if (handle_shape_particle_collision(shape, b.state, pos)) {
+							ps.set_position(pi, pos);
+						}
+					}
+				},
+				b.body_shape->value
+			);
+		}
+	}
+
+	template <typename Particles> void engine::_project_particle_constraints(Particles &ps, scalar inv_dt2) {
+		const auto project_spring = [&](std::size_t j) {
+			const auto &s = particle_spring_constraints[j];
+			vec3 x1 = ps.get_position(s.particle1);
+			vec3 x2 = ps.get_position(s.particle2);
+			s.project(
+				x1, x2, ps.get_inverse_mass(s.particle1), ps.get_inverse_mass(s.particle2),
+				inv_dt2, spring_lambdas[j]
+			);
+			ps.set_position(s.particle1, x1);
+			ps.set_position(s.particle2, x2);
+		};
+		const auto project_face = [&](std::size_t j) {
+			constraints::face &f = face_constraints[j];
+			vec3 x1 = ps.get_position(f.particle1);
+			vec3 x2 = ps.get_position(f.particle2);
+			vec3 x3 = ps.get_position(f.particle3);
+			f.project(
+				x1, x2, x3,
+				ps.get_inverse_mass(f.particle1), ps.get_inverse_mass(f.particle2), ps.get_inverse_mass(f.particle3),
+				inv_dt2, face_lambdas[j], face_constraint_projection_type
+			);
+			ps.set_position(f.particle1, x1);
+			ps.set_position(f.particle2, x2);
+			ps.set_position(f.particle3, x3);
+		};
+		const auto project_bend = [&](std::size_t j) {
+			constraints::bend &b = bend_constraints[j];
+			vec3 x1 = ps.get_position(b.particle_edge1);
+			vec3 x2 = ps.get_position(b.particle_edge2);
+			vec3 x3 = ps.get_position(b.particle3);
+			vec3 x4 = ps.get_position(b.particle4);
+			b.project(
+				x1, x2, x3, x4,
+				ps.get_inverse_mass(b.particle_edge1), ps.get_inverse_mass(b.particle_edge2),
+				ps.get_inverse_mass(b.particle3), ps.get_inverse_mass(b.particle4),
+				inv_dt2, bend_lambdas[j]
+			);
+			ps.set_position(b.particle_edge1, x1);
+			ps.set_position(b.particle_edge2, x2);
+			ps.set_position(b.particle3, x3);
+			ps.set_position(b.particle4, x4);
+		};
+		const auto project_isometric_bend = [&](std::size_t j) {
+			const constraints::isometric_bend &b = isometric_bend_constraints[j];
+			vec3 x1 = ps.get_position(b.particle_edge1);
+			vec3 x2 = ps.get_position(b.particle_edge2);
+			vec3 x3 = ps.get_position(b.particle3);
+			vec3 x4 = ps.get_position(b.particle4);
+			b.project(
+				x1, x2, x3, x4,
+				ps.get_inverse_mass(b.particle_edge1), ps.get_inverse_mass(b.particle_edge2),
+				ps.get_inverse_mass(b.particle3), ps.get_inverse_mass(b.particle4),
+				inv_dt2, isometric_bend_lambdas[j]
+			);
+			ps.set_position(b.particle_edge1, x1);
+			ps.set_position(b.particle_edge2, x2);
+			ps.set_position(b.particle3, x3);
+			ps.set_position(b.particle4, x4);
+		};
+
+		// springs stored as structures of arrays are always projected in batches
+		if constexpr (std::is_same_v<Particles, particle_soa>) {
+			for (std::size_t c = 0; c < _spring_batches.get_num_colors(); ++c) {
+				const std::size_t first = _spring_batches.color_offsets[c];
+				_parallel_for(_spring_batches.color_offsets[c + 1] - first,
+					[&](std::size_t begin, std::size_t end) {
+						_spring_batches.project(ps, first + begin, first + end, inv_dt2);
+					}
+				);
+			}
+		}
+
+		switch (particle_constraint_ordering) {
+		case constraint_ordering::serial:
+			if constexpr (!std::is_same_v<Particles, particle_soa>) {
+				for (std::size_t j = 0; j < particle_spring_constraints.size(); ++j) {
+					project_spring(j);
+				}
+			}
+			for (std::size_t j = 0; j < face_constraints.size(); ++j) {
+				project_face(j);
+			}
+			for (std::size_t j = 0; j < bend_constraints.size(); ++j) {
+				project_bend(j);
+			}
+			for (std::size_t j = 0; j < isometric_bend_constraints.size(); ++j) {
+				project_isometric_bend(j);
+			}
+			break;
+		case constraint_ordering::colored_parallel:
+			if constexpr (!std::is_same_v<Particles, particle_soa>) {
+				_project_colored(_spring_coloring, project_spring);
+			}
+			_project_colored(_face_coloring, project_face);
+			_project_colored(_bend_coloring, project_bend);
+			_project_colored(_isometric_bend_coloring, project_isometric_bend);
+			break;
+		default:
+			break;
+		}
+
+		_project_self_collisions(ps);
+	}
+
+	template <typename Particles> void engine::_project_self_collisions(Particles &ps) {
+		for (const constraints::particle_pair_collision &c : _particle_pair_collisions) {
+			vec3 x1 = ps.get_position(c.particle1);
+			vec3 x2 = ps.get_position(c.particle2);
+			c.project(
+				x1, x2, ps.get_inverse_mass(c.particle1), ps.get_inverse_mass(c.particle2), self_collision_thickness
+			);
+			ps.set_position(c.particle1, x1);
+			ps.set_position(c.particle2, x2);
+		}
+		for (const constraints::particle_triangle_collision &c : _particle_triangle_collisions) {
+			vec3 x = ps.get_position(c.particle);
+			vec3 x1 = ps.get_position(c.triangle1);
+			vec3 x2 = ps.get_position(c.triangle2);
+			vec3 x3 = ps.get_position(c.triangle3);
+			c.project(
+				x, x1, x2, x3,
+				ps.get_inverse_mass(c.particle), ps.get_inverse_mass(c.triangle1),
+				ps.get_inverse_mass(c.triangle2), ps.get_inverse_mass(c.triangle3),
+				self_collision_thickness
+			);
+			ps.set_position(c.particle, x);
+			ps.set_position(c.triangle1, x1);
+			ps.set_position(c.triangle2, x2);
+			ps.set_position(c.triangle3, x3);
 		}
 	}
 
 	template <
 		typename Shape1, typename Shape2
 	> [[nodiscard]] std::optional<engine::collision_detection_result> engine::detect_collision(
-		const Shape1&, const body_state&, const Shape2&, const body_state&
+		const Shape1&, const body_state&, const Shape2&, const body_state&, narrow_phase_context
 	) {
 		return std::nullopt;
 	}
 
 	std::optional<engine::collision_detection_result> engine::detect_collision(
-		const collision::shape &s1, const body_state &st1, const collision::shape &s2, const body_state &st2
+		const collision::shape &s1, const body_state &st1, const collision::shape &s2, const body_state &st2,
+		narrow_phase_context context
 	) {
 		const collision::shape *sa = &s1;
 		const collision::shape *sb = &s2;
@@ -197,67 +1600,248 @@ namespace lotus::physics {
 		const body_state *stb = &st2;
 		if (sa->get_type() > sb->get_type()) {
 			auto res = std::visit([=](const auto &shapeb, const auto &shapea) {
-				return detect_collision(shapeb, *stb, shapea, *sta);
+				return detect_collision(shapeb, *stb, shapea, *sta, context);
 			}, sb->value, sa->value);
 			if (res) {
-				std::swap(res->contact1, res->contact2);
+				for (auto &pt : res->get_points()) {
+					std::swap(pt.contact1, pt.contact2);
+					std::swap(pt.feature1, pt.feature2);
+				}
 				res->normal = -res->normal;
 			}
 			return res;
 		} else {
 			return std::visit([=](const auto &shapea, const auto &shapeb) {
-				return detect_collision(shapea, *sta, shapeb, *stb);
+				return detect_collision(shapea, *sta, shapeb, *stb, context);
 			}, sa->value, sb->value);
 		}
 	}
 
 	std::optional<engine::collision_detection_result> engine::detect_collision(
-		const collision::shapes::sphere&, const body_state&, const collision::shapes::plane&, const body_state&
+		const collision::shapes::plane&, const body_state &s1,
+		const collision::shapes::sphere &sp2, const body_state &s2, narrow_phase_context
 	) {
-		return std::nullopt; // TODO
+		const vec3 norm_world = s1.rotation.rotate(vec3(0.0f, 0.0f, 1.0f));
+		const vec3 center = s2.position + s2.rotation.rotate(sp2.offset);
+		const scalar dist = vec::dot(center - s1.position, norm_world);
+		if (dist >= sp2.radius) {
+			return std::nullopt;
+		}
+		const vec3 contact1 = center - dist * norm_world;
+		const vec3 contact2 = center - sp2.radius * norm_world;
+		return engine::collision_detection_result::create(
+			s1.rotation.inverse().rotate(contact1 - s1.position),
+			s2.rotation.inverse().rotate(contact2 - s2.position),
+			norm_world
+		);
 	}
 
 	std::optional<engine::collision_detection_result> engine::detect_collision(
-		const collision::shapes::sphere&, const body_state&, const collision::shapes::sphere&, const body_state&
+		const collision::shapes::sphere &sp1, const body_state &s1,
+		const collision::shapes::sphere &sp2, const body_state &s2, narrow_phase_context
 	) {
-		return std::nullopt; // TODO
+		const vec3 center1 = s1.position + s1.rotation.rotate(sp1.offset);
+		const vec3 center2 = s2.position + s2.rotation.rotate(sp2.offset);
+		const vec3 diff = center2 - center1;
+		const scalar radius = sp1.radius + sp2.radius;
+		const scalar dist2 = diff.squared_norm();
+		if (dist2 >= radius * radius) {
+			return std::nullopt;
+		}
+		// concentric spheres can be separated in any direction
+		const scalar dist = std::sqrt(dist2);
+		const vec3 normal = dist > 0.0f ? diff / dist : vec3(0.0f, 0.0f, 1.0f);
+		return engine::collision_detection_result::create(
+			sp1.offset + s1.rotation.inverse().rotate(sp1.radius * normal),
+			sp2.offset - s2.rotation.inverse().rotate(sp2.radius * normal),
+			normal
+		);
 	}
 
 	std::optional<engine::collision_detection_result> engine::detect_collision(
 		const collision::shapes::plane&, const body_state &s1,
-		const collision::shapes::polyhedron &p2, const body_state &s2
+		const collision::shapes::polyhedron &p2, const body_state &s2, narrow_phase_context
 	) {
-		vec3 norm_world = s1.rotation.rotate(vec3(0.0f, 0.0f, 1.0f));
-		vec3 norm_local2 = s2.rotation.inverse().rotate(norm_world);
-		vec3 plane_pos = s2.rotation.inverse().rotate(s1.position - s2.position);
-		scalar min_depth = 0.0f;
-		std::optional<vec3> contact;
-		for (const auto &vert : p2.vertices) {
-			scalar depth = vec::dot(vert - plane_pos, norm_local2);
-			if (depth < min_depth) {
-				min_depth = depth;
-				contact = vert;
-			}
-		}
-		if (contact) {
-			vec3 vert_world = s2.rotation.rotate(contact.value()) + s2.position;
-			vert_world -= norm_world * min_depth;
-			return engine::collision_detection_result::create(
-				s1.rotation.inverse().rotate(vert_world - s1.position), contact.value(), norm_world
+		const vec3 norm_world = s1.rotation.rotate(vec3(0.0f, 0.0f, 1.0f));
+		const vec3 norm_local2 = s2.rotation.inverse().rotate(norm_world);
+		const vec3 plane_pos = s2.rotation.inverse().rotate(s1.position - s2.position);
+
+		// all vertices within the margin are candidates; whenever the buffer is full, it's reduced to the points that
+		// would be kept in the end anyway
+		using contact_point = collision::feature_clipping::contact_point;
+		short_vector<contact_point, collision::feature_clipping::max_clipped_points> points;
+		bool penetrating = false;
+		for (std::uint32_t i = 0; i < p2.vertices.size(); ++i) {
+			const scalar dist = vec::dot(p2.vertices[i] - plane_pos, norm_local2);
+			if (dist > contact_manifold_margin) {
+				continue;
+			}
+			penetrating = penetrating || dist < 0.0f;
+			if (points.size() == collision::feature_clipping::max_clipped_points) {
+				const std::uint32_t num_kept =
+					collision::feature_clipping::reduce(std::span(points.begin(), points.size()), norm_world);
+				points.erase(points.begin() + num_kept, points.end());
+			}
+			contact_point &pt = points.emplace_back(uninitialized);
+			pt.position2 = s2.rotation.rotate(p2.vertices[i]) + s2.position;
+			pt.position1 = pt.position2 - dist * norm_world;
+			pt.depth = -dist;
+			pt.feature1 = collision::contact_feature::none();
+			pt.feature2 = collision::contact_feature::from_vertices(i);
+		}
+		if (!penetrating) {
+			return std::nullopt;
+		}
+
+		const std::uint32_t num_points =
+			collision::feature_clipping::reduce(std::span(points.begin(), points.size()), norm_world);
+		auto result = engine::collision_detection_result::create(norm_world);
+		for (std::uint32_t i = 0; i < num_points; ++i) {
+			auto &pt = result.add_point(
+				s1.rotation.inverse().rotate(points[i].position1 - s1.position),
+				p2.vertices[points[i].feature2.vertices[0]]
 			);
+			pt.feature2 = points[i].feature2;
 		}
-		return std::nullopt;
+		return result;
 	}
 
 	std::optional<engine::collision_detection_result> engine::detect_collision(
-		const collision::shapes::sphere&, const body_state&, const collision::shapes::polyhedron&, const body_state&
+		const collision::shapes::sphere &sp1, const body_state &s1,
+		const collision::shapes::polyhedron &p2, const body_state &s2, narrow_phase_context context
 	) {
-		return std::nullopt; // TODO
+		const vec3 center = s1.position + s1.rotation.rotate(sp1.offset);
+		const vec3 local_center = s2.rotation.inverse().rotate(center - s2.position);
+
+		// start from the vertices that were closest to the sphere in the previous step
+		collision::gjk_epa::pair_cache *cache = context.gjk_cache;
+		step_counters *counters = instrumentation_enabled ? context.counters : nullptr;
+		std::array<std::uint32_t, 4> initial_vertices{};
+		std::size_t num_initial_vertices = 0;
+		if (cache) {
+			for (; num_initial_vertices < cache->simplex_vertices; ++num_initial_vertices) {
+				initial_vertices[num_initial_vertices] = cache->simplex[num_initial_vertices].index2;
+			}
+		}
+		const auto closest = collision::gjk_distance::closest_point(
+			p2, local_center, std::span(initial_vertices.data(), num_initial_vertices)
+		);
+		if (cache) {
+			cache->simplex_vertices = closest.num_vertices;
+			for (std::uint32_t i = 0; i < closest.num_vertices; ++i) {
+				cache->simplex[i] = collision::gjk_epa::simplex_vertex(0, closest.vertices[i]);
+			}
+			cache->separating_axis = zero;
+		}
+		if (counters) {
+			++counters->gjk_calls;
+			counters->gjk_support_queries += closest.support_queries;
+		}
+
+		if (!closest.is_inside() && closest.distance > 0.0f) {
+			if (closest.distance >= sp1.radius) {
+				return std::nullopt;
+			}
+			const vec3 local_normal = (closest.closest_point - local_center) / closest.distance;
+			const vec3 normal = s2.rotation.rotate(local_normal);
+			auto result = engine::collision_detection_result::create(
+				sp1.offset + s1.rotation.inverse().rotate(sp1.radius * normal), closest.closest_point, normal
+			);
+			result.points[0].feature2 = collision::contact_feature::from_vertices(
+				closest.vertices[0],
+				closest.num_vertices > 1 ? closest.vertices[1] : collision::contact_feature::invalid_vertex,
+				closest.num_vertices > 2 ? closest.vertices[2] : collision::contact_feature::invalid_vertex
+			);
+			return result;
+		}
+
+		// the center is inside the polyhedron, so the penetration depth is found by treating it as a polyhedron
+		// with a single vertex; this is rare, since the sphere is usually pushed out before its center gets in
+		auto alg = collision::gjk_epa::for_bodies(
+			body_state::stationary_at(center, uquats::identity()), _get_point_polyhedron(), s2, p2
+		);
+		auto [intersect, state] = alg.gjk();
+		if (counters) {
+			++counters->gjk_calls;
+			counters->gjk_support_queries += state.support_queries;
+		}
+		if (!intersect) {
+			return std::nullopt;
+		}
+		const auto epa_res = alg.epa(state);
+		if (counters) {
+			counters->epa_iterations += epa_res.iterations;
+			if (!epa_res.converged) {
+				++counters->epa_fallbacks;
+			}
+			counters->peak_narrow_phase_scratch_bytes =
+				std::max(counters->peak_narrow_phase_scratch_bytes, epa_res.peak_scratch_bytes);
+		}
+		const vec3 contact2 = center - epa_res.penetration_depth * epa_res.normal;
+		auto result = engine::collision_detection_result::create(
+			sp1.offset + s1.rotation.inverse().rotate(sp1.radius * epa_res.normal),
+			s2.rotation.inverse().rotate(contact2 - s2.position),
+			epa_res.normal
+		);
+		result.points[0].feature2 = collision::contact_feature::from_vertices(
+			epa_res.vertices[0].index2, epa_res.vertices[1].index2, epa_res.vertices[2].index2
+		);
+		return result;
+	}
+
+	std::optional<engine::collision_detection_result> engine::_detect_nearby_polyhedra(
+		const collision::shapes::polyhedron &p1, const body_state &s1,
+		const collision::shapes::polyhedron &p2, const body_state &s2, narrow_phase_context context
+	) {
+		step_counters *counters = instrumentation_enabled ? context.counters : nullptr;
+		auto res = collision::gjk_distance::closest_points(p1, s1, p2, s2);
+		if (counters) {
+			counters->gjk_support_queries += res.support_queries;
+		}
+		if (res.distance >= contact_manifold_margin) {
+			return std::nullopt;
+		}
+		if (res.intersecting) {
+			// the polyhedra touch within rounding errors, which leaves no usable normal; move the first polyhedron
+			// away from the second so that the closest feature of their Minkowski difference can be found. if their
+			// centers coincide any direction will do, since the polyhedra are rejected below if they still intersect
+			const vec3 center_offset = s2.position - s1.position;
+			const scalar center_distance = center_offset.norm();
+			const vec3 direction = center_distance > 0.0f ? center_offset / center_distance : vec3(1.0f, 0.0f, 0.0f);
+			const vec3 offset = direction * contact_manifold_margin;
+			res = collision::gjk_distance::closest_points(
+				p1, body_state::stationary_at(s1.position - offset, s1.rotation), p2, s2
+			);
+			if (counters) {
+				counters->gjk_support_queries += res.support_queries;
+			}
+			if (res.intersecting) {
+				return std::nullopt;
+			}
+			res.position1 += offset;
+			res.distance = 0.0f;
+		}
+		collision::conservative_advancement::separation closest = uninitialized;
+		closest.position1 = res.position1;
+		closest.position2 = res.position2;
+		closest.normal = res.normal;
+		closest.distance = res.distance;
+		auto clip_res = collision::feature_clipping::clip(
+			collision::feature_clipping::find_support_feature(p1, s1, closest.normal),
+			collision::feature_clipping::find_support_feature(p2, s2, -closest.normal),
+			closest.normal, res.distance + contact_manifold_margin
+		);
+		if (!clip_res.points.empty()) {
+			closest.normal = clip_res.normal;
+		}
+		return _create_manifold_from_points(
+			std::span(clip_res.points.begin(), clip_res.points.size()), s1, s2, closest, 1.0f
+		);
 	}
 
 	std::optional<engine::collision_detection_result> engine::detect_collision(
 		const collision::shapes::polyhedron &p1, const body_state &s1,
-		const collision::shapes::polyhedron &p2, const body_state &s2
+		const collision::shapes::polyhedron &p2, const body_state &s2, narrow_phase_context context
 	) {
 		auto alg = collision::gjk_epa::for_bodies(s1, p1, s2, p2);
 		alg.center1 = s1.position;
@@ -267,14 +1851,69 @@ namespace lotus::physics {
 		alg.orient2 = s2.rotation;
 		alg.polyhedron2 = &p2;
 
+		collision::gjk_epa::pair_cache *cache = context.gjk_cache;
+		step_counters *counters = instrumentation_enabled ? context.counters : nullptr;
+		if (cache) {
+			alg.resume_from(*cache);
+			// if the bodies were separated in the previous step, they're likely still separated along the same axis
+			if (cache->separating_axis.squared_norm() > 0.0f) {
+				if (counters) {
+					++counters->gjk_support_queries;
+				}
+				if (alg.is_separated_along(s1.rotation.rotate(cache->separating_axis), contact_manifold_margin)) {
+					return std::nullopt;
+				}
+			}
+		}
+
 		auto [intersect, state] = alg.gjk();
+		if (cache) {
+			alg.store_to(*cache, state);
+		}
+		if (counters) {
+			++counters->gjk_calls;
+			counters->gjk_support_queries += state.support_queries;
+		}
 		if (!intersect) {
-			return std::nullopt;
+			return _detect_nearby_polyhedra(p1, s1, p2, s2, context);
 		}
 		auto epa_res = alg.epa(state);
+		if (counters) {
+			counters->epa_iterations += epa_res.iterations;
+			if (!epa_res.converged) {
+				++counters->epa_fallbacks;
+			}
+			counters->peak_narrow_phase_scratch_bytes =
+				std::max(counters->peak_narrow_phase_scratch_bytes, epa_res.peak_scratch_bytes);
+		}
+
+		// clip the features of both polyhedra along the contact normal against each other to find multiple points
+		{
+			auto clip_res = collision::feature_clipping::clip(
+				collision::feature_clipping::find_support_feature(p1, s1, epa_res.normal),
+				collision::feature_clipping::find_support_feature(p2, s2, -epa_res.normal),
+				epa_res.normal, contact_manifold_margin
+			);
+			if (!clip_res.points.empty()) {
+				auto &points = clip_res.points;
+				const std::uint32_t num_points =
+					collision::feature_clipping::reduce(std::span(points.begin(), points.size()), clip_res.normal);
+				auto result = engine::collision_detection_result::create(clip_res.normal);
+				for (std::uint32_t i = 0; i < num_points; ++i) {
+					auto &pt = result.add_point(
+						s1.rotation.inverse().rotate(points[i].position1 - s1.position),
+						s2.rotation.inverse().rotate(points[i].position2 - s2.position)
+					);
+					pt.feature1 = points[i].feature1;
+					pt.feature2 = points[i].feature2;
+				}
+				return result;
+			}
+		}
 
-		engine::collision_detection_result result = uninitialized;
-		result.normal = epa_res.normal;
+		// otherwise, use the single point found by EPA
+		auto result = engine::collision_detection_result::create(epa_res.normal);
+		auto &point = result.add_point(zero, zero);
 		bool face_p1 =
 			epa_res.vertices[0].index2 == epa_res.vertices[1].index2 &&
 			epa_res.vertices[0].index2 == epa_res.vertices[2].index2;
@@ -282,15 +1921,23 @@ namespace lotus::physics {
 			epa_res.vertices[0].index1 == epa_res.vertices[1].index1 &&
 			epa_res.vertices[0].index1 == epa_res.vertices[2].index1;
 		if (face_p1) { // a vertex from p2 and a face from p1
-			result.contact2 = p2.vertices[epa_res.vertices[0].index2];
+			point.feature1 = collision::contact_feature::from_vertices(
+				epa_res.vertices[0].index1, epa_res.vertices[1].index1, epa_res.vertices[2].index1
+			);
+			point.feature2 = collision::contact_feature::from_vertices(epa_res.vertices[0].index2);
+			point.contact2 = p2.vertices[epa_res.vertices[0].index2];
 			const vec3 contact1 =
-				s2.rotation.rotate(result.contact2) + s2.position + epa_res.penetration_depth * epa_res.normal;
-			result.contact1 = s1.rotation.inverse().rotate(contact1 - s1.position);
+				s2.rotation.rotate(point.contact2) + s2.position + epa_res.penetration_depth * epa_res.normal;
+			point.contact1 = s1.rotation.inverse().rotate(contact1 - s1.position);
 		} else if (face_p2) { // a vertex from p1 and a face from p2
-			result.contact1 = p1.vertices[epa_res.vertices[0].index1];
+			point.feature1 = collision::contact_feature::from_vertices(epa_res.vertices[0].index1);
+			point.feature2 = collision::contact_feature::from_vertices(
+				epa_res.vertices[0].index2, epa_res.vertices[1].index2, epa_res.vertices[2].index2
+			);
+			point.contact1 = p1.vertices[epa_res.vertices[0].index1];
 			const vec3 contact2 =
-				s1.rotation.rotate(result.contact1) + s1.position - epa_res.penetration_depth * epa_res.normal;
-			result.contact2 = s2.rotation.inverse().rotate(contact2 - s2.position);
+				s1.rotation.rotate(point.contact1) + s1.position - epa_res.penetration_depth * epa_res.normal;
+			point.contact2 = s2.rotation.inverse().rotate(contact2 - s2.position);
 		} else { // two edges
 			std::array<vec3, 3> spx_pos = epa_res.simplex_positions;
 			std::array<collision::gjk_epa::simplex_vertex, 3> spx_id = epa_res.vertices;
@@ -332,12 +1979,41 @@ namespace lotus::physics {
 			vec3 local_contact1 =
 				p1.vertices[spx_id[0].index1] * (1.0f - barycentric[0]) +
 				p1.vertices[spx_id[1].index1] * barycentric[0];
-			result.contact1 = local_contact1;
-			result.contact2 = local_contact2;
+			point.contact1 = local_contact1;
+			point.contact2 = local_contact2;
+			point.feature1 = collision::contact_feature::from_vertices(spx_id[0].index1, spx_id[1].index1);
+			point.feature2 = collision::contact_feature::from_vertices(spx_id[0].index2, spx_id[2].index2);
 		}
 		return result;
 	}
 
+	std::optional<engine::collision_detection_result> engine::detect_continuous_collision(
+		const collision::shape &s1, const body_state &from1, const body_state &to1,
+		const collision::shape &s2, const body_state &from2, const body_state &to2, narrow_phase_context context
+	) {
+		step_counters *counters = instrumentation_enabled ? context.counters : nullptr;
+		if (counters) {
+			++counters->continuous_collision_tests;
+		}
+		// shapes that already touch, e.g., resting bodies, are handled by the discrete narrow phase, which produces
+		// complete manifolds
+		const auto initial = collision::conservative_advancement::compute_separation(s1, from1, s2, from2);
+		if (!initial || initial->distance <= contact_manifold_margin) {
+			return detect_collision(s1, to1, s2, to2, context);
+		}
+		const auto toi = collision::conservative_advancement::compute_time_of_impact(
+			s1, from1, to1, s2, from2, to2, contact_manifold_margin
+		);
+		if (!toi) {
+			return std::nullopt;
+		}
+		if (counters) {
+			++counters->speculative_contacts;
+		}
+		// contacts are stored in local space, so the points are carried along with the bodies to their final states
+		return _create_speculative_manifold(s1, toi->state1, s2, toi->state2, toi->closest, toi->time);
+	}
+
 	bool engine::handle_shape_particle_collision(
 		const collision::shapes::plane&, const body_state &state, vec3 &pos
 	) {
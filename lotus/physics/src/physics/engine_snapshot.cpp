@@ -0,0 +1,549 @@
+#include "lotus/physics/engine.h"
+
+/// \file
+/// Saving and restoring snapshots of the simulation state.
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <type_traits>
+
+namespace lotus::physics {
+	/// Identifies snapshots written by \ref engine::save_snapshot().
+	constexpr static std::uint32_t _snapshot_magic = 0x53535050; // "PPSS"
+	/// Flag in \ref _snapshot_header::flags that is set for snapshots that only contain bodies that have changed.
+	constexpr static std::uint32_t _snapshot_body_delta_flag = 1;
+	/// Flag in \ref _snapshot_header::flags that is set for snapshots that only contain particles that have
+	/// changed.
+	constexpr static std::uint32_t _snapshot_particle_delta_flag = 2;
+	/// Snapshots with any of these flags in \ref _snapshot_header::flags need a full snapshot to be restored.
+	constexpr static std::uint32_t _snapshot_delta_flags = _snapshot_body_delta_flag | _snapshot_particle_delta_flag;
+
+	/// Header at the start of each snapshot. All fields are 32-bit, so that there is no padding.
+	struct _snapshot_header {
+		std::uint32_t magic; ///< Always \ref _snapshot_magic.
+		std::uint32_t version; ///< Always \ref engine::snapshot_version.
+		std::uint32_t flags; ///< Flags, see \ref _snapshot_delta_flags.
+		std::uint32_t num_particles; ///< The number of particles in the engine.
+		/// The number of particle records that follow, which is less than \ref num_particles for delta snapshots.
+		std::uint32_t num_particle_records;
+		std::uint32_t num_bodies; ///< The number of bodies in the engine.
+		/// The number of body records that follow, which is less than \ref num_bodies for delta snapshots.
+		std::uint32_t num_body_records;
+		/// The number of spring constraints. Lambda values of constraints are saved for all constraints; they're
+		/// zero if no time step has been taken since the constraints were added.
+		std::uint32_t num_springs;
+		std::uint32_t num_faces; ///< The number of face constraints.
+		std::uint32_t num_bends; ///< The number of bend constraints.
+		std::uint32_t num_isometric_bends; ///< The number of isometric bend constraints.
+		std::uint32_t num_contacts; ///< The number of contact constraints.
+		std::uint32_t num_cached_contacts; ///< The number of contacts kept for warm starting.
+		std::uint32_t num_cached_gjk_pairs; ///< The number of pairs kept for collision pair caching.
+		std::uint32_t next_island; ///< One plus the largest island index of all sleeping bodies.
+	};
+	static_assert(std::is_trivially_copyable_v<_snapshot_header>);
+
+	/// Size of a particle in a snapshot: its state and its previous position.
+	constexpr static std::size_t _snapshot_particle_size = sizeof(particle_state) + sizeof(vec3);
+	/// Size of a body in a snapshot: its handle, its state, its states after the previous time step, and its
+	/// sleeping state.
+	constexpr static std::size_t _snapshot_body_size =
+		sizeof(body_handle) + sizeof(body_state) + sizeof(vec3) + sizeof(uquats) + 2 * sizeof(vec3) +
+		sizeof(std::uint8_t) + sizeof(scalar) + sizeof(std::uint32_t);
+	/// Size of a contact kept for warm starting in a snapshot.
+	constexpr static std::size_t _snapshot_cached_contact_size =
+		2 * sizeof(body_handle) + 2 * sizeof(collision::contact_feature) + 2 * sizeof(scalar);
+	/// Size of a pair kept for collision pair caching in a snapshot.
+	constexpr static std::size_t _snapshot_cached_gjk_pair_size =
+		2 * sizeof(body_handle) + sizeof(collision::gjk_epa::pair_cache);
+
+	/// Writes values sequentially into a buffer. All functions assume that the buffer is large enough.
+	struct _snapshot_writer {
+		/// Writes the bytes of the given object.
+		template <typename T> void write(const T &value) {
+			static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable objects can be saved");
+			std::memcpy(ptr, &value, sizeof(T));
+			ptr += sizeof(T);
+		}
+		/// Writes the bytes of all objects in the given array.
+		template <typename T> void write_array(std::span<const T> values) {
+			static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable objects can be saved");
+			if (!values.empty()) { // memcpy() does not accept null pointers
+				std::memcpy(ptr, values.data(), values.size_bytes());
+				ptr += values.size_bytes();
+			}
+		}
+
+		std::byte *ptr; ///< The location where the next value is written.
+	};
+	/// Reads values sequentially from a buffer. All functions assume that the buffer is large enough.
+	struct _snapshot_reader {
+		/// Reads an object.
+		template <typename T> [[nodiscard]] T read() {
+			static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable objects can be restored");
+			// not all types can be default-constructed
+			std::array<std::byte, sizeof(T)> bytes;
+			std::memcpy(bytes.data(), ptr, sizeof(T));
+			ptr += sizeof(T);
+			return std::bit_cast<T>(bytes);
+		}
+		/// Fills the given array.
+		template <typename T> void read_array(std::span<T> values) {
+			static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable objects can be restored");
+			if (!values.empty()) {
+				std::memcpy(values.data(), ptr, values.size_bytes());
+				ptr += values.size_bytes();
+			}
+		}
+		/// Skips the given number of bytes.
+		void skip(std::size_t bytes) {
+			ptr += bytes;
+		}
+
+		const std::byte *ptr; ///< The location where the next value is read from.
+	};
+
+	/// Writes the record of a single particle.
+	static void _write_snapshot_particle(_snapshot_writer &writer, const particle &p) {
+		writer.write(p.state);
+		writer.write(p.prev_position);
+	}
+	/// Reads the record of a single particle.
+	static void _read_snapshot_particle(_snapshot_reader &reader, particle &p) {
+		p.state         = reader.read<particle_state>();
+		p.prev_position = reader.read<vec3>();
+	}
+	/// Writes the record of a single body.
+	static void _write_snapshot_body(_snapshot_writer &writer, body_handle handle, const body &b) {
+		writer.write(handle);
+		writer.write(b.state);
+		writer.write(b.prev_position);
+		writer.write(b.prev_rotation);
+		writer.write(b.prev_linear_velocity);
+		writer.write(b.prev_angular_velocity);
+		writer.write(static_cast<std::uint8_t>(b.sleeping));
+		writer.write(b.sleep_timer);
+		writer.write(b.island);
+	}
+	/// Reads the record of a single body, except for its handle, which must have been skipped.
+	static void _read_snapshot_body(_snapshot_reader &reader, body &b) {
+		b.state                 = reader.read<body_state>();
+		b.prev_position         = reader.read<vec3>();
+		b.prev_rotation         = reader.read<uquats>();
+		b.prev_linear_velocity  = reader.read<vec3>();
+		b.prev_angular_velocity = reader.read<vec3>();
+		b.sleeping              = reader.read<std::uint8_t>() != 0;
+		b.sleep_timer           = reader.read<scalar>();
+		b.island                = reader.read<std::uint32_t>();
+	}
+
+	/// Writes the records of the given number of objects using the given callback, and returns the number of
+	/// records written. If \p base_records is not \p nullptr, it points to the records of the same objects in a
+	/// full snapshot, and only records that differ from them are written, each preceded by the index of its
+	/// object. If that would not be smaller, all records are written without indices instead, and
+	/// \p base_records is set to \p nullptr.
+	template <typename Write> [[nodiscard]] static std::uint32_t _write_snapshot_records(
+		_snapshot_writer &writer, const std::byte *&base_records, std::size_t record_size, std::uint32_t count,
+		Write &&write_record
+	) {
+		std::byte *const first_record = writer.ptr;
+		if (base_records) {
+			std::uint32_t num_records = 0;
+			for (std::uint32_t i = 0; i < count; ++i) {
+				// write the record in place, and keep it only if it differs from the base
+				std::byte *const index_ptr = writer.ptr;
+				writer.write(i);
+				std::byte *const record = writer.ptr;
+				write_record(i);
+				if (std::memcmp(record, base_records + i * record_size, record_size) == 0) {
+					writer.ptr = index_ptr;
+				} else {
+					++num_records;
+				}
+			}
+			if (num_records * (sizeof(std::uint32_t) + record_size) < count * record_size) {
+				return num_records;
+			}
+			base_records = nullptr;
+			writer.ptr = first_record;
+		}
+		for (std::uint32_t i = 0; i < count; ++i) {
+			write_record(i);
+		}
+		return count;
+	}
+	/// Reads the records written by \ref _write_snapshot_records() using the given callback. For delta records,
+	/// all objects are first read from \p full_records, which are the records of a full snapshot.
+	template <typename Read> static void _read_snapshot_records(
+		_snapshot_reader &reader, const std::byte *full_records, bool delta, std::uint32_t num_records,
+		std::uint32_t count, Read &&read_record
+	) {
+		if (delta) {
+			_snapshot_reader base_reader{ full_records };
+			for (std::uint32_t i = 0; i < count; ++i) {
+				read_record(base_reader, i);
+			}
+			for (std::uint32_t i = 0; i < num_records; ++i) {
+				const auto index = reader.read<std::uint32_t>();
+				read_record(reader, index);
+			}
+		} else {
+			for (std::uint32_t i = 0; i < count; ++i) {
+				read_record(reader, i);
+			}
+		}
+	}
+	/// Checks that the given records are consistent with the number of objects: full records must contain all
+	/// objects, and delta records must refer to existing objects.
+	[[nodiscard]] static bool _check_snapshot_records(
+		const std::byte *records, bool delta, std::uint32_t num_records, std::size_t record_size, std::uint32_t count
+	) {
+		if (!delta) {
+			return num_records == count;
+		}
+		_snapshot_reader reader{ records };
+		for (std::uint32_t i = 0; i < num_records; ++i) {
+			if (reader.read<std::uint32_t>() >= count) {
+				return false;
+			}
+			reader.skip(record_size);
+		}
+		return true;
+	}
+
+	/// Writes the lambda values of the given number of constraints. If the lambda values have not been allocated
+	/// yet, zeros are written instead.
+	template <typename T> static void _write_snapshot_lambdas(
+		_snapshot_writer &writer, const std::vector<T> &lambdas, std::size_t count, const T &zero_lambda
+	) {
+		if (lambdas.size() == count) {
+			writer.write_array(std::span<const T>(lambdas));
+		} else {
+			for (std::size_t i = 0; i < count; ++i) {
+				writer.write(zero_lambda);
+			}
+		}
+	}
+
+	/// Returns the number of bytes occupied by all sections of a snapshot after its body records.
+	[[nodiscard]] static std::size_t _get_snapshot_tail_size(const _snapshot_header &header) {
+		return
+			header.num_springs * sizeof(scalar) +
+			header.num_faces * 2 * sizeof(column_vector<6, scalar>) +
+			header.num_bends * sizeof(scalar) +
+			header.num_isometric_bends * sizeof(scalar) +
+			header.num_contacts * (
+				sizeof(constraints::body_contact) + 2 * sizeof(scalar) +
+				2 * sizeof(body_handle) + 2 * sizeof(collision::contact_feature)
+			) +
+			header.num_cached_contacts * _snapshot_cached_contact_size +
+			header.num_cached_gjk_pairs * _snapshot_cached_gjk_pair_size;
+	}
+	/// Returns the size of a record in a snapshot with the given header, given the size of the object's data. The
+	/// records of delta snapshots also store the indices of their objects.
+	[[nodiscard]] static std::size_t _get_snapshot_record_size(
+		const _snapshot_header &header, std::uint32_t delta_flag, std::size_t size
+	) {
+		return (header.flags & delta_flag) ? sizeof(std::uint32_t) + size : size;
+	}
+	/// Returns the offset of the first body record in a snapshot with the given header.
+	[[nodiscard]] static std::size_t _get_snapshot_body_records_offset(const _snapshot_header &header) {
+		return
+			sizeof(_snapshot_header) +
+			header.num_particle_records *
+				_get_snapshot_record_size(header, _snapshot_particle_delta_flag, _snapshot_particle_size);
+	}
+	/// Returns the total size of a snapshot with the given header.
+	[[nodiscard]] static std::size_t _get_snapshot_size(const _snapshot_header &header) {
+		const std::size_t body_record_size =
+			_get_snapshot_record_size(header, _snapshot_body_delta_flag, _snapshot_body_size);
+		return
+			_get_snapshot_body_records_offset(header) +
+			header.num_body_records * body_record_size +
+			_get_snapshot_tail_size(header);
+	}
+	/// Returns whether the given header belongs to a full snapshot, which can be the base of delta snapshots.
+	[[nodiscard]] static bool _is_full_snapshot(const _snapshot_header &header) {
+		return
+			!(header.flags & _snapshot_delta_flags) &&
+			header.num_particle_records == header.num_particles && header.num_body_records == header.num_bodies;
+	}
+	/// Reads the header of a snapshot and checks that the snapshot is complete. Returns \p std::nullopt if the
+	/// data is not a valid snapshot.
+	[[nodiscard]] static std::optional<_snapshot_header> _read_snapshot_header(std::span<const std::byte> data) {
+		if (data.size() < sizeof(_snapshot_header)) {
+			return std::nullopt;
+		}
+		_snapshot_header header;
+		std::memcpy(&header, data.data(), sizeof(_snapshot_header));
+		if (header.magic != _snapshot_magic || header.version != engine::snapshot_version) {
+			return std::nullopt;
+		}
+		if (data.size() < _get_snapshot_size(header)) {
+			return std::nullopt;
+		}
+		return header;
+	}
+
+
+	std::size_t engine::get_snapshot_size() const {
+		_snapshot_header header;
+		header.flags                = 0;
+		header.num_particle_records = static_cast<std::uint32_t>(particles.size());
+		header.num_body_records     = static_cast<std::uint32_t>(bodies.size());
+		header.num_springs          = static_cast<std::uint32_t>(particle_spring_constraints.size());
+		header.num_faces            = static_cast<std::uint32_t>(face_constraints.size());
+		header.num_bends            = static_cast<std::uint32_t>(bend_constraints.size());
+		header.num_isometric_bends  = static_cast<std::uint32_t>(isometric_bend_constraints.size());
+		header.num_contacts         = static_cast<std::uint32_t>(contact_constraints.size());
+		header.num_cached_contacts  = static_cast<std::uint32_t>(_contact_cache.size());
+		header.num_cached_gjk_pairs = static_cast<std::uint32_t>(_gjk_cache.size());
+		return _get_snapshot_size(header);
+	}
+
+	std::size_t engine::get_snapshot_delta_size() const {
+		return get_snapshot_size() + (particles.size() + bodies.size()) * sizeof(std::uint32_t);
+	}
+
+	std::size_t engine::save_snapshot(std::span<std::byte> buffer) const {
+		return _save_snapshot({}, buffer);
+	}
+
+	std::size_t engine::save_snapshot_delta(std::span<const std::byte> base, std::span<std::byte> buffer) const {
+		const auto base_header = _read_snapshot_header(base);
+		if (
+			!base_header || !_is_full_snapshot(base_header.value()) ||
+			base_header->num_particles != particles.size() || base_header->num_bodies != bodies.size()
+		) {
+			return 0;
+		}
+		const std::byte *base_bodies = base.data() + _get_snapshot_body_records_offset(base_header.value());
+		for (std::uint32_t i = 0; i < bodies.size(); ++i) {
+			const body_handle handle = bodies.get_handle(i);
+			if (std::memcmp(base_bodies + i * _snapshot_body_size, &handle, sizeof(body_handle)) != 0) {
+				return 0; // the bodies have changed since the base snapshot was taken
+			}
+		}
+		return _save_snapshot(base, buffer);
+	}
+
+	std::size_t engine::_save_snapshot(std::span<const std::byte> base, std::span<std::byte> buffer) const {
+		crash_if(
+			contact_lambdas.size() != contact_constraints.size() || _contact_keys.size() != contact_constraints.size()
+		);
+
+		const std::span<const body> all_bodies = bodies.get_objects();
+
+		_snapshot_header header;
+		header.magic                = _snapshot_magic;
+		header.version              = snapshot_version;
+		header.flags                = 0;
+		header.num_particles        = static_cast<std::uint32_t>(particles.size());
+		header.num_particle_records = header.num_particles;
+		header.num_bodies           = static_cast<std::uint32_t>(all_bodies.size());
+		header.num_body_records     = header.num_bodies;
+		header.num_springs          = static_cast<std::uint32_t>(particle_spring_constraints.size());
+		header.num_faces            = static_cast<std::uint32_t>(face_constraints.size());
+		header.num_bends            = static_cast<std::uint32_t>(bend_constraints.size());
+		header.num_isometric_bends  = static_cast<std::uint32_t>(isometric_bend_constraints.size());
+		header.num_contacts         = static_cast<std::uint32_t>(contact_constraints.size());
+		header.num_cached_contacts  = static_cast<std::uint32_t>(_contact_cache.size());
+		header.num_cached_gjk_pairs = static_cast<std::uint32_t>(_gjk_cache.size());
+		header.next_island          = _next_island;
+		// the number of records of delta snapshots is only known after comparing them against the base, so the
+		// size is checked against the upper bound
+		{
+			const std::size_t max_size =
+				_get_snapshot_size(header) +
+				(base.empty() ? 0 : (particles.size() + all_bodies.size()) * sizeof(std::uint32_t));
+			if (buffer.size() < max_size) {
+				return 0;
+			}
+		}
+
+		const std::byte *base_particles = nullptr;
+		const std::byte *base_bodies = nullptr;
+		if (!base.empty()) {
+			base_particles = base.data() + sizeof(_snapshot_header);
+			base_bodies = base_particles + particles.size() * _snapshot_particle_size;
+		}
+		_snapshot_writer writer{ buffer.data() + sizeof(_snapshot_header) };
+		header.num_particle_records = _write_snapshot_records(
+			writer, base_particles, _snapshot_particle_size, header.num_particles, [&](std::uint32_t i) {
+				_write_snapshot_particle(writer, particles[i]);
+			}
+		);
+		header.num_body_records = _write_snapshot_records(
+			writer, base_bodies, _snapshot_body_size, header.num_bodies, [&](std::uint32_t i) {
+				_write_snapshot_body(writer, bodies.get_handle(i), all_bodies[i]);
+			}
+		);
+		if (base_particles) {
+			header.flags |= _snapshot_particle_delta_flag;
+		}
+		if (base_bodies) {
+			header.flags |= _snapshot_body_delta_flag;
+		}
+
+		_write_snapshot_lambdas(writer, spring_lambdas, header.num_springs, 0.0f);
+		_write_snapshot_lambdas(writer, face_lambdas, header.num_faces, column_vector<6, scalar>(zero));
+		_write_snapshot_lambdas(writer, bend_lambdas, header.num_bends, 0.0f);
+		_write_snapshot_lambdas(writer, isometric_bend_lambdas, header.num_isometric_bends, 0.0f);
+		// Gauss-Seidel projection of face constraints starts from the result of the previous projection
+		for (const constraints::face &f : face_constraints) {
+			writer.write(f.state.prev_delta_lambda);
+		}
+
+		writer.write_array(std::span<const constraints::body_contact>(contact_constraints));
+		for (const auto &[lambda_n, lambda_t] : contact_lambdas) {
+			writer.write(lambda_n);
+			writer.write(lambda_t);
+		}
+		for (const _contact_key &key : _contact_keys) {
+			writer.write(key.body1);
+			writer.write(key.body2);
+			writer.write(key.feature1);
+			writer.write(key.feature2);
+		}
+		for (const _cached_contact &cached : _contact_cache) {
+			writer.write(cached.key.body1);
+			writer.write(cached.key.body2);
+			writer.write(cached.key.feature1);
+			writer.write(cached.key.feature2);
+			writer.write(cached.lambdas.first);
+			writer.write(cached.lambdas.second);
+		}
+		for (const _cached_gjk_pair &cached : _gjk_cache) {
+			writer.write(cached.bodies.first);
+			writer.write(cached.bodies.second);
+			writer.write(cached.cache);
+		}
+
+		std::memcpy(buffer.data(), &header, sizeof(_snapshot_header));
+		return static_cast<std::size_t>(writer.ptr - buffer.data());
+	}
+
+	bool engine::restore_snapshot(std::span<const std::byte> snapshot, std::span<const std::byte> base) {
+		const auto header = _read_snapshot_header(snapshot);
+		if (!header) {
+			return false;
+		}
+		if (
+			header->num_particles != particles.size() ||
+			header->num_bodies != bodies.size() ||
+			header->num_springs != particle_spring_constraints.size() ||
+			header->num_faces != face_constraints.size() ||
+			header->num_bends != bend_constraints.size() ||
+			header->num_isometric_bends != isometric_bend_constraints.size()
+		) {
+			return false;
+		}
+
+		// check that all particles and bodies match before modifying anything
+		const bool particle_delta = header->flags & _snapshot_particle_delta_flag;
+		const bool body_delta = header->flags & _snapshot_body_delta_flag;
+		const std::byte *particle_records = snapshot.data() + sizeof(_snapshot_header);
+		const std::byte *body_records = snapshot.data() + _get_snapshot_body_records_offset(header.value());
+		const std::byte *full_particle_records = particle_records;
+		const std::byte *full_body_records = body_records;
+		if (header->flags & _snapshot_delta_flags) {
+			const auto base_header = _read_snapshot_header(base);
+			if (
+				!base_header || !_is_full_snapshot(base_header.value()) ||
+				base_header->num_particles != header->num_particles || base_header->num_bodies != header->num_bodies
+			) {
+				return false;
+			}
+			if (particle_delta) {
+				full_particle_records = base.data() + sizeof(_snapshot_header);
+			}
+			if (body_delta) {
+				full_body_records = base.data() + _get_snapshot_body_records_offset(base_header.value());
+			}
+		}
+		if (
+			!_check_snapshot_records(
+				particle_records, particle_delta, header->num_particle_records, _snapshot_particle_size,
+				header->num_particles
+			) ||
+			!_check_snapshot_records(
+				body_records, body_delta, header->num_body_records, _snapshot_body_size, header->num_bodies
+			)
+		) {
+			return false;
+		}
+		for (std::uint32_t i = 0; i < header->num_bodies; ++i) {
+			const body_handle handle = bodies.get_handle(i);
+			if (std::memcmp(full_body_records + i * _snapshot_body_size, &handle, sizeof(body_handle)) != 0) {
+				return false;
+			}
+		}
+
+		_snapshot_reader reader{ particle_records };
+		_read_snapshot_records(
+			reader, full_particle_records, particle_delta, header->num_particle_records, header->num_particles,
+			[&](_snapshot_reader &record_reader, std::uint32_t i) {
+				_read_snapshot_particle(record_reader, particles[i]);
+			}
+		);
+		const std::span<body> all_bodies = bodies.get_objects();
+		_read_snapshot_records(
+			reader, full_body_records, body_delta, header->num_body_records, header->num_bodies,
+			[&](_snapshot_reader &record_reader, std::uint32_t i) {
+				record_reader.skip(sizeof(body_handle));
+				_read_snapshot_body(record_reader, all_bodies[i]);
+			}
+		);
+
+		spring_lambdas.resize(header->num_springs);
+		reader.read_array(std::span(spring_lambdas));
+		face_lambdas.resize(header->num_faces, uninitialized);
+		reader.read_array(std::span(face_lambdas));
+		bend_lambdas.resize(header->num_bends);
+		reader.read_array(std::span(bend_lambdas));
+		isometric_bend_lambdas.resize(header->num_isometric_bends);
+		reader.read_array(std::span(isometric_bend_lambdas));
+		for (constraints::face &f : face_constraints) {
+			f.state.prev_delta_lambda = reader.read<column_vector<6, scalar>>();
+		}
+
+		contact_constraints.resize(header->num_contacts, uninitialized);
+		reader.read_array(std::span(contact_constraints));
+		contact_lambdas.resize(header->num_contacts);
+		for (auto &[lambda_n, lambda_t] : contact_lambdas) {
+			lambda_n = reader.read<scalar>();
+			lambda_t = reader.read<scalar>();
+		}
+		_contact_keys.resize(header->num_contacts, uninitialized);
+		for (_contact_key &key : _contact_keys) {
+			key.body1    = reader.read<body_handle>();
+			key.body2    = reader.read<body_handle>();
+			key.feature1 = reader.read<collision::contact_feature>();
+			key.feature2 = reader.read<collision::contact_feature>();
+		}
+		// contacts of a restored snapshot are only used by the next time step to find persistent contacts
+		_speculative_contacts.assign(header->num_contacts, false);
+		_margin_contacts.assign(header->num_contacts, false);
+
+		_contact_cache.resize(header->num_cached_contacts, uninitialized);
+		for (_cached_contact &cached : _contact_cache) {
+			cached.key.body1      = reader.read<body_handle>();
+			cached.key.body2      = reader.read<body_handle>();
+			cached.key.feature1   = reader.read<collision::contact_feature>();
+			cached.key.feature2   = reader.read<collision::contact_feature>();
+			cached.lambdas.first  = reader.read<scalar>();
+			cached.lambdas.second = reader.read<scalar>();
+		}
+		_gjk_cache.clear();
+		_gjk_cache.reserve(header->num_cached_gjk_pairs);
+		for (std::uint32_t i = 0; i < header->num_cached_gjk_pairs; ++i) {
+			const auto body1 = reader.read<body_handle>();
+			const auto body2 = reader.read<body_handle>();
+			_gjk_cache.emplace_back(std::make_pair(body1, body2)).cache =
+				reader.read<collision::gjk_epa::pair_cache>();
+		}
+
+		_next_island = header->next_island;
+		return true;
+	}
+}
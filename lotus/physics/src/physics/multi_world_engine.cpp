@@ -0,0 +1,818 @@
+#include "lotus/physics/multi_world_engine.h"
+
+/// \file
+/// Implementation of the multi-world engine.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+
+#if !defined(LOTUS_PHYSICS_NO_SIMD) && defined(__AVX2__)
+#	define LOTUS_PHYSICS_MULTI_WORLD_AVX2
+#	include <immintrin.h>
+#elif !defined(LOTUS_PHYSICS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64))
+#	define LOTUS_PHYSICS_MULTI_WORLD_SSE2
+#	include <emmintrin.h>
+#endif
+
+namespace lotus::physics {
+	constexpr static std::size_t _block_size = multi_world_engine::block_size; ///< Shorthand for the block size.
+
+	/// Values of a scalar in all worlds of a block.
+	struct _lanes {
+		static_assert(_block_size == 8, "The SIMD backends assume that a block contains eight worlds");
+
+		/// No initialization, so that arrays of this type can be declared.
+		_lanes() = default;
+
+		/// Loads values from the given array.
+		[[nodiscard]] static _lanes load(const scalar *p) {
+			_lanes result;
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+			result._v = _mm256_loadu_ps(p);
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+			result._lo = _mm_loadu_ps(p);
+			result._hi = _mm_loadu_ps(p + 4);
+#else
+			std::copy_n(p, _block_size, result._v.begin());
+#endif
+			return result;
+		}
+		/// Returns an object where all values are the same.
+		[[nodiscard]] static _lanes broadcast(scalar x) {
+			_lanes result;
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+			result._v = _mm256_set1_ps(x);
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+			result._lo = result._hi = _mm_set1_ps(x);
+#else
+			result._v.fill(x);
+#endif
+			return result;
+		}
+		/// Stores all values into the given array.
+		void store(scalar *p) const {
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+			_mm256_storeu_ps(p, _v);
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+			_mm_storeu_ps(p, _lo);
+			_mm_storeu_ps(p + 4, _hi);
+#else
+			std::copy(_v.begin(), _v.end(), p);
+#endif
+		}
+
+		/// Element-wise addition.
+		[[nodiscard]] friend _lanes operator+(_lanes lhs, _lanes rhs) {
+			return _apply(lhs, rhs,
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+				_mm256_add_ps
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+				_mm_add_ps
+#else
+				std::plus<scalar>()
+#endif
+			);
+		}
+		/// Element-wise subtraction.
+		[[nodiscard]] friend _lanes operator-(_lanes lhs, _lanes rhs) {
+			return _apply(lhs, rhs,
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+				_mm256_sub_ps
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+				_mm_sub_ps
+#else
+				std::minus<scalar>()
+#endif
+			);
+		}
+		/// Element-wise multiplication.
+		[[nodiscard]] friend _lanes operator*(_lanes lhs, _lanes rhs) {
+			return _apply(lhs, rhs,
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+				_mm256_mul_ps
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+				_mm_mul_ps
+#else
+				std::multiplies<scalar>()
+#endif
+			);
+		}
+		/// Element-wise division.
+		[[nodiscard]] friend _lanes operator/(_lanes lhs, _lanes rhs) {
+			return _apply(lhs, rhs,
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+				_mm256_div_ps
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+				_mm_div_ps
+#else
+				std::divides<scalar>()
+#endif
+			);
+		}
+		/// Element-wise maximum.
+		[[nodiscard]] friend _lanes max(_lanes lhs, _lanes rhs) {
+			return _apply(lhs, rhs,
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+				_mm256_max_ps
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+				_mm_max_ps
+#else
+				[](scalar a, scalar b) {
+					return std::max(a, b);
+				}
+#endif
+			);
+		}
+		/// Negation.
+		[[nodiscard]] friend _lanes operator-(_lanes x) {
+			return broadcast(0.0f) - x;
+		}
+		/// Element-wise square root.
+		[[nodiscard]] friend _lanes sqrt(_lanes x) {
+			_lanes result;
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+			result._v = _mm256_sqrt_ps(x._v);
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+			result._lo = _mm_sqrt_ps(x._lo);
+			result._hi = _mm_sqrt_ps(x._hi);
+#else
+			for (std::size_t i = 0; i < _block_size; ++i) {
+				result._v[i] = std::sqrt(x._v[i]);
+			}
+#endif
+			return result;
+		}
+		/// Returns the values of \p x where \p cond is at least \p threshold, and zero elsewhere.
+		[[nodiscard]] friend _lanes select_at_least(_lanes cond, scalar threshold, _lanes x) {
+			_lanes result;
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+			result._v = _mm256_and_ps(_mm256_cmp_ps(cond._v, _mm256_set1_ps(threshold), _CMP_GE_OQ), x._v);
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+			const __m128 t = _mm_set1_ps(threshold);
+			result._lo = _mm_and_ps(_mm_cmpge_ps(cond._lo, t), x._lo);
+			result._hi = _mm_and_ps(_mm_cmpge_ps(cond._hi, t), x._hi);
+#else
+			for (std::size_t i = 0; i < _block_size; ++i) {
+				result._v[i] = cond._v[i] >= threshold ? x._v[i] : 0.0f;
+			}
+#endif
+			return result;
+		}
+	private:
+		/// Applies the given binary operation to all elements.
+		template <typename Op> [[nodiscard]] static _lanes _apply(_lanes lhs, _lanes rhs, Op &&op) {
+			_lanes result;
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+			result._v = op(lhs._v, rhs._v);
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+			result._lo = op(lhs._lo, rhs._lo);
+			result._hi = op(lhs._hi, rhs._hi);
+#else
+			for (std::size_t i = 0; i < _block_size; ++i) {
+				result._v[i] = op(lhs._v[i], rhs._v[i]);
+			}
+#endif
+			return result;
+		}
+
+#if defined(LOTUS_PHYSICS_MULTI_WORLD_AVX2)
+		__m256 _v; ///< All values.
+#elif defined(LOTUS_PHYSICS_MULTI_WORLD_SSE2)
+		__m128 _lo; ///< The first half of the values.
+		__m128 _hi; ///< The second half of the values.
+#else
+		std::array<scalar, _block_size> _v; ///< All values.
+#endif
+	};
+
+	/// Values of a vector in all worlds of a block.
+	struct _lanes3 {
+		/// Loads the three coordinates stored one after another at the given address.
+		[[nodiscard]] static _lanes3 load(const scalar *p) {
+			return { _lanes::load(p), _lanes::load(p + _block_size), _lanes::load(p + 2 * _block_size) };
+		}
+		/// Stores the three coordinates one after another at the given address.
+		void store(scalar *p) const {
+			x.store(p);
+			y.store(p + _block_size);
+			z.store(p + 2 * _block_size);
+		}
+
+		/// Element-wise addition.
+		[[nodiscard]] friend _lanes3 operator+(const _lanes3 &lhs, const _lanes3 &rhs) {
+			return { lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z };
+		}
+		/// Element-wise subtraction.
+		[[nodiscard]] friend _lanes3 operator-(const _lanes3 &lhs, const _lanes3 &rhs) {
+			return { lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z };
+		}
+		/// Scaling.
+		[[nodiscard]] friend _lanes3 operator*(const _lanes3 &lhs, _lanes rhs) {
+			return { lhs.x * rhs, lhs.y * rhs, lhs.z * rhs };
+		}
+		/// Scaling.
+		[[nodiscard]] friend _lanes3 operator*(_lanes lhs, const _lanes3 &rhs) {
+			return rhs * lhs;
+		}
+		/// Division by a scalar.
+		[[nodiscard]] friend _lanes3 operator/(const _lanes3 &lhs, _lanes rhs) {
+			return { lhs.x / rhs, lhs.y / rhs, lhs.z / rhs };
+		}
+
+		/// Dot product.
+		[[nodiscard]] friend _lanes dot(const _lanes3 &lhs, const _lanes3 &rhs) {
+			return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+		}
+		/// Cross product.
+		[[nodiscard]] friend _lanes3 cross(const _lanes3 &lhs, const _lanes3 &rhs) {
+			return {
+				lhs.y * rhs.z - lhs.z * rhs.y,
+				lhs.z * rhs.x - lhs.x * rhs.z,
+				lhs.x * rhs.y - lhs.y * rhs.x
+			};
+		}
+		/// Returns the length of the vector.
+		[[nodiscard]] friend _lanes norm(const _lanes3 &v) {
+			return sqrt(dot(v, v));
+		}
+
+		_lanes x; ///< X coordinates.
+		_lanes y; ///< Y coordinates.
+		_lanes z; ///< Z coordinates.
+	};
+
+	/// Returns the offset of the coordinates of the given particle in the arrays of a block.
+	[[nodiscard]] constexpr static std::size_t _particle_offset(std::size_t particle) {
+		return particle * 3 * _block_size;
+	}
+	/// Returns the position of a particle in a single world, given the address of its coordinates.
+	[[nodiscard]] static vec3 _get_lane(const scalar *p, std::size_t lane) {
+		return vec3(p[lane], p[_block_size + lane], p[2 * _block_size + lane]);
+	}
+	/// Sets the position of a particle in a single world, given the address of its coordinates.
+	static void _set_lane(scalar *p, std::size_t lane, vec3 v) {
+		p[lane] = v[0];
+		p[_block_size + lane] = v[1];
+		p[2 * _block_size + lane] = v[2];
+	}
+
+	/// Resizes the array to hold \p count values for all worlds of a block, and sets all worlds to the same
+	/// values.
+	template <typename Get> static void _fill_lanes(std::vector<scalar> &arr, std::size_t count, Get &&get) {
+		arr.resize(count * _block_size);
+		for (std::size_t i = 0; i < count; ++i) {
+			std::fill_n(arr.begin() + i * _block_size, _block_size, get(i));
+		}
+	}
+
+
+	multi_world_engine multi_world_engine::create(const engine &e, std::size_t num_worlds) {
+		multi_world_engine result;
+		result._num_worlds                     = num_worlds;
+		result.bodies                          = e.bodies;
+		result.gravity                         = e.gravity;
+		result.face_constraint_projection_type = e.face_constraint_projection_type;
+		result.particle_collision_margin       = e.particle_collision_margin;
+		result.worker_pool                     = e.worker_pool;
+
+		for (const particle &p : e.particles) {
+			result._inverse_masses.emplace_back(p.properties.inverse_mass);
+		}
+		result._springs         = e.particle_spring_constraints;
+		result._faces           = e.face_constraints;
+		result._bends           = e.bend_constraints;
+		result._isometric_bends = e.isometric_bend_constraints;
+
+		const std::size_t num_particles = e.particles.size();
+		result._blocks.resize((num_worlds + block_size - 1) / block_size);
+		for (std::size_t i = 0; i < result._blocks.size(); ++i) {
+			_block &b = result._blocks[i];
+			b.num_worlds = std::min(block_size, num_worlds - i * block_size);
+			_fill_lanes(b.positions, 3 * num_particles, [&](std::size_t i) {
+				return e.particles[i / 3].state.position[i % 3];
+			});
+			_fill_lanes(b.prev_positions, 3 * num_particles, [&](std::size_t i) {
+				return e.particles[i / 3].prev_position[i % 3];
+			});
+			_fill_lanes(b.velocities, 3 * num_particles, [&](std::size_t i) {
+				return e.particles[i / 3].state.velocity[i % 3];
+			});
+
+			b.spring_lambdas.resize(e.particle_spring_constraints.size() * block_size);
+			b.face_lambdas.resize(6 * e.face_constraints.size() * block_size);
+			_fill_lanes(b.face_prev_delta_lambdas, 6 * e.face_constraints.size(), [&](std::size_t i) {
+				return e.face_constraints[i / 6].state.prev_delta_lambda[i % 6];
+			});
+			b.bend_lambdas.resize(e.bend_constraints.size() * block_size);
+			b.isometric_bend_lambdas.resize(e.isometric_bend_constraints.size() * block_size);
+
+			_fill_lanes(b.spring_inverse_stiffness_scale, 1, [](std::size_t) {
+				return 1.0f;
+			});
+			_fill_lanes(b.face_inverse_stiffness, 36 * e.face_constraints.size(), [&](std::size_t i) {
+				return e.face_constraints[i / 36].properties.inverse_stiffness((i % 36) / 6, i % 6);
+			});
+			_fill_lanes(b.bend_inverse_stiffness, e.bend_constraints.size(), [&](std::size_t i) {
+				return e.bend_constraints[i].properties.inverse_stiffness;
+			});
+			_fill_lanes(b.isometric_bend_inverse_stiffness, e.isometric_bend_constraints.size(), [&](std::size_t i) {
+				return e.isometric_bend_constraints[i].properties.inverse_stiffness;
+			});
+		}
+		return result;
+	}
+
+	void multi_world_engine::timestep(scalar dt, std::uint32_t iters) {
+		_predict_bodies(dt);
+		if (worker_pool) {
+			worker_pool->parallel_for(_blocks.size(), 1, [&](std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; ++i) {
+					_timestep_block(_blocks[i], dt, iters);
+				}
+			});
+		} else {
+			for (_block &b : _blocks) {
+				_timestep_block(b, dt, iters);
+			}
+		}
+		_update_body_velocities(dt);
+	}
+
+	particle_state multi_world_engine::get_particle_state(std::size_t world, std::size_t particle) const {
+		const _block &b = _blocks[world / block_size];
+		const std::size_t offset = _particle_offset(particle);
+		return particle_state::at(
+			_get_lane(b.positions.data() + offset, world % block_size),
+			_get_lane(b.velocities.data() + offset, world % block_size)
+		);
+	}
+
+	void multi_world_engine::set_particle_state(std::size_t world, std::size_t particle, particle_state st) {
+		_block &b = _blocks[world / block_size];
+		const std::size_t offset = _particle_offset(particle);
+		_set_lane(b.positions.data() + offset, world % block_size, st.position);
+		_set_lane(b.velocities.data() + offset, world % block_size, st.velocity);
+	}
+
+	scalar multi_world_engine::get_spring_inverse_stiffness_scale(std::size_t world) const {
+		return _blocks[world / block_size].spring_inverse_stiffness_scale[world % block_size];
+	}
+
+	void multi_world_engine::set_spring_inverse_stiffness_scale(std::size_t world, scalar scale) {
+		_blocks[world / block_size].spring_inverse_stiffness_scale[world % block_size] = scale;
+	}
+
+	constraints::face::constraint_properties multi_world_engine::get_face_properties(
+		std::size_t world, std::size_t face
+	) const {
+		const scalar *inv_k =
+			_blocks[world / block_size].face_inverse_stiffness.data() + face * 36 * block_size + world % block_size;
+		constraints::face::constraint_properties result = uninitialized;
+		for (std::size_t y = 0; y < 6; ++y) {
+			for (std::size_t x = 0; x < 6; ++x) {
+				result.inverse_stiffness(y, x) = inv_k[(y * 6 + x) * block_size];
+			}
+		}
+		return result;
+	}
+
+	void multi_world_engine::set_face_properties(
+		std::size_t world, std::size_t face, const constraints::face::constraint_properties &props
+	) {
+		scalar *inv_k =
+			_blocks[world / block_size].face_inverse_stiffness.data() + face * 36 * block_size + world % block_size;
+		for (std::size_t y = 0; y < 6; ++y) {
+			for (std::size_t x = 0; x < 6; ++x) {
+				inv_k[(y * 6 + x) * block_size] = props.inverse_stiffness(y, x);
+			}
+		}
+	}
+
+	constraints::bend::constraint_properties multi_world_engine::get_bend_properties(
+		std::size_t world, std::size_t bend
+	) const {
+		constraints::bend::constraint_properties result = uninitialized;
+		result.inverse_stiffness =
+			_blocks[world / block_size].bend_inverse_stiffness[bend * block_size + world % block_size];
+		return result;
+	}
+
+	void multi_world_engine::set_bend_properties(
+		std::size_t world, std::size_t bend, const constraints::bend::constraint_properties &props
+	) {
+		_blocks[world / block_size].bend_inverse_stiffness[bend * block_size + world % block_size] =
+			props.inverse_stiffness;
+	}
+
+	constraints::isometric_bend::constraint_properties multi_world_engine::get_isometric_bend_properties(
+		std::size_t world, std::size_t bend
+	) const {
+		constraints::isometric_bend::constraint_properties result = uninitialized;
+		result.inverse_stiffness =
+			_blocks[world / block_size].isometric_bend_inverse_stiffness[bend * block_size + world % block_size];
+		return result;
+	}
+
+	void multi_world_engine::set_isometric_bend_properties(
+		std::size_t world, std::size_t bend, const constraints::isometric_bend::constraint_properties &props
+	) {
+		_blocks[world / block_size].isometric_bend_inverse_stiffness[bend * block_size + world % block_size] =
+			props.inverse_stiffness;
+	}
+
+	void multi_world_engine::_predict_bodies(scalar dt) {
+		for (body &b : bodies) {
+			if (b.properties.inverse_mass != 0.0f) {
+				continue;
+			}
+			b.prev_position = b.state.position;
+			b.state.position += dt * b.state.linear_velocity;
+			b.prev_rotation = b.state.rotation;
+			b.state.rotation = quat::unsafe_normalize(
+				b.state.rotation + 0.5f * dt * quats::from_vector(b.state.angular_velocity) * b.state.rotation
+			);
+		}
+	}
+
+	void multi_world_engine::_update_body_velocities(scalar dt) {
+		for (body &b : bodies) {
+			if (b.properties.inverse_mass != 0.0f) {
+				continue;
+			}
+			b.prev_linear_velocity = b.state.linear_velocity;
+			b.prev_angular_velocity = b.state.angular_velocity;
+			b.state.linear_velocity = (b.state.position - b.prev_position) / dt;
+			auto dq = b.state.rotation * b.prev_rotation.inverse();
+			b.state.angular_velocity = dq.axis() * (2.0f / dt);
+			if (dq.w() < 0.0f) {
+				b.state.angular_velocity = -b.state.angular_velocity;
+			}
+		}
+	}
+
+	void multi_world_engine::_timestep_block(_block &b, scalar dt, std::uint32_t iters) const {
+		const _lanes vdt = _lanes::broadcast(dt);
+		const _lanes3 delta_v{
+			_lanes::broadcast(dt * gravity[0]), _lanes::broadcast(dt * gravity[1]), _lanes::broadcast(dt * gravity[2])
+		};
+		for (std::size_t i = 0; i < _inverse_masses.size(); ++i) {
+			const std::size_t offset = _particle_offset(i);
+			const _lanes3 x = _lanes3::load(b.positions.data() + offset);
+			_lanes3 v = _lanes3::load(b.velocities.data() + offset);
+			if (_inverse_masses[i] > 0.0f) {
+				v = v + delta_v;
+				v.store(b.velocities.data() + offset);
+			}
+			x.store(b.prev_positions.data() + offset);
+			(x + vdt * v).store(b.positions.data() + offset);
+		}
+
+		std::fill(b.spring_lambdas.begin(), b.spring_lambdas.end(), 0.0f);
+		std::fill(b.face_lambdas.begin(), b.face_lambdas.end(), 0.0f);
+		std::fill(b.bend_lambdas.begin(), b.bend_lambdas.end(), 0.0f);
+		std::fill(b.isometric_bend_lambdas.begin(), b.isometric_bend_lambdas.end(), 0.0f);
+
+		_gather_collision_candidates(b);
+		const scalar inv_dt2 = 1.0f / (dt * dt);
+		for (std::uint32_t i = 0; i < iters; ++i) {
+			_handle_collisions(b);
+			_project_constraints(b, inv_dt2);
+		}
+
+		for (std::size_t i = 0; i < _inverse_masses.size(); ++i) {
+			const std::size_t offset = _particle_offset(i);
+			const _lanes3 x = _lanes3::load(b.positions.data() + offset);
+			const _lanes3 prev_x = _lanes3::load(b.prev_positions.data() + offset);
+			((x - prev_x) / vdt).store(b.velocities.data() + offset);
+		}
+	}
+
+	void multi_world_engine::_gather_collision_candidates(_block &b) const {
+		b.collision_bodies.clear();
+		b.collision_offsets.assign(1, 0);
+		b.collision_candidates.clear();
+
+		scalar max_displacement2 = 0.0f;
+		for (std::size_t i = 0; i < b.positions.size(); i += 3 * block_size) {
+			for (std::size_t lane = 0; lane < b.num_worlds; ++lane) {
+				const vec3 x = _get_lane(b.positions.data() + i, lane);
+				const vec3 prev_x = _get_lane(b.prev_positions.data() + i, lane);
+				max_displacement2 = std::max(max_displacement2, (x - prev_x).squared_norm());
+			}
+		}
+		const scalar margin = particle_collision_margin + std::sqrt(max_displacement2);
+
+		for (std::uint32_t bi = 0; bi < bodies.size(); ++bi) {
+			const body &collider = bodies.get_objects()[bi];
+			if (collider.properties.inverse_mass != 0.0f) {
+				continue;
+			}
+			collision::bounding_box bounds = collider.body_shape->get_bounds(collider.state);
+			bounds.min -= vec3(margin, margin, margin);
+			bounds.max += vec3(margin, margin, margin);
+			const std::size_t first = b.collision_candidates.size();
+			for (std::uint32_t i = 0; i < _inverse_masses.size(); ++i) {
+				for (std::size_t lane = 0; lane < b.num_worlds; ++lane) {
+					const vec3 x = _get_lane(b.positions.data() + _particle_offset(i), lane);
+					if (
+						x[0] >= bounds.min[0] && x[1] >= bounds.min[1] && x[2] >= bounds.min[2] &&
+						x[0] <= bounds.max[0] && x[1] <= bounds.max[1] && x[2] <= bounds.max[2]
+					) {
+						b.collision_candidates.emplace_back(i);
+						break;
+					}
+				}
+			}
+			if (b.collision_candidates.size() > first) {
+				b.collision_bodies.emplace_back(bi);
+				b.collision_offsets.emplace_back(static_cast<std::uint32_t>(b.collision_candidates.size()));
+			}
+		}
+	}
+
+	void multi_world_engine::_handle_collisions(_block &b) const {
+		for (std::size_t i = 0; i < b.collision_bodies.size(); ++i) {
+			const body &collider = bodies.get_objects()[b.collision_bodies[i]];
+			std::visit(
+				[&](const auto &shape) {
+					const std::uint32_t end = b.collision_offsets[i + 1];
+					for (std::uint32_t j = b.collision_offsets[i]; j < end; ++j) {
+						scalar *x = b.positions.data() + _particle_offset(b.collision_candidates[j]);
+						for (std::size_t lane = 0; lane < b.num_worlds; ++lane) {
+							vec3 pos = _get_lane(x, lane);
+							if (engine::handle_shape_particle_collision(shape, collider.state, pos)) {
+								_set_lane(x, lane, pos);
+							}
+						}
+					}
+				},
+				collider.body_shape->value
+			);
+		}
+	}
+
+	/// Projects a face constraint in all worlds of a block using one Gauss-Seidel iteration. This performs the
+	/// same computation as \ref constraints::face::project(), but the Jacobian is computed element by element.
+	static void _project_face_gauss_seidel(
+		const constraints::face &f, _lanes3 &p1, _lanes3 &p2, _lanes3 &p3, const std::array<scalar, 3> &inv_m,
+		scalar inv_dt2, const scalar *inv_stiffness, scalar *lambda, scalar *prev_delta_lambda
+	) {
+		const _lanes3 d1 = p2 - p1;
+		const _lanes3 d2 = p3 - p1;
+		const _lanes3 d1_norm = d1 / norm(d1);
+		const _lanes3 normal = cross(d1, d2);
+		const _lanes3 normal_norm = normal / norm(normal);
+		const _lanes sqrt_vol = _lanes::broadcast(f.state.sqrt_volume);
+
+		// rows of the rotation matrix from world to surface space
+		const std::array<_lanes3, 3> r{ d1_norm, cross(normal_norm, d1_norm), normal_norm };
+		const mat33s &inv_config = f.state.inverse_configuration;
+		_lanes def[3][3]; // deformation gradient
+		for (std::size_t y = 0; y < 3; ++y) {
+			const _lanes r_d1 = dot(r[y], d1);
+			const _lanes r_d2 = dot(r[y], d2);
+			for (std::size_t x = 0; x < 3; ++x) {
+				def[y][x] = r_d1 * _lanes::broadcast(inv_config(0, x)) + r_d2 * _lanes::broadcast(inv_config(1, x));
+				if (y == 2) {
+					def[y][x] = def[y][x] + _lanes::broadcast(inv_config(2, x));
+				}
+			}
+		}
+
+		// pairs of columns of the deformation gradient that each strain component depends on
+		constexpr std::size_t pairs[6][2]{ { 0, 0 }, { 1, 1 }, { 2, 2 }, { 0, 1 }, { 0, 2 }, { 1, 2 } };
+		_lanes c[6];
+		for (std::size_t k = 0; k < 6; ++k) {
+			const std::size_t a = pairs[k][0];
+			const std::size_t b = pairs[k][1];
+			_lanes g = def[0][a] * def[0][b] + def[1][a] * def[1][b] + def[2][a] * def[2][b];
+			if (a == b) {
+				g = g - _lanes::broadcast(1.0f);
+			}
+			c[k] = _lanes::broadcast(0.5f) * g * sqrt_vol;
+		}
+
+		// rows of the transposed deformation gradient, scaled by the square root of the volume
+		_lanes f2_t[3][3];
+		for (std::size_t y = 0; y < 3; ++y) {
+			for (std::size_t x = 0; x < 3; ++x) {
+				f2_t[y][x] = def[x][y] * sqrt_vol;
+			}
+		}
+		const mat33s &df_dx = f.state.deformation_gradient_derivatives;
+		_lanes dep_dx[6][9];
+		_lanes dep_dx_t_over_m[9][6];
+		for (std::size_t k = 0; k < 6; ++k) {
+			const std::size_t a = pairs[k][0];
+			const std::size_t b = pairs[k][1];
+			for (std::size_t p = 0; p < 3; ++p) {
+				for (std::size_t x = 0; x < 3; ++x) {
+					if (a == b) {
+						dep_dx[k][p * 3 + x] = _lanes::broadcast(df_dx(a, p)) * f2_t[a][x];
+					} else {
+						dep_dx[k][p * 3 + x] =
+							_lanes::broadcast(0.5f * df_dx(a, p)) * f2_t[b][x] +
+							_lanes::broadcast(0.5f * df_dx(b, p)) * f2_t[a][x];
+					}
+					dep_dx_t_over_m[p * 3 + x][k] = dep_dx[k][p * 3 + x] * _lanes::broadcast(inv_m[p]);
+				}
+			}
+		}
+
+		const _lanes vinv_dt2 = _lanes::broadcast(inv_dt2);
+		_lanes lambdas[6];
+		_lanes rhs[6];
+		for (std::size_t y = 0; y < 6; ++y) {
+			lambdas[y] = _lanes::load(lambda + y * _block_size);
+		}
+		for (std::size_t y = 0; y < 6; ++y) {
+			_lanes k_lambda = _lanes::broadcast(0.0f);
+			for (std::size_t x = 0; x < 6; ++x) {
+				k_lambda = k_lambda + _lanes::load(inv_stiffness + (y * 6 + x) * _block_size) * (lambdas[x] * vinv_dt2);
+			}
+			rhs[y] = -(c[y] + k_lambda);
+		}
+		_lanes lhs[6][6];
+		for (std::size_t y = 0; y < 6; ++y) {
+			for (std::size_t x = y; x < 6; ++x) {
+				_lanes sum = _lanes::broadcast(0.0f);
+				for (std::size_t k = 0; k < 9; ++k) {
+					sum = sum + dep_dx[y][k] * dep_dx_t_over_m[k][x];
+				}
+				lhs[y][x] = sum;
+				lhs[x][y] = sum;
+			}
+		}
+		for (std::size_t y = 0; y < 6; ++y) {
+			for (std::size_t x = 0; x < 6; ++x) {
+				lhs[y][x] = lhs[y][x] + _lanes::load(inv_stiffness + (y * 6 + x) * _block_size) * vinv_dt2;
+			}
+		}
+
+		_lanes delta_lambda[6];
+		for (std::size_t y = 0; y < 6; ++y) {
+			delta_lambda[y] = _lanes::load(prev_delta_lambda + y * _block_size);
+		}
+		for (std::size_t y = 0; y < 6; ++y) {
+			_lanes sum = rhs[y];
+			for (std::size_t x = 0; x < 6; ++x) {
+				if (x != y) {
+					sum = sum - lhs[y][x] * delta_lambda[x];
+				}
+			}
+			delta_lambda[y] = sum / lhs[y][y];
+		}
+		for (std::size_t y = 0; y < 6; ++y) {
+			delta_lambda[y].store(prev_delta_lambda + y * _block_size);
+			(lambdas[y] + delta_lambda[y]).store(lambda + y * _block_size);
+		}
+
+		// the corrections are in surface space; the columns of the inverse rotation are the rows of r
+		std::array<_lanes3*, 3> ps{ &p1, &p2, &p3 };
+		for (std::size_t p = 0; p < 3; ++p) {
+			_lanes delta_x[3];
+			for (std::size_t x = 0; x < 3; ++x) {
+				delta_x[x] = _lanes::broadcast(0.0f);
+				for (std::size_t k = 0; k < 6; ++k) {
+					delta_x[x] = delta_x[x] + dep_dx_t_over_m[p * 3 + x][k] * delta_lambda[k];
+				}
+			}
+			*ps[p] = *ps[p] + (r[0] * delta_x[0] + r[1] * delta_x[1] + r[2] * delta_x[2]);
+		}
+	}
+
+	void multi_world_engine::_project_constraints(_block &b, scalar inv_dt2) const {
+		const _lanes vinv_dt2 = _lanes::broadcast(inv_dt2);
+		scalar *const positions = b.positions.data();
+
+		const _lanes spring_scale = _lanes::load(b.spring_inverse_stiffness_scale.data());
+		for (std::size_t j = 0; j < _springs.size(); ++j) {
+			const constraints::particle_spring &s = _springs[j];
+			scalar *const px1 = positions + _particle_offset(s.particle1);
+			scalar *const px2 = positions + _particle_offset(s.particle2);
+			const _lanes inv_m1 = _lanes::broadcast(_inverse_masses[s.particle1]);
+			const _lanes inv_m2 = _lanes::broadcast(_inverse_masses[s.particle2]);
+			const _lanes3 x1 = _lanes3::load(px1);
+			const _lanes3 x2 = _lanes3::load(px2);
+
+			const _lanes3 t = x2 - x1;
+			const _lanes t_len = norm(t);
+			const _lanes c = t_len - _lanes::broadcast(s.properties.length);
+			const _lanes inv_k_dt2 = _lanes::broadcast(s.properties.inverse_stiffness) * spring_scale * vinv_dt2;
+			const _lanes lambda = _lanes::load(b.spring_lambdas.data() + j * block_size);
+			const _lanes delta_lambda = -(c + inv_k_dt2 * lambda) / (inv_m1 + inv_m2 + inv_k_dt2);
+			(lambda + delta_lambda).store(b.spring_lambdas.data() + j * block_size);
+			const _lanes3 dx = (delta_lambda / t_len) * t;
+			(x1 - inv_m1 * dx).store(px1);
+			(x2 + inv_m2 * dx).store(px2);
+		}
+
+		const bool simd_faces = face_constraint_projection_type == constraints::face::projection_type::gauss_seidel;
+		for (std::size_t j = 0; j < _faces.size(); ++j) {
+			const constraints::face &f = _faces[j];
+			scalar *const px1 = positions + _particle_offset(f.particle1);
+			scalar *const px2 = positions + _particle_offset(f.particle2);
+			scalar *const px3 = positions + _particle_offset(f.particle3);
+			scalar *const lambda = b.face_lambdas.data() + j * 6 * block_size;
+			const scalar *const inv_stiffness = b.face_inverse_stiffness.data() + j * 36 * block_size;
+			const std::array<scalar, 3> inv_m{
+				_inverse_masses[f.particle1], _inverse_masses[f.particle2], _inverse_masses[f.particle3]
+			};
+			if (simd_faces) {
+				_lanes3 x1 = _lanes3::load(px1);
+				_lanes3 x2 = _lanes3::load(px2);
+				_lanes3 x3 = _lanes3::load(px3);
+				_project_face_gauss_seidel(
+					f, x1, x2, x3, inv_m, inv_dt2, inv_stiffness, lambda,
+					b.face_prev_delta_lambdas.data() + j * 6 * block_size
+				);
+				x1.store(px1);
+				x2.store(px2);
+				x3.store(px3);
+				continue;
+			}
+			// other projection types solve a linear system, which is done world by world
+			constraints::face lane_face = f;
+			for (std::size_t lane = 0; lane < b.num_worlds; ++lane) {
+				for (std::size_t k = 0; k < 36; ++k) {
+					lane_face.properties.inverse_stiffness(k / 6, k % 6) = inv_stiffness[k * block_size + lane];
+				}
+				column_vector<6, scalar> lane_lambda = uninitialized;
+				for (std::size_t k = 0; k < 6; ++k) {
+					lane_lambda[k] = lambda[k * block_size + lane];
+				}
+				vec3 x1 = _get_lane(px1, lane);
+				vec3 x2 = _get_lane(px2, lane);
+				vec3 x3 = _get_lane(px3, lane);
+				lane_face.project(
+					x1, x2, x3, inv_m[0], inv_m[1], inv_m[2], inv_dt2, lane_lambda, face_constraint_projection_type
+				);
+				_set_lane(px1, lane, x1);
+				_set_lane(px2, lane, x2);
+				_set_lane(px3, lane, x3);
+				for (std::size_t k = 0; k < 6; ++k) {
+					lambda[k * block_size + lane] = lane_lambda[k];
+				}
+			}
+		}
+
+		// dihedral angles require trigonometric functions, so bends are projected world by world
+		for (std::size_t j = 0; j < _bends.size(); ++j) {
+			constraints::bend lane_bend = _bends[j];
+			scalar *const px1 = positions + _particle_offset(lane_bend.particle_edge1);
+			scalar *const px2 = positions + _particle_offset(lane_bend.particle_edge2);
+			scalar *const px3 = positions + _particle_offset(lane_bend.particle3);
+			scalar *const px4 = positions + _particle_offset(lane_bend.particle4);
+			for (std::size_t lane = 0; lane < b.num_worlds; ++lane) {
+				lane_bend.properties.inverse_stiffness = b.bend_inverse_stiffness[j * block_size + lane];
+				vec3 x1 = _get_lane(px1, lane);
+				vec3 x2 = _get_lane(px2, lane);
+				vec3 x3 = _get_lane(px3, lane);
+				vec3 x4 = _get_lane(px4, lane);
+				lane_bend.project(
+					x1, x2, x3, x4,
+					_inverse_masses[lane_bend.particle_edge1], _inverse_masses[lane_bend.particle_edge2],
+					_inverse_masses[lane_bend.particle3], _inverse_masses[lane_bend.particle4],
+					inv_dt2, b.bend_lambdas[j * block_size + lane]
+				);
+				_set_lane(px1, lane, x1);
+				_set_lane(px2, lane, x2);
+				_set_lane(px3, lane, x3);
+				_set_lane(px4, lane, x4);
+			}
+		}
+
+		for (std::size_t j = 0; j < _isometric_bends.size(); ++j) {
+			const constraints::isometric_bend &ib = _isometric_bends[j];
+			const _lanes alpha_hat =
+				_lanes::load(b.isometric_bend_inverse_stiffness.data() + j * block_size) * vinv_dt2;
+			const std::array<std::size_t, 4> indices{
+				ib.particle_edge1, ib.particle_edge2, ib.particle3, ib.particle4
+			};
+			std::array<_lanes3, 4> xs;
+			const _lanes zero_lanes = _lanes::broadcast(0.0f);
+			_lanes3 h{ zero_lanes, zero_lanes, zero_lanes };
+			scalar w = 0.0f;
+			for (std::size_t k = 0; k < 4; ++k) {
+				xs[k] = _lanes3::load(positions + _particle_offset(indices[k]));
+				h = h + _lanes::broadcast(ib.state.coefficients[k]) * xs[k];
+				w += _inverse_masses[indices[k]] * ib.state.coefficients[k] * ib.state.coefficients[k];
+			}
+			constexpr scalar min_curvature = 1e-6f; // the gradient is undefined below this
+			const _lanes h_norm = norm(h);
+			const _lanes c = h_norm - _lanes::broadcast(ib.state.rest_curvature);
+			const _lanes lambda = _lanes::load(b.isometric_bend_lambdas.data() + j * block_size);
+			const _lanes delta_lambda = select_at_least(
+				h_norm, min_curvature, -(c + alpha_hat * lambda) / (_lanes::broadcast(w) + alpha_hat)
+			);
+			(lambda + delta_lambda).store(b.isometric_bend_lambdas.data() + j * block_size);
+			const _lanes3 dir = h * (delta_lambda / max(h_norm, _lanes::broadcast(min_curvature)));
+			for (std::size_t k = 0; k < 4; ++k) {
+				const _lanes scale = _lanes::broadcast(_inverse_masses[indices[k]] * ib.state.coefficients[k]);
+				(xs[k] + scale * dir).store(positions + _particle_offset(indices[k]));
+			}
+		}
+	}
+}
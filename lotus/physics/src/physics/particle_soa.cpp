@@ -0,0 +1,27 @@
+#include "lotus/physics/particle_soa.h"
+
+/// \file
+/// Implementation of structure-of-arrays particle storage.
+
+namespace lotus::physics {
+	void particle_soa::load(std::span<const particle> particles) {
+		const std::size_t n = particles.size();
+		position_x.resize(n);
+		position_y.resize(n);
+		position_z.resize(n);
+		inverse_mass.resize(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			const particle &p = particles[i];
+			position_x[i] = p.state.position[0];
+			position_y[i] = p.state.position[1];
+			position_z[i] = p.state.position[2];
+			inverse_mass[i] = p.properties.inverse_mass;
+		}
+	}
+
+	void particle_soa::store(std::span<particle> particles) const {
+		for (std::size_t i = 0; i < particles.size(); ++i) {
+			particles[i].state.position = vec3(position_x[i], position_y[i], position_z[i]);
+		}
+	}
+}
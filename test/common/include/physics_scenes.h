@@ -0,0 +1,417 @@
+#pragma once
+
+/// \file
+/// Scenes shared by the physics testbed and benchmarks. These only set up the physics engine and do not depend on
+/// the renderer.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <lotus/physics/engine.h>
+
+namespace physics_scenes {
+	using namespace lotus::physics::types;
+
+	/// Pyramids of boxes surrounded by walls. Multiple pyramids are placed next to each other along the Z axis.
+	struct box_stack {
+		/// Adds all shapes and bodies to the engine.
+		void build(lotus::physics::engine &engine) {
+			engine.gravity = vec3(0.0f, -9.8f, 0.0f);
+			engine.body_broad_phase = lotus::collision::broad_phase::create(
+				static_cast<lotus::collision::broad_phase::type>(broad_phase)
+			);
+
+			auto &plane = engine.shapes.emplace_back(lotus::collision::shape::create(lotus::collision::shapes::plane()));
+
+			auto &box_shape = engine.shapes.emplace_back();
+			auto &box = box_shape.value.emplace<lotus::collision::shapes::polyhedron>();
+			vec3 half_size(box_size[0], box_size[1], box_size[2]);
+			half_size *= 0.5f;
+			box.vertices.emplace_back( half_size[0],  half_size[1],  half_size[2]);
+			box.vertices.emplace_back( half_size[0],  half_size[1], -half_size[2]);
+			box.vertices.emplace_back( half_size[0], -half_size[1],  half_size[2]);
+			box.vertices.emplace_back( half_size[0], -half_size[1], -half_size[2]);
+			box.vertices.emplace_back(-half_size[0],  half_size[1],  half_size[2]);
+			box.vertices.emplace_back(-half_size[0],  half_size[1], -half_size[2]);
+			box.vertices.emplace_back(-half_size[0], -half_size[1],  half_size[2]);
+			box.vertices.emplace_back(-half_size[0], -half_size[1], -half_size[2]);
+			auto box_props = box.bake(1.0f);
+
+			auto &bullet_shape = engine.shapes.emplace_front();
+			bullet_shape_iter = engine.shapes.begin();
+			auto &bullet = bullet_shape.value.emplace<lotus::collision::shapes::polyhedron>();
+			vec3 half_bullet_size(0.05f, 0.05f, 0.05f);
+			bullet.vertices.emplace_back(half_bullet_size[0], half_bullet_size[1], half_bullet_size[2]);
+			bullet.vertices.emplace_back(half_bullet_size[0], half_bullet_size[1], -half_bullet_size[2]);
+			bullet.vertices.emplace_back(half_bullet_size[0], -half_bullet_size[1], half_bullet_size[2]);
+			bullet.vertices.emplace_back(half_bullet_size[0], -half_bullet_size[1], -half_bullet_size[2]);
+			bullet.vertices.emplace_back(-half_bullet_size[0], half_bullet_size[1], half_bullet_size[2]);
+			bullet.vertices.emplace_back(-half_bullet_size[0], half_bullet_size[1], -half_bullet_size[2]);
+			bullet.vertices.emplace_back(-half_bullet_size[0], -half_bullet_size[1], half_bullet_size[2]);
+			bullet.vertices.emplace_back(-half_bullet_size[0], -half_bullet_size[1], -half_bullet_size[2]);
+			bullet_properties = bullet.bake(10.0f);
+
+			auto mat = material();
+
+			std::vector<lotus::physics::body> new_bodies;
+			new_bodies.emplace_back(lotus::physics::body::create(
+				plane, mat,
+				lotus::physics::body_properties::kinematic(),
+				lotus::physics::body_state::stationary_at(
+					lotus::zero,
+					lotus::quat::from_normalized_axis_angle(vec3(1.0f, 0.0f, 0.0f), -0.5f * lotus::physics::pi)
+				)
+			));
+			new_bodies.emplace_back(lotus::physics::body::create(
+				plane, mat,
+				lotus::physics::body_properties::kinematic(),
+				lotus::physics::body_state::stationary_at(
+					vec3(10.0f, 0.0f, 0.0f),
+					lotus::quat::from_normalized_axis_angle(vec3(0.0f, 1.0f, 0.0f), -0.5f * lotus::physics::pi)
+				)
+			));
+			new_bodies.emplace_back(lotus::physics::body::create(
+				plane, mat,
+				lotus::physics::body_properties::kinematic(),
+				lotus::physics::body_state::stationary_at(
+					vec3(-10.0f, 0.0f, 0.0f),
+					lotus::quat::from_normalized_axis_angle(vec3(0.0f, 1.0f, 0.0f), 0.5f * lotus::physics::pi)
+				)
+			));
+			new_bodies.emplace_back(lotus::physics::body::create(
+				plane, mat,
+				lotus::physics::body_properties::kinematic(),
+				lotus::physics::body_state::stationary_at(
+					vec3(0.0f, 0.0f, 10.0f),
+					lotus::quat::from_normalized_axis_angle(vec3(0.0f, 1.0f, 0.0f), lotus::physics::pi)
+				)
+			));
+			new_bodies.emplace_back(lotus::physics::body::create(
+				plane, mat,
+				lotus::physics::body_properties::kinematic(),
+				lotus::physics::body_state::stationary_at(
+					vec3(0.0f, 0.0f, -10.0f), uquats::identity()
+				)
+			));
+
+			const double pile_depth = box_size[2] + pile_gap;
+			for (int pi = 0; pi < pile_count; ++pi) {
+				const double z = pile_depth * (pi - 0.5 * (pile_count - 1));
+				double x = -(box_size[0] + gap[0]) * static_cast<float>(box_count[0] - 1) / 2.0;
+				double y = 0.5 * box_size[1] + gap[1];
+				for (
+					int yi = 0;
+					yi < box_count[1];
+					++yi, y += box_size[1] + gap[1], x += 0.5 * (box_size[0] + gap[0])
+				) {
+					double cx = x;
+					for (int xi = 0; xi + yi < box_count[0]; ++xi, cx += box_size[0] + gap[0]) {
+						lotus::physics::body_state state = lotus::uninitialized;
+						if (rotate_90) {
+							state = lotus::physics::body_state::stationary_at(
+								vec3(static_cast<scalar>(z), static_cast<scalar>(y), static_cast<scalar>(cx)),
+								lotus::quat::from_normalized_axis_angle(
+									vec3(0.0f, 1.0f, 0.0f), 0.5f * lotus::physics::pi
+								)
+							);
+						} else {
+							state = lotus::physics::body_state::stationary_at(
+								vec3(static_cast<scalar>(cx), static_cast<scalar>(y), static_cast<scalar>(z)),
+								uquats::identity()
+							);
+						}
+						new_bodies.emplace_back(lotus::physics::body::create(
+							box_shape, mat,
+							fix_first_row && yi == 0 ? lotus::physics::body_properties::kinematic() : box_props,
+							state
+						));
+					}
+				}
+			}
+
+			if (inverse_list) {
+				std::reverse(new_bodies.begin(), new_bodies.end());
+			}
+			for (const lotus::physics::body &b : new_bodies) {
+				engine.bodies.allocate(b);
+			}
+		}
+
+		/// Returns the material of all bodies.
+		[[nodiscard]] lotus::physics::material_properties material() const {
+			return lotus::physics::material_properties(static_friction, dynamic_friction, restitution);
+		}
+
+		int broad_phase = static_cast<int>(lotus::collision::broad_phase::type::sweep_and_prune);
+
+		bool rotate_90 = false;
+		bool inverse_list = false;
+		bool fix_first_row = false;
+
+		float static_friction = 0.4f;
+		float dynamic_friction = 0.35f;
+		float restitution = 0.0f;
+
+		float density = 1.0f;
+		float box_size[3]{ 1.0f, 0.2f, 0.6f };
+		float gap[2]{ 0.02f, 0.02f };
+		int box_count[2]{ 5, 3 };
+		int pile_count = 1;
+		float pile_gap = 0.4f;
+
+		/// Shape used for boxes shot by the user.
+		std::deque<lotus::collision::shape>::iterator bullet_shape_iter;
+		/// Properties of boxes shot by the user.
+		lotus::physics::body_properties bullet_properties = lotus::uninitialized;
+	};
+
+	/// Common parameters of cloth scenes, and a kinematic sphere that moves back and forth through the cloth.
+	struct cloth_base {
+		/// Moves the sphere to its position at the given time. The engine can be a
+		/// \ref lotus::physics::multi_world_engine created from the engine that the scene has been built in.
+		template <typename Engine> void update_kinematics(Engine &engine, double world_time) {
+			engine.bodies[sphere].state.position = {
+				static_cast<scalar>(sphere_travel * std::cos((2.0 * lotus::physics::pi / sphere_period) * world_time)),
+				sphere_yz[0],
+				sphere_yz[1]
+			};
+		}
+
+		int side_segments = 30;
+		float cloth_size = 1.0f;
+		float cloth_density = 1200.0f;
+
+		lotus::physics::body_handle sphere = lotus::physics::body_handle::invalid(); ///< The moving sphere.
+		float sphere_travel = 1.5f;
+		float sphere_period = 3.0f;
+		float sphere_yz[2]{ 0.5f, 0.0f };
+
+		/// Triangles of the cloth surface, filled by \p build().
+		std::vector<std::uint32_t> triangles;
+	};
+
+	/// A piece of cloth simulated using springs.
+	struct spring_cloth : cloth_base {
+		/// Adds all particles, constraints, and bodies to the engine.
+		void build(lotus::physics::engine &engine) {
+			engine.gravity = { 0.0f, -10.0f, 0.0f };
+			triangles.clear();
+
+			double cloth_mass = cloth_density * cloth_size * cloth_size * 0.001; // assume 1mm thick
+			double node_mass = cloth_mass / (side_segments * side_segments);
+			double segment_length = cloth_size / static_cast<double>(side_segments - 1);
+
+			std::vector<std::vector<std::uint32_t>> pid(
+				static_cast<std::size_t>(side_segments),
+				std::vector<std::uint32_t>(static_cast<std::size_t>(side_segments)));
+			for (int y = 0; y < side_segments; ++y) {
+				for (int x = 0; x < side_segments; ++x) {
+					auto prop = lotus::physics::particle_properties::from_mass(static_cast<scalar>(node_mass));
+					if (x == 0 && (y == 0 || y == side_segments - 1)) {
+						prop = lotus::physics::particle_properties::kinematic();
+					}
+					auto state = lotus::physics::particle_state::stationary_at(
+						{
+							static_cast<scalar>(x * segment_length),
+							cloth_size,
+							static_cast<scalar>(y * segment_length - 0.5 * cloth_size)
+						}
+					);
+					pid[x][y] = static_cast<std::uint32_t>(engine.particles.size());
+					engine.particles.emplace_back(lotus::physics::particle::create(prop, state));
+				}
+			}
+			for (int y = 0; y < side_segments; ++y) {
+				for (int x = 0; x < side_segments; ++x) {
+					if (x > 0) {
+						_add_spring(engine, pid[x - 1][y], pid[x][y], youngs_modulus_short);
+						if (x > 1) {
+							_add_spring(engine, pid[x - 2][y], pid[x][y], youngs_modulus_long);
+						}
+
+					}
+
+					if (y > 0) {
+						_add_spring(engine, pid[x][y - 1], pid[x][y], youngs_modulus_short);
+						if (y > 1) {
+							_add_spring(engine, pid[x][y - 2], pid[x][y], youngs_modulus_long);
+						}
+					}
+
+					if (x > 0 && y > 0) {
+						_add_spring(engine, pid[x - 1][y - 1], pid[x][y], youngs_modulus_diag);
+						_add_spring(engine, pid[x - 1][y], pid[x][y - 1], youngs_modulus_diag);
+
+						triangles.append_range(std::vector{ pid[x - 1][y - 1], pid[x - 1][y], pid[x][y - 1] });
+						triangles.append_range(std::vector{ pid[x][y - 1], pid[x - 1][y], pid[x][y] });
+					}
+				}
+			}
+
+			auto &sphere_shape = engine.shapes.emplace_back(
+				lotus::collision::shape::create(lotus::collision::shapes::sphere::from_radius(0.25f))
+			);
+
+			auto material = lotus::physics::material_properties(0.5f, 0.45f, 0.2f);
+
+			sphere = engine.bodies.allocate(lotus::physics::body::create(
+				sphere_shape, material,
+				lotus::physics::body_properties::kinematic(),
+				lotus::physics::body_state::stationary_at(lotus::zero, uquats::identity())
+			)).first;
+		}
+
+		float youngs_modulus_short = 50000.0f;
+		float youngs_modulus_diag = 50000.0f;
+		float youngs_modulus_long = 50000.0f;
+	protected:
+		/// Adds a spring between the two particles with the given Young's modulus.
+		static void _add_spring(lotus::physics::engine &engine, std::size_t i1, std::size_t i2, double y) {
+			auto &spring = engine.particle_spring_constraints.emplace_back(lotus::uninitialized);
+			spring.particle1 = i1;
+			spring.particle2 = i2;
+			spring.properties.length =
+				(engine.particles[i1].state.position - engine.particles[i2].state.position).norm();
+			spring.properties.inverse_stiffness = static_cast<scalar>(1.0 / (spring.properties.length * y));
+		}
+	};
+
+	/// A piece of cloth simulated using face and bend constraints.
+	struct fem_cloth : cloth_base {
+		/// Initializes the default size of the cloth.
+		fem_cloth() {
+			side_segments = 10;
+		}
+
+		/// Adds all particles, constraints, and bodies to the engine.
+		void build(lotus::physics::engine &engine) {
+			engine.gravity = { 0.0f, -10.0f, 0.0f };
+			engine.face_constraint_projection_type =
+				static_cast<lotus::physics::constraints::face::projection_type>(face_projection);
+			triangles.clear();
+
+			double cloth_mass = cloth_density * cloth_size * cloth_size * thickness;
+			double node_mass = cloth_mass / (side_segments * side_segments);
+			double segment_length = cloth_size / static_cast<double>(side_segments - 1);
+
+			std::vector<std::vector<std::uint32_t>> pid(
+				static_cast<std::size_t>(side_segments),
+				std::vector<std::uint32_t>(static_cast<std::size_t>(side_segments))
+			);
+			for (int y = 0; y < side_segments; ++y) {
+				for (int x = 0; x < side_segments; ++x) {
+					auto prop = lotus::physics::particle_properties::from_mass(static_cast<scalar>(node_mass));
+					if (x == 0 && (y == 0 || y == side_segments - 1)) {
+						prop = lotus::physics::particle_properties::kinematic();
+					}
+					auto state = lotus::physics::particle_state::stationary_at(
+						{
+							static_cast<scalar>(x * segment_length),
+							cloth_size,
+							static_cast<scalar>(y * segment_length - 0.5 * cloth_size)
+						}
+					);
+					pid[x][y] = static_cast<std::uint32_t>(engine.particles.size());
+					engine.particles.emplace_back(lotus::physics::particle::create(prop, state));
+				}
+			}
+			for (int y = 1; y < side_segments; ++y) {
+				for (int x = 1; x < side_segments; ++x) {
+					_add_face(engine, pid[x - 1][y - 1], pid[x - 1][y], pid[x][y - 1]);
+					_add_face(engine, pid[x - 1][y], pid[x][y], pid[x][y - 1]);
+
+					if (bend_constraints) {
+						_add_bend(engine, pid[x][y - 1], pid[x - 1][y], pid[x - 1][y - 1], pid[x][y]);
+						if (x > 1) {
+							_add_bend(engine, pid[x - 1][y - 1], pid[x - 1][y], pid[x - 2][y], pid[x][y - 1]);
+						}
+						if (y > 1) {
+							_add_bend(engine, pid[x - 1][y - 1], pid[x][y - 1], pid[x][y - 2], pid[x - 1][y]);
+						}
+					}
+
+					triangles.append_range(std::vector{ pid[x - 1][y - 1], pid[x - 1][y], pid[x][y - 1] });
+					triangles.append_range(std::vector{ pid[x][y - 1], pid[x - 1][y], pid[x][y] });
+				}
+			}
+
+			auto &sphere_shape = engine.shapes.emplace_back(lotus::collision::shape::create(lotus::collision::shapes::sphere::from_radius(0.25f)));
+			auto &plane_shape = engine.shapes.emplace_back(lotus::collision::shape::create(lotus::collision::shapes::plane()));
+
+			auto material = lotus::physics::material_properties(0.5f, 0.45f, 0.2f);
+
+			engine.bodies.allocate(lotus::physics::body::create(
+				plane_shape, material,
+				lotus::physics::body_properties::kinematic(),
+				lotus::physics::body_state::stationary_at(lotus::zero, lotus::quat::from_axis_angle(lotus::physics::vec3(1.0f, 0.0f, 0.0f), -0.5f * lotus::physics::pi))
+			));
+
+			sphere = engine.bodies.allocate(lotus::physics::body::create(
+				sphere_shape, material,
+				lotus::physics::body_properties::kinematic(),
+				lotus::physics::body_state::stationary_at(lotus::zero, lotus::physics::uquats::identity())
+			)).first;
+		}
+
+		int face_projection = static_cast<int>(lotus::physics::constraints::face::projection_type::gauss_seidel);
+
+		float youngs_modulus = 10000000.0f;
+		float poisson_ratio = 0.3f;
+		float thickness = 0.02f;
+		bool bend_constraints = true;
+		/// Whether bending uses \ref lotus::physics::constraints::isometric_bend instead of
+		/// \ref lotus::physics::constraints::bend.
+		bool isometric_bending = false;
+	protected:
+		/// Adds a face constraint for the given triangle.
+		void _add_face(lotus::physics::engine &engine, std::size_t i1, std::size_t i2, std::size_t i3) const {
+			auto &face = engine.face_constraints.emplace_back(lotus::uninitialized);
+			face.particle1 = i1;
+			face.particle2 = i2;
+			face.particle3 = i3;
+			face.state = lotus::physics::constraints::face::constraint_state::from_rest_pose(
+				engine.particles[i1].state.position,
+				engine.particles[i2].state.position,
+				engine.particles[i3].state.position,
+				thickness
+			);
+			face.properties = lotus::physics::constraints::face::constraint_properties::from_material_properties(
+				youngs_modulus, poisson_ratio
+			);
+		}
+
+		/// Adds a bend constraint for the two triangles sharing the edge (e1, e2).
+		void _add_bend(
+			lotus::physics::engine &engine, std::size_t e1, std::size_t e2, std::size_t x3, std::size_t x4
+		) const {
+			if (isometric_bending) {
+				_add_bend_constraint(engine.isometric_bend_constraints, engine, e1, e2, x3, x4);
+			} else {
+				_add_bend_constraint(engine.bend_constraints, engine, e1, e2, x3, x4);
+			}
+		}
+		/// Adds a bend constraint of the given type to the given list.
+		template <typename Bend> void _add_bend_constraint(
+			std::vector<Bend> &constraints, const lotus::physics::engine &engine,
+			std::size_t e1, std::size_t e2, std::size_t x3, std::size_t x4
+		) const {
+			auto &bend = constraints.emplace_back(lotus::uninitialized);
+			bend.particle_edge1 = e1;
+			bend.particle_edge2 = e2;
+			bend.particle3 = x3;
+			bend.particle4 = x4;
+			bend.state = Bend::constraint_state::from_rest_pose(
+				engine.particles[e1].state.position,
+				engine.particles[e2].state.position,
+				engine.particles[x3].state.position,
+				engine.particles[x4].state.position
+			);
+			bend.properties = Bend::constraint_properties::from_material_properties(
+				youngs_modulus, poisson_ratio, thickness
+			);
+		}
+	};
+}
@@ -0,0 +1,117 @@
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "lotus/containers/dense_pool.h"
+#include "lotus/logging.h"
+
+using lotus::log;
+
+using pool = lotus::dense_pool<int>;
+
+/// Checks that freeing an object invalidates its handle, and that the last object is moved into its place without
+/// invalidating the handle of the moved object.
+void check_free() {
+	pool p;
+	const pool::handle a = p.allocate(1).first;
+	const pool::handle b = p.allocate(2).first;
+	const pool::handle c = p.allocate(3).first;
+	lotus::crash_if(p.get_index(a) != 0 || p.get_index(b) != 1 || p.get_index(c) != 2);
+
+	p.free(b);
+	lotus::crash_if(p.is_valid(b));
+	lotus::crash_if(!p.is_valid(a) || !p.is_valid(c));
+	lotus::crash_if(p.size() != 2);
+	// c is swapped into the position of b
+	lotus::crash_if(p.get_index(c) != 1 || p[c] != 3 || p.get_handle(1) != c);
+	lotus::crash_if(p.get_index(a) != 0 || p[a] != 1 || p.get_handle(0) != a);
+
+	// freeing the last object does not move anything
+	p.free(c);
+	lotus::crash_if(p.is_valid(c) || !p.is_valid(a) || p.get_index(a) != 0 || p[a] != 1);
+
+	p.free(a);
+	lotus::crash_if(p.is_valid(a) || !p.empty());
+	lotus::crash_if(p.is_valid(pool::handle::invalid()));
+}
+
+/// Checks that a stale handle does not validate once its slot has been reused by a new object.
+void check_slot_reuse() {
+	pool p;
+	const pool::handle a = p.allocate(1).first;
+	const pool::handle b = p.allocate(2).first;
+	p.free(a);
+	const pool::handle c = p.allocate(3).first;
+	lotus::crash_if(c.slot != a.slot || c == a);
+	lotus::crash_if(p.is_valid(a) || !p.is_valid(c) || !p.is_valid(b));
+	lotus::crash_if(p[b] != 2 || p[c] != 3);
+
+	// the slot is reused again after being freed a second time
+	p.free(c);
+	const pool::handle d = p.allocate(4).first;
+	lotus::crash_if(d.slot != a.slot || d == a || d == c);
+	lotus::crash_if(p.is_valid(a) || p.is_valid(c) || !p.is_valid(d));
+	lotus::crash_if(p[d] != 4);
+}
+
+/// Checks that clearing the pool invalidates all handles, including after their slots are reused.
+void check_clear() {
+	pool p;
+	std::vector<pool::handle> handles;
+	for (int i = 0; i < 4; ++i) {
+		handles.emplace_back(p.allocate(i).first);
+	}
+	p.clear();
+	lotus::crash_if(!p.empty());
+	for (const pool::handle h : handles) {
+		lotus::crash_if(p.is_valid(h));
+	}
+	for (int i = 0; i < 4; ++i) {
+		const pool::handle h = p.allocate(i + 10).first;
+		lotus::crash_if(!p.is_valid(h) || p[h] != i + 10);
+	}
+	for (const pool::handle h : handles) {
+		lotus::crash_if(p.is_valid(h));
+	}
+}
+
+/// Randomly allocates and frees objects, and checks the pool against a list of live and freed handles.
+void check_random(std::uint32_t seed) {
+	std::mt19937 rng(seed);
+	pool p;
+	std::vector<std::pair<pool::handle, int>> live;
+	std::vector<pool::handle> freed;
+	int next_value = 0;
+	for (int step = 0; step < 10000; ++step) {
+		if (live.empty() || std::uniform_int_distribution<int>(0, 2)(rng) != 0) {
+			const int value = next_value++;
+			live.emplace_back(p.allocate(value).first, value);
+		} else {
+			const std::size_t i = std::uniform_int_distribution<std::size_t>(0, live.size() - 1)(rng);
+			p.free(live[i].first);
+			freed.emplace_back(live[i].first);
+			live[i] = live.back();
+			live.pop_back();
+		}
+
+		lotus::crash_if(p.size() != live.size());
+		for (const auto &[h, value] : live) {
+			lotus::crash_if(!p.is_valid(h) || p[h] != value);
+			lotus::crash_if(p.get_handle(p.get_index(h)) != h);
+		}
+		for (const pool::handle h : freed) {
+			lotus::crash_if(p.is_valid(h));
+		}
+	}
+}
+
+int main() {
+	check_free();
+	check_slot_reuse();
+	check_clear();
+	for (std::uint32_t seed = 0; seed < 4; ++seed) {
+		check_random(seed);
+	}
+	log().info("All checks passed");
+	return 0;
+}
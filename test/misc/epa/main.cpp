@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <lotus/logging.h>
+#include <lotus/collision/algorithms/gjk_epa.h>
+
+using namespace lotus::physics::types;
+
+/// Creates a polyhedron whose vertices are evenly distributed on a unit sphere, so that all vertices are on the
+/// convex hull.
+[[nodiscard]] lotus::collision::shapes::polyhedron create_sphere_hull(std::size_t num_vertices) {
+	const scalar golden_angle = lotus::physics::pi * (3.0f - std::sqrt(5.0f));
+	lotus::collision::shapes::polyhedron result;
+	for (std::size_t i = 0; i < num_vertices; ++i) {
+		const scalar y = 1.0f - 2.0f * (static_cast<scalar>(i) + 0.5f) / static_cast<scalar>(num_vertices);
+		const scalar r = std::sqrt(1.0f - y * y);
+		const scalar theta = golden_angle * static_cast<scalar>(i);
+		result.vertices.emplace_back(r * std::cos(theta), y, r * std::sin(theta));
+	}
+	[[maybe_unused]] const auto props = result.bake(1.0f);
+	return result;
+}
+
+int main(int argc, char **argv) {
+	const std::size_t num_queries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000;
+
+	// deeply overlapping pairs: the centers are at most half a radius apart, in random directions and orientations
+	std::vector<std::pair<lotus::physics::body_state, lotus::physics::body_state>> pairs;
+	{
+		std::default_random_engine rng(1234);
+		std::normal_distribution<scalar> dist(0.0f, 1.0f);
+		std::uniform_real_distribution<scalar> offset(0.05f, 0.5f);
+		auto random_rotation = [&]() {
+			const vec3 axis = lotus::vec::unsafe_normalize(vec3(dist(rng), dist(rng), dist(rng)));
+			return lotus::quat::from_normalized_axis_angle(axis, lotus::physics::pi * dist(rng));
+		};
+		for (std::size_t i = 0; i < num_queries; ++i) {
+			const vec3 dir = lotus::vec::unsafe_normalize(vec3(dist(rng), dist(rng), dist(rng)));
+			pairs.emplace_back(
+				lotus::physics::body_state::stationary_at(lotus::zero, random_rotation()),
+				lotus::physics::body_state::stationary_at(offset(rng) * dir, random_rotation())
+			);
+		}
+	}
+
+	for (std::size_t num_vertices = 16; num_vertices <= 4096; num_vertices *= 4) {
+		const auto poly = create_sphere_hull(num_vertices);
+
+		std::uint64_t iterations = 0;
+		std::size_t fallbacks = 0;
+		std::size_t peak_scratch_bytes = 0;
+		double depth_error = 0.0;
+		double seconds = 0.0;
+		for (const auto &[st1, st2] : pairs) {
+			auto alg = lotus::collision::gjk_epa::for_bodies(st1, poly, st2, poly);
+			const auto [intersect, state] = alg.gjk();
+			if (!intersect) {
+				continue;
+			}
+
+			const auto begin = std::chrono::high_resolution_clock::now();
+			const auto result = alg.epa(state);
+			seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+			iterations += result.iterations;
+			if (!result.converged) {
+				++fallbacks;
+			}
+			peak_scratch_bytes = std::max(peak_scratch_bytes, result.peak_scratch_bytes);
+			// the exact penetration depth of two unit spheres
+			const scalar exact_depth = 2.0f - (st2.position - st1.position).norm();
+			depth_error += std::abs(static_cast<double>(exact_depth - result.penetration_depth));
+		}
+
+		const auto queries = static_cast<double>(num_queries);
+		lotus::log().info(
+			"{:5} vertices: {:9.1f}ns per query, {:6.1f} iterations, mean depth error {:.4f}, "
+			"{} fallbacks, peak scratch {} bytes",
+			num_vertices,
+			seconds / queries * 1e9, static_cast<double>(iterations) / queries, depth_error / queries,
+			fallbacks, peak_scratch_bytes
+		);
+	}
+
+	return 0;
+}
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <lotus/logging.h>
+#include <lotus/physics/engine.h>
+
+using namespace lotus::physics::types;
+
+/// Creates a polyhedron whose vertices are evenly distributed on a unit sphere, so that all vertices are on the
+/// convex hull.
+[[nodiscard]] lotus::collision::shapes::polyhedron create_sphere_hull(std::size_t num_vertices) {
+	const scalar golden_angle = lotus::physics::pi * (3.0f - std::sqrt(5.0f));
+	lotus::collision::shapes::polyhedron result;
+	for (std::size_t i = 0; i < num_vertices; ++i) {
+		const scalar y = 1.0f - 2.0f * (static_cast<scalar>(i) + 0.5f) / static_cast<scalar>(num_vertices);
+		const scalar r = std::sqrt(1.0f - y * y);
+		const scalar theta = golden_angle * static_cast<scalar>(i);
+		result.vertices.emplace_back(r * std::cos(theta), y, r * std::sin(theta));
+	}
+	[[maybe_unused]] const auto props = result.bake(1.0f);
+	return result;
+}
+
+/// Creates a cube with the given half extent.
+[[nodiscard]] lotus::collision::shapes::polyhedron create_cube(scalar half_extent) {
+	lotus::collision::shapes::polyhedron result;
+	for (std::size_t i = 0; i < 8; ++i) {
+		result.vertices.emplace_back(
+			(i & 1) ? half_extent : -half_extent,
+			(i & 2) ? half_extent : -half_extent,
+			(i & 4) ? half_extent : -half_extent
+		);
+	}
+	[[maybe_unused]] const auto props = result.bake(1.0f);
+	return result;
+}
+
+/// Returns the exact penetration depth of a sphere and a cube centered at the origin with the given half extent,
+/// given the center of the sphere in the local space of the cube. The result is negative if they're separated.
+[[nodiscard]] scalar sphere_cube_depth(vec3 center, scalar radius, scalar half_extent) {
+	vec3 closest = center;
+	bool inside = true;
+	scalar min_exit = std::numeric_limits<scalar>::max();
+	for (std::size_t i = 0; i < 3; ++i) {
+		if (std::abs(center[i]) > half_extent) {
+			closest[i] = std::copysign(half_extent, center[i]);
+			inside = false;
+		}
+		min_exit = std::min(min_exit, half_extent - std::abs(center[i]));
+	}
+	return inside ? radius + min_exit : radius - (center - closest).norm();
+}
+
+/// A pair of shapes, and a function that returns the exact penetration depth of the shapes for the given states if
+/// it's available.
+struct pair_type {
+	const char *name; ///< The name of this pair type.
+	const lotus::collision::shape *shape1; ///< The first shape.
+	const lotus::collision::shape *shape2; ///< The second shape.
+	/// Returns the exact penetration depth for the given pair of states.
+	std::function<std::optional<scalar>(const lotus::physics::body_state&, const lotus::physics::body_state&)>
+		exact_depth;
+};
+
+int main(int argc, char **argv) {
+	const std::size_t num_pairs = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+	const std::size_t num_repeats = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100;
+	// by default, centers are up to 2 apart in random directions, so roughly half of all pairs of unit-sized shapes
+	// collide; a larger minimum distance excludes deeply penetrating pairs
+	const scalar min_offset = argc > 3 ? std::strtof(argv[3], nullptr) : 0.0f;
+	const scalar max_offset = argc > 4 ? std::strtof(argv[4], nullptr) : 2.0f;
+
+	constexpr scalar sphere_radius = 0.5f;
+	constexpr scalar cube_half_extent = 0.5f;
+	const auto plane = lotus::collision::shape::create(lotus::collision::shapes::plane());
+	const auto sphere =
+		lotus::collision::shape::create(lotus::collision::shapes::sphere::from_radius(sphere_radius));
+	const auto cube = lotus::collision::shape::create(create_cube(cube_half_extent));
+	const auto hull = lotus::collision::shape::create(create_sphere_hull(64));
+
+	const auto sphere_center = [](const lotus::physics::body_state &st) {
+		return st.position;
+	};
+	const std::vector<pair_type> types{
+		{ "plane-sphere", &plane, &sphere, [&](const auto &st1, const auto &st2) {
+			const vec3 normal = st1.rotation.rotate(vec3(0.0f, 0.0f, 1.0f));
+			return std::optional(sphere_radius - lotus::vec::dot(sphere_center(st2) - st1.position, normal));
+		} },
+		{ "sphere-sphere", &sphere, &sphere, [&](const auto &st1, const auto &st2) {
+			return std::optional(2.0f * sphere_radius - (sphere_center(st2) - sphere_center(st1)).norm());
+		} },
+		{ "sphere-cube", &sphere, &cube, [&](const auto &st1, const auto &st2) {
+			const vec3 local = st2.rotation.inverse().rotate(sphere_center(st1) - st2.position);
+			return std::optional(sphere_cube_depth(local, sphere_radius, cube_half_extent));
+		} },
+		{ "sphere-hull64", &sphere, &hull, [](const auto&, const auto&) {
+			return std::optional<scalar>();
+		} },
+		{ "plane-cube", &plane, &cube, [](const auto&, const auto&) {
+			return std::optional<scalar>();
+		} },
+		{ "cube-cube", &cube, &cube, [](const auto&, const auto&) {
+			return std::optional<scalar>();
+		} },
+	};
+
+	std::vector<std::pair<lotus::physics::body_state, lotus::physics::body_state>> pairs;
+	{
+		std::default_random_engine rng(1234);
+		std::normal_distribution<scalar> dist(0.0f, 1.0f);
+		std::uniform_real_distribution<scalar> offset(min_offset, max_offset);
+		auto random_rotation = [&]() {
+			const vec3 axis = lotus::vec::unsafe_normalize(vec3(dist(rng), dist(rng), dist(rng)));
+			return lotus::quat::from_normalized_axis_angle(axis, lotus::physics::pi * dist(rng));
+		};
+		for (std::size_t i = 0; i < num_pairs; ++i) {
+			const vec3 dir = lotus::vec::unsafe_normalize(vec3(dist(rng), dist(rng), dist(rng)));
+			pairs.emplace_back(
+				lotus::physics::body_state::stationary_at(lotus::zero, random_rotation()),
+				lotus::physics::body_state::stationary_at(offset(rng) * dir, random_rotation())
+			);
+		}
+	}
+
+	for (const pair_type &type : types) {
+		std::size_t num_collisions = 0;
+		const auto begin = std::chrono::high_resolution_clock::now();
+		std::size_t num_points = 0;
+		for (std::size_t rep = 0; rep < num_repeats; ++rep) {
+			for (const auto &[st1, st2] : pairs) {
+				if (auto res = lotus::physics::engine::detect_collision(*type.shape1, st1, *type.shape2, st2)) {
+					++num_collisions;
+					num_points += res->num_points;
+				}
+			}
+		}
+		const double seconds =
+			std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+		// compare the penetration depth along the contact normal against the exact value
+		std::size_t num_checked = 0;
+		std::size_t num_misclassified = 0;
+		double depth_error = 0.0;
+		for (const auto &[st1, st2] : pairs) {
+			const auto exact = type.exact_depth(st1, st2);
+			if (!exact) {
+				continue;
+			}
+			const auto result = lotus::physics::engine::detect_collision(*type.shape1, st1, *type.shape2, st2);
+			if (result.has_value() != (exact.value() > 0.0f)) {
+				++num_misclassified;
+				continue;
+			}
+			if (result) {
+				// the exact depth is that of the deepest point
+				scalar depth = -std::numeric_limits<scalar>::max();
+				for (const auto &pt : result->get_points()) {
+					const vec3 contact1 = st1.position + st1.rotation.rotate(pt.contact1);
+					const vec3 contact2 = st2.position + st2.rotation.rotate(pt.contact2);
+					depth = std::max(depth, lotus::vec::dot(contact1 - contact2, result->normal));
+				}
+				depth_error += std::abs(static_cast<double>(depth - exact.value()));
+				++num_checked;
+			}
+		}
+
+		const auto queries = static_cast<double>(num_pairs * num_repeats);
+		lotus::log().info(
+			"{:14}: {:7.1f}ns per pair, {:5.1f}% colliding, {:.2f} points per contact, "
+			"mean depth error {:.6f}, {} misclassified",
+			type.name,
+			seconds / queries * 1e9, 100.0 * static_cast<double>(num_collisions) / queries,
+			num_collisions > 0 ? static_cast<double>(num_points) / static_cast<double>(num_collisions) : 0.0,
+			num_checked > 0 ? depth_error / static_cast<double>(num_checked) : 0.0, num_misclassified
+		);
+	}
+
+	return 0;
+}
@@ -0,0 +1,121 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <lotus/logging.h>
+#include <lotus/physics/constraint_coloring.h>
+#include <lotus/physics/particle_soa.h>
+#include <lotus/physics/constraints/spring.h>
+#include <lotus/physics/constraints/spring_batches.h>
+
+using namespace lotus::physics::types;
+
+/// A square piece of cloth made of particles connected by structural and shear springs.
+struct cloth {
+	explicit cloth(std::size_t side) {
+		const scalar segment = 1.0f / static_cast<scalar>(side - 1);
+		for (std::size_t y = 0; y < side; ++y) {
+			for (std::size_t x = 0; x < side; ++x) {
+				auto prop = lotus::physics::particle_properties::from_mass(0.01f);
+				if (x == 0 && (y == 0 || y == side - 1)) {
+					prop = lotus::physics::particle_properties::kinematic();
+				}
+				// slightly stretch the cloth so that all springs are violated
+				const vec3 pos(static_cast<scalar>(x) * segment * 1.1f, 0.0f, static_cast<scalar>(y) * segment);
+				particles.emplace_back(lotus::physics::particle::create(
+					prop, lotus::physics::particle_state::stationary_at(pos)
+				));
+			}
+		}
+		auto add_spring = [&](std::size_t i1, std::size_t i2, scalar length) {
+			auto &s = springs.emplace_back(lotus::uninitialized);
+			s.particle1 = i1;
+			s.particle2 = i2;
+			s.properties.length = length;
+			s.properties.inverse_stiffness = 1.0f / (length * 50000.0f);
+		};
+		for (std::size_t y = 0; y < side; ++y) {
+			for (std::size_t x = 0; x < side; ++x) {
+				const std::size_t i = y * side + x;
+				if (x + 1 < side) {
+					add_spring(i, i + 1, segment);
+				}
+				if (y + 1 < side) {
+					add_spring(i, i + side, segment);
+				}
+				if (x + 1 < side && y + 1 < side) {
+					add_spring(i, i + side + 1, segment * std::sqrt(2.0f));
+					add_spring(i + 1, i + side, segment * std::sqrt(2.0f));
+				}
+			}
+		}
+	}
+
+	std::vector<lotus::physics::particle> particles;
+	std::vector<lotus::physics::constraints::particle_spring> springs;
+};
+
+/// Runs the given function and returns the number of seconds it took.
+template <typename Func> [[nodiscard]] double measure(Func &&func) {
+	const auto begin = std::chrono::high_resolution_clock::now();
+	func();
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+}
+
+int main(int argc, char **argv) {
+	const std::size_t side = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+	const std::size_t iterations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200;
+	constexpr scalar inv_dt2 = 3600.0f;
+
+	const cloth base(side);
+	const auto coloring = lotus::physics::constraint_coloring::compute(
+		base.springs.size(), base.particles.size(),
+		[&](std::size_t i) {
+			return std::array{ base.springs[i].particle1, base.springs[i].particle2 };
+		}
+	);
+	const double num_projections = static_cast<double>(base.springs.size() * iterations);
+	lotus::log().info(
+		"{} particles, {} springs, {} colors, {} iterations",
+		base.particles.size(), base.springs.size(), coloring.get_num_colors(), iterations
+	);
+
+	{ // array of structures, one spring at a time
+		cloth c = base;
+		std::vector<scalar> lambdas(c.springs.size(), 0.0f);
+		const double seconds = measure([&]() {
+			for (std::size_t it = 0; it < iterations; ++it) {
+				for (std::size_t color = 0; color < coloring.get_num_colors(); ++color) {
+					for (const std::uint32_t i : coloring.get_constraints(color)) {
+						const auto &s = c.springs[i];
+						auto &p1 = c.particles[s.particle1];
+						auto &p2 = c.particles[s.particle2];
+						s.project(
+							p1.state.position, p2.state.position,
+							p1.properties.inverse_mass, p2.properties.inverse_mass,
+							inv_dt2, lambdas[i]
+						);
+					}
+				}
+			}
+		});
+		lotus::log().info("Array of structures:  {:.3f}M springs/s", num_projections / seconds * 1e-6);
+	}
+
+	{ // structure of arrays, batched
+		cloth c = base;
+		lotus::physics::particle_soa soa;
+		soa.load(c.particles);
+		auto batches = lotus::physics::constraints::particle_spring_batches::create(c.springs, coloring);
+		const double seconds = measure([&]() {
+			for (std::size_t it = 0; it < iterations; ++it) {
+				batches.project(soa, 0, batches.get_num_batches(), inv_dt2);
+			}
+		});
+		lotus::log().info("Structure of arrays:  {:.3f}M springs/s", num_projections / seconds * 1e-6);
+	}
+
+	return 0;
+}
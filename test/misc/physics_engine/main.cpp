@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <lotus/logging.h>
+#include <lotus/utils/thread_pool.h>
+#include <lotus/physics/engine.h>
+
+#include "physics_scenes.h"
+
+using lotus::log;
+using namespace lotus::physics::types;
+
+constexpr scalar time_step = 1.0f / 60.0f; ///< Time step used by all checks.
+constexpr std::uint32_t iterations = 10; ///< Solver iterations used by all checks.
+
+/// Checks that the velocity solve does not hold down the edge of a box that tips over another edge. Contacts at
+/// the lifting edge stay in the manifold because they're within
+/// \ref lotus::physics::engine::contact_manifold_margin of the ground, but they're never enforced and must not
+/// apply restitution or friction.
+void check_tipping() {
+	lotus::physics::engine engine;
+	physics_scenes::box_stack scene;
+	scene.box_count[0] = scene.box_count[1] = 1;
+	scene.build(engine);
+	lotus::physics::body &box = engine.bodies.get_objects().back();
+	for (int i = 0; i < 60; ++i) {
+		engine.timestep(time_step, iterations);
+	}
+
+	// rotate around the edge at -X, which stays on the ground while the edge at +X lifts off
+	const scalar angular_velocity = 0.5f;
+	const scalar half_width = 0.5f * scene.box_size[0];
+	box.state.linear_velocity = vec3(0.0f, angular_velocity * half_width, 0.0f);
+	box.state.angular_velocity = vec3(0.0f, 0.0f, angular_velocity);
+	engine.timestep(time_step, iterations);
+	// gravity slows the box down to about 0.26 rad/s; enforcing the lifting edge would almost stop it
+	log().info("Angular velocity after one step: {}", box.state.angular_velocity[2]);
+	lotus::crash_if(box.state.angular_velocity[2] < 0.2f);
+}
+
+/// Checks that all boxes of the default box stack fall asleep within ten seconds with the default sleep settings.
+void check_stack_sleeps() {
+	lotus::physics::engine engine;
+	physics_scenes::box_stack scene;
+	scene.build(engine);
+	engine.sleeping_enabled = true;
+	for (int i = 0; i < 600; ++i) {
+		engine.timestep(time_step, iterations);
+	}
+
+	std::size_t num_dynamic = 0;
+	std::size_t num_sleeping = 0;
+	for (const lotus::physics::body &b : engine.bodies.get_objects()) {
+		if (b.properties.inverse_mass > 0.0f) {
+			++num_dynamic;
+			num_sleeping += b.sleeping ? 1 : 0;
+		}
+	}
+	log().info("Sleeping bodies: {} / {}", num_sleeping, num_dynamic);
+	lotus::crash_if(num_sleeping != num_dynamic);
+}
+
+/// Checks that separate piles fall asleep as separate islands whose IDs stay bounded, and that waking up one pile
+/// leaves the other one asleep.
+void check_island_ids() {
+	lotus::physics::engine engine;
+	physics_scenes::box_stack scene;
+	scene.pile_count = 2;
+	scene.build(engine);
+	engine.sleeping_enabled = true;
+	for (int i = 0; i < 600; ++i) {
+		engine.timestep(time_step, iterations);
+	}
+
+	// piles are laid out along Z, centered around the origin
+	const std::span<lotus::physics::body> all_bodies = engine.bodies.get_objects();
+	std::uint32_t front_island = 0;
+	std::uint32_t back_island = 0;
+	lotus::physics::body *front_body = nullptr;
+	for (lotus::physics::body &b : all_bodies) {
+		if (b.properties.inverse_mass == 0.0f) {
+			continue;
+		}
+		lotus::crash_if(!b.sleeping || b.island > all_bodies.size());
+		(b.state.position[2] > 0.0f ? front_island : back_island) = b.island;
+		if (b.state.position[2] > 0.0f) {
+			front_body = &b;
+		}
+	}
+	lotus::crash_if(front_island == back_island);
+
+	front_body->state.linear_velocity = vec3(0.0f, 1.0f, 0.0f);
+	engine.timestep(time_step, iterations);
+	for (const lotus::physics::body &b : all_bodies) {
+		if (b.properties.inverse_mass > 0.0f) {
+			lotus::crash_if(b.sleeping != (b.state.position[2] < 0.0f));
+		}
+	}
+}
+
+/// Checks that islands are counted when sleeping is disabled, in which case the sleep update does not look at them.
+void check_island_count() {
+	lotus::physics::engine engine;
+	physics_scenes::box_stack scene;
+	scene.pile_count = 2;
+	scene.build(engine);
+	for (int i = 0; i < 60; ++i) {
+		engine.timestep(time_step, iterations);
+	}
+	if constexpr (lotus::physics::instrumentation_enabled) {
+		const std::uint64_t islands = engine.recent_statistics.latest().counters.islands;
+		log().info("Islands: {}", islands);
+		lotus::crash_if(islands != 2);
+	}
+}
+
+/// Checks that a box falling onto a sleeping box wakes it up, and that the narrow phase result of the pair that
+/// wakes it up is reused instead of being computed again. The two boxes are the only pair of polyhedra, so GJK
+/// should run at most once per time step.
+void check_wake_test_reused() {
+	lotus::physics::engine engine;
+	physics_scenes::box_stack scene;
+	scene.box_count[0] = scene.box_count[1] = 1;
+	scene.build(engine);
+	engine.sleeping_enabled = true;
+	for (int i = 0; i < 600; ++i) {
+		engine.timestep(time_step, iterations);
+	}
+	const lotus::physics::body_handle sleeping_box = engine.bodies.get_handle(
+		static_cast<std::uint32_t>(engine.bodies.get_objects().size() - 1)
+	);
+	lotus::crash_if(!engine.bodies[sleeping_box].sleeping);
+
+	lotus::physics::body falling_box = engine.bodies[sleeping_box];
+	falling_box.state.position[1] += 2.0f * scene.box_size[1];
+	falling_box.state.linear_velocity = vec3(0.0f, -5.0f, 0.0f);
+	falling_box.sleeping = false;
+	engine.bodies.allocate(falling_box);
+	bool woken = false;
+	for (int i = 0; i < 30; ++i) {
+		engine.timestep(time_step, iterations);
+		if constexpr (lotus::physics::instrumentation_enabled) {
+			lotus::crash_if(engine.recent_statistics.latest().counters.gjk_calls > 1);
+		}
+		woken = woken || !engine.bodies[sleeping_box].sleeping;
+	}
+	lotus::crash_if(!woken);
+}
+
+/// Checks that the velocities of kinematic bodies after the previous timestep are updated, since they're used by
+/// restitution and friction of all contacts against them.
+void check_kinematic_previous_velocities() {
+	lotus::physics::engine engine;
+	physics_scenes::box_stack scene;
+	scene.build(engine);
+	const scalar nan = std::numeric_limits<scalar>::quiet_NaN();
+	for (lotus::physics::body &b : engine.bodies.get_objects()) {
+		if (b.properties.inverse_mass == 0.0f) {
+			b.prev_linear_velocity = b.prev_angular_velocity = vec3(nan, nan, nan);
+		}
+	}
+	for (int i = 0; i < 60; ++i) {
+		engine.timestep(time_step, iterations);
+	}
+
+	for (const lotus::physics::body &b : engine.bodies.get_objects()) {
+		for (std::size_t i = 0; i < 3; ++i) {
+			lotus::crash_if(!std::isfinite(b.state.position[i]) || !std::isfinite(b.state.linear_velocity[i]));
+		}
+	}
+}
+
+/// Checks that the residuals reported by the position solver do not depend on whether a worker pool is used.
+/// Small batches make sure that the sums are split into many chunks.
+void check_residuals_deterministic() {
+	const auto simulate = [](lotus::thread_pool *pool) {
+		lotus::physics::engine engine;
+		physics_scenes::spring_cloth scene;
+		scene.build(engine);
+		engine.worker_pool = pool;
+		engine.constraint_batch_size = 7;
+		engine.convergence_monitoring = true;
+		for (int i = 0; i < 10; ++i) {
+			engine.timestep(time_step, iterations);
+		}
+		return engine.last_position_solve.residuals.springs;
+	};
+	lotus::thread_pool pool(4);
+	const scalar serial = simulate(nullptr);
+	const scalar parallel = simulate(&pool);
+	log().info("Spring residual: {} (serial), {} (parallel)", serial, parallel);
+	lotus::crash_if(serial != parallel);
+}
+
+/// Checks that over-relaxation with a factor that's too large falls back to plain iterations before the cloth
+/// blows up.
+void check_over_relaxation_fallback() {
+	lotus::physics::engine engine;
+	physics_scenes::fem_cloth scene;
+	scene.build(engine);
+	engine.particle_iteration_acceleration = lotus::physics::engine::iteration_acceleration::over_relaxation;
+	engine.over_relaxation_factor = 1.95f;
+	scalar max_residual = 0.0f;
+	for (int i = 0; i < 300; ++i) {
+		engine.timestep(time_step, iterations);
+		max_residual = std::max(max_residual, engine.last_position_solve.residuals.max());
+	}
+	log().info("Largest residual with over-relaxation: {}", max_residual);
+	lotus::crash_if(!(max_residual < 1.0f));
+}
+
+int main() {
+	check_tipping();
+	check_stack_sleeps();
+	check_island_ids();
+	check_island_count();
+	check_wake_test_reused();
+	check_kinematic_previous_velocities();
+	check_residuals_deterministic();
+	check_over_relaxation_fallback();
+	log().info("All checks passed");
+	return 0;
+}
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <lotus/logging.h>
+#include <lotus/collision/shapes/polyhedron.h>
+
+using namespace lotus::physics::types;
+
+/// Creates a polyhedron whose vertices are evenly distributed on a unit sphere, so that all vertices are on the
+/// convex hull.
+[[nodiscard]] lotus::collision::shapes::polyhedron create_sphere_hull(std::size_t num_vertices) {
+	const scalar golden_angle = lotus::physics::pi * (3.0f - std::sqrt(5.0f));
+	lotus::collision::shapes::polyhedron result;
+	for (std::size_t i = 0; i < num_vertices; ++i) {
+		const scalar y = 1.0f - 2.0f * (static_cast<scalar>(i) + 0.5f) / static_cast<scalar>(num_vertices);
+		const scalar r = std::sqrt(1.0f - y * y);
+		const scalar theta = golden_angle * static_cast<scalar>(i);
+		result.vertices.emplace_back(r * std::cos(theta), y, r * std::sin(theta));
+	}
+	[[maybe_unused]] const auto props = result.bake(1.0f);
+	return result;
+}
+
+/// Runs the given function and returns the number of seconds it took.
+template <typename Func> [[nodiscard]] double measure(Func &&func) {
+	const auto begin = std::chrono::high_resolution_clock::now();
+	func();
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+}
+
+int main(int argc, char **argv) {
+	const std::size_t num_queries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+	// directions that rotate slowly, as they do for a pair of bodies across GJK iterations and time steps
+	std::vector<vec3> directions;
+	{
+		std::default_random_engine rng(1234);
+		std::normal_distribution<scalar> dist(0.0f, 1.0f);
+		vec3 dir = lotus::vec::unsafe_normalize(vec3(dist(rng), dist(rng), dist(rng)));
+		for (std::size_t i = 0; i < num_queries; ++i) {
+			dir = lotus::vec::unsafe_normalize(dir + 0.05f * vec3(dist(rng), dist(rng), dist(rng)));
+			directions.emplace_back(dir);
+		}
+	}
+
+	for (std::size_t num_vertices = 8; num_vertices <= 1024; num_vertices *= 2) {
+		const auto poly = create_sphere_hull(num_vertices);
+
+		std::vector<std::uint32_t> linear(num_queries);
+		const double seconds_linear = measure([&]() {
+			for (std::size_t i = 0; i < num_queries; ++i) {
+				linear[i] = poly.get_support_vertex(directions[i]).first;
+			}
+		});
+
+		// start from the previous result
+		std::vector<std::uint32_t> coherent(num_queries);
+		const double seconds_coherent = measure([&]() {
+			std::uint32_t start = 0;
+			for (std::size_t i = 0; i < num_queries; ++i) {
+				start = coherent[i] = poly.get_support_vertex(directions[i], start).first;
+			}
+		});
+
+		// always start from the same vertex
+		std::vector<std::uint32_t> fixed(num_queries);
+		const double seconds_fixed = measure([&]() {
+			for (std::size_t i = 0; i < num_queries; ++i) {
+				fixed[i] = poly.get_support_vertex(directions[i], 0).first;
+			}
+		});
+
+		// different vertices may be returned when there are ties, so compare the support values instead
+		std::size_t num_mismatches = 0;
+		for (std::size_t i = 0; i < num_queries; ++i) {
+			const scalar expected = lotus::vec::dot(poly.vertices[linear[i]], directions[i]);
+			if (
+				lotus::vec::dot(poly.vertices[coherent[i]], directions[i]) < expected - 1e-5f ||
+				lotus::vec::dot(poly.vertices[fixed[i]], directions[i]) < expected - 1e-5f
+			) {
+				++num_mismatches;
+			}
+		}
+
+		const auto queries = static_cast<double>(num_queries);
+		lotus::log().info(
+			"{:5} vertices: linear {:7.1f}ns, hill climbing from previous {:7.1f}ns, from fixed vertex {:7.1f}ns, "
+			"{} mismatches",
+			num_vertices,
+			seconds_linear / queries * 1e9, seconds_coherent / queries * 1e9, seconds_fixed / queries * 1e9,
+			num_mismatches
+		);
+	}
+
+	return 0;
+}
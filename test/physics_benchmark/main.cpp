@@ -0,0 +1,579 @@
+/// \file
+/// Headless benchmark that simulates the testbed scenes and reports timings as JSON.
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <lotus/physics/engine.h>
+#include <lotus/physics/multi_world_engine.h>
+
+#include <physics_scenes.h>
+
+using namespace lotus::physics::types;
+
+/// Command line options.
+struct options {
+	std::string_view scene = "spring_cloth"; ///< The scene to simulate.
+	std::optional<int> size; ///< Size of the scene. The meaning depends on the scene.
+	double dt = 1.0 / 60.0; ///< Time step.
+	std::uint32_t iterations = 10; ///< Solver iterations per step or substep.
+	std::uint32_t substeps = 1; ///< Number of substeps.
+	std::uint32_t steps = 600; ///< Number of time steps to simulate.
+	bool warm_start = false; ///< Whether contact warm starting is enabled.
+	bool pair_cache = true; ///< Whether GJK data is cached for each pair of bodies.
+	bool sleep = false; ///< Whether resting bodies are put to sleep.
+	std::optional<int> piles; ///< Number of pyramids in the box stack scene.
+	/// Total number of threads used by the engine. Zero uses all hardware threads, and one disables the worker
+	/// pool.
+	std::size_t threads = 1;
+	bool self_collision = false; ///< Whether particles collide with each other.
+	std::optional<double> thickness; ///< Self-collision thickness.
+	/// How face constraints are projected in the FEM cloth scene.
+	std::optional<lotus::physics::constraints::face::projection_type> face_projection;
+	bool isometric_bending = false; ///< Whether the FEM cloth scene uses isometric bend constraints.
+	/// Whether snapshots are saved and restored after the simulation, to measure their cost and to check that
+	/// simulating from a restored snapshot reproduces the same results.
+	bool snapshot = false;
+	/// Number of worlds with different stiffness values that are simulated both by independent engines and by a
+	/// multi-world engine after the main simulation, to compare their performance. Zero disables this.
+	std::size_t worlds = 0;
+	/// If set, enables convergence monitoring in the engine with this residual tolerance, so that the number of
+	/// iterations becomes a maximum.
+	std::optional<double> tolerance;
+	std::uint32_t residual_interval = 4; ///< Number of iterations between residual checks.
+	/// How particle positions are extrapolated between iterations.
+	lotus::physics::engine::iteration_acceleration acceleration = lotus::physics::engine::iteration_acceleration::none;
+	std::optional<double> omega; ///< Over-relaxation factor.
+	std::optional<double> spectral_radius; ///< Spectral radius estimate used by Chebyshev acceleration.
+};
+
+/// Names of all face constraint projection types, indexed by their values.
+constexpr std::string_view face_projection_names[] = { "exact", "gauss_seidel", "ldlt" };
+static_assert(
+	std::size(face_projection_names) ==
+	static_cast<std::size_t>(lotus::physics::constraints::face::projection_type::num_projection_types)
+);
+
+/// Names of all iteration acceleration methods, indexed by their values.
+constexpr std::string_view acceleration_names[] = { "none", "over_relaxation", "chebyshev" };
+static_assert(
+	std::size(acceleration_names) ==
+	static_cast<std::size_t>(lotus::physics::engine::iteration_acceleration::num_iteration_accelerations)
+);
+
+/// A scene set up in an engine, along with a function that updates kinematic objects.
+struct scene_instance {
+	lotus::physics::engine engine; ///< The engine.
+	physics_scenes::cloth_base *cloth = nullptr; ///< The cloth scene, if any.
+	physics_scenes::spring_cloth spring_cloth; ///< Storage for the spring cloth scene.
+	physics_scenes::fem_cloth fem_cloth; ///< Storage for the FEM cloth scene.
+	physics_scenes::box_stack box_stack; ///< Storage for the box stack scene.
+};
+
+/// Builds the scene with the given name. Returns \p false if the name is unknown.
+[[nodiscard]] bool build_scene(scene_instance &inst, const options &opts) {
+	if (opts.scene == "box_stack") {
+		if (opts.size) {
+			inst.box_stack.box_count[0] = inst.box_stack.box_count[1] = opts.size.value();
+		}
+		inst.box_stack.pile_count = opts.piles.value_or(inst.box_stack.pile_count);
+		inst.box_stack.build(inst.engine);
+		return true;
+	}
+	if (opts.scene == "spring_cloth") {
+		inst.cloth = &inst.spring_cloth;
+		inst.spring_cloth.side_segments = opts.size.value_or(inst.spring_cloth.side_segments);
+		inst.spring_cloth.build(inst.engine);
+		return true;
+	}
+	if (opts.scene == "fem_cloth") {
+		inst.cloth = &inst.fem_cloth;
+		inst.fem_cloth.side_segments = opts.size.value_or(inst.fem_cloth.side_segments);
+		if (opts.face_projection) {
+			inst.fem_cloth.face_projection = static_cast<int>(opts.face_projection.value());
+		}
+		inst.fem_cloth.isometric_bending = opts.isometric_bending;
+		inst.fem_cloth.build(inst.engine);
+		return true;
+	}
+	return false;
+}
+
+/// Computes a FNV-1a hash of the positions and orientations of all particles and bodies.
+[[nodiscard]] std::uint64_t compute_checksum(const lotus::physics::engine &engine) {
+	std::uint64_t hash = 14695981039346656037ull;
+	auto add = [&](scalar x) {
+		const auto bits = std::bit_cast<std::uint32_t>(x);
+		for (std::size_t i = 0; i < 4; ++i) {
+			hash ^= (bits >> (8 * i)) & 0xFF;
+			hash *= 1099511628211ull;
+		}
+	};
+	for (const auto &p : engine.particles) {
+		add(p.state.position[0]);
+		add(p.state.position[1]);
+		add(p.state.position[2]);
+	}
+	for (const auto &b : engine.bodies) {
+		add(b.state.position[0]);
+		add(b.state.position[1]);
+		add(b.state.position[2]);
+		add(b.state.rotation.w());
+		add(b.state.rotation.x());
+		add(b.state.rotation.y());
+		add(b.state.rotation.z());
+	}
+	return hash;
+}
+
+/// Results of \ref measure_snapshots().
+struct snapshot_results {
+	std::size_t size = 0; ///< Size of a full snapshot in bytes.
+	std::size_t delta_size = 0; ///< Size of a delta snapshot taken one time step after the full snapshot.
+	double save_ns = 0.0; ///< Average time it takes to save a full snapshot.
+	double restore_ns = 0.0; ///< Average time it takes to restore a full snapshot.
+	/// Whether simulating from a restored snapshot produces the same results as simulating from the state where
+	/// the snapshot was saved, both for full and delta snapshots.
+	bool replay_matches = false;
+};
+
+/// Saves and restores snapshots of the current state of the scene, and simulates a few more time steps from them.
+[[nodiscard]] snapshot_results measure_snapshots(scene_instance &inst, const options &opts, double world_time) {
+	constexpr std::uint32_t repetitions = 100;
+	constexpr std::uint32_t replay_steps = 10;
+
+	const auto dt = static_cast<scalar>(opts.dt);
+	auto simulate = [&](std::uint32_t steps) {
+		double time = world_time;
+		for (std::uint32_t i = 0; i < steps; ++i) {
+			time += opts.dt;
+			if (inst.cloth) {
+				inst.cloth->update_kinematics(inst.engine, time);
+			}
+			if (opts.substeps > 1) {
+				inst.engine.timestep_substepped(dt, opts.substeps, opts.iterations);
+			} else {
+				inst.engine.timestep(dt, opts.iterations);
+			}
+		}
+	};
+
+	snapshot_results result;
+	std::vector<std::byte> snapshot(inst.engine.get_snapshot_size());
+	{
+		const auto begin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < repetitions; ++i) {
+			result.size = inst.engine.save_snapshot(snapshot);
+		}
+		result.save_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::high_resolution_clock::now() - begin
+		).count()) / repetitions;
+	}
+	{
+		const auto begin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < repetitions; ++i) {
+			[[maybe_unused]] const bool restored = inst.engine.restore_snapshot(snapshot);
+		}
+		result.restore_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::high_resolution_clock::now() - begin
+		).count()) / repetitions;
+	}
+
+	// take a delta snapshot after a single step, then check that both snapshots replay the same steps
+	simulate(1);
+	const std::uint64_t after_one_step = compute_checksum(inst.engine);
+	std::vector<std::byte> delta(inst.engine.get_snapshot_delta_size());
+	result.delta_size = inst.engine.save_snapshot_delta(snapshot, delta);
+	simulate(replay_steps);
+	const std::uint64_t expected = compute_checksum(inst.engine);
+
+	result.replay_matches = inst.engine.restore_snapshot(snapshot);
+	simulate(1);
+	result.replay_matches = result.replay_matches && compute_checksum(inst.engine) == after_one_step;
+	result.replay_matches = result.replay_matches && inst.engine.restore_snapshot(delta, snapshot);
+	simulate(replay_steps);
+	result.replay_matches = result.replay_matches && compute_checksum(inst.engine) == expected;
+	return result;
+}
+
+/// Results of \ref measure_worlds().
+struct world_results {
+	double independent_ns_per_step = 0.0; ///< Time it takes to step all worlds using independent engines.
+	double batched_ns_per_step = 0.0; ///< Time it takes to step all worlds using a multi-world engine.
+	/// The largest distance between a particle simulated by the multi-world engine and the same particle simulated
+	/// by an independent engine, over all worlds.
+	double max_deviation = 0.0;
+};
+
+/// Simulates the cloth scene in several worlds whose constraints are made increasingly soft, once using an engine
+/// for each world and once using a single multi-world engine.
+[[nodiscard]] world_results measure_worlds(const options &opts, lotus::thread_pool *pool) {
+	const std::size_t num_worlds = opts.worlds;
+	auto get_scale = [&](std::size_t world) {
+		return 1.0f + static_cast<scalar>(world) / static_cast<scalar>(num_worlds);
+	};
+
+	std::vector<std::unique_ptr<scene_instance>> instances;
+	for (std::size_t w = 0; w < num_worlds; ++w) {
+		scene_instance &inst = *instances.emplace_back(std::make_unique<scene_instance>());
+		[[maybe_unused]] const bool built = build_scene(inst, opts);
+		inst.engine.worker_pool = pool;
+		const scalar scale = get_scale(w);
+		for (auto &s : inst.engine.particle_spring_constraints) {
+			s.properties.inverse_stiffness *= scale;
+		}
+		for (auto &f : inst.engine.face_constraints) {
+			f.properties.inverse_stiffness *= scale;
+		}
+		for (auto &b : inst.engine.bend_constraints) {
+			b.properties.inverse_stiffness *= scale;
+		}
+		for (auto &b : inst.engine.isometric_bend_constraints) {
+			b.properties.inverse_stiffness *= scale;
+		}
+	}
+	// the first world is unmodified, so its springs are the base of all other worlds; faces and bends are copied
+	// from the engine of each world
+	scene_instance &first = *instances[0];
+	auto worlds = lotus::physics::multi_world_engine::create(first.engine, num_worlds);
+	for (std::size_t w = 1; w < num_worlds; ++w) {
+		const lotus::physics::engine &world_engine = instances[w]->engine;
+		worlds.set_spring_inverse_stiffness_scale(w, get_scale(w));
+		for (std::size_t i = 0; i < world_engine.face_constraints.size(); ++i) {
+			worlds.set_face_properties(w, i, world_engine.face_constraints[i].properties);
+		}
+		for (std::size_t i = 0; i < world_engine.bend_constraints.size(); ++i) {
+			worlds.set_bend_properties(w, i, world_engine.bend_constraints[i].properties);
+		}
+		for (std::size_t i = 0; i < world_engine.isometric_bend_constraints.size(); ++i) {
+			worlds.set_isometric_bend_properties(w, i, world_engine.isometric_bend_constraints[i].properties);
+		}
+	}
+
+	const auto dt = static_cast<scalar>(opts.dt);
+	const double steps = std::max<double>(1.0, opts.steps);
+	world_results result;
+	{
+		double world_time = 0.0;
+		const auto begin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < opts.steps; ++i) {
+			world_time += opts.dt;
+			for (const auto &inst : instances) {
+				inst->cloth->update_kinematics(inst->engine, world_time);
+				inst->engine.timestep(dt, opts.iterations);
+			}
+		}
+		result.independent_ns_per_step = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::high_resolution_clock::now() - begin
+		).count()) / steps;
+	}
+	{
+		double world_time = 0.0;
+		const auto begin = std::chrono::high_resolution_clock::now();
+		for (std::uint32_t i = 0; i < opts.steps; ++i) {
+			world_time += opts.dt;
+			first.cloth->update_kinematics(worlds, world_time);
+			worlds.timestep(dt, opts.iterations);
+		}
+		result.batched_ns_per_step = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::high_resolution_clock::now() - begin
+		).count()) / steps;
+	}
+
+	for (std::size_t w = 0; w < num_worlds; ++w) {
+		const auto &particles = instances[w]->engine.particles;
+		for (std::size_t i = 0; i < particles.size(); ++i) {
+			const vec3 diff = worlds.get_particle_state(w, i).position - particles[i].state.position;
+			result.max_deviation = std::max<double>(result.max_deviation, diff.norm());
+		}
+	}
+	return result;
+}
+
+/// Parses command line arguments. Returns \p std::nullopt if they're invalid.
+[[nodiscard]] std::optional<options> parse_options(int argc, char **argv) {
+	options result;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string_view key = argv[i];
+		const char *value = argv[i + 1];
+		if (key == "--scene") {
+			result.scene = value;
+		} else if (key == "--size") {
+			result.size = std::atoi(value);
+		} else if (key == "--dt") {
+			result.dt = std::atof(value);
+		} else if (key == "--iters") {
+			result.iterations = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+		} else if (key == "--substeps") {
+			result.substeps = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+		} else if (key == "--steps") {
+			result.steps = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+		} else if (key == "--warm-start") {
+			result.warm_start = std::atoi(value) != 0;
+		} else if (key == "--pair-cache") {
+			result.pair_cache = std::atoi(value) != 0;
+		} else if (key == "--sleep") {
+			result.sleep = std::atoi(value) != 0;
+		} else if (key == "--piles") {
+			result.piles = std::atoi(value);
+		} else if (key == "--threads") {
+			result.threads = static_cast<std::size_t>(std::strtoul(value, nullptr, 10));
+		} else if (key == "--self-collision") {
+			result.self_collision = std::atoi(value) != 0;
+		} else if (key == "--thickness") {
+			result.thickness = std::atof(value);
+		} else if (key == "--face-projection") {
+			const auto it = std::find(std::begin(face_projection_names), std::end(face_projection_names), value);
+			if (it == std::end(face_projection_names)) {
+				return std::nullopt;
+			}
+			result.face_projection = static_cast<lotus::physics::constraints::face::projection_type>(
+				it - std::begin(face_projection_names)
+			);
+		} else if (key == "--isometric-bending") {
+			result.isometric_bending = std::atoi(value) != 0;
+		} else if (key == "--snapshot") {
+			result.snapshot = std::atoi(value) != 0;
+		} else if (key == "--worlds") {
+			result.worlds = static_cast<std::size_t>(std::strtoul(value, nullptr, 10));
+		} else if (key == "--tolerance") {
+			result.tolerance = std::atof(value);
+		} else if (key == "--residual-interval") {
+			result.residual_interval = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+		} else if (key == "--acceleration") {
+			const auto it = std::find(std::begin(acceleration_names), std::end(acceleration_names), value);
+			if (it == std::end(acceleration_names)) {
+				return std::nullopt;
+			}
+			result.acceleration = static_cast<lotus::physics::engine::iteration_acceleration>(
+				it - std::begin(acceleration_names)
+			);
+		} else if (key == "--omega") {
+			result.omega = std::atof(value);
+		} else if (key == "--spectral-radius") {
+			result.spectral_radius = std::atof(value);
+		} else {
+			return std::nullopt;
+		}
+	}
+	if (argc % 2 == 0 || result.substeps == 0) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+int main(int argc, char **argv) {
+	const auto opts = parse_options(argc, argv);
+	if (!opts) {
+		std::fprintf(stderr,
+			"Usage: %s [--scene box_stack|spring_cloth|fem_cloth] [--size N] [--dt seconds] [--iters N] "
+			"[--substeps N] [--steps N] [--warm-start 0|1] "
+			"[--pair-cache 0|1] [--sleep 0|1] [--piles N] [--threads N] [--self-collision 0|1] "
+			"[--thickness meters] [--face-projection exact|gauss_seidel|ldlt] [--isometric-bending 0|1] "
+			"[--snapshot 0|1] [--worlds N] [--tolerance residual] [--residual-interval N] "
+			"[--acceleration none|over_relaxation|chebyshev] [--omega factor] [--spectral-radius rho]\n",
+			argv[0]
+		);
+		return 1;
+	}
+
+	scene_instance inst;
+	if (!build_scene(inst, opts.value())) {
+		std::fprintf(stderr, "Unknown scene: %.*s\n", static_cast<int>(opts->scene.size()), opts->scene.data());
+		return 1;
+	}
+
+	inst.engine.contact_warm_starting = opts->warm_start;
+	inst.engine.collision_pair_caching = opts->pair_cache;
+	inst.engine.sleeping_enabled = opts->sleep;
+	inst.engine.particle_self_collision = opts->self_collision;
+	if (opts->thickness) {
+		inst.engine.self_collision_thickness = static_cast<scalar>(opts->thickness.value());
+	}
+	if (opts->tolerance) {
+		inst.engine.convergence_monitoring = true;
+		inst.engine.residual_tolerance = static_cast<scalar>(opts->tolerance.value());
+	}
+	inst.engine.residual_check_interval = opts->residual_interval;
+	inst.engine.particle_iteration_acceleration = opts->acceleration;
+	if (opts->omega) {
+		inst.engine.over_relaxation_factor = static_cast<scalar>(opts->omega.value());
+	}
+	if (opts->spectral_radius) {
+		inst.engine.chebyshev_spectral_radius = static_cast<scalar>(opts->spectral_radius.value());
+	}
+	std::optional<lotus::thread_pool> pool;
+	if (opts->threads != 1) {
+		inst.engine.worker_pool = &pool.emplace(opts->threads);
+	}
+
+	const auto dt = static_cast<scalar>(opts->dt);
+	double world_time = 0.0;
+	// only the last substep of each step is counted
+	std::uint64_t particle_iterations = 0;
+	std::uint64_t contact_iterations = 0;
+	std::uint32_t acceleration_fallbacks = 0;
+	const auto begin = std::chrono::high_resolution_clock::now();
+	for (std::uint32_t i = 0; i < opts->steps; ++i) {
+		world_time += opts->dt;
+		if (inst.cloth) {
+			inst.cloth->update_kinematics(inst.engine, world_time);
+		}
+		if (opts->substeps > 1) {
+			inst.engine.timestep_substepped(dt, opts->substeps, opts->iterations);
+		} else {
+			inst.engine.timestep(dt, opts->iterations);
+		}
+		particle_iterations += inst.engine.last_position_solve.particle_iterations;
+		contact_iterations += inst.engine.last_position_solve.contact_iterations;
+		if (inst.engine.last_position_solve.acceleration_fallback) {
+			++acceleration_fallbacks;
+		}
+	}
+	const auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::high_resolution_clock::now() - begin
+	);
+
+	const double steps = std::max<double>(1.0, opts->steps);
+	auto per_step = [&](std::chrono::nanoseconds t) {
+		return static_cast<double>(t.count()) / steps;
+	};
+	const auto &timings = inst.engine.accumulated_statistics.timings;
+	const auto &counters = inst.engine.accumulated_statistics.counters;
+	std::printf("{\n");
+	std::printf("\t\"scene\": \"%.*s\",\n", static_cast<int>(opts->scene.size()), opts->scene.data());
+	std::printf("\t\"size\": %d,\n", inst.cloth ? inst.cloth->side_segments : inst.box_stack.box_count[0]);
+	std::printf("\t\"dt\": %.9g,\n", opts->dt);
+	std::printf("\t\"iterations\": %u,\n", opts->iterations);
+	std::printf("\t\"substeps\": %u,\n", opts->substeps);
+	std::printf("\t\"steps\": %u,\n", opts->steps);
+	std::printf("\t\"warm_start\": %s,\n", opts->warm_start ? "true" : "false");
+	std::printf("\t\"pair_cache\": %s,\n", opts->pair_cache ? "true" : "false");
+	std::printf("\t\"sleep\": %s,\n", opts->sleep ? "true" : "false");
+	std::printf("\t\"piles\": %d,\n", inst.box_stack.pile_count);
+	std::printf("\t\"threads\": %zu,\n", pool ? pool->get_num_threads() : 1);
+	std::printf("\t\"self_collision\": %s,\n", opts->self_collision ? "true" : "false");
+	std::printf("\t\"thickness\": %.9g,\n", inst.engine.self_collision_thickness);
+	std::printf("\t\"num_bodies\": %zu,\n", inst.engine.bodies.size());
+	std::printf("\t\"num_particles\": %zu,\n", inst.engine.particles.size());
+	const std::string_view face_projection =
+		face_projection_names[static_cast<std::size_t>(inst.engine.face_constraint_projection_type)];
+	std::printf(
+		"\t\"face_projection\": \"%.*s\",\n", static_cast<int>(face_projection.size()), face_projection.data()
+	);
+	std::printf("\t\"num_faces\": %zu,\n", inst.engine.face_constraints.size());
+	std::printf(
+		"\t\"num_bends\": %zu,\n",
+		inst.engine.bend_constraints.size() + inst.engine.isometric_bend_constraints.size()
+	);
+	std::printf("\t\"isometric_bending\": %s,\n", opts->isometric_bending ? "true" : "false");
+	std::printf("\t\"total_ns\": %lld,\n", static_cast<long long>(total.count()));
+	std::printf("\t\"ns_per_step\": %.1f,\n", per_step(total));
+	std::printf("\t\"phase_ns_per_step\": {\n");
+	std::printf("\t\t\"prediction\": %.1f,\n", per_step(timings.prediction));
+	std::printf("\t\t\"collision_detection\": %.1f,\n", per_step(timings.collision_detection));
+	std::printf("\t\t\"position_solve\": %.1f,\n", per_step(timings.position_solve));
+	std::printf("\t\t\"velocity_update\": %.1f,\n", per_step(timings.velocity_update));
+	std::printf("\t\t\"velocity_solve\": %.1f,\n", per_step(timings.velocity_solve));
+	std::printf("\t\t\"sleep_update\": %.1f\n", per_step(timings.sleep_update));
+	std::printf("\t},\n");
+	std::printf("\t\"counters_per_step\": {\n");
+	std::printf("\t\t\"body_pairs_tested\": %.1f,\n", static_cast<double>(counters.body_pairs_tested) / steps);
+	std::printf("\t\t\"gjk_calls\": %.1f,\n", static_cast<double>(counters.gjk_calls) / steps);
+	std::printf(
+		"\t\t\"gjk_support_queries\": %.1f,\n", static_cast<double>(counters.gjk_support_queries) / steps
+	);
+	std::printf("\t\t\"epa_iterations\": %.1f,\n", static_cast<double>(counters.epa_iterations) / steps);
+	std::printf("\t\t\"epa_fallbacks\": %.1f,\n", static_cast<double>(counters.epa_fallbacks) / steps);
+	std::printf("\t\t\"contacts_generated\": %.1f,\n", static_cast<double>(counters.contacts_generated) / steps);
+	std::printf("\t\t\"contacts_matched\": %.1f,\n", static_cast<double>(counters.contacts_matched) / steps);
+	std::printf("\t\t\"contacts_created\": %.1f,\n", static_cast<double>(counters.contacts_created) / steps);
+	std::printf("\t\t\"contacts_dropped\": %.1f,\n", static_cast<double>(counters.contacts_dropped) / steps);
+	std::printf(
+		"\t\t\"continuous_collision_tests\": %.1f,\n",
+		static_cast<double>(counters.continuous_collision_tests) / steps
+	);
+	std::printf("\t\t\"speculative_contacts\": %.1f,\n", static_cast<double>(counters.speculative_contacts) / steps);
+	std::printf("\t\t\"active_bodies\": %.1f,\n", static_cast<double>(counters.active_bodies) / steps);
+	std::printf("\t\t\"sleeping_bodies\": %.1f,\n", static_cast<double>(counters.sleeping_bodies) / steps);
+	std::printf("\t\t\"islands\": %.1f,\n", static_cast<double>(counters.islands) / steps);
+	std::printf("\t\t\"split_islands\": %.1f,\n", static_cast<double>(counters.split_islands) / steps);
+	std::printf("\t\t\"constraints_projected\": %.1f,\n", static_cast<double>(counters.constraints_projected) / steps);
+	std::printf(
+		"\t\t\"particle_collision_tests\": %.1f,\n", static_cast<double>(counters.particle_collision_tests) / steps
+	);
+	std::printf("\t\t\"self_collisions\": %.1f\n", static_cast<double>(counters.self_collisions) / steps);
+	std::printf("\t},\n");
+	std::printf("\t\"constraints_per_iteration\": %.1f,\n", counters.get_constraints_per_iteration());
+	{ // all other constraints are projected in the same phase, so this is a lower bound
+		const double face_projections =
+			static_cast<double>(inst.engine.face_constraints.size()) * static_cast<double>(counters.solver_iterations);
+		const double seconds = std::chrono::duration<double>(timings.position_solve).count();
+		std::printf("\t\"face_projections_per_second\": %.1f,\n", seconds > 0.0 ? face_projections / seconds : 0.0);
+	}
+	std::printf(
+		"\t\"peak_narrow_phase_scratch_bytes\": %llu,\n",
+		static_cast<unsigned long long>(counters.peak_narrow_phase_scratch_bytes)
+	);
+	{
+		const std::string_view acceleration = acceleration_names[static_cast<std::size_t>(opts->acceleration)];
+		std::printf(
+			"\t\"acceleration\": \"%.*s\",\n", static_cast<int>(acceleration.size()), acceleration.data()
+		);
+		std::printf("\t\"over_relaxation_factor\": %.9g,\n", inst.engine.over_relaxation_factor);
+		std::printf("\t\"chebyshev_spectral_radius\": %.9g,\n", inst.engine.chebyshev_spectral_radius);
+		std::printf("\t\"acceleration_fallbacks\": %u,\n", acceleration_fallbacks);
+	}
+	if (opts->tolerance) {
+		const auto &residuals = inst.engine.last_position_solve.residuals;
+		std::printf("\t\"convergence\": {\n");
+		std::printf("\t\t\"tolerance\": %.9g,\n", inst.engine.residual_tolerance);
+		std::printf("\t\t\"residual_interval\": %u,\n", inst.engine.residual_check_interval);
+		std::printf("\t\t\"particle_iterations_per_step\": %.2f,\n", static_cast<double>(particle_iterations) / steps);
+		std::printf("\t\t\"contact_iterations_per_step\": %.2f,\n", static_cast<double>(contact_iterations) / steps);
+		std::printf("\t\t\"last_residuals\": {\n");
+		std::printf("\t\t\t\"springs\": %.9g,\n", residuals.springs);
+		std::printf("\t\t\t\"faces\": %.9g,\n", residuals.faces);
+		std::printf("\t\t\t\"bends\": %.9g,\n", residuals.bends);
+		std::printf("\t\t\t\"contacts\": %.9g\n", residuals.contacts);
+		std::printf("\t\t}\n");
+		std::printf("\t},\n");
+	}
+	std::printf("\t\"instrumentation\": %s,\n", lotus::physics::instrumentation_enabled ? "true" : "false");
+	// the checksum is computed before snapshots are measured, which simulates more time steps
+	const std::uint64_t checksum = compute_checksum(inst.engine);
+	if (opts->snapshot) {
+		const snapshot_results snapshot = measure_snapshots(inst, opts.value(), world_time);
+		std::printf("\t\"snapshot\": {\n");
+		std::printf("\t\t\"bytes\": %zu,\n", snapshot.size);
+		std::printf("\t\t\"delta_bytes\": %zu,\n", snapshot.delta_size);
+		std::printf("\t\t\"save_ns\": %.1f,\n", snapshot.save_ns);
+		std::printf("\t\t\"restore_ns\": %.1f,\n", snapshot.restore_ns);
+		std::printf("\t\t\"replay_matches\": %s\n", snapshot.replay_matches ? "true" : "false");
+		std::printf("\t},\n");
+	}
+	if (opts->worlds > 0 && inst.cloth) {
+		const world_results worlds = measure_worlds(opts.value(), pool ? &pool.value() : nullptr);
+		std::printf("\t\"worlds\": {\n");
+		std::printf("\t\t\"count\": %zu,\n", opts->worlds);
+		std::printf("\t\t\"independent_ns_per_step\": %.1f,\n", worlds.independent_ns_per_step);
+		std::printf("\t\t\"batched_ns_per_step\": %.1f,\n", worlds.batched_ns_per_step);
+		std::printf(
+			"\t\t\"speedup\": %.3f,\n",
+			worlds.batched_ns_per_step > 0.0 ? worlds.independent_ns_per_step / worlds.batched_ns_per_step : 0.0
+		);
+		std::printf("\t\t\"max_deviation\": %.9g\n", worlds.max_deviation);
+		std::printf("\t},\n");
+	}
+	std::printf("\t\"checksum\": \"%016llx\"\n", static_cast<unsigned long long>(checksum));
+	std::printf("}\n");
+	return 0;
+}
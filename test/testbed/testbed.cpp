@@ -29,7 +29,7 @@ public:
 	/// Initializes the GLFW window.
 	testbed_app(int argc, char **argv, lotus::gpu::context_options options) :
 		application(argc, argv, u8"Physics Testbed", options) {
-
+		_test_context.worker_pool = &_worker_pool;
 	}
 
 	/// Renders all objects.
@@ -142,6 +142,7 @@ protected:
 	float _scroll_sensitivity = 0.95f;
 	lotus::camera_control<scalar> _camera_control = nullptr;
 
+	lotus::thread_pool _worker_pool{ 0 }; ///< Worker threads shared by all tests.
 	test_context _test_context; ///< Test context.
 	std::vector<_test_creator> _tests; ///< The list of tests.
 
@@ -185,6 +186,14 @@ protected:
 				ImGui::SliderFloat("Time Scaling", &_time_scale, 0.0f, 100.0f, "%.1f%%");
 				ImGui::SliderFloat("Time Step", &_time_step, 0.001f, 0.1f, "%.3fs", ImGuiSliderFlags_Logarithmic);
 				ImGui::SliderInt("Iterations", &_iters, 1, 100);
+				ImGui::SliderInt("Substeps", &_test_context.substeps, 1, 100);
+				{
+					int cadence = static_cast<int>(_test_context.substep_collision_detection);
+					if (ImGui::Combo("Substep Collisions", &cadence, "Once per Frame\0Once per Substep\0\0")) {
+						_test_context.substep_collision_detection =
+							static_cast<lotus::physics::engine::collision_detection_cadence>(cadence);
+					}
+				}
 				if (ImGui::Button("Execute Single Time Step")) {
 					if (_test) {
 						_test->timestep(_time_step, _iters);
@@ -228,6 +237,10 @@ protected:
 					"RA Timestep Factor", &_timestep_cost_factor, 0.0f, 1.0f, "%.4f", ImGuiSliderFlags_Logarithmic
 				);
 				ImGui::LabelText("RA Timestep Cost", "%.3fms", _timestep_cost);
+
+				if (const lotus::physics::engine *engine = _test ? _test->get_engine() : nullptr) {
+					_engine_statistics_gui(*engine);
+				}
 			}
 		}
 		ImGui::End();
@@ -244,6 +257,64 @@ protected:
 	}
 
 
+	/// Displays the recent statistics of the given engine, averaged over all entries in its history.
+	void _engine_statistics_gui(const lotus::physics::engine &engine) {
+		if constexpr (!lotus::physics::instrumentation_enabled) {
+			ImGui::Text("[Physics instrumentation disabled]");
+			return;
+		}
+		const auto &history = engine.recent_statistics;
+		if (history.empty()) {
+			return;
+		}
+
+		lotus::physics::step_statistics sum;
+		std::vector<float> step_costs(history.size());
+		for (std::size_t i = 0; i < history.size(); ++i) {
+			sum += history[i];
+			step_costs[i] = std::chrono::duration<float, std::milli>(history[i].timings.total()).count();
+		}
+		const auto count = static_cast<double>(history.size());
+		auto average_ms = [&](std::chrono::nanoseconds t) {
+			return std::chrono::duration<double, std::milli>(t).count() / count;
+		};
+		auto average = [&](std::uint64_t c) {
+			return static_cast<double>(c) / count;
+		};
+
+		ImGui::PlotLines("Step Cost History", step_costs.data(), static_cast<int>(step_costs.size()));
+		ImGui::LabelText("Prediction", "%.3fms", average_ms(sum.timings.prediction));
+		ImGui::LabelText("Collision Detection", "%.3fms", average_ms(sum.timings.collision_detection));
+		ImGui::LabelText("Position Solve", "%.3fms", average_ms(sum.timings.position_solve));
+		ImGui::LabelText("Velocity Update", "%.3fms", average_ms(sum.timings.velocity_update));
+		ImGui::LabelText("Velocity Solve", "%.3fms", average_ms(sum.timings.velocity_solve));
+		ImGui::LabelText("Sleep Update", "%.3fms", average_ms(sum.timings.sleep_update));
+		ImGui::LabelText("Pairs Tested", "%.1f", average(sum.counters.body_pairs_tested));
+		ImGui::LabelText("GJK Calls", "%.1f", average(sum.counters.gjk_calls));
+		ImGui::LabelText("GJK Support Queries", "%.1f", average(sum.counters.gjk_support_queries));
+		ImGui::LabelText("EPA Iterations", "%.1f", average(sum.counters.epa_iterations));
+		ImGui::LabelText("EPA Fallbacks", "%.1f", average(sum.counters.epa_fallbacks));
+		ImGui::LabelText(
+			"Peak Narrow Phase Scratch", "%llu bytes",
+			static_cast<unsigned long long>(sum.counters.peak_narrow_phase_scratch_bytes)
+		);
+		ImGui::LabelText("Contacts", "%.1f", average(sum.counters.contacts_generated));
+		ImGui::LabelText(
+			"Matched / Created / Dropped", "%.1f / %.1f / %.1f",
+			average(sum.counters.contacts_matched), average(sum.counters.contacts_created),
+			average(sum.counters.contacts_dropped)
+		);
+		ImGui::LabelText(
+			"Active / Sleeping Bodies", "%.1f / %.1f",
+			average(sum.counters.active_bodies), average(sum.counters.sleeping_bodies)
+		);
+		ImGui::LabelText("Islands", "%.1f", average(sum.counters.islands));
+		ImGui::LabelText("Split Islands", "%.1f", average(sum.counters.split_islands));
+		ImGui::LabelText("Constraints / Iteration", "%.1f", sum.counters.get_constraints_per_iteration());
+		ImGui::LabelText("Particle Collision Tests", "%.1f", average(sum.counters.particle_collision_tests));
+		ImGui::LabelText("Self Collisions", "%.1f", average(sum.counters.self_collisions));
+	}
+
 	void _reset_camera() {
 		_test_context.camera_params = lotus::camera_parameters<scalar>::create_look_at(lotus::zero, { 3.0, 4.0, 5.0 }, { 0.0, 1.0, 0.0 }, _get_window_size()[0] / std::max<scalar>(1.0f, static_cast<scalar>(_get_window_size()[1])));
 		_test_context.update_camera();
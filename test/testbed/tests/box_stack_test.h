@@ -2,6 +2,8 @@
 
 #include <lotus/physics/engine.h>
 
+#include <physics_scenes.h>
+
 #include "test.h"
 
 class box_stack_test : public test {
@@ -11,7 +13,7 @@ public:
 	}
 
 	void timestep(double dt, std::size_t iters) override {
-		_engine.timestep(dt, iters);
+		_timestep_engine(_engine, dt, iters);
 	}
 
 	void render(
@@ -25,144 +27,66 @@ public:
 
 	void soft_reset() override {
 		_engine = lotus::physics::engine();
-		_engine.gravity = vec3(0.0, -9.8, 0.0);
+		_engine.contact_warm_starting = _warm_start_contacts;
+		_engine.collision_pair_caching = _cache_gjk_results;
+		_engine.sleeping_enabled = _sleep;
+		_engine.worker_pool = _get_test_context().worker_pool;
 
 		_render = debug_render();
 		_render.ctx = &_get_test_context();
 
-		auto &plane = _engine.shapes.emplace_back(lotus::collision::shape::create(lotus::collision::shapes::plane()));
-
-		auto &box_shape = _engine.shapes.emplace_back();
-		auto &box = box_shape.value.emplace<lotus::collision::shapes::polyhedron>();
-		vec3 half_size(_box_size[0], _box_size[1], _box_size[2]);
-		half_size *= 0.5;
-		box.vertices.emplace_back( half_size[0],  half_size[1],  half_size[2]);
-		box.vertices.emplace_back( half_size[0],  half_size[1], -half_size[2]);
-		box.vertices.emplace_back( half_size[0], -half_size[1],  half_size[2]);
-		box.vertices.emplace_back( half_size[0], -half_size[1], -half_size[2]);
-		box.vertices.emplace_back(-half_size[0],  half_size[1],  half_size[2]);
-		box.vertices.emplace_back(-half_size[0],  half_size[1], -half_size[2]);
-		box.vertices.emplace_back(-half_size[0], -half_size[1],  half_size[2]);
-		box.vertices.emplace_back(-half_size[0], -half_size[1], -half_size[2]);
-		auto box_props = box.bake(1.0);
-
-		auto &bullet_shape = _engine.shapes.emplace_front();
-		_bullet_shape = _engine.shapes.begin();
-		auto &bullet = bullet_shape.value.emplace<lotus::collision::shapes::polyhedron>();
-		vec3 half_bullet_size(0.05, 0.05, 0.05);
-		bullet.vertices.emplace_back(half_bullet_size[0], half_bullet_size[1], half_bullet_size[2]);
-		bullet.vertices.emplace_back(half_bullet_size[0], half_bullet_size[1], -half_bullet_size[2]);
-		bullet.vertices.emplace_back(half_bullet_size[0], -half_bullet_size[1], half_bullet_size[2]);
-		bullet.vertices.emplace_back(half_bullet_size[0], -half_bullet_size[1], -half_bullet_size[2]);
-		bullet.vertices.emplace_back(-half_bullet_size[0], half_bullet_size[1], half_bullet_size[2]);
-		bullet.vertices.emplace_back(-half_bullet_size[0], half_bullet_size[1], -half_bullet_size[2]);
-		bullet.vertices.emplace_back(-half_bullet_size[0], -half_bullet_size[1], half_bullet_size[2]);
-		bullet.vertices.emplace_back(-half_bullet_size[0], -half_bullet_size[1], -half_bullet_size[2]);
-		_bullet_properties = bullet.bake(10.0);
-
-		auto material = lotus::physics::material_properties(
-			_static_friction, _dynamic_friction, _restitution
-		);
-
-		_engine.bodies.emplace_back(lotus::physics::body::create(
-			plane, material,
-			lotus::physics::body_properties::kinematic(),
-			lotus::physics::body_state::stationary_at(
-				lotus::zero, lotus::quat::from_normalized_axis_angle(vec3(1.0, 0.0, 0.0), -0.5 * lotus::physics::pi)
-			)
-		));
-		_engine.bodies.emplace_back(lotus::physics::body::create(
-			plane, material,
-			lotus::physics::body_properties::kinematic(),
-			lotus::physics::body_state::stationary_at(
-				vec3(10.0, 0.0, 0.0),
-				lotus::quat::from_normalized_axis_angle(vec3(0.0, 1.0, 0.0), -0.5 * lotus::physics::pi)
-			)
-		));
-		_engine.bodies.emplace_back(lotus::physics::body::create(
-			plane, material,
-			lotus::physics::body_properties::kinematic(),
-			lotus::physics::body_state::stationary_at(
-				vec3(-10.0, 0.0, 0.0),
-				lotus::quat::from_normalized_axis_angle(vec3(0.0, 1.0, 0.0), 0.5 * lotus::physics::pi)
-			)
-		));
-		_engine.bodies.emplace_back(lotus::physics::body::create(
-			plane, material,
-			lotus::physics::body_properties::kinematic(),
-			lotus::physics::body_state::stationary_at(
-				vec3(0.0, 0.0, 10.0),
-				lotus::quat::from_normalized_axis_angle(vec3(0.0, 1.0, 0.0), lotus::physics::pi)
-			)
-		));
-		_engine.bodies.emplace_back(lotus::physics::body::create(
-			plane, material,
-			lotus::physics::body_properties::kinematic(),
-			lotus::physics::body_state::stationary_at(
-				vec3(0.0, 0.0, -10.0), uquats::identity()
-			)
-		));
-
-		double x = -(_box_size[0] + _gap[0]) * (_box_count[0] - 1) / 2.0;
-		double y = 0.5 * _box_size[1] + _gap[1];
-		for (
-			int yi = 0;
-			yi < _box_count[1];
-			++yi, y += _box_size[1] + _gap[1], x += 0.5 * (_box_size[0] + _gap[0])
-		) {
-			double cx = x;
-			for (int xi = 0; xi + yi < _box_count[0]; ++xi, cx += _box_size[0] + _gap[0]) {
-				lotus::physics::body_state state = lotus::uninitialized;
-				if (_rotate_90) {
-					state = lotus::physics::body_state::stationary_at(
-						vec3(0.0, y, cx),
-						lotus::quat::from_normalized_axis_angle(vec3(0.0, 1.0, 0.0), 0.5 * lotus::physics::pi)
-					);
-				} else {
-					state = lotus::physics::body_state::stationary_at(
-						vec3(cx, y, 0.0), uquats::identity()
-					);
-				}
-				_engine.bodies.emplace_back(lotus::physics::body::create(
-					box_shape, material,
-					_fix_first_row && yi == 0 ? lotus::physics::body_properties::kinematic() : box_props,
-					state
-				));
-			}
-		}
+		_scene.build(_engine);
+	}
 
-		if (_inverse_list) {
-			_engine.bodies.reverse();
-		}
+	[[nodiscard]] const lotus::physics::engine *get_engine() const override {
+		return &_engine;
 	}
 
 	void gui() override {
-		ImGui::SliderInt2("Box Count", _box_count, 1, 20);
-		ImGui::SliderFloat3("Box Size", _box_size, 0.0f, 2.0f, "%.1f");
-		ImGui::SliderFloat2("Gap", _gap, 0.0f, 0.1f);
-		ImGui::Checkbox("Rotate 90 Degrees", &_rotate_90);
-		ImGui::Checkbox("Inverse Body List", &_inverse_list);
-		ImGui::Checkbox("Fix First Row", &_fix_first_row);
+		if (ImGui::Combo("Broad Phase", &_scene.broad_phase, "Brute Force\0Sweep and Prune\0Dynamic AABB Tree\0\0")) {
+			_engine.body_broad_phase = lotus::collision::broad_phase::create(
+				static_cast<lotus::collision::broad_phase::type>(_scene.broad_phase)
+			);
+		}
+
+		ImGui::SliderInt2("Box Count", _scene.box_count, 1, 20);
+		ImGui::SliderInt("Pile Count", &_scene.pile_count, 1, 16);
+		ImGui::SliderFloat3("Box Size", _scene.box_size, 0.0f, 2.0f, "%.1f");
+		ImGui::SliderFloat2("Gap", _scene.gap, 0.0f, 0.1f);
+		ImGui::Checkbox("Rotate 90 Degrees", &_scene.rotate_90);
+		ImGui::Checkbox("Inverse Body List", &_scene.inverse_list);
+		ImGui::Checkbox("Fix First Row", &_scene.fix_first_row);
+
+		if (ImGui::Checkbox("Warm Start Contacts", &_warm_start_contacts)) {
+			_engine.contact_warm_starting = _warm_start_contacts;
+		}
+		if (ImGui::Checkbox("Cache GJK Results", &_cache_gjk_results)) {
+			_engine.collision_pair_caching = _cache_gjk_results;
+		}
+		if (ImGui::Checkbox("Sleep", &_sleep)) {
+			_engine.sleeping_enabled = _sleep;
+		}
 
 		ImGui::Separator();
-		ImGui::SliderFloat("Static Friction", &_static_friction, 0.0f, 1.0f);
-		ImGui::SliderFloat("Dynamic Friction", &_dynamic_friction, 0.0f, 1.0f);
-		ImGui::SliderFloat("Restitution", &_restitution, 0.0f, 1.0f);
-		ImGui::SliderFloat("Box Density", &_density, 0.0f, 100.0f);
+		ImGui::SliderFloat("Static Friction", &_scene.static_friction, 0.0f, 1.0f);
+		ImGui::SliderFloat("Dynamic Friction", &_scene.dynamic_friction, 0.0f, 1.0f);
+		ImGui::SliderFloat("Restitution", &_scene.restitution, 0.0f, 1.0f);
+		ImGui::SliderFloat("Box Density", &_scene.density, 0.0f, 100.0f);
 
 		ImGui::Separator();
+		ImGui::Checkbox("Continuous Collision", &_continuous_collision);
 		if (ImGui::Button("Shoot Box")) {
-			auto material = lotus::physics::material_properties(_static_friction, _dynamic_friction, _restitution);
-			_engine.bodies.emplace_back(lotus::physics::body::create(
-				*_bullet_shape,
-				material,
-				_bullet_properties,
+			auto &&[handle, bullet] = _engine.bodies.allocate(lotus::physics::body::create(
+				*_scene.bullet_shape_iter,
+				_scene.material(),
+				_scene.bullet_properties,
 				lotus::physics::body_state::at(
 					_get_test_context().camera_params.position,
 					uquats::identity(),
 					_get_test_context().camera.unit_forward * 50.0, lotus::zero
 				)
 			));
+			bullet.continuous_collision = _continuous_collision;
 		}
 		test::gui();
 	}
@@ -174,19 +98,10 @@ protected:
 	lotus::physics::engine _engine;
 	debug_render _render;
 
-	bool _rotate_90 = false;
-	bool _inverse_list = false;
-	bool _fix_first_row = false;
-
-	float _static_friction = 0.4;
-	float _dynamic_friction = 0.35;
-	float _restitution = 0.0;
-
-	float _density = 1.0f;
-	float _box_size[3]{ 1.0f, 0.2f, 0.6f };
-	float _gap[2]{ 0.02f, 0.02f };
-	int _box_count[2]{ 5, 3 };
+	bool _warm_start_contacts = false;
+	bool _cache_gjk_results = true;
+	bool _sleep = false;
+	bool _continuous_collision = true; ///< Whether shot boxes use continuous collision detection.
 
-	std::deque<lotus::collision::shape>::iterator _bullet_shape;
-	lotus::physics::body_properties _bullet_properties = lotus::uninitialized;
+	physics_scenes::box_stack _scene;
 };
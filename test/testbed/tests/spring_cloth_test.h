@@ -2,6 +2,8 @@
 
 #include <lotus/physics/engine.h>
 
+#include <physics_scenes.h>
+
 #include "test.h"
 #include "../utils.h"
 
@@ -13,85 +15,29 @@ public:
 
 	void soft_reset() override {
 		_engine = lotus::physics::engine();
-		_engine.gravity = { 0.0, -10.0, 0.0 };
+		_engine.particle_constraint_ordering =
+			static_cast<lotus::physics::engine::constraint_ordering>(_constraint_ordering);
+		_engine.particle_storage_layout =
+			static_cast<lotus::physics::engine::particle_layout>(_particle_layout);
+		_engine.worker_pool = _get_test_context().worker_pool;
+		_engine.particle_self_collision = _self_collision;
+		_engine.self_collision_thickness = _self_collision_thickness;
 
 		_render = debug_render();
 		_render.ctx = &_get_test_context();
 
 		_world_time = 0.0;
 
-
-		double cloth_mass = _cloth_density * _cloth_size * _cloth_size * 0.001; // assume 1mm thick
-		double node_mass = cloth_mass / (_side_segments * _side_segments);
-		double segment_length = _cloth_size / static_cast<double>(_side_segments - 1);
-
+		_scene.build(_engine);
 		auto &surface = _render.surfaces.emplace_back();
 		surface.color = lotus::linear_rgba_f(1.0f, 0.4f, 0.2f, 0.5f);
-		std::vector<std::vector<std::uint32_t>> pid(
-			static_cast<std::size_t>(_side_segments),
-			std::vector<std::uint32_t>(static_cast<std::size_t>(_side_segments)));
-		for (int y = 0; y < _side_segments; ++y) {
-			for (int x = 0; x < _side_segments; ++x) {
-				auto prop = lotus::physics::particle_properties::from_mass(node_mass);
-				if (x == 0 && (y == 0 || y == _side_segments - 1)) {
-					prop = lotus::physics::particle_properties::kinematic();
-				}
-				auto state = lotus::physics::particle_state::stationary_at(
-					{ x * segment_length, _cloth_size, y * segment_length - 0.5 * _cloth_size }
-				);
-				pid[x][y] = static_cast<std::uint32_t>(_engine.particles.size());
-				_engine.particles.emplace_back(lotus::physics::particle::create(prop, state));
-			}
-		}
-		for (int y = 0; y < _side_segments; ++y) {
-			for (int x = 0; x < _side_segments; ++x) {
-				if (x > 0) {
-					_add_spring(pid[x - 1][y], pid[x][y], _youngs_modulus_short);
-					if (x > 1) {
-						_add_spring(pid[x - 2][y], pid[x][y], _youngs_modulus_long);
-					}
-
-				}
-
-				if (y > 0) {
-					_add_spring(pid[x][y - 1], pid[x][y], _youngs_modulus_short);
-					if (y > 1) {
-						_add_spring(pid[x][y - 2], pid[x][y], _youngs_modulus_long);
-					}
-				}
-
-				if (x > 0 && y > 0) {
-					_add_spring(pid[x - 1][y - 1], pid[x][y], _youngs_modulus_diag);
-					_add_spring(pid[x - 1][y], pid[x][y - 1], _youngs_modulus_diag);
-
-					surface.triangles.append_range(std::vector{ pid[x - 1][y - 1], pid[x - 1][y], pid[x][y - 1] });
-					surface.triangles.append_range(std::vector{ pid[x][y - 1], pid[x - 1][y], pid[x][y] });
-				}
-			}
-		}
-
-		auto &sphere_shape = _engine.shapes.emplace_back(
-			lotus::collision::shape::create(lotus::collision::shapes::sphere::from_radius(0.25))
-		);
-
-		auto material = lotus::physics::material_properties(0.5, 0.45, 0.2);
-
-		_engine.bodies.emplace_front(lotus::physics::body::create(
-			sphere_shape, material,
-			lotus::physics::body_properties::kinematic(),
-			lotus::physics::body_state::stationary_at(lotus::zero, uquats::identity())
-		));
-		_sphere = _engine.bodies.begin();
+		surface.triangles = _scene.triangles;
 	}
 
 	void timestep(double dt, std::size_t iterations) override {
 		_world_time += dt;
-		_sphere->state.position = {
-			_sphere_travel * std::cos((2.0 * lotus::physics::pi / _sphere_period) * _world_time),
-			_sphere_yz[0],
-			_sphere_yz[1]
-		};
-		_engine.timestep(dt, iterations);
+		_scene.update_kinematics(_engine, _world_time);
+		_timestep_engine(_engine, dt, iterations);
 	}
 
 	void render(
@@ -103,27 +49,45 @@ public:
 		_render.flush(ctx, q, uploader, color, depth, size);
 	}
 
+	[[nodiscard]] const lotus::physics::engine *get_engine() const override {
+		return &_engine;
+	}
+
 	void gui() override {
-		ImGui::SliderInt("Cloth Partitions", &_side_segments, 2, 100);
-		ImGui::SliderFloat("Cloth Size", &_cloth_size, 0.0f, 3.0f);
-		ImGui::SliderFloat("Cloth Density", &_cloth_density, 0.0f, 20000.0f);
+		if (ImGui::Combo("Constraint Order", &_constraint_ordering, "Serial\0Colored Parallel\0\0")) {
+			_engine.particle_constraint_ordering =
+				static_cast<lotus::physics::engine::constraint_ordering>(_constraint_ordering);
+		}
+		if (ImGui::Combo("Particle Layout", &_particle_layout, "Array of Structures\0Structure of Arrays\0\0")) {
+			_engine.particle_storage_layout =
+				static_cast<lotus::physics::engine::particle_layout>(_particle_layout);
+		}
+		if (ImGui::Checkbox("Self Collision", &_self_collision)) {
+			_engine.particle_self_collision = _self_collision;
+		}
+		if (ImGui::SliderFloat("Self Collision Thickness", &_self_collision_thickness, 0.0f, 0.05f, "%.4f")) {
+			_engine.self_collision_thickness = _self_collision_thickness;
+		}
+		ImGui::SliderInt("Cloth Partitions", &_scene.side_segments, 2, 100);
+		ImGui::SliderFloat("Cloth Size", &_scene.cloth_size, 0.0f, 3.0f);
+		ImGui::SliderFloat("Cloth Density", &_scene.cloth_density, 0.0f, 20000.0f);
 		ImGui::SliderFloat(
-			"Young's Modulus - Short", &_youngs_modulus_short, 0.0f, 1000000000.0f,
+			"Young's Modulus - Short", &_scene.youngs_modulus_short, 0.0f, 1000000000.0f,
 			"%f", ImGuiSliderFlags_Logarithmic
 		);
 		ImGui::SliderFloat(
-			"Young's Modulus - Diagonal", &_youngs_modulus_diag, 0.0f, 1000000000.0f,
+			"Young's Modulus - Diagonal", &_scene.youngs_modulus_diag, 0.0f, 1000000000.0f,
 			"%f", ImGuiSliderFlags_Logarithmic
 		);
 		ImGui::SliderFloat(
-			"Young's Modulus - Long", &_youngs_modulus_long, 0.0f, 1000000000.0f,
+			"Young's Modulus - Long", &_scene.youngs_modulus_long, 0.0f, 1000000000.0f,
 			"%f", ImGuiSliderFlags_Logarithmic
 		);
 		ImGui::Separator();
 
-		ImGui::SliderFloat("Sphere Travel Distance", &_sphere_travel, 0.0f, 3.0f);
-		ImGui::SliderFloat("Sphere Period", &_sphere_period, 0.1f, 10.0f);
-		ImGui::SliderFloat2("Sphere Position", _sphere_yz, -10.0, 10.0);
+		ImGui::SliderFloat("Sphere Travel Distance", &_scene.sphere_travel, 0.0f, 3.0f);
+		ImGui::SliderFloat("Sphere Period", &_scene.sphere_period, 0.1f, 10.0f);
+		ImGui::SliderFloat2("Sphere Position", _scene.sphere_yz, -10.0, 10.0);
 		ImGui::Separator();
 
 		test::gui();
@@ -137,26 +101,10 @@ protected:
 	debug_render _render;
 	double _world_time = 0.0;
 
-	int _side_segments = 30;
-	float _cloth_size = 1.0f;
-	float _cloth_density = 1200.0f;
+	int _constraint_ordering = 0;
+	int _particle_layout = 0;
+	bool _self_collision = false;
+	float _self_collision_thickness = 0.005f;
 
-	float _youngs_modulus_short = 50000.0f;
-	float _youngs_modulus_diag = 50000.0f;
-	float _youngs_modulus_long = 50000.0f;
-
-	std::list<lotus::physics::body>::iterator _sphere;
-	float _sphere_travel = 1.5f;
-	float _sphere_period = 3.0f;
-	float _sphere_yz[2]{ 0.5f, 0.0f };
-
-
-	void _add_spring(std::size_t i1, std::size_t i2, double y) {
-		auto &spring = _engine.particle_spring_constraints.emplace_back(lotus::uninitialized);
-		spring.particle1 = i1;
-		spring.particle2 = i2;
-		spring.properties.length =
-			(_engine.particles[i1].state.position - _engine.particles[i2].state.position).norm();
-		spring.properties.inverse_stiffness = 1.0 / (spring.properties.length * y);
-	}
+	physics_scenes::spring_cloth _scene;
 };
@@ -31,6 +31,10 @@ public:
 		lotus::renderer::context&, lotus::renderer::context::queue&, lotus::renderer::constant_uploader&,
 		lotus::renderer::image2d_color, lotus::renderer::image2d_depth_stencil, lotus::cvec2u32 size
 	) = 0;
+	/// Returns the physics engine used by this test, if any, so that its statistics can be displayed.
+	[[nodiscard]] virtual const lotus::physics::engine *get_engine() const {
+		return nullptr;
+	}
 	/// Displays the test-specific GUI.
 	virtual void gui() {
 		if (ImGui::Button("Soft Reset")) {
@@ -42,6 +46,19 @@ protected:
 	const test_context &_get_test_context() const {
 		return *_test_context;
 	}
+	/// Executes one time step of the engine, using substeps if they're enabled in the test context.
+	void _timestep_engine(lotus::physics::engine &engine, double dt, std::size_t iterations) const {
+		const test_context &ctx = _get_test_context();
+		if (ctx.substeps > 1) {
+			engine.substep_collision_detection = ctx.substep_collision_detection;
+			engine.timestep_substepped(
+				static_cast<scalar>(dt), static_cast<std::uint32_t>(ctx.substeps),
+				static_cast<std::uint32_t>(iterations)
+			);
+		} else {
+			engine.timestep(static_cast<scalar>(dt), static_cast<std::uint32_t>(iterations));
+		}
+	}
 private:
 	const test_context *_test_context; ///< The test context.
 };
@@ -6,6 +6,7 @@
 #include <lotus/color.h>
 #include <lotus/math/vector.h>
 #include <lotus/utils/camera.h>
+#include <lotus/utils/thread_pool.h>
 #include <lotus/physics/engine.h>
 #include <lotus/renderer/context/asset_manager.h>
 
@@ -27,6 +28,12 @@ struct test_context {
 	bool draw_body_velocities = true;
 	bool draw_contacts = false;
 
+	int substeps = 1;
+	lotus::physics::engine::collision_detection_cadence substep_collision_detection =
+		lotus::physics::engine::collision_detection_cadence::once_per_frame;
+
+	lotus::thread_pool *worker_pool = nullptr;
+
 	void update_camera() {
 		camera = camera_params.into_camera();
 	}